@@ -0,0 +1,149 @@
+/***********************************************************************
+ allocs.cpp - Counts the heap allocations Query::store() makes for
+	each row of a result, in each of the ways it can hold the values:
+	copying each into its own block, copying them all into an Arena,
+	reusing the Arena's blocks through an ArenaRecycler, and pointing
+	into the C API's copy of the rows.
+
+ Copyright (c) 2009 by Educational Technology Resources, Inc.
+ Others may also hold copyrights on code in this file.  See the
+ CREDITS.txt file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#include "cmdline.h"
+
+#include <mysql++.h>
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+
+using namespace std;
+
+// The stock table joined with itself enough times to make a result of
+// a few hundred rows
+static const char* query_text =
+		"SELECT a.item, b.num, c.weight, d.price, a.sdate "
+		"FROM stock a, stock b, stock c, stock d";
+
+// How many times to run the query each way
+static const int runs = 10;
+
+
+// Count every heap allocation the program makes
+static unsigned long allocations = 0;
+
+#if __cplusplus >= 201103L
+#	define NEW_THROWS
+#	define DELETE_THROWS noexcept
+#else
+#	define NEW_THROWS throw (std::bad_alloc)
+#	define DELETE_THROWS throw ()
+#endif
+
+void*
+operator new(size_t n) NEW_THROWS
+{
+	++allocations;
+	if (void* p = malloc(n ? n : 1)) {
+		return p;
+	}
+	throw std::bad_alloc();
+}
+
+void*
+operator new[](size_t n) NEW_THROWS
+{
+	return operator new(n);
+}
+
+void
+operator delete(void* p) DELETE_THROWS
+{
+	free(p);
+}
+
+void
+operator delete[](void* p) DELETE_THROWS
+{
+	free(p);
+}
+
+
+// Run the query several times on the given connection, reporting the
+// allocations store() made per row, on average
+static void
+report(mysqlpp::Connection& conn, const char* what)
+{
+	unsigned long total = 0;
+	size_t rows = 0;
+	for (int i = 0; i < runs; ++i) {
+		mysqlpp::Query query = conn.query(query_text);
+		unsigned long before = allocations;
+		mysqlpp::StoreQueryResult res = query.store();
+		total += allocations - before;
+		rows += res.num_rows();
+	}
+
+	cout << setw(20) << left << what << fixed << setprecision(2) <<
+			setw(8) << right << (rows ? double(total) / rows : 0.0) <<
+			" allocations per row" << endl;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+	// Get database access parameters from command line
+	mysqlpp::examples::CommandLine cmdline(argc, argv);
+	if (!cmdline) {
+		return 1;
+	}
+
+	try {
+		mysqlpp::Connection conn(mysqlpp::examples::db_name,
+				cmdline.server(), cmdline.user(), cmdline.pass());
+
+		// The default: each value in its own heap block
+		report(conn, "copied values");
+
+		// Each result's values in one arena, with nothing recycled
+		mysqlpp::ArenaRecycler fresh(64 * 1024, 0);
+		conn.set_arena_recycler(&fresh);
+		report(conn, "arena");
+
+		// As above, but each run reuses the blocks of the one before
+		mysqlpp::ArenaRecycler recycler;
+		conn.set_arena_recycler(&recycler);
+		report(conn, "recycled arena");
+		conn.set_arena_recycler(0);
+
+		// No copies at all
+		conn.set_zero_copy();
+		report(conn, "zero-copy");
+	}
+	catch (const mysqlpp::Exception& er) {
+		cerr << "Error: " << er.what() << endl;
+		return 1;
+	}
+
+	return 0;
+}
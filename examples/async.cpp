@@ -0,0 +1,148 @@
+/***********************************************************************
+ async.cpp - Example showing how to run queries on many connections at
+	once from a single thread, using the non-blocking operations and
+	the Reactor.
+
+ Copyright (c) 2009 by Educational Technology Resources, Inc.  Others
+ may also hold copyrights on code in this file.  See the CREDITS.txt
+ file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#include "cmdline.h"
+
+#include <mysql++.h>
+
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+#if defined(MYSQLPP_HAVE_REACTOR)
+// Number of connections to run queries on at once
+static const size_t num_conns = 20;
+
+// Each connection's query counts the rows in the stock table, with a
+// bit of server-side delay so the queries overlap visibly.
+class StockCount : public mysqlpp::AsyncQuery
+{
+public:
+	StockCount(mysqlpp::Connection* c, size_t id) :
+	mysqlpp::AsyncQuery(c),
+	id_(id)
+	{
+	}
+
+	void finished()
+	{
+		if (status() == succeeded) {
+			cout << "Connection " << id_ << ": " <<
+					result()[0][0] << " items" << endl;
+		}
+		else {
+			cerr << "Connection " << id_ << " query failed: " <<
+					error() << endl;
+		}
+	}
+
+private:
+	size_t id_;
+};
+
+
+// Once each connection comes up, its finished() starts the query on it
+class Connector : public mysqlpp::AsyncConnect
+{
+public:
+	Connector(mysqlpp::Connection* c,
+			const mysqlpp::examples::CommandLine& cmdline,
+			mysqlpp::Reactor& reactor, StockCount& query) :
+	mysqlpp::AsyncConnect(c, mysqlpp::examples::db_name,
+			cmdline.server(), cmdline.user(), cmdline.pass()),
+	reactor_(reactor),
+	query_(query)
+	{
+	}
+
+	void finished()
+	{
+		if (status() == succeeded) {
+			query_.start("SELECT COUNT(*), SLEEP(0.1) FROM stock");
+			reactor_.add(query_);
+		}
+		else {
+			cerr << "Connection failed: " << error() << endl;
+		}
+	}
+
+private:
+	mysqlpp::Reactor& reactor_;
+	StockCount& query_;
+};
+#endif
+
+
+int
+main(int argc, char *argv[])
+{
+	// Get database access parameters from command line
+	mysqlpp::examples::CommandLine cmdline(argc, argv);
+	if (!cmdline) {
+		return 1;
+	}
+
+#if defined(MYSQLPP_HAVE_REACTOR)
+	try {
+		// Set up the connections and their operations.  The Reactor
+		// doesn't own any of these, so they must outlive its run().
+		vector<mysqlpp::Connection*> conns;
+		vector<StockCount*> queries;
+		vector<Connector*> connectors;
+		mysqlpp::Reactor reactor;
+		for (size_t i = 0; i < num_conns; ++i) {
+			conns.push_back(new mysqlpp::Connection(false));
+			queries.push_back(new StockCount(conns.back(), i));
+			connectors.push_back(new Connector(conns.back(), cmdline,
+					reactor, *queries.back()));
+			connectors.back()->start();
+			reactor.add(*connectors.back());
+		}
+
+		// Connect and run all the queries from this one thread.  They
+		// should take about as long as one of them would alone.
+		reactor.run();
+
+		for (size_t i = 0; i < num_conns; ++i) {
+			delete connectors[i];
+			delete queries[i];
+			delete conns[i];
+		}
+	}
+	catch (const mysqlpp::Exception& er) {
+		cerr << "Error: " << er.what() << endl;
+		return 1;
+	}
+
+	return 0;
+#else
+	cerr << "This example needs MySQL++ built against MySQL 8.0.16 or "
+			"newer, on Linux." << endl;
+	return 1;
+#endif
+}
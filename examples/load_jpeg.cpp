@@ -89,6 +89,10 @@ load_jpeg_file(const mysqlpp::examples::CommandLine& cmdline,
 		img.data.data = static_cast<const stringstream*>(
 				&(stringstream() << img_file.rdbuf()))->str();
 
+		// Mark it as binary data, so it goes into the INSERT query as
+		// a compact hex literal instead of being escaped.
+		img.data.data.set_binary();
+
 		// Check JPEG data for sanity.
 		const char* error;
 		if (is_jpeg(img.data.data, &error)) {
@@ -0,0 +1,176 @@
+/***********************************************************************
+ pinsert.cpp - Compares the time it takes to insert many rows with a
+	single Query::insertfrom() call against splitting the job into
+	shards with ParallelInsert, in both of its commit modes.  Works on
+	a scratch copy of the stock table, which it removes afterward.
+
+ Copyright (c) 2009 by Educational Technology Resources, Inc.
+ Others may also hold copyrights on code in this file.  See the
+ CREDITS.txt file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#include "cmdline.h"
+#include "stock.h"
+
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+using namespace std;
+
+// How many rows to insert each way, and how many threads the parallel
+// runs use
+static const int num_rows = 100000;
+static const unsigned int num_threads = 4;
+
+
+// A ConnectionPool making connections to the sample database with the
+// parameters given on the command line
+class ExampleConnectionPool : public mysqlpp::ConnectionPool
+{
+public:
+	ExampleConnectionPool(mysqlpp::examples::CommandLine& cl) :
+	server_(cl.server() ? cl.server() : ""),
+	user_(cl.user() ? cl.user() : ""),
+	password_(cl.pass() ? cl.pass() : "")
+	{
+	}
+
+	~ExampleConnectionPool()
+	{
+		clear();
+	}
+
+protected:
+	mysqlpp::Connection* create()
+	{
+		return new mysqlpp::Connection(mysqlpp::examples::db_name,
+				server_.empty() ? 0 : server_.c_str(),
+				user_.empty() ? 0 : user_.c_str(),
+				password_.empty() ? "" : password_.c_str());
+	}
+
+	void destroy(mysqlpp::Connection* cp)
+	{
+		delete cp;
+	}
+
+	unsigned int max_idle_time()
+	{
+		return 60;
+	}
+
+private:
+	std::string server_, user_, password_;
+};
+
+
+// Empty the scratch table, and report how long the given insert took
+// and how many rows it left behind
+static void
+report(mysqlpp::Query& query, const char* what, double start,
+		bool ok)
+{
+	double elapsed = mysqlpp::internal::seconds_now() - start;
+	mysqlpp::StoreQueryResult res =
+			query.store("SELECT COUNT(*) FROM pinsert_stock");
+	cout << setw(16) << left << what << fixed << setprecision(3) <<
+			setw(8) << right << elapsed << " s  " <<
+			setw(8) << int(num_rows / elapsed) << " rows/s  " <<
+			res[0][0] << " rows" << (ok ? "" : " (FAILED)") << endl;
+	query.exec("TRUNCATE TABLE pinsert_stock");
+}
+
+
+int
+main(int argc, char *argv[])
+{
+	// Get database access parameters from command line
+	mysqlpp::examples::CommandLine cmdline(argc, argv);
+	if (!cmdline) {
+		return 1;
+	}
+
+	// Make up the rows to insert
+	vector<stock> items;
+	for (int i = 0; i < num_rows; ++i) {
+		ostringstream name;
+		name << "Item " << i;
+		items.push_back(stock(name.str(), i, i / 100.0,
+				mysqlpp::sql_double_null(i / 10.0),
+				mysqlpp::sql_date("2009-03-01"),
+				mysqlpp::sql_mediumtext_null(mysqlpp::null)));
+	}
+	stock::table("pinsert_stock");
+
+	try {
+		mysqlpp::Connection con(mysqlpp::examples::db_name,
+				cmdline.server(), cmdline.user(), cmdline.pass());
+		mysqlpp::Query query = con.query();
+		query.exec("DROP TABLE IF EXISTS pinsert_stock");
+		query.exec("CREATE TABLE pinsert_stock LIKE stock");
+
+		// Each way uses the same policy: statements as big as the
+		// server allows
+		mysqlpp::Query::MaxPacketInsertPolicy<> policy(
+				int(mysqlpp::internal::max_allowed_packet(&con)));
+
+		// The baseline: one connection, one thread
+		double start = mysqlpp::internal::seconds_now();
+		query.insertfrom(items.begin(), items.end(), policy);
+		report(query, "serial", start, true);
+
+		ExampleConnectionPool pool(cmdline);
+		mysqlpp::QueryExecutor executor(pool, num_threads);
+		if (executor.threads() == 0) {
+			cout << "MySQL++ was built without thread support, so the "
+					"shards below run one at a time." << endl;
+		}
+
+		// Each shard commits independently
+		mysqlpp::ParallelInsert ps(executor,
+				mysqlpp::ParallelInsert::per_shard);
+		start = mysqlpp::internal::seconds_now();
+		bool ok = ps.insertfrom(items.begin(), items.end(), policy);
+		report(query, "per-shard", start, ok);
+
+		// The shards commit together, or not at all
+		mysqlpp::ParallelInsert an(executor,
+				mysqlpp::ParallelInsert::all_or_nothing);
+		start = mysqlpp::internal::seconds_now();
+		ok = an.insertfrom(items.begin(), items.end(), policy);
+		report(query, "all-or-nothing", start, ok);
+		for (size_t i = 0; i < an.results().size(); ++i) {
+			if (!an.results()[i].error().empty()) {
+				cerr << "Shard " << i << ": " <<
+						an.results()[i].error() << endl;
+			}
+		}
+
+		query.exec("DROP TABLE pinsert_stock");
+	}
+	catch (const mysqlpp::Exception& er) {
+		cerr << "Error: " << er.what() << endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,190 @@
+/***********************************************************************
+ arena.cpp - Implements the Arena and ArenaRecycler classes.
+
+ Copyright (c) 2009 by Educational Technology Resources, Inc.
+ Others may also hold copyrights on code in this file.  See the
+ CREDITS.txt file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#define MYSQLPP_NOT_HEADER
+#include "common.h"
+
+#include "arena.h"
+
+#include <string.h>
+
+namespace mysqlpp {
+
+// Block size for arenas not using a recycler
+static const size_t default_block_size = 64 * 1024;
+
+// Alignment place() gives, enough for anything SQLBuffer holds
+static const size_t alignment = sizeof(double) > sizeof(void*) ?
+		sizeof(double) : sizeof(void*);
+
+
+ArenaRecycler::ArenaRecycler(size_t block_size, size_t max_kept) :
+block_size_(block_size),
+max_kept_(max_kept)
+{
+	blocks_.reserve(max_kept);
+}
+
+
+ArenaRecycler::~ArenaRecycler()
+{
+	for (size_t i = 0; i < blocks_.size(); ++i) {
+		delete[] blocks_[i];
+	}
+}
+
+
+void
+ArenaRecycler::give(char* block)
+{
+	{
+		ScopedLock lock(mutex_);
+		if (blocks_.size() < max_kept_) {
+			blocks_.push_back(block);
+			return;
+		}
+	}
+
+	delete[] block;
+}
+
+
+size_t
+ArenaRecycler::kept() const
+{
+	ScopedLock lock(mutex_);
+	return blocks_.size();
+}
+
+
+char*
+ArenaRecycler::take()
+{
+	{
+		ScopedLock lock(mutex_);
+		if (!blocks_.empty()) {
+			char* block = blocks_.back();
+			blocks_.pop_back();
+			return block;
+		}
+	}
+
+	return new char[block_size_];
+}
+
+
+Arena::Arena(ArenaRecycler* recycler) :
+recycler_(recycler),
+block_size_(recycler ? recycler->block_size() : default_block_size),
+next_(0),
+left_(0)
+{
+}
+
+
+Arena::~Arena()
+{
+	for (size_t i = 0; i < blocks_.size(); ++i) {
+		if (recycler_) {
+			recycler_->give(blocks_[i]);
+		}
+		else {
+			delete[] blocks_[i];
+		}
+	}
+	for (size_t i = 0; i < big_.size(); ++i) {
+		delete[] big_[i];
+	}
+}
+
+
+char*
+Arena::allocate(size_t n)
+{
+	if (n > block_size_ / 4) {
+		// Too big to be worth a block of the standard size
+		char* block = new char[n];
+		try {
+			big_.push_back(block);
+		}
+		catch (...) {
+			delete[] block;
+			throw;
+		}
+		return block;
+	}
+	else if (n > left_) {
+		char* block = recycler_ ? recycler_->take() : new char[block_size_];
+		try {
+			blocks_.push_back(block);
+		}
+		catch (...) {
+			if (recycler_) {
+				recycler_->give(block);
+			}
+			else {
+				delete[] block;
+			}
+			throw;
+		}
+		next_ = block;
+		left_ = block_size_;
+	}
+
+	char* p = next_;
+	next_ += n;
+	left_ -= n;
+	return p;
+}
+
+
+char*
+Arena::copy(const char* data, size_t length)
+{
+	char* p = allocate(length + 1);
+	memcpy(p, data, length);
+	p[length] = '\0';
+	return p;
+}
+
+
+void*
+Arena::place(size_t n)
+{
+	// Blocks start out aligned, so pad from where this one started,
+	// moving on to a new block if the padding doesn't fit
+	const size_t pad = (alignment - (block_size_ - left_) % alignment) %
+			alignment;
+	if (pad + n <= left_) {
+		next_ += pad;
+		left_ -= pad;
+	}
+	else {
+		left_ = 0;
+	}
+	return allocate(n);
+}
+
+} // end namespace mysqlpp
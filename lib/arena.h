@@ -0,0 +1,154 @@
+/// \file arena.h
+/// \brief Declares the Arena and ArenaRecycler classes, which let a
+/// StoreQueryResult keep its values in a few large blocks of memory
+/// instead of one heap block per value.
+
+/***********************************************************************
+ Copyright (c) 2009 by Educational Technology Resources, Inc.
+ Others may also hold copyrights on code in this file.  See the
+ CREDITS.txt file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#if !defined(MYSQLPP_ARENA_H)
+#define MYSQLPP_ARENA_H
+
+#include "common.h"
+
+#include "beemutex.h"
+#include "sql_buffer.h"
+
+#include <vector>
+
+namespace mysqlpp {
+
+/// \brief Keeps the blocks of memory Arenas are done with, so the
+/// next ones can reuse them
+///
+/// Attach one to a connection with Connection::set_arena_recycler(),
+/// and Query::store() copies each result's values into an Arena built
+/// on it instead of giving each value its own heap block.  When the
+/// last value pointing into an Arena goes away, its blocks come back
+/// here, up to \c max_kept of them, so a program running the same
+/// kinds of queries over and over stops asking the heap for memory to
+/// hold their results.
+///
+/// One recycler per thread, next to that thread's Connection, keeps
+/// its blocks warm in that thread's cache, and its lock uncontended.
+/// The lock is still there because a result's values may be let go
+/// of in another thread.  Set \c max_kept to 0 to use arenas without
+/// keeping any blocks.
+///
+/// The recycler must outlive every Arena built on it, so keep it
+/// alive until all the results stored with it, and every String
+/// copied from them, are gone.
+
+class MYSQLPP_EXPORT ArenaRecycler
+{
+public:
+	/// \brief Create the recycler
+	///
+	/// \param block_size the size of the blocks Arenas using this
+	/// recycler allocate
+	/// \param max_kept the most free blocks to keep for reuse
+	ArenaRecycler(size_t block_size = 64 * 1024, size_t max_kept = 16);
+
+	/// \brief Destroy the recycler, freeing the blocks it kept
+	~ArenaRecycler();
+
+	/// \brief Return the size of the blocks this recycler deals in
+	size_t block_size() const { return block_size_; }
+
+	/// \brief Take back a block an Arena is done with
+	///
+	/// It's freed if the recycler already holds \c max_kept blocks.
+	void give(char* block);
+
+	/// \brief Return the number of free blocks waiting for reuse
+	size_t kept() const;
+
+	/// \brief Hand out a block of block_size() bytes, reusing a kept
+	/// one if there is one
+	char* take();
+
+private:
+	const size_t block_size_;
+	const size_t max_kept_;
+	std::vector<char*> blocks_;
+	mutable BeecryptMutex mutex_;
+
+	// Can't copy these
+	ArenaRecycler(const ArenaRecycler&);
+	ArenaRecycler& operator=(const ArenaRecycler&);
+};
+
+
+/// \brief Hands out memory from a few large blocks, all freed at once
+/// when the arena is destroyed
+///
+/// A StoreQueryResult built with an ArenaRecycler copies its values
+/// into one of these, and each value's String keeps the arena alive
+/// as its SQLBufferOwner.  The Strings' SQLBuffers, reference counts
+/// included, are put in the arena too, so a value costs no heap
+/// allocation of its own.  Anything bigger than a quarter of a block
+/// gets a block of its own, which is freed instead of recycled.
+
+class MYSQLPP_EXPORT Arena : public SQLBufferOwner
+{
+public:
+	/// \brief Create an empty arena
+	///
+	/// \param recycler where to get blocks from and return them to,
+	/// or 0 to use the heap directly
+	explicit Arena(ArenaRecycler* recycler = 0);
+
+	/// \brief Destroy the arena, returning all of its memory
+	~Arena();
+
+	/// \brief Return \c n bytes of memory, with no alignment
+	char* allocate(size_t n);
+
+	/// \brief Return the number of blocks the arena has allocated
+	size_t blocks() const { return blocks_.size() + big_.size(); }
+
+	/// \brief Copy \c length bytes into the arena, followed by a null
+	/// character, as SQLBuffer wants
+	char* copy(const char* data, size_t length);
+
+	/// \brief Return \c n bytes of memory aligned for any object,
+	/// for SQLBuffer::create() to build a buffer in
+	void* place(size_t n);
+
+private:
+	ArenaRecycler* recycler_;
+	const size_t block_size_;
+
+	std::vector<char*> blocks_;	///< blocks of block_size_ bytes
+	std::vector<char*> big_;	///< blocks too big to recycle
+	char* next_;				///< next free byte in the last block
+	size_t left_;				///< free bytes after next_
+
+	// Can't copy these
+	Arena(const Arena&);
+	Arena& operator=(const Arena&);
+};
+
+} // end namespace mysqlpp
+
+#endif // !defined(MYSQLPP_ARENA_H)
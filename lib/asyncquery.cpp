@@ -0,0 +1,229 @@
+/***********************************************************************
+ asyncquery.cpp - Implements the classes for non-blocking connections
+	and queries.
+
+ Copyright (c) 2009 by Educational Technology Resources, Inc.
+ Others may also hold copyrights on code in this file.  See the
+ CREDITS.txt file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#define MYSQLPP_NOT_HEADER
+#include "common.h"
+
+#include "asyncquery.h"
+
+#if defined(MYSQLPP_HAVE_NONBLOCKING)
+
+#include "connection.h"
+#include "dbdriver.h"
+#include "query.h"
+#include "resultcache.h"
+
+namespace mysqlpp {
+
+//// AsyncOperation ////////////////////////////////////////////////////
+
+AsyncOperation::Status
+AsyncOperation::begin()
+{
+	status_ = pending;
+	errnum_ = 0;
+	error_.clear();
+	return resume();
+}
+
+
+AsyncOperation::Status
+AsyncOperation::fail()
+{
+	errnum_ = conn_->errnum();
+	error_ = conn_->error();
+	return status_ = failed;
+}
+
+
+AsyncOperation::Status
+AsyncOperation::fail(const char* msg)
+{
+	errnum_ = 0;
+	error_ = msg;
+	return status_ = failed;
+}
+
+
+AsyncOperation::Status
+AsyncOperation::resume()
+{
+	if (status_ == pending) {
+		status_ = step();
+	}
+	return status_;
+}
+
+
+int
+AsyncOperation::socket() const
+{
+	return conn_->driver()->socket();
+}
+
+
+//// AsyncConnect //////////////////////////////////////////////////////
+
+AsyncConnect::AsyncConnect(Connection* c, const char* db,
+		const char* server, const char* user, const char* password,
+		unsigned int port) :
+AsyncOperation(c),
+db_(db),
+server_(server),
+user_(user),
+password_(password),
+port_(port)
+{
+}
+
+
+AsyncOperation::Status
+AsyncConnect::step()
+{
+	switch (connection()->connect_nonblocking(db_.c_str(),
+			server_.c_str(), user_.c_str(), password_.c_str(), port_)) {
+		case NET_ASYNC_NOT_READY:	return pending;
+		case NET_ASYNC_ERROR:		return fail();
+		default:					return succeeded;
+	}
+}
+
+
+//// AsyncQuery ////////////////////////////////////////////////////////
+
+AsyncQuery::AsyncQuery(Connection* c) :
+AsyncOperation(c),
+phase_(sending),
+has_rows_(false)
+{
+}
+
+
+AsyncOperation::Status
+AsyncQuery::start(const std::string& sql)
+{
+	sql_ = sql;
+	phase_ = sending;
+	has_rows_ = false;
+	result_ = StoreQueryResult();
+	simple_ = SimpleResult();
+	return begin();
+}
+
+
+AsyncOperation::Status
+AsyncQuery::start(Query& q)
+{
+	return start(q.str());
+}
+
+
+AsyncOperation::Status
+AsyncQuery::step()
+{
+	if (!connection()->connected()) {
+		return fail("AsyncQuery needs a connected Connection");
+	}
+
+	Status s = advance();
+	if (s != pending) {
+		if (ResultCache* cache = connection()->result_cache()) {
+			cache->invalidate(sql_.data(), sql_.length());
+		}
+	}
+	return s;
+}
+
+
+AsyncOperation::Status
+AsyncQuery::advance()
+{
+	DBDriver* driver = connection()->driver();
+	MYSQL_RES* res = 0;
+	for (;;) {
+		switch (phase_) {
+			case sending:
+				switch (driver->execute_nonblocking(sql_.data(),
+						sql_.length())) {
+					case NET_ASYNC_NOT_READY:	return pending;
+					case NET_ASYNC_ERROR:		return fail();
+					default:					phase_ = storing;
+				}
+				break;
+
+			case storing:
+				switch (driver->store_result_nonblocking(&res)) {
+					case NET_ASYNC_NOT_READY:	return pending;
+					case NET_ASYNC_ERROR:		return fail();
+					default:					break;
+				}
+				if (res) {
+					result_ = StoreQueryResult(res, driver, false);
+					has_rows_ = true;
+				}
+				else if (!driver->result_empty()) {
+					return fail();	// should have had rows, but didn't
+				}
+				simple_ = SimpleResult(true, driver->insert_id(),
+						driver->affected_rows(), driver->query_info());
+				if (!driver->more_results()) {
+					return succeeded;
+				}
+				phase_ = next_result;
+				break;
+
+			case next_result:
+				switch (driver->next_result_nonblocking()) {
+					case NET_ASYNC_NOT_READY:	return pending;
+					case NET_ASYNC_ERROR:		return fail();
+					case NET_ASYNC_COMPLETE_NO_MORE_RESULTS:
+						return succeeded;
+					default:					phase_ = skip_result;
+				}
+				break;
+
+			case skip_result:
+				switch (driver->store_result_nonblocking(&res)) {
+					case NET_ASYNC_NOT_READY:	return pending;
+					case NET_ASYNC_ERROR:		return fail();
+					default:					break;
+				}
+				if (res) {
+					driver->free_result(res);
+					res = 0;
+				}
+				if (!driver->more_results()) {
+					return succeeded;
+				}
+				phase_ = next_result;
+				break;
+		}
+	}
+}
+
+} // end namespace mysqlpp
+
+#endif // defined(MYSQLPP_HAVE_NONBLOCKING)
@@ -0,0 +1,247 @@
+/// \file asyncquery.h
+/// \brief Declares classes for connecting to the database server and
+/// running queries without blocking the calling thread.
+///
+/// These use the non-blocking functions added to the MySQL C API in
+/// MySQL 8.0.16, so they're only available when MySQL++ is built
+/// against that version or newer; MYSQLPP_HAVE_NONBLOCKING is defined
+/// when they are.  See Reactor for a way to drive many of them at once.
+
+/***********************************************************************
+ Copyright (c) 2009 by Educational Technology Resources, Inc.
+ Others may also hold copyrights on code in this file.  See the
+ CREDITS.txt file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#if !defined(MYSQLPP_ASYNCQUERY_H)
+#define MYSQLPP_ASYNCQUERY_H
+
+#include "common.h"
+
+#if defined(MYSQLPP_HAVE_NONBLOCKING)
+
+#include "result.h"
+
+#include <string>
+
+namespace mysqlpp {
+
+#if !defined(DOXYGEN_IGNORE)
+// Make Doxygen ignore this
+class MYSQLPP_EXPORT Connection;
+class MYSQLPP_EXPORT Query;
+#endif
+
+/// \brief Base class for database operations that proceed in steps,
+/// without blocking, as the connection's socket becomes ready.
+///
+/// Start the operation with the subclass's start() method, which does
+/// as much work as it can right away.  While status() is \c pending,
+/// wait for the socket() to become readable or writable, then call
+/// resume().  The MySQL C API doesn't say which of the two it's
+/// waiting for, so wait for either; Reactor does this efficiently
+/// with edge-triggered \c epoll.
+
+class MYSQLPP_EXPORT AsyncOperation
+{
+public:
+	/// \brief States an operation goes through
+	enum Status {
+		idle,		///< not started yet
+		pending,	///< waiting for the socket to be ready
+		succeeded,	///< finished successfully
+		failed		///< finished with an error; see error()
+	};
+
+	/// \brief Destroy the object
+	virtual ~AsyncOperation() { }
+
+	/// \brief Return the connection the operation works on
+	Connection* connection() const { return conn_; }
+
+	/// \brief Return the error message if the operation failed
+	const std::string& error() const { return error_; }
+
+	/// \brief Return the C API error number if the operation failed,
+	/// or 0
+	int errnum() const { return errnum_; }
+
+	/// \brief Called by Reactor when the operation finishes, whether
+	/// it succeeded or failed
+	///
+	/// The default does nothing.  Override it to handle the outcome;
+	/// it's fine to start another operation on the same connection
+	/// from here and hand it back to the Reactor.
+	virtual void finished() { }
+
+	/// \brief Do as much of the remaining work as possible without
+	/// blocking
+	///
+	/// Does nothing unless the operation is pending.
+	Status resume();
+
+	/// \brief Return the connection's socket descriptor, for waiting
+	/// on while the operation is pending
+	int socket() const;
+
+	/// \brief Return the operation's current status
+	Status status() const { return status_; }
+
+protected:
+	/// \brief Create an operation working on the given connection
+	AsyncOperation(Connection* c) :
+	conn_(c),
+	status_(idle),
+	errnum_(0)
+	{
+	}
+
+	/// \brief Mark the operation as started, then take the first step
+	Status begin();
+
+	/// \brief Record the connection's current error and mark the
+	/// operation as failed
+	Status fail();
+
+	/// \brief Mark the operation as failed with the given message,
+	/// for errors found before talking to the C API
+	Status fail(const char* msg);
+
+	/// \brief Do as much of the remaining work as possible, returning
+	/// \c pending, or the result of fail() or \c succeeded
+	virtual Status step() = 0;
+
+private:
+	Connection* conn_;
+	Status status_;
+	int errnum_;
+	std::string error_;
+};
+
+
+/// \brief Connects a Connection to the database server without
+/// blocking.
+///
+/// Only connections made this way can run AsyncQuery operations
+/// without blocking.  The parameters are the same as for
+/// Connection::connect().
+
+class MYSQLPP_EXPORT AsyncConnect : public AsyncOperation
+{
+public:
+	/// \brief Create an operation to connect the given connection
+	AsyncConnect(Connection* c, const char* db = 0,
+			const char* server = 0, const char* user = 0,
+			const char* password = 0, unsigned int port = 0);
+
+	/// \brief Start connecting
+	Status start() { return begin(); }
+
+protected:
+	/// \brief Continue the connection handshake
+	Status step();
+
+private:
+	/// \brief A copy of a connection parameter, remembering whether
+	/// the caller passed 0
+	struct Param {
+		Param(const char* s) : value(s ? s : ""), given(s != 0) { }
+		const char* c_str() const { return given ? value.c_str() : 0; }
+
+		std::string value;
+		bool given;
+	};
+
+	Param db_;
+	Param server_;
+	Param user_;
+	Param password_;
+	unsigned int port_;
+};
+
+
+/// \brief Runs a query without blocking.
+///
+/// Once it succeeds, result() holds any rows the query returned and
+/// simple() its affected row count, insert ID and info string, as
+/// Query::store() and Query::execute() would give you.
+///
+/// The connection must have been made with AsyncConnect, and must not
+/// be used for anything else until the query finishes.  Send one
+/// statement at a time: if a multi-statement query returns several
+/// result sets, only the first is kept.
+
+class MYSQLPP_EXPORT AsyncQuery : public AsyncOperation
+{
+public:
+	/// \brief Create an operation to run queries on the given
+	/// connection
+	///
+	/// The object can be reused for any number of queries, one at a
+	/// time.
+	explicit AsyncQuery(Connection* c);
+
+	/// \brief Returns true if the query returned a result set, even an
+	/// empty one
+	bool has_rows() const { return has_rows_; }
+
+	/// \brief Return the rows the query returned
+	const StoreQueryResult& result() const { return result_; }
+
+	/// \brief Return the affected row count, insert ID and info string
+	/// for the query
+	const SimpleResult& simple() const { return simple_; }
+
+	/// \brief Start running the given query
+	Status start(const std::string& sql);
+
+	/// \brief Start running the query built up in a Query object,
+	/// filling in template query parameters from its defaults
+	Status start(Query& q);
+
+protected:
+	/// \brief Continue running the query
+	Status step();
+
+private:
+	/// \brief Do the work of step(), which then drops any cached
+	/// results the query may have made stale once it's finished
+	Status advance();
+
+	/// \brief Where we are in running the query
+	enum Phase {
+		sending,		///< sending the query, waiting for its status
+		storing,		///< reading the result set
+		next_result,	///< moving to an extra result set
+		skip_result		///< reading and discarding an extra result set
+	};
+
+	std::string sql_;
+	Phase phase_;
+	bool has_rows_;
+	StoreQueryResult result_;
+	SimpleResult simple_;
+};
+
+} // end namespace mysqlpp
+
+#endif // defined(MYSQLPP_HAVE_NONBLOCKING)
+
+#endif // !defined(MYSQLPP_ASYNCQUERY_H)
@@ -0,0 +1,214 @@
+/***********************************************************************
+ bulkloader.cpp - Implements the BulkLoader class.
+
+ Copyright (c) 2009 by Educational Technology Resources, Inc.
+ Others may also hold copyrights on code in this file.  See the
+ CREDITS.txt file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#define MYSQLPP_NOT_HEADER
+#include "common.h"
+
+#include "bulkloader.h"
+
+#include "connection.h"
+#include "dbdriver.h"
+#include "exceptions.h"
+#include "options.h"
+#include "resultcache.h"
+
+#include <sstream>
+
+#include <string.h>
+
+namespace mysqlpp {
+
+// How much row text to build up each time the C API runs out.  The
+// C API asks for data in pieces of about this size.
+static const size_t chunk_size = 16 * 1024;
+
+// C API error code reported when a row can't be turned into text;
+// it's CR_UNKNOWN_ERROR in errmsg.h.
+static const int serialization_error = 2000;
+
+
+namespace {
+
+// State of one load, handed to the C API's LOCAL INFILE callbacks
+struct InfileState
+{
+	explicit InfileState(BulkSource& s) :
+	source(s),
+	pos(0)
+	{
+	}
+
+	// Turn the next chunk's worth of rows into text
+	//
+	// Returns false if there were no more rows.
+	bool refill()
+	{
+		text.str(std::string());
+		while ((size_t(text.tellp()) < chunk_size) &&
+				source.next(text)) {
+			// keep going
+		}
+		pending = text.str();
+		pos = 0;
+		return !pending.empty();
+	}
+
+	BulkSource& source;
+	std::ostringstream text;
+	std::string pending;
+	size_t pos;
+	std::string error;
+};
+
+} // end anonymous namespace
+
+
+static int
+infile_init(void** ptr, const char* /* filename */, void* userdata)
+{
+	*ptr = userdata;
+	return 0;
+}
+
+
+static int
+infile_read(void* ptr, char* buf, unsigned int buf_len)
+{
+	InfileState* st = static_cast<InfileState*>(ptr);
+	unsigned int n = 0;
+	try {
+		while (n < buf_len) {
+			if ((st->pos == st->pending.size()) && !st->refill()) {
+				break;
+			}
+			size_t len = st->pending.size() - st->pos;
+			if (len > buf_len - n) {
+				len = buf_len - n;
+			}
+			memcpy(buf + n, st->pending.data() + st->pos, len);
+			st->pos += len;
+			n += static_cast<unsigned int>(len);
+		}
+	}
+	catch (const std::exception& e) {
+		st->error = e.what();
+		return -1;
+	}
+	return static_cast<int>(n);
+}
+
+
+static void
+infile_end(void* /* ptr */)
+{
+	// InfileState lives on BulkLoader::load()'s stack
+}
+
+
+static int
+infile_error(void* ptr, char* error_msg, unsigned int error_msg_len)
+{
+	InfileState* st = static_cast<InfileState*>(ptr);
+	if (error_msg_len) {
+		size_t len = st->error.copy(error_msg, error_msg_len - 1);
+		error_msg[len] = '\0';
+	}
+	return serialization_error;
+}
+
+
+BulkLoader::BulkLoader(Connection* c, bool te) :
+OptionalExceptions(te),
+conn_(c),
+rows_(0),
+warnings_(0)
+{
+	if (!conn_->connected()) {
+		conn_->set_option(new LocalInfileOption(true));
+	}
+}
+
+
+ulonglong
+BulkLoader::load(const std::string& table, BulkSource& source)
+{
+	reset();
+	const std::string& s = statement(table, source);
+
+	InfileState st(source);
+	DBDriver* driver = conn_->driver();
+	driver->set_local_infile_handler(infile_init, infile_read,
+			infile_end, infile_error, &st);
+	bool ok = driver->execute(s.data(), s.length());
+	driver->set_local_infile_default();
+	if (ResultCache* cache = conn_->result_cache()) {
+		cache->invalidate(table);
+	}
+
+	if (ok) {
+		rows_ = driver->affected_rows();
+		warnings_ = driver->warning_count();
+		info_ = driver->query_info();
+	}
+	else if (throw_exceptions()) {
+		// If a row couldn't be serialized, that's what the user needs
+		// to see, not the C API's report of an aborted transfer.
+		if (st.error.empty()) {
+			throw BadQuery(driver->error(), driver->errnum());
+		}
+		else {
+			throw BadQuery(st.error, serialization_error);
+		}
+	}
+
+	return rows_;
+}
+
+
+std::string
+BulkLoader::statement(const std::string& table,
+		const BulkSource& source) const
+{
+	std::ostringstream sql;
+	sql << "LOAD DATA LOCAL INFILE 'mysqlpp-bulk' INTO TABLE " << table <<
+			" CHARACTER SET " << conn_->driver()->character_set_name() <<
+			" FIELDS TERMINATED BY '\\t' ESCAPED BY '\\\\'"
+			" LINES TERMINATED BY '\\n' (";
+	source.columns(sql);
+	sql << ')';
+	return sql.str();
+}
+
+
+ulonglong
+BulkLoader::reset()
+{
+	rows_ = 0;
+	warnings_ = 0;
+	info_.clear();
+	return 0;
+}
+
+} // end namespace mysqlpp
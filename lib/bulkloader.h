@@ -0,0 +1,216 @@
+/// \file bulkloader.h
+/// \brief Declares the BulkLoader class, which feeds rows from memory
+/// to the server with <tt>LOAD DATA LOCAL INFILE</tt>.
+
+/***********************************************************************
+ Copyright (c) 2009 by Educational Technology Resources, Inc.
+ Others may also hold copyrights on code in this file.  See the
+ CREDITS.txt file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#if !defined(MYSQLPP_BULKLOADER_H)
+#define MYSQLPP_BULKLOADER_H
+
+#include "common.h"
+
+#include "manip.h"
+#include "noexceptions.h"
+
+#include <ostream>
+#include <string>
+
+namespace mysqlpp {
+
+#if !defined(DOXYGEN_IGNORE)
+// Make Doxygen ignore this
+class MYSQLPP_EXPORT Connection;
+#endif
+
+/// \brief Supplies the rows for one BulkLoader::load() call
+///
+/// \internal BulkLoader::load() wraps the caller's iterator range in
+/// a BulkRange, so the non-template code can pull rows from it.
+
+class MYSQLPP_EXPORT BulkSource
+{
+public:
+	/// \brief Destroy the object
+	virtual ~BulkSource() { }
+
+	/// \brief Write the comma-separated column list for the rows
+	virtual void columns(std::ostream& os) const = 0;
+
+	/// \brief Write the next row as a line of tab-separated fields
+	///
+	/// \retval false if there are no more rows
+	virtual bool next(std::ostream& os) = 0;
+};
+
+
+/// \brief A BulkSource reading from an iterator range of SSQLS
+/// objects or Row objects
+///
+/// \internal Both types have the field_list() and value_list()
+/// members we need, so one template serves for both.
+
+template <class Iter>
+class BulkRange : public BulkSource
+{
+public:
+	/// \brief Create a source for the given range, which must not be
+	/// empty
+	BulkRange(Iter first, Iter last) :
+	first_(first),
+	cur_(first),
+	last_(last)
+	{
+	}
+
+	void columns(std::ostream& os) const
+	{
+		os << first_->field_list();
+	}
+
+	bool next(std::ostream& os)
+	{
+		if (cur_ == last_) {
+			return false;
+		}
+		os << cur_->value_list("\t", escape_tsv) << '\n';
+		++cur_;
+		return true;
+	}
+
+private:
+	Iter first_;
+	Iter cur_;
+	Iter last_;
+};
+
+
+/// \brief Loads rows into a table with <tt>LOAD DATA LOCAL
+/// INFILE</tt>, straight from an in-memory container.
+///
+/// This is the fastest way MySQL++ has to get many rows into the
+/// database: several times faster than even the multi-row INSERT
+/// statements Query::insertfrom() builds, because the server doesn't
+/// have to parse SQL for each value.  The rows are turned into
+/// tab-separated text as the C API asks for it, a buffer at a time, so
+/// nothing goes to disk and the whole data set is never in memory as
+/// text at once:
+///
+/// \code
+/// std::vector<stock> items;
+/// ...fill items...
+/// mysqlpp::BulkLoader loader(&con);
+/// loader.load(items.begin(), items.end());
+/// std::cout << loader.rows() << " rows loaded, " <<
+///         loader.warnings() << " warnings" << std::endl;
+/// \endcode
+///
+/// The range can hold SSQLS objects or Row objects.  Row ranges need
+/// the table name to be given to load().
+///
+/// The client and server must both allow <tt>LOCAL</tt> loading: set
+/// LocalInfileOption on the Connection before connecting (the
+/// constructor does it for you if the connection isn't up yet), and
+/// turn on the server's \c local_infile variable.
+///
+/// Warnings aren't errors for <tt>LOAD DATA</tt>: rows with bad values
+/// are loaded with whatever the server could make of them, or skipped
+/// as duplicates, and only show up in warnings() and info().
+
+class MYSQLPP_EXPORT BulkLoader : public OptionalExceptions
+{
+public:
+	/// \brief Create a loader working through the given connection
+	///
+	/// \param c connection to load data through
+	/// \param te if true, load() throws BadQuery on failure
+	BulkLoader(Connection* c, bool te = true);
+
+	/// \brief Return the server's summary of the last load, such as
+	/// "Records: 3  Deleted: 0  Skipped: 0  Warnings: 0"
+	const std::string& info() const { return info_; }
+
+	/// \brief Load a range of SSQLS objects into their table
+	///
+	/// \retval number of rows loaded
+	template <class Iter>
+	ulonglong load(Iter first, Iter last)
+	{
+		if (first == last) {
+			return reset();
+		}
+		return load(first->table(), first, last);
+	}
+
+	/// \brief Load a range of SSQLS or Row objects into the given
+	/// table
+	///
+	/// \retval number of rows loaded
+	template <class Iter>
+	ulonglong load(const std::string& table, Iter first, Iter last)
+	{
+		if (first == last) {
+			return reset();
+		}
+		BulkRange<Iter> source(first, last);
+		return load(table, source);
+	}
+
+	/// \brief Load the rows from a BulkSource into the given table
+	///
+	/// This is what the other load() overloads call.  Use it directly
+	/// if your rows don't come from an iterator range.
+	///
+	/// \retval number of rows loaded
+	ulonglong load(const std::string& table, BulkSource& source);
+
+	/// \brief Return the number of rows the last load() added
+	ulonglong rows() const { return rows_; }
+
+	/// \brief Return the <tt>LOAD DATA</tt> statement load() sends
+	/// for the given table and rows
+	///
+	/// The statement names the connection's character set, which the
+	/// rows' text is in, since the server would otherwise read it as
+	/// being in the database's default character set.
+	std::string statement(const std::string& table,
+			const BulkSource& source) const;
+
+	/// \brief Return the number of warnings the last load() raised
+	unsigned int warnings() const { return warnings_; }
+
+private:
+	/// \brief Forget the outcome of the last load
+	///
+	/// \retval 0, for load() to return
+	ulonglong reset();
+
+	Connection* conn_;
+	ulonglong rows_;
+	unsigned int warnings_;
+	std::string info_;
+};
+
+} // end namespace mysqlpp
+
+#endif // !defined(MYSQLPP_BULKLOADER_H)
@@ -0,0 +1,276 @@
+/***********************************************************************
+ columnar.cpp - Implements the Column and ColumnarResult classes.
+
+ Copyright (c) 2009 by Educational Technology Resources, Inc.
+ Others may also hold copyrights on code in this file.  See the
+ CREDITS.txt file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#define MYSQLPP_NOT_HEADER
+#include "common.h"
+
+#include "columnar.h"
+
+#include "dbdriver.h"
+#include "null.h"
+#include "sql_types.h"
+
+#include <locale.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <locale>
+#include <sstream>
+
+namespace mysqlpp {
+
+// Digits in a packed date and time: YYYYMMDDhhmmss
+static const int packed_digits = 14;
+
+
+// Parse a floating-point value from the server's text form, which
+// always uses '.' for the decimal point.  strtod() goes by the C
+// locale's LC_NUMERIC, so if the program has changed that, fall back
+// to a stream in the classic locale.  p must be null-terminated.
+static double
+parse_real(const char* p, size_t len)
+{
+	const char* point = localeconv()->decimal_point;
+	if (!point || ((point[0] == '.') && (point[1] == '\0'))) {
+		return strtod(p, 0);
+	}
+
+	std::istringstream is(std::string(p, len));
+	is.imbue(std::locale::classic());
+	double d = 0.0;
+	is >> d;
+	return d;
+}
+
+
+// Return true if the C++ type is T or Null<T>
+template <typename T>
+static bool
+is(const std::type_info& t)
+{
+	return t == typeid(T) || t == typeid(Null<T>);
+}
+
+
+Column::Column(Kind k) :
+kind_(k),
+size_(0),
+null_count_(0),
+offsets_(1, 0)
+{
+}
+
+
+void
+Column::append(const char* data, size_t len)
+{
+	if ((size_ % 8) == 0) {
+		nulls_.push_back(0);
+	}
+	if (!data) {
+		nulls_[size_ / 8] |= static_cast<unsigned char>(1 << (size_ % 8));
+		++null_count_;
+		len = 0;
+	}
+
+	const char* end = data + len;
+	switch (kind_) {
+		case integer: {
+			bool negative = false;
+			if ((data != end) && ((*data == '-') || (*data == '+'))) {
+				negative = *data++ == '-';
+			}
+			longlong n = 0;
+			for ( ; (data != end) && (*data >= '0') && (*data <= '9');
+					++data) {
+				n = n * 10 + (*data - '0');
+			}
+			ints_.push_back(negative ? -n : n);
+			break;
+		}
+
+		case unsigned_integer: {
+			ulonglong n = 0;
+			for ( ; (data != end) && (*data >= '0') && (*data <= '9');
+					++data) {
+				n = n * 10 + (*data - '0');
+			}
+			uints_.push_back(n);
+			break;
+		}
+
+		case real:
+			if (len == 0) {
+				reals_.push_back(0.0);
+			}
+			else {
+				// parse_real() needs a null-terminated string; a DOUBLE's
+				// text always fits the buffer, a long DECIMAL might not
+				char buf[80];
+				std::string big;
+				const char* p = buf;
+				if (len < sizeof(buf)) {
+					memcpy(buf, data, len);
+					buf[len] = '\0';
+				}
+				else {
+					big.assign(data, len);
+					p = big.c_str();
+				}
+				reals_.push_back(parse_real(p, len));
+			}
+			break;
+
+		case datetime: {
+			// Gather the digits, skipping the separators, and stopping
+			// at any fractional seconds.  A DATE has only 8 digits, so
+			// fill out the rest with zeroes, for midnight.
+			longlong n = 0;
+			int digits = 0;
+			for ( ; (data != end) && (*data != '.') &&
+					(digits < packed_digits); ++data) {
+				if ((*data >= '0') && (*data <= '9')) {
+					n = n * 10 + (*data - '0');
+					++digits;
+				}
+			}
+			for ( ; digits < packed_digits; ++digits) {
+				n *= 10;
+			}
+			ints_.push_back(n);
+			break;
+		}
+
+		case text:
+			arena_.insert(arena_.end(), data, end);
+			arena_.push_back('\0');
+			offsets_.push_back(arena_.size());
+			break;
+	}
+
+	++size_;
+}
+
+
+DateTime
+Column::datetime_at(size_t i) const
+{
+	longlong n = ints_[i];
+	unsigned char s = static_cast<unsigned char>(n % 100);
+	n /= 100;
+	unsigned char min = static_cast<unsigned char>(n % 100);
+	n /= 100;
+	unsigned char h = static_cast<unsigned char>(n % 100);
+	n /= 100;
+	unsigned char d = static_cast<unsigned char>(n % 100);
+	n /= 100;
+	unsigned char mon = static_cast<unsigned char>(n % 100);
+	n /= 100;
+	return DateTime(static_cast<unsigned short>(n), mon, d, h, min, s);
+}
+
+
+Column::Kind
+Column::kind_for(const mysql_type_info& type)
+{
+	const std::type_info& t = type.c_type();
+	if (is<sql_bigint_unsigned>(t)) {
+		return unsigned_integer;
+	}
+	else if (is<sql_tinyint>(t) || is<sql_tinyint_unsigned>(t) ||
+			is<sql_smallint>(t) || is<sql_smallint_unsigned>(t) ||
+			is<sql_mediumint>(t) || is<sql_mediumint_unsigned>(t) ||
+			is<sql_int>(t) || is<sql_int_unsigned>(t) ||
+			is<sql_bigint>(t)) {
+		return integer;
+	}
+	else if (is<sql_float>(t) || is<sql_double>(t) ||
+			is<sql_decimal>(t)) {
+		return real;
+	}
+	else if (is<sql_date>(t) || is<sql_datetime>(t)) {
+		return datetime;
+	}
+	else {
+		return text;
+	}
+}
+
+
+void
+Column::reserve(size_t n)
+{
+	nulls_.reserve((n + 7) / 8);
+	switch (kind_) {
+		case integer:
+		case datetime:			ints_.reserve(n); break;
+		case unsigned_integer:	uints_.reserve(n); break;
+		case real:				reals_.reserve(n); break;
+		case text:				offsets_.reserve(n + 1); break;
+	}
+}
+
+
+ColumnarResult::ColumnarResult(MYSQL_RES* res, DBDriver* dbd, bool te) :
+ResultBase(res, dbd, te),
+rows_(0),
+copacetic_(res && dbd)
+{
+	if (copacetic_) {
+		const size_t nrows = static_cast<size_t>(dbd->num_rows(res));
+		columns_.reserve(fields_.size());
+		for (size_t i = 0; i < fields_.size(); ++i) {
+			columns_.push_back(Column(Column::kind_for(fields_[i].type())));
+			columns_.back().reserve(nrows);
+		}
+
+		while (MYSQL_ROW row = dbd->fetch_row(res)) {
+			if (const unsigned long* lengths = dbd->fetch_lengths(res)) {
+				for (size_t i = 0; i < columns_.size(); ++i) {
+					columns_[i].append(row[i], lengths[i]);
+				}
+				++rows_;
+			}
+		}
+
+		dbd->free_result(res);
+	}
+}
+
+
+ColumnarResult&
+ColumnarResult::copy(const ColumnarResult& other)
+{
+	if (this != &other) {
+		ResultBase::copy(other);
+		columns_ = other.columns_;
+		rows_ = other.rows_;
+		copacetic_ = other.copacetic_;
+	}
+
+	return *this;
+}
+
+} // end namespace mysqlpp
@@ -0,0 +1,259 @@
+/// \file columnar.h
+/// \brief Declares the ColumnarResult class, which holds a result set
+/// as one typed array per column.
+
+/***********************************************************************
+ Copyright (c) 2009 by Educational Technology Resources, Inc.
+ Others may also hold copyrights on code in this file.  See the
+ CREDITS.txt file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#if !defined(MYSQLPP_COLUMNAR_H)
+#define MYSQLPP_COLUMNAR_H
+
+#include "common.h"
+
+#include "datetime.h"
+#include "result.h"
+
+#include <string>
+#include <vector>
+
+namespace mysqlpp {
+
+/// \brief One column of a ColumnarResult
+///
+/// Each value is converted from the text the server sends just once,
+/// when the column is built, and stored in a contiguous array of the
+/// column's C++ type.  Which array holds the values depends on kind():
+///
+/// - \c integer: ints(), for all the signed and unsigned integer types
+///   except <tt>BIGINT UNSIGNED</tt>
+/// - \c unsigned_integer: uints(), for <tt>BIGINT UNSIGNED</tt>
+/// - \c real: reals(), for \c FLOAT, \c DOUBLE and \c DECIMAL; the
+///   latter loses precision, just as it does with sql_decimal
+/// - \c datetime: ints(), for \c DATE, \c DATETIME and \c TIMESTAMP,
+///   with each value packed into a number of the form YYYYMMDDhhmmss,
+///   so dates compare and sort as plain numbers; datetime() unpacks one
+/// - \c text: everything else, in one arena(), with each value's start
+///   in offsets()
+///
+/// A SQL null is stored as 0, or as an empty string, with its bit set
+/// in null_bitmap().
+///
+/// Because the values sit side by side in memory, a loop over one of
+/// these arrays is something the compiler can vectorize:
+///
+/// \code
+/// const mysqlpp::Column& num = res.column("num");
+/// const mysqlpp::longlong* p = num.ints();
+/// mysqlpp::longlong total = 0;
+/// for (size_t i = 0; i < num.size(); ++i) {
+///     total += p[i];      // nulls are 0, so they add nothing
+/// }
+/// \endcode
+
+class MYSQLPP_EXPORT Column
+{
+public:
+	/// \brief The ways a column may store its values
+	enum Kind {
+		integer,			///< in ints()
+		unsigned_integer,	///< in uints()
+		real,				///< in reals()
+		datetime,			///< in ints(), packed as YYYYMMDDhhmmss
+		text				///< in arena(), at offsets()
+	};
+
+	/// \brief Create an empty column that stores values of a kind
+	explicit Column(Kind k = text);
+
+	/// \brief Convert a value from the server's text form and add it
+	/// to the end of the column
+	///
+	/// \param data the value's text, or 0 for a SQL null
+	/// \param len the length of \c data
+	void append(const char* data, size_t len);
+
+	/// \brief Return the text of every value, one after another
+	///
+	/// Each value is followed by a null character, which isn't counted
+	/// in its length().  Empty unless kind() is \c text.
+	const char* arena() const
+			{ return arena_.empty() ? "" : &arena_[0]; }
+
+	/// \brief Return a \c datetime value as a DateTime
+	///
+	/// A \c DATE value's time part is midnight.
+	DateTime datetime_at(size_t i) const;
+
+	/// \brief Return true if the value at index \c i is a SQL null
+	bool is_null(size_t i) const
+			{ return (nulls_[i / 8] & (1 << (i % 8))) != 0; }
+
+	/// \brief Return the values, if kind() is \c integer or \c datetime
+	const longlong* ints() const
+			{ return ints_.empty() ? 0 : &ints_[0]; }
+
+	/// \brief Return the kind of values this column stores
+	Kind kind() const { return kind_; }
+
+	/// \brief Pick the kind of column to store values of the given SQL
+	/// type in
+	static Kind kind_for(const mysql_type_info& type);
+
+	/// \brief Return the length of the \c text value at index \c i
+	size_t length(size_t i) const
+			{ return offsets_[i + 1] - offsets_[i] - 1; }
+
+	/// \brief Return the bitmap of SQL nulls
+	///
+	/// The bit for the value at index \c i is <tt>1 << (i % 8)</tt> in
+	/// byte <tt>i / 8</tt>, and it's set if the value is null.
+	const unsigned char* null_bitmap() const
+			{ return nulls_.empty() ? 0 : &nulls_[0]; }
+
+	/// \brief Return the number of SQL nulls in the column
+	size_t null_count() const { return null_count_; }
+
+	/// \brief Return where each \c text value starts in arena()
+	///
+	/// There are size() + 1 of these.  The last is the size of the
+	/// arena, so value \c i runs to the offset after its own.
+	const size_t* offsets() const { return &offsets_[0]; }
+
+	/// \brief Return the values, if kind() is \c real
+	const double* reals() const
+			{ return reals_.empty() ? 0 : &reals_[0]; }
+
+	/// \brief Set aside room for a number of values
+	void reserve(size_t n);
+
+	/// \brief Return the number of values in the column
+	size_t size() const { return size_; }
+
+	/// \brief Return the \c text value at index \c i
+	///
+	/// Use length() to get its length, since a \c BLOB value may hold
+	/// null characters.
+	const char* text_at(size_t i) const
+			{ return arena_.empty() ? "" : &arena_[offsets_[i]]; }
+
+	/// \brief Return the values, if kind() is \c unsigned_integer
+	const ulonglong* uints() const
+			{ return uints_.empty() ? 0 : &uints_[0]; }
+
+private:
+	Kind kind_;
+	size_t size_;
+	size_t null_count_;
+
+	std::vector<unsigned char> nulls_;
+	std::vector<longlong> ints_;
+	std::vector<ulonglong> uints_;
+	std::vector<double> reals_;
+	std::vector<size_t> offsets_;
+	std::vector<char> arena_;
+};
+
+
+/// \brief A result set held one column at a time, for fast scans
+/// over a few columns of many rows
+///
+/// StoreQueryResult keeps each row as a separate object, and each value
+/// within it as text, so a scan over one numeric column of a large
+/// result visits a scattered heap object for every value and converts
+/// each one from text again every time it's used.  This class instead
+/// converts every value once, as it's read from the server, into one
+/// Column per field.  Get one from Query::store_columnar().
+///
+/// The price is that rows no longer exist as objects: there's no
+/// Row or SSQLS access, and a value is found by column, then row index.
+
+class MYSQLPP_EXPORT ColumnarResult : public ResultBase
+{
+private:
+	/// \brief Pointer to bool data member, for use by safe bool
+	/// conversion operator.
+	///
+	/// \see http://www.artima.com/cppsource/safebool.html
+	typedef bool ColumnarResult::*private_bool_type;
+
+public:
+	/// \brief Default constructor
+	ColumnarResult() :
+	ResultBase(),
+	rows_(0),
+	copacetic_(false)
+	{
+	}
+
+	/// \brief Fully initialize object, reading every row of the result
+	/// and freeing it
+	ColumnarResult(MYSQL_RES* result, DBDriver* dbd, bool te = true);
+
+	/// \brief Initialize object as a copy of another ColumnarResult
+	ColumnarResult(const ColumnarResult& other) :
+	ResultBase(),
+	rows_(0),
+	copacetic_(false)
+	{
+		copy(other);
+	}
+
+	/// \brief Copy another ColumnarResult object's data into this
+	/// object
+	ColumnarResult& operator =(const ColumnarResult& rhs)
+			{ return this != &rhs ? copy(rhs) : *this; }
+
+	/// \brief Return the column for the field at index \c i
+	const Column& column(size_t i) const { return columns_.at(i); }
+
+	/// \brief Return the column for the named field
+	const Column& column(const std::string& name) const
+			{ return columns_.at(field_num(name)); }
+
+	/// \brief Returns the number of rows in this result set
+	size_t num_rows() const { return rows_; }
+
+	/// \brief Test whether the query that created this result succeeded
+	///
+	/// If you test this object in bool context and it's false, it's a
+	/// signal that the query this was created from failed in some way.
+	/// Call Query::error() or Query::errnum() to find out what exactly
+	/// happened.
+	operator private_bool_type() const
+	{
+		return copacetic_ ? &ColumnarResult::copacetic_ : 0;
+	}
+
+private:
+	/// \brief Copy another ColumnarResult object's contents into this
+	/// one.
+	ColumnarResult& copy(const ColumnarResult& other);
+
+	std::vector<Column> columns_;
+	size_t rows_;
+	bool copacetic_;	///< true if initialized from a good result set
+};
+
+} // end namespace mysqlpp
+
+#endif // !defined(MYSQLPP_COLUMNAR_H)
@@ -191,4 +191,26 @@ typedef unsigned long ulong;
 #	include <mysql.h>
 #endif
 
+// MySQL 8.0.16 added non-blocking variants of the query functions.
+// MariaDB has its own, different, API for this, which we don't use.
+#if MYSQL_VERSION_ID >= 80016 && !defined(MARIADB_BASE_VERSION) && \
+		!defined(MARIADB_PACKAGE_VERSION)
+#	define MYSQLPP_HAVE_NONBLOCKING
+#endif
+
+namespace mysqlpp {
+
+#if !defined(DOXYGEN_IGNORE)
+// Type of the flags MYSQL_BIND points at.  MySQL 8.0 dropped my_bool
+// in favor of plain C bool; MariaDB still uses my_bool.
+#if MYSQL_VERSION_ID >= 80001 && !defined(MARIADB_BASE_VERSION) && \
+		!defined(MARIADB_PACKAGE_VERSION)
+typedef bool bind_bool;
+#else
+typedef my_bool bind_bool;
+#endif
+#endif // !defined(DOXYGEN_IGNORE)
+
+} // end namespace mysqlpp
+
 #endif // !defined(MYSQLPP_COMMON_H)
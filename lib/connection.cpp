@@ -28,6 +28,7 @@
 #include "connection.h"
 
 #include "dbdriver.h"
+#include "prepquery.h"
 #include "query.h"
 #include "result.h"
 
@@ -38,7 +39,10 @@ namespace mysqlpp {
 Connection::Connection(bool te) :
 OptionalExceptions(te),
 driver_(new DBDriver()),
-copacetic_(true)
+copacetic_(true),
+cache_(0),
+zero_copy_(false),
+arena_recycler_(0)
 {
 }
 
@@ -47,7 +51,10 @@ Connection::Connection(const char* db, const char* server,
 		const char* user, const char* password, unsigned int port) :
 OptionalExceptions(),
 driver_(new DBDriver()),
-copacetic_(true)
+copacetic_(true),
+cache_(0),
+zero_copy_(false),
+arena_recycler_(0)
 {
 	try {
 		connect(db, server, user, password, port);
@@ -63,7 +70,10 @@ copacetic_(true)
 
 Connection::Connection(const Connection& other) :
 OptionalExceptions(other.throw_exceptions()),
-driver_(new DBDriver(*other.driver_))
+driver_(new DBDriver(*other.driver_)),
+cache_(0),
+zero_copy_(false),
+arena_recycler_(0)
 {
 	copy(other);
 }
@@ -115,6 +125,27 @@ Connection::connect(const char* db, const char* server,
 }
 
 
+#if defined(MYSQLPP_HAVE_NONBLOCKING)
+net_async_status
+Connection::connect_nonblocking(const char* db, const char* server,
+		const char* user, const char* password, unsigned int port)
+{
+	error_message_.clear();
+	string host, socket_name;
+	if (!parse_ipc_method(server, host, port, socket_name)) {
+		copacetic_ = false;
+		return NET_ASYNC_ERROR;
+	}
+
+	net_async_status rc = driver_->connect_nonblocking(host.c_str(),
+			(socket_name.empty() ? 0 : socket_name.c_str()), port, db,
+			user, password);
+	copacetic_ = rc != NET_ASYNC_ERROR;
+	return rc;
+}
+#endif
+
+
 bool
 Connection::connected() const
 {
@@ -128,6 +159,9 @@ Connection::copy(const Connection& other)
 	error_message_.clear();
 	set_exceptions(other.throw_exceptions());
 	driver_->copy(*other.driver_);
+	cache_ = other.cache_;
+	zero_copy_ = other.zero_copy_;
+	arena_recycler_ = other.arena_recycler_;
 }
 
 
@@ -259,6 +293,20 @@ Connection::ping()
 }
 
 
+PreparedQuery
+Connection::prepare(const char* tmpl)
+{
+	return PreparedQuery(this, tmpl, throw_exceptions());
+}
+
+
+PreparedQuery
+Connection::prepare(const std::string& tmpl)
+{
+	return prepare(tmpl.c_str());
+}
+
+
 int
 Connection::protocol_version() const
 {
@@ -46,7 +46,10 @@ namespace mysqlpp {
 
 #if !defined(DOXYGEN_IGNORE)
 // Make Doxygen ignore this
+class MYSQLPP_EXPORT ArenaRecycler;
+class MYSQLPP_EXPORT PreparedQuery;
 class MYSQLPP_EXPORT Query;
+class MYSQLPP_EXPORT ResultCache;
 class DBDriver;
 #endif
 
@@ -116,6 +119,10 @@ public:
 	/// \brief Destroy object
 	virtual ~Connection();
 
+	/// \brief Return the recycler of the arenas this connection's
+	/// queries store their results in, if any
+	ArenaRecycler* arena_recycler() const { return arena_recycler_; }
+
 	/// \brief Get version of library underpinning the current database
 	/// driver.
 	std::string client_version() const;
@@ -132,6 +139,23 @@ public:
 			const char* user = 0, const char* password = 0,
 			unsigned int port = 0);
 
+#if defined(MYSQLPP_HAVE_NONBLOCKING)
+	/// \brief Start or continue connecting to the database server
+	/// without blocking
+	///
+	/// Takes the same parameters as connect().  Call it again with the
+	/// same parameters each time it returns \c NET_ASYNC_NOT_READY,
+	/// once the driver's socket is ready for I/O; AsyncConnect does
+	/// this for you.  This never throws: on \c NET_ASYNC_ERROR, check
+	/// error() and errnum().
+	///
+	/// Only connections made this way can run queries without
+	/// blocking, through AsyncQuery.
+	net_async_status connect_nonblocking(const char* db = 0,
+			const char* server = 0, const char* user = 0,
+			const char* password = 0, unsigned int port = 0);
+#endif
+
 	/// \brief Returns true if connection was established successfully
 	///
 	/// \return true if connection was established successfully
@@ -234,6 +258,20 @@ public:
 	/// the ping and we could not re-establish the connection.
 	bool ping();
 
+	/// \brief Return a new prepared statement object
+	///
+	/// The template is given to the database server to compile once,
+	/// after which you can execute it many times with different
+	/// parameter values.  See PreparedQuery for details.
+	///
+	/// \param tmpl template query, in the syntax Query::parse() accepts
+	PreparedQuery prepare(const char* tmpl);
+
+	/// \brief Return a new prepared statement object
+	///
+	/// \param tmpl template query
+	PreparedQuery prepare(const std::string& tmpl);
+
 	/// \brief Returns version number of the protocol the database
 	/// driver uses to communicate with the server.
 	int protocol_version() const;
@@ -255,6 +293,10 @@ public:
 	/// \param qstr initial query string
 	Query query(const std::string& qstr);
 
+	/// \brief Return the cache of query results this connection uses,
+	/// if any
+	ResultCache* result_cache() const { return cache_; }
+
 	/// \brief Change to a different database managed by the
 	/// database server we are connected to.
 	///
@@ -266,6 +308,23 @@ public:
 	/// \brief Get the database server's version string
 	std::string server_version() const;
 
+	/// \brief Make Query::store() copy each result's values into an
+	/// Arena built on the given recycler
+	///
+	/// Normally, store() gives every value too long to fit inside its
+	/// String's SQLBuffer its own block of heap memory.  With this
+	/// set, all of a result's values are copied into a few large
+	/// blocks, which are freed, or kept by the recycler for the next
+	/// result, when the last String pointing into them goes away.
+	/// The recycler isn't owned by the connection, and it must outlive
+	/// every result stored with it.  Pass 0 to go back to separate
+	/// blocks.  set_zero_copy() takes precedence over this, since it
+	/// copies nothing at all.
+	///
+	/// \sa ArenaRecycler
+	void set_arena_recycler(ArenaRecycler* recycler)
+			{ arena_recycler_ = recycler; }
+
 	/// \brief Sets a connection option
 	///
 	/// \param o pointer to any derivative of Option allocated on
@@ -291,6 +350,34 @@ public:
 	/// \retval true if option was successfully set
 	bool set_option(Option* o);
 
+	/// \brief Make this connection's queries use a cache of query
+	/// results
+	///
+	/// Query::store() then answers repeated SELECTs from the cache, and
+	/// every other statement this connection's queries run drops the
+	/// cached results it may have made stale.  The cache isn't owned
+	/// by the connection, so it may be shared by several, but it must
+	/// outlive them all.  Pass 0 to stop using the cache.
+	///
+	/// \sa ResultCache
+	void set_result_cache(ResultCache* cache) { cache_ = cache; }
+
+	/// \brief Make Query::store() share the C API's copy of each
+	/// result's rows instead of copying them
+	///
+	/// Normally, store() copies every value of every row out of the
+	/// C API's result set into a separate String, then frees the
+	/// result set, so for a moment the result is held twice.  With
+	/// this set, each String points into the result set instead, which
+	/// stays alive until the last String pointing into it goes away.
+	/// That saves the copies and the memory, but one String kept from
+	/// a large result keeps all of it alive; copy the value into a new
+	/// String to avoid that.  Assigning to a String always makes it
+	/// hold its own copy.
+	///
+	/// \sa StoreQueryResult::StoreQueryResult()
+	void set_zero_copy(bool zero_copy = true) { zero_copy_ = zero_copy; }
+
 	/// \brief Ask database server to shut down.
 	bool shutdown();
 
@@ -332,6 +419,12 @@ public:
 	/// \retval True if there was no problem
 	static bool thread_start();
 
+	/// \brief Returns true if Query::store() shares the C API's copy
+	/// of each result's rows
+	///
+	/// \sa set_zero_copy()
+	bool zero_copy() const { return zero_copy_; }
+
 protected:
 	/// \brief Build an error message in the standard form used whenever
 	/// one of the methods can't succeed because we're not connected to
@@ -354,6 +447,9 @@ protected:
 private:
 	DBDriver* driver_;
 	bool copacetic_;
+	ResultCache* cache_;
+	bool zero_copy_;
+	ArenaRecycler* arena_recycler_;
 };
 
 
@@ -27,6 +27,7 @@
 #include "dbdriver.h"
 
 #include "exceptions.h"
+#include "sqlescape.h"
 
 #include <cstring>
 #include <memory>
@@ -44,7 +45,8 @@ using namespace std;
 namespace mysqlpp {
 
 DBDriver::DBDriver() :
-is_connected_(false)
+is_connected_(false),
+connecting_(false)
 {
 	// We won't allow calls to mysql_*() functions that take a MYSQL
 	// object until we get a connection up.  Such calls are nonsense.
@@ -54,7 +56,8 @@ is_connected_(false)
 
 
 DBDriver::DBDriver(const DBDriver& other) :
-is_connected_(false)
+is_connected_(false),
+connecting_(false)
 {
 	copy(other);
 }
@@ -62,9 +65,7 @@ is_connected_(false)
 
 DBDriver::~DBDriver()
 {
-	if (connected()) {
-		disconnect();
-	}
+	disconnect();		// also abandons a connect_nonblocking() in progress
 
 	OptionList::const_iterator it;
 	for (it = applied_options_.begin(); it != applied_options_.end(); ++it) {
@@ -96,6 +97,30 @@ DBDriver::connect(const MYSQL& other)
 }
 
 
+#if defined(MYSQLPP_HAVE_NONBLOCKING)
+net_async_status
+DBDriver::connect_nonblocking(const char* host, const char* socket_name,
+		unsigned int port, const char* db, const char* user,
+		const char* password)
+{
+	if (!connecting_) {
+		if (!connect_prepare()) {
+			return NET_ASYNC_ERROR;
+		}
+		connecting_ = true;
+	}
+
+	net_async_status rc = mysql_real_connect_nonblocking(&mysql_, host,
+			user, password, db, port, socket_name, mysql_.client_flag);
+	if (rc != NET_ASYNC_NOT_READY) {
+		connecting_ = false;
+		is_connected_ = rc == NET_ASYNC_COMPLETE;
+	}
+	return rc;
+}
+#endif
+
+
 bool
 DBDriver::connect_prepare()
 {
@@ -140,10 +165,10 @@ DBDriver::copy(const DBDriver& other)
 void
 DBDriver::disconnect()
 {
-	if (is_connected_) {
+	if (is_connected_ || connecting_) {
 		mysql_close(&mysql_);
 		memset(&mysql_, 0, sizeof(mysql_));
-		is_connected_ = false;
+		is_connected_ = connecting_ = false;
 		error_message_.clear();
 	}
 }
@@ -167,6 +192,76 @@ DBDriver::enable_ssl(const char* key, const char* cert,
 }
 
 
+size_t
+DBDriver::escape_into(std::string* ps, const char* original,
+		size_t length, DBDriver* driver)
+{
+	if ((original >= ps->data()) &&
+			(original < ps->data() + ps->length())) {
+		// Escaping in place; the C API can't do that, so build the
+		// result beside the original and swap it in.
+		std::string escaped;
+		escape_into(&escaped, original, length, driver);
+		ps->swap(escaped);
+		return ps->length();
+	}
+
+	// Size the destination for the worst case, escape straight into
+	// it, then trim it to the escaped length.  std::string doesn't
+	// give back memory on shrinking, so reusing ps makes this free of
+	// allocations after the first call.
+	ps->resize(length * 2 + 1);
+	length = driver ?
+			driver->escape_string(&(*ps)[0], original, length) :
+			DBDriver::escape_string_no_conn(&(*ps)[0], original, length);
+	ps->resize(length);
+	return length;
+}
+
+
+// Adapters between the C API's escaping functions and escape_sql()
+static size_t
+escape_run(void* ctx, char* to, const char* from, size_t length)
+{
+	return mysql_real_escape_string(static_cast<MYSQL*>(ctx), to, from,
+			static_cast<unsigned long>(length));
+}
+
+static size_t
+escape_run_no_conn(void*, char* to, const char* from, size_t length)
+{
+	return mysql_escape_string(to, from, static_cast<unsigned long>(length));
+}
+
+
+size_t
+DBDriver::escape_string(char* to, const char* from, size_t length)
+{
+	error_message_.clear();
+
+#if MYSQL_VERSION_ID >= 50001
+	// With NO_BACKSLASH_ESCAPES in effect, the C API escapes quotes by
+	// doubling them instead, so leave it to that.
+	if (!(mysql_.server_status & SERVER_STATUS_NO_BACKSLASH_ESCAPES))
+#endif
+	{
+		const char* cs = mysql_character_set_name(&mysql_);
+		if (cs && ((strcmp(cs, "latin1") == 0) ||
+				(strcmp(cs, "ascii") == 0) ||
+				(strcmp(cs, "binary") == 0))) {
+			// Single-byte character sets; nothing to do for non-ASCII
+			return escape_sql(to, from, length);
+		}
+		else if (cs && (strncmp(cs, "utf8", 4) == 0)) {
+			return escape_sql(to, from, length, escape_run, &mysql_);
+		}
+	}
+
+	return mysql_real_escape_string(&mysql_, to, from,
+			static_cast<unsigned long>(length));
+}
+
+
 size_t
 DBDriver::escape_string(std::string* ps, const char* original,
 		size_t length)
@@ -190,12 +285,14 @@ DBDriver::escape_string(std::string* ps, const char* original,
 		length = strlen(original);
 	}
 
-	char* escaped = new char[length * 2 + 1];
-	length = escape_string(escaped, original, length);
-	ps->assign(escaped, length);
-	delete[] escaped;
+	return escape_into(ps, original, length, this);
+}
+
 
-	return length;
+size_t
+DBDriver::escape_string_no_conn(char* to, const char* from, size_t length)
+{
+	return escape_sql(to, from, length, escape_run_no_conn, 0);
 }
 
 
@@ -220,12 +317,7 @@ DBDriver::escape_string_no_conn(std::string* ps, const char* original,
 		length = strlen(original);
 	}
 
-	char* escaped = new char[length * 2 + 1];
-	length = DBDriver::escape_string_no_conn(escaped, original, length);
-	ps->assign(escaped, length);
-	delete[] escaped;
-
-	return length;
+	return escape_into(ps, original, length, 0);
 }
 
 
@@ -88,6 +88,16 @@ public:
 		return mysql_affected_rows(&mysql_);
 	}
 
+	/// \brief Get the name of the connection's character set, the one
+	/// SET NAMES or mysql_set_character_set() last chose
+	///
+	/// Wraps \c mysql_character_set_name() in the MySQL C API.
+	const char* character_set_name()
+	{
+		error_message_.clear();
+		return mysql_character_set_name(&mysql_);
+	}
+
 	/// \brief Get database client library version
 	///
 	/// Wraps \c mysql_get_client_info() in the MySQL C API.
@@ -112,6 +122,22 @@ public:
 			unsigned int port, const char* db, const char* user,
 			const char* password);
 
+#if defined(MYSQLPP_HAVE_NONBLOCKING)
+	/// \brief Start or continue connecting to the database server
+	/// without blocking
+	///
+	/// Takes the same parameters as connect().  Call it again with the
+	/// same parameters each time it returns \c NET_ASYNC_NOT_READY,
+	/// once socket() is ready for I/O.  Connections made this way are
+	/// the only ones the other \c _nonblocking methods work properly
+	/// on: on a connection made with connect(), they block.
+	///
+	/// Wraps \c mysql_real_connect_nonblocking() in the MySQL C API.
+	net_async_status connect_nonblocking(const char* host,
+			const char* socket_name, unsigned int port, const char* db,
+			const char* user, const char* password);
+#endif
+
 	/// \brief Return true if we have an active connection to the
 	/// database server.
 	///
@@ -201,19 +227,20 @@ public:
 	///
 	/// \retval number of characters placed in escaped
 	///
-	/// Wraps \c mysql_real_escape_string() in the MySQL C API.
+	/// Produces the same output as \c mysql_real_escape_string() in
+	/// the MySQL C API.  For the \c latin1, \c ascii, \c binary and
+	/// UTF-8 character sets, it uses a vectorized escaper that copies
+	/// runs of characters not needing escaping in bulk, only calling
+	/// the C API for non-ASCII characters in UTF-8.  For other
+	/// character sets, or if the server has backslash escapes turned
+	/// off, it simply wraps the C API function.
 	///
 	/// Proper SQL escaping takes the database's current character set 
 	/// into account, however if a database connection isn't available
 	/// DBDriver also provides a static version of this same method.
 	///
 	/// \sa escape_string_no_conn(char*, const char*, size_t)
-	size_t escape_string(char* to, const char* from, size_t length)
-	{
-		error_message_.clear();
-		return mysql_real_escape_string(&mysql_, to, from, 
-				static_cast<unsigned long>(length));
-	}
+	size_t escape_string(char* to, const char* from, size_t length);
 
 	/// \brief Return a SQL-escaped version of a character buffer
 	///
@@ -260,15 +287,15 @@ public:
 	/// \brief SQL-escapes the given string without reference to the 
 	/// character set of a database server.
 	///
-	/// Wraps \c mysql_escape_string() in the MySQL C API.
+	/// Produces the same output as \c mysql_escape_string() in the
+	/// MySQL C API, using the same vectorized escaper as
+	/// escape_string(char*, const char*, size_t).  Runs of non-ASCII
+	/// characters are still passed to the C API, since we don't know
+	/// which character set it will assume.
 	///
 	/// \sa escape_string(char*, const char*, size_t)
 	static size_t escape_string_no_conn(char* to, const char* from,
-			size_t length)
-	{
-		return mysql_escape_string(to, from,
-				static_cast<unsigned long>(length));
-	}
+			size_t length);
 
 	/// \brief SQL-escapes the given string without reference to the 
 	/// character set of a database server.
@@ -288,6 +315,22 @@ public:
 				static_cast<unsigned long>(length));
 	}
 
+#if defined(MYSQLPP_HAVE_NONBLOCKING)
+	/// \brief Starts or continues executing the given query string
+	/// without blocking
+	///
+	/// Call this again with the same arguments each time it returns
+	/// \c NET_ASYNC_NOT_READY, once socket() is ready for I/O.
+	///
+	/// Wraps \c mysql_real_query_nonblocking() in the MySQL C API.
+	net_async_status execute_nonblocking(const char* qstr, size_t length)
+	{
+		error_message_.clear();
+		return mysql_real_query_nonblocking(&mysql_, qstr,
+				static_cast<unsigned long>(length));
+	}
+#endif
+
 	/// \brief Returns the next raw C API row structure from the given
 	/// result set.
 	///
@@ -301,6 +344,19 @@ public:
 		return mysql_fetch_row(res);
 	}
 
+#if defined(MYSQLPP_HAVE_NONBLOCKING)
+	/// \brief Starts or continues fetching the next row of a "use"
+	/// query result set without blocking
+	///
+	/// Wraps \c mysql_fetch_row_nonblocking() in MySQL C API.
+	net_async_status fetch_row_nonblocking(MYSQL_RES* res,
+			MYSQL_ROW* row) const
+	{
+		error_message_.clear();
+		return mysql_fetch_row_nonblocking(res, row);
+	}
+#endif
+
 	/// \brief Returns the lengths of the fields in the current row
 	/// from a "use" query.
 	///
@@ -350,6 +406,20 @@ public:
 		mysql_free_result(res);
 	}
 
+#if defined(MYSQLPP_HAVE_NONBLOCKING)
+	/// \brief Starts or continues releasing a result set without
+	/// blocking
+	///
+	/// This can block when rows of a "use" query remain to be read.
+	///
+	/// Wraps \c mysql_free_result_nonblocking() in MySQL C API.
+	net_async_status free_result_nonblocking(MYSQL_RES* res) const
+	{
+		error_message_.clear();
+		return mysql_free_result_nonblocking(res);
+	}
+#endif
+
 	/// \brief Return the connection options object
 	st_mysql_options get_options() const { return mysql_.options; }
 
@@ -382,6 +452,16 @@ public:
 		return mysql_insert_id(&mysql_);
 	}
 
+	/// \brief Returns true if the server says a transaction is open
+	/// on this connection, as of the last statement
+	///
+	/// Reads \c SERVER_STATUS_IN_TRANS from the status the server
+	/// sends with each reply.
+	bool in_transaction() const
+	{
+		return (mysql_.server_status & SERVER_STATUS_IN_TRANS) != 0;
+	}
+
 	/// \brief Kill a MySQL server thread
 	///
 	/// \param tid ID of thread to kill
@@ -432,6 +512,21 @@ public:
 		#endif
 	}
 
+#if defined(MYSQLPP_HAVE_NONBLOCKING)
+	/// \brief Starts or continues moving to the next result set of a
+	/// multi-query without blocking
+	///
+	/// Returns \c NET_ASYNC_COMPLETE_NO_MORE_RESULTS instead of
+	/// \c NET_ASYNC_COMPLETE when there are no more results.
+	///
+	/// Wraps \c mysql_next_result_nonblocking() in the MySQL C API.
+	net_async_status next_result_nonblocking()
+	{
+		error_message_.clear();
+		return mysql_next_result_nonblocking(&mysql_);
+	}
+#endif
+
 	/// \brief Returns the number of fields in the given result set
 	///
 	/// Wraps \c mysql_num_fields() in MySQL C API.
@@ -521,6 +616,32 @@ public:
 		return mysql_get_server_info(&mysql_);
 	}
 
+	/// \brief Go back to the C API's own handling of
+	/// <tt>LOAD DATA LOCAL INFILE</tt>, which reads a real file
+	///
+	/// Wraps \c mysql_set_local_infile_default() in the MySQL C API.
+	void set_local_infile_default()
+	{
+		mysql_set_local_infile_default(&mysql_);
+	}
+
+	/// \brief Install callbacks that supply the data for
+	/// <tt>LOAD DATA LOCAL INFILE</tt> statements, instead of having
+	/// the C API read the named file
+	///
+	/// Wraps \c mysql_set_local_infile_handler() in the MySQL C API.
+	/// BulkLoader uses this to stream data from memory.
+	void set_local_infile_handler(
+			int (*init)(void**, const char*, void*),
+			int (*read)(void*, char*, unsigned int),
+			void (*end)(void*),
+			int (*error)(void*, char*, unsigned int),
+			void* userdata)
+	{
+		mysql_set_local_infile_handler(&mysql_, init, read, end, error,
+				userdata);
+	}
+
 	/// \brief Sets a connection option
 	///
 	/// This is the database-independent high-level option setting
@@ -597,6 +718,209 @@ public:
 		return mysql_stat(&mysql_);
 	}
 
+	/// \brief Returns the connection's socket descriptor
+	///
+	/// Wait on this for I/O readiness when using the \c _nonblocking
+	/// methods.  It's -1 on platforms where sockets aren't plain
+	/// integers, or if we're not connected.
+	int socket() const
+	{
+	#if defined(MYSQLPP_PLATFORM_WINDOWS)
+		return -1;
+	#else
+		return connected() || connecting_ ? mysql_.net.fd : -1;
+	#endif
+	}
+
+	/// \brief Return the number of rows affected by the last execution
+	/// of a prepared statement
+	///
+	/// Wraps \c mysql_stmt_affected_rows() in the MySQL C API.
+	ulonglong stmt_affected_rows(MYSQL_STMT* stmt) const
+	{
+		error_message_.clear();
+		return mysql_stmt_affected_rows(stmt);
+	}
+
+	/// \brief Sets an attribute on a prepared statement
+	///
+	/// Wraps \c mysql_stmt_attr_set() in the MySQL C API.
+	bool stmt_attr_set(MYSQL_STMT* stmt, enum_stmt_attr_type attr,
+			const void* arg) const
+	{
+		error_message_.clear();
+		return !mysql_stmt_attr_set(stmt, attr, arg);
+	}
+
+	/// \brief Attaches the given parameter buffers to a prepared
+	/// statement
+	///
+	/// \retval true if the C API accepted the bindings
+	///
+	/// Wraps \c mysql_stmt_bind_param() in the MySQL C API.
+	bool stmt_bind_param(MYSQL_STMT* stmt, MYSQL_BIND* binds) const
+	{
+		error_message_.clear();
+		return !mysql_stmt_bind_param(stmt, binds);
+	}
+
+	/// \brief Attaches the given buffers to a prepared statement to
+	/// receive column values from each row fetched
+	///
+	/// Wraps \c mysql_stmt_bind_result() in the MySQL C API.
+	bool stmt_bind_result(MYSQL_STMT* stmt, MYSQL_BIND* binds) const
+	{
+		error_message_.clear();
+		return !mysql_stmt_bind_result(stmt, binds);
+	}
+
+	/// \brief Return the last error number associated with a prepared
+	/// statement
+	///
+	/// Wraps \c mysql_stmt_errno() in the MySQL C API.
+	int stmt_errno(MYSQL_STMT* stmt) const
+	{
+		return mysql_stmt_errno(stmt);
+	}
+
+	/// \brief Return the last error message associated with a prepared
+	/// statement
+	///
+	/// Wraps \c mysql_stmt_error() in the MySQL C API.
+	const char* stmt_error(MYSQL_STMT* stmt) const
+	{
+		return mysql_stmt_error(stmt);
+	}
+
+	/// \brief Executes a prepared statement using the values in its
+	/// currently bound parameter buffers
+	///
+	/// Wraps \c mysql_stmt_execute() in the MySQL C API.
+	bool stmt_execute(MYSQL_STMT* stmt) const
+	{
+		error_message_.clear();
+		return !mysql_stmt_execute(stmt);
+	}
+
+	/// \brief Fetches the next row of a prepared statement's result
+	/// set into the buffers given to stmt_bind_result()
+	///
+	/// \retval 0 on success, \c MYSQL_NO_DATA after the last row,
+	/// \c MYSQL_DATA_TRUNCATED if a buffer was too small, 1 on error
+	///
+	/// Wraps \c mysql_stmt_fetch() in the MySQL C API.
+	int stmt_fetch(MYSQL_STMT* stmt) const
+	{
+		error_message_.clear();
+		return mysql_stmt_fetch(stmt);
+	}
+
+	/// \brief Fetches one column of the current row again, into a
+	/// different buffer
+	///
+	/// Used to recover values truncated by stmt_fetch().
+	///
+	/// Wraps \c mysql_stmt_fetch_column() in the MySQL C API.
+	bool stmt_fetch_column(MYSQL_STMT* stmt, MYSQL_BIND* bind,
+			size_t column, size_t offset = 0) const
+	{
+		error_message_.clear();
+		return !mysql_stmt_fetch_column(stmt, bind,
+				static_cast<unsigned int>(column),
+				static_cast<unsigned long>(offset));
+	}
+
+	/// \brief Releases the result set buffered for a prepared
+	/// statement
+	///
+	/// Wraps \c mysql_stmt_free_result() in the MySQL C API.
+	void stmt_free_result(MYSQL_STMT* stmt) const
+	{
+		error_message_.clear();
+		mysql_stmt_free_result(stmt);
+	}
+
+	/// \brief Allocates a new prepared statement handle on this
+	/// connection
+	///
+	/// Free it with \c mysql_stmt_close(), typically by handing it to a
+	/// RefCountedPointer<MYSQL_STMT>.
+	///
+	/// Wraps \c mysql_stmt_init() in the MySQL C API.
+	MYSQL_STMT* stmt_init()
+	{
+		error_message_.clear();
+		return mysql_stmt_init(&mysql_);
+	}
+
+	/// \brief Get ID generated for an AUTO_INCREMENT column by the last
+	/// execution of a prepared statement
+	///
+	/// Wraps \c mysql_stmt_insert_id() in the MySQL C API.
+	ulonglong stmt_insert_id(MYSQL_STMT* stmt) const
+	{
+		error_message_.clear();
+		return mysql_stmt_insert_id(stmt);
+	}
+
+	/// \brief Return the number of rows in a prepared statement's
+	/// buffered result set
+	///
+	/// Wraps \c mysql_stmt_num_rows() in the MySQL C API.
+	ulonglong stmt_num_rows(MYSQL_STMT* stmt) const
+	{
+		error_message_.clear();
+		return mysql_stmt_num_rows(stmt);
+	}
+
+	/// \brief Return the number of parameter markers the server found
+	/// in a prepared statement
+	///
+	/// Wraps \c mysql_stmt_param_count() in the MySQL C API.
+	size_t stmt_param_count(MYSQL_STMT* stmt) const
+	{
+		error_message_.clear();
+		return mysql_stmt_param_count(stmt);
+	}
+
+	/// \brief Returns field information for a prepared statement's
+	/// result set
+	///
+	/// \retval 0 if the statement doesn't return rows.  Otherwise, free
+	/// the returned structure with free_result().
+	///
+	/// Wraps \c mysql_stmt_result_metadata() in the MySQL C API.
+	MYSQL_RES* stmt_result_metadata(MYSQL_STMT* stmt) const
+	{
+		error_message_.clear();
+		return mysql_stmt_result_metadata(stmt);
+	}
+
+	/// \brief Sends a statement to the server for preparation
+	///
+	/// \param stmt handle returned by stmt_init()
+	/// \param qstr SQL statement, with \c ? marking each parameter
+	/// \param length number of bytes in qstr
+	///
+	/// Wraps \c mysql_stmt_prepare() in the MySQL C API.
+	bool stmt_prepare(MYSQL_STMT* stmt, const char* qstr,
+			size_t length) const
+	{
+		error_message_.clear();
+		return !mysql_stmt_prepare(stmt, qstr,
+				static_cast<unsigned long>(length));
+	}
+
+	/// \brief Buffers the entire result set of a prepared statement
+	/// on the client
+	///
+	/// Wraps \c mysql_stmt_store_result() in the MySQL C API.
+	bool stmt_store_result(MYSQL_STMT* stmt) const
+	{
+		error_message_.clear();
+		return !mysql_stmt_store_result(stmt);
+	}
+
 	/// \brief Saves the results of the query just execute()d in memory
 	/// and returns a pointer to the MySQL C API data structure the
 	/// results are stored in.
@@ -610,6 +934,20 @@ public:
 		return mysql_store_result(&mysql_);
 	}
 
+#if defined(MYSQLPP_HAVE_NONBLOCKING)
+	/// \brief Starts or continues saving the results of the query
+	/// just executed without blocking
+	///
+	/// \c *res is set once this returns \c NET_ASYNC_COMPLETE.
+	///
+	/// Wraps \c mysql_store_result_nonblocking() in the MySQL C API.
+	net_async_status store_result_nonblocking(MYSQL_RES** res)
+	{
+		error_message_.clear();
+		return mysql_store_result_nonblocking(&mysql_, res);
+	}
+#endif
+
 	/// \brief Returns true if MySQL++ and the underlying MySQL C API
 	/// library were both compiled with thread awareness.
 	///
@@ -684,6 +1022,15 @@ public:
 		return mysql_use_result(&mysql_);
 	}
 
+	/// \brief Returns the number of warnings the last query raised
+	///
+	/// Wraps \c mysql_warning_count() in the MySQL C API.
+	unsigned int warning_count()
+	{
+		error_message_.clear();
+		return mysql_warning_count(&mysql_);
+	}
+
 protected:
 	/// \brief Does things common to both connect() overloads, before
 	/// each go and establish the connection in their different ways.
@@ -704,8 +1051,16 @@ private:
 	/// that way.  What would it mean?
 	DBDriver& operator=(const DBDriver&);
 
+	/// \brief Common implementation of the escape_string() and
+	/// escape_string_no_conn() overloads taking a C++ string
+	///
+	/// Escapes directly into \c *ps, using \c driver if it's not 0.
+	static size_t escape_into(std::string* ps, const char* original,
+			size_t length, DBDriver* driver);
+
 	MYSQL mysql_;
 	bool is_connected_;
+	bool connecting_;
 	OptionList applied_options_;
 	OptionList pending_options_;
 	mutable std::string error_message_;
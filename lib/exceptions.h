@@ -411,6 +411,20 @@ public:
 };
 
 
+/// \brief Exception thrown when the operating system's event
+/// notification facility fails while Reactor is using it.
+
+class MYSQLPP_EXPORT ReactorFailed : public Exception
+{
+public:
+	/// \brief Create exception object
+	explicit ReactorFailed(const char* w = "") :
+	Exception(w)
+	{
+	}
+};
+
+
 /// \brief Used within MySQL++'s test harness only.
 
 class MYSQLPP_EXPORT SelfTestFailed : public Exception
@@ -424,6 +438,23 @@ public:
 };
 
 
+/// \brief Exception thrown from Future::get() when the task threw
+/// something other than BadQuery or ConnectionFailed.
+///
+/// The original exception can't be carried across threads, so this
+/// holds its what() message instead, if it had one.
+
+class MYSQLPP_EXPORT TaskFailed : public Exception
+{
+public:
+	/// \brief Create exception object
+	explicit TaskFailed(const std::string& w) :
+	Exception(w)
+	{
+	}
+};
+
+
 /// \brief Thrown from the C++ to SQL data type conversion routine when
 /// it can't figure out how to map the type.
 ///
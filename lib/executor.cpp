@@ -0,0 +1,761 @@
+/***********************************************************************
+ executor.cpp - Implements the QueryExecutor class, and the parts of
+	Future's shared state that don't depend on the task's type.
+
+ Copyright (c) 2009 by Educational Technology Resources, Inc.
+ Others may also hold copyrights on code in this file.  See the
+ CREDITS.txt file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#define MYSQLPP_NOT_HEADER
+#include "common.h"
+
+#include "executor.h"
+
+#include "connection.h"
+#include "cpool.h"
+#include "scopedconnection.h"
+#include "utility.h"
+
+#include <deque>
+#include <vector>
+
+// Windows only got condition variables in Vista.  On anything older,
+// or where we don't have pthreads, the executor runs tasks inline.
+#if defined(HAVE_PTHREAD)
+#	include <pthread.h>
+#	include <sys/time.h>
+#	define HAVE_EXECUTOR_THREADS
+#elif defined(MYSQLPP_PLATFORM_WINDOWS) && (_WIN32_WINNT >= 0x0600)
+#	define HAVE_EXECUTOR_THREADS
+#endif
+
+namespace mysqlpp {
+
+namespace {
+
+// Thin wrappers over the platform's mutex, condition variable and
+// thread primitives.  They're no-ops when we don't have threads.
+class SysMutex
+{
+public:
+#if defined(HAVE_PTHREAD)
+	SysMutex() { pthread_mutex_init(&m_, 0); }
+	~SysMutex() { pthread_mutex_destroy(&m_); }
+	void lock() { pthread_mutex_lock(&m_); }
+	void unlock() { pthread_mutex_unlock(&m_); }
+	pthread_mutex_t m_;
+#elif defined(HAVE_EXECUTOR_THREADS)
+	SysMutex() { InitializeCriticalSection(&m_); }
+	~SysMutex() { DeleteCriticalSection(&m_); }
+	void lock() { EnterCriticalSection(&m_); }
+	void unlock() { LeaveCriticalSection(&m_); }
+	CRITICAL_SECTION m_;
+#else
+	void lock() { }
+	void unlock() { }
+#endif
+};
+
+
+class SysLock
+{
+public:
+	explicit SysLock(SysMutex& m) : m_(m) { m_.lock(); }
+	~SysLock() { m_.unlock(); }
+
+private:
+	SysMutex& m_;
+};
+
+
+class SysCondition
+{
+public:
+#if defined(HAVE_PTHREAD)
+	SysCondition() { pthread_cond_init(&c_, 0); }
+	~SysCondition() { pthread_cond_destroy(&c_); }
+	void broadcast() { pthread_cond_broadcast(&c_); }
+	void signal() { pthread_cond_signal(&c_); }
+	void wait(SysMutex& m) { pthread_cond_wait(&c_, &m.m_); }
+	void wait_for(SysMutex& m, double seconds)
+	{
+		timeval now;
+		gettimeofday(&now, 0);
+		long usec = now.tv_usec + long((seconds - long(seconds)) * 1e6);
+		timespec until;
+		until.tv_sec = now.tv_sec + time_t(seconds) + usec / 1000000;
+		until.tv_nsec = (usec % 1000000) * 1000;
+		pthread_cond_timedwait(&c_, &m.m_, &until);
+	}
+
+private:
+	pthread_cond_t c_;
+#elif defined(HAVE_EXECUTOR_THREADS)
+	SysCondition() { InitializeConditionVariable(&c_); }
+	void broadcast() { WakeAllConditionVariable(&c_); }
+	void signal() { WakeConditionVariable(&c_); }
+	void wait(SysMutex& m)
+			{ SleepConditionVariableCS(&c_, &m.m_, INFINITE); }
+	void wait_for(SysMutex& m, double seconds)
+			{ SleepConditionVariableCS(&c_, &m.m_, DWORD(seconds * 1000) + 1); }
+
+private:
+	CONDITION_VARIABLE c_;
+#else
+	void broadcast() { }
+	void signal() { }
+	void wait(SysMutex&) { }
+	void wait_for(SysMutex&, double) { }
+#endif
+};
+
+
+// What a Future's shared state needs to let the waiting thread sleep
+struct FutureSync
+{
+	SysMutex mutex;
+	SysCondition done;
+};
+
+
+static FutureSync*
+sync_ptr(void* p)
+{
+	return static_cast<FutureSync*>(p);
+}
+
+
+// The executor's queues, threads, and the locking around them
+struct ExecutorImpl
+{
+	typedef std::deque<FutureStateBase*> Queue;
+
+	ExecutorImpl(ConnectionPool& p, unsigned int n, size_t limit) :
+	pool(p),
+	queues(n),
+	queue_limit(limit ? limit : 1),
+	next_queue(0),
+	queued(0),
+	stopping(false)
+	{
+	}
+
+	// Remove a task from worker me's queue, or failing that, steal
+	// one from another worker's.  Caller holds the mutex.
+	FutureStateBase* take(size_t me)
+	{
+		FutureStateBase* task = 0;
+		if (!queues[me].empty()) {
+			task = queues[me].front();
+			queues[me].pop_front();
+		}
+		else {
+			for (size_t i = 1; i < queues.size(); ++i) {
+				Queue& victim = queues[(me + i) % queues.size()];
+				if (!victim.empty()) {
+					task = victim.back();
+					victim.pop_back();
+					break;
+				}
+			}
+		}
+
+		if (task) {
+			--queued;
+		}
+		return task;
+	}
+
+	void work(size_t me);
+
+	ConnectionPool& pool;
+	std::vector<Queue> queues;
+	size_t queue_limit;
+	size_t next_queue;
+	size_t queued;
+	bool stopping;
+
+	SysMutex mutex;
+	SysCondition work_ready;	// a task was queued, or we're stopping
+	SysCondition space_ready;	// a task was dequeued, or we're stopping
+
+#if defined(HAVE_PTHREAD)
+	std::vector<pthread_t> threads;
+#elif defined(HAVE_EXECUTOR_THREADS)
+	std::vector<HANDLE> threads;
+#endif
+};
+
+
+static ExecutorImpl*
+impl_ptr(void* p)
+{
+	return static_cast<ExecutorImpl*>(p);
+}
+
+
+void
+ExecutorImpl::work(size_t me)
+{
+	// The pool's connections were probably made in other threads, so
+	// the C API won't have set up its per-thread data for this one.
+	Connection::thread_start();
+
+	for (;;) {
+		FutureStateBase* task;
+		{
+			SysLock lock(mutex);
+			while ((task = take(me)) == 0) {
+				if (stopping) {
+					Connection::thread_end();
+					return;
+				}
+				work_ready.wait(mutex);
+			}
+			space_ready.signal();
+		}
+
+		task->run(pool);
+		task->release();
+	}
+}
+
+
+#if defined(HAVE_EXECUTOR_THREADS)
+// Argument passed to each worker thread's entry point
+struct WorkerArg
+{
+	ExecutorImpl* impl;
+	size_t index;
+};
+
+#	if defined(HAVE_PTHREAD)
+extern "C" void*
+executor_worker(void* p)
+#	else
+DWORD WINAPI
+executor_worker(LPVOID p)
+#	endif
+{
+	WorkerArg* arg = static_cast<WorkerArg*>(p);
+	ExecutorImpl* impl = arg->impl;
+	size_t index = arg->index;
+	delete arg;
+
+	impl->work(index);
+	return 0;
+}
+#endif
+
+} // end anonymous namespace
+
+
+//// CommitVote ////////////////////////////////////////////////////////
+
+namespace {
+
+struct VoteState
+{
+	VoteState(unsigned int v) :
+	waiting(v),
+	all_ok(true)
+	{
+	}
+
+	SysMutex mutex;
+	SysCondition done;
+	unsigned int waiting;
+	bool all_ok;
+};
+
+
+static VoteState*
+vote_ptr(void* p)
+{
+	return static_cast<VoteState*>(p);
+}
+
+} // end anonymous namespace
+
+
+CommitVote::CommitVote(unsigned int voters) :
+impl_(new VoteState(voters))
+{
+}
+
+
+CommitVote::~CommitVote()
+{
+	delete vote_ptr(impl_);
+}
+
+
+void
+CommitVote::fail(unsigned int voters)
+{
+	VoteState* vs = vote_ptr(impl_);
+	SysLock lock(vs->mutex);
+	vs->all_ok = false;
+	vs->waiting = voters < vs->waiting ? vs->waiting - voters : 0;
+	if (vs->waiting == 0) {
+		vs->done.broadcast();
+	}
+}
+
+
+bool
+CommitVote::vote(bool ok)
+{
+	VoteState* vs = vote_ptr(impl_);
+	SysLock lock(vs->mutex);
+	if (!ok) {
+		vs->all_ok = false;
+	}
+	if (vs->waiting > 0 && --vs->waiting == 0) {
+		vs->done.broadcast();
+	}
+	while (vs->waiting > 0) {
+		vs->done.wait(vs->mutex);
+	}
+	return vs->all_ok;
+}
+
+
+//// KeyBatcher ////////////////////////////////////////////////////////
+
+namespace {
+
+struct KeyBatcherState
+{
+	// A batch not yet taken
+	struct Pending
+	{
+		KeyBatcher::BatchId id;
+		KeyBatcher::Batch items;
+		double deadline;	// per internal::seconds_now()
+		bool full;
+	};
+
+	KeyBatcherState(size_t l, unsigned int w) :
+	limit(l ? l : 1),
+	window(w / 1000.0),
+	next_id(1)
+	{
+	}
+
+	// Return the pending batch with the given ID, or end()
+	std::deque<Pending>::iterator find(KeyBatcher::BatchId id)
+	{
+		std::deque<Pending>::iterator it = pending.begin();
+		while ((it != pending.end()) && (it->id != id)) {
+			++it;
+		}
+		return it;
+	}
+
+	size_t limit;
+	double window;
+	KeyBatcher::BatchId next_id;
+	std::deque<Pending> pending;	// oldest first
+
+	SysMutex mutex;
+	SysCondition changed;	// a batch filled up or was taken
+};
+
+
+static KeyBatcherState*
+batcher_ptr(void* p)
+{
+	return static_cast<KeyBatcherState*>(p);
+}
+
+} // end anonymous namespace
+
+
+KeyBatcher::KeyBatcher(size_t limit, unsigned int window_ms) :
+impl_(new KeyBatcherState(limit, window_ms))
+{
+}
+
+
+KeyBatcher::~KeyBatcher()
+{
+	KeyBatcherState* ks = batcher_ptr(impl_);
+	{
+		SysLock lock(ks->mutex);
+		while (!ks->pending.empty()) {
+			ks->changed.wait(ks->mutex);
+		}
+	}
+	delete ks;
+}
+
+
+KeyBatcher::BatchId
+KeyBatcher::add(const std::string& key, Waiter* waiter)
+{
+	KeyBatcherState* ks = batcher_ptr(impl_);
+	SysLock lock(ks->mutex);
+
+	BatchId opened = 0;
+	if (ks->pending.empty() || ks->pending.back().full) {
+		opened = ks->next_id++;
+		if (ks->next_id == 0) {
+			ks->next_id = 1;	// wrapped; 0 means "no new batch"
+		}
+		ks->pending.push_back(KeyBatcherState::Pending());
+		ks->pending.back().id = opened;
+		ks->pending.back().deadline = internal::seconds_now() +
+				ks->window;
+		ks->pending.back().full = false;
+	}
+
+	KeyBatcherState::Pending& batch = ks->pending.back();
+	batch.items.push_back(Item());
+	batch.items.back().key = key;
+	batch.items.back().waiter = waiter;
+	if (batch.items.size() >= ks->limit) {
+		batch.full = true;
+		ks->changed.broadcast();
+	}
+
+	return opened;
+}
+
+
+void
+KeyBatcher::take(BatchId id, Batch& batch)
+{
+	KeyBatcherState* ks = batcher_ptr(impl_);
+	SysLock lock(ks->mutex);
+	std::deque<KeyBatcherState::Pending>::iterator it = ks->find(id);
+
+#if defined(HAVE_EXECUTOR_THREADS)
+	while ((it != ks->pending.end()) && !it->full) {
+		double left = it->deadline - internal::seconds_now();
+		if (left <= 0) {
+			break;
+		}
+		ks->changed.wait_for(ks->mutex, left);
+		it = ks->find(id);		// others may have come and gone
+	}
+#endif
+
+	batch.clear();
+	if (it != ks->pending.end()) {
+		batch.swap(it->items);
+		ks->pending.erase(it);
+	}
+	ks->changed.broadcast();
+}
+
+
+void
+KeyBatcher::cancel(BatchId id, Batch& batch)
+{
+	KeyBatcherState* ks = batcher_ptr(impl_);
+	SysLock lock(ks->mutex);
+
+	batch.clear();
+	std::deque<KeyBatcherState::Pending>::iterator it = ks->find(id);
+	if (it != ks->pending.end()) {
+		batch.swap(it->items);
+		ks->pending.erase(it);
+	}
+	ks->changed.broadcast();
+}
+
+
+//// FutureStateBase ///////////////////////////////////////////////////
+
+FutureStateBase::FutureStateBase() :
+sync_(new FutureSync),
+refs_(1),
+ready_(false),
+error_kind_(no_error),
+errnum_(0)
+{
+}
+
+
+FutureStateBase::~FutureStateBase()
+{
+	delete sync_ptr(sync_);
+}
+
+
+void
+FutureStateBase::add_ref()
+{
+	SysLock lock(sync_ptr(sync_)->mutex);
+	++refs_;
+}
+
+
+void
+FutureStateBase::fail(const std::exception& e)
+{
+	if (const BadQuery* bq = dynamic_cast<const BadQuery*>(&e)) {
+		finish(bad_query, bq->what(), bq->errnum());
+	}
+	else if (const ConnectionFailed* cf =
+			dynamic_cast<const ConnectionFailed*>(&e)) {
+		finish(connection_failed, cf->what(), cf->errnum());
+	}
+	else {
+		finish(other_error, e.what(), 0);
+	}
+}
+
+
+void
+FutureStateBase::finish(ErrorKind kind, const char* msg, int errnum)
+{
+	FutureSync* sync = sync_ptr(sync_);
+	SysLock lock(sync->mutex);
+	error_kind_ = kind;
+	error_ = msg;
+	errnum_ = errnum;
+	ready_ = true;
+	sync->done.broadcast();
+}
+
+
+bool
+FutureStateBase::ready() const
+{
+	SysLock lock(sync_ptr(sync_)->mutex);
+	return ready_;
+}
+
+
+void
+FutureStateBase::release()
+{
+	bool last;
+	{
+		SysLock lock(sync_ptr(sync_)->mutex);
+		last = --refs_ == 0;
+	}
+
+	if (last) {
+		delete this;
+	}
+}
+
+
+void
+FutureStateBase::rethrow() const
+{
+	// Only called after wait(), so the fields are settled
+	switch (error_kind_) {
+		case bad_query:
+			throw BadQuery(error_, errnum_);
+
+		case connection_failed:
+			throw ConnectionFailed(error_.c_str(), errnum_);
+
+		case other_error:
+			throw TaskFailed(error_);
+
+		default:
+			break;
+	}
+}
+
+
+void
+FutureStateBase::run(ConnectionPool& pool)
+{
+	bool called = false;
+	try {
+		ScopedConnection conn(pool);
+		if (!conn) {
+			throw ConnectionFailed("pool gave us no connection");
+		}
+		called = true;
+		call(*conn);
+	}
+	catch (const std::exception& e) {
+		if (!called) {
+			abandon(e);
+		}
+		fail(e);
+		return;
+	}
+	catch (...) {
+		if (!called) {
+			abandon(TaskFailed("connection pool threw an unknown "
+					"exception"));
+		}
+		finish(other_error, "task threw an unknown exception", 0);
+		return;
+	}
+
+	succeed();
+}
+
+
+void
+FutureStateBase::succeed()
+{
+	finish(no_error, "", 0);
+}
+
+
+void
+FutureStateBase::wait() const
+{
+	FutureSync* sync = sync_ptr(sync_);
+	SysLock lock(sync->mutex);
+	while (!ready_) {
+		sync->done.wait(sync->mutex);
+	}
+}
+
+
+//// QueryExecutor /////////////////////////////////////////////////////
+
+QueryExecutor::QueryExecutor(ConnectionPool& pool, unsigned int threads,
+		size_t queue_limit) :
+pool_(pool),
+threads_(0),
+impl_(0)
+{
+#if defined(HAVE_EXECUTOR_THREADS)
+	if (threads == 0) {
+		threads = 1;
+	}
+	ExecutorImpl* impl = new ExecutorImpl(pool, threads, queue_limit);
+	impl_ = impl;
+
+	for (unsigned int i = 0; i < threads; ++i) {
+		WorkerArg* arg = new WorkerArg;
+		arg->impl = impl;
+		arg->index = i;
+#	if defined(HAVE_PTHREAD)
+		pthread_t t;
+		bool started = pthread_create(&t, 0, executor_worker, arg) == 0;
+#	else
+		HANDLE t = CreateThread(0, 0, executor_worker, arg, 0, 0);
+		bool started = t != 0;
+#	endif
+		if (!started) {
+			delete arg;
+			shutdown();
+			delete impl;
+			throw ObjectNotInitialized("failed to start executor thread");
+		}
+		impl->threads.push_back(t);
+		++threads_;
+	}
+#else
+	(void)threads;
+	(void)queue_limit;
+#endif
+}
+
+
+QueryExecutor::~QueryExecutor()
+{
+	shutdown();
+	delete impl_ptr(impl_);
+}
+
+
+bool
+QueryExecutor::enqueue(FutureStateBase* task, bool wait)
+{
+#if defined(HAVE_EXECUTOR_THREADS)
+	ExecutorImpl* impl = impl_ptr(impl_);
+	SysLock lock(impl->mutex);
+	for (;;) {
+		if (impl->stopping) {
+			throw ObjectNotInitialized("QueryExecutor is shut down");
+		}
+
+		// Start looking where the last task went, so the work spreads
+		// evenly over the queues.
+		const size_t n = impl->queues.size();
+		for (size_t i = 0; i < n; ++i) {
+			size_t q = (impl->next_queue + i) % n;
+			if (impl->queues[q].size() < impl->queue_limit) {
+				task->add_ref();
+				impl->queues[q].push_back(task);
+				impl->next_queue = (q + 1) % n;
+				++impl->queued;
+				impl->work_ready.signal();
+				return true;
+			}
+		}
+
+		if (!wait) {
+			return false;
+		}
+		impl->space_ready.wait(impl->mutex);
+	}
+#else
+	(void)wait;
+	task->run(pool_);
+	return true;
+#endif
+}
+
+
+size_t
+QueryExecutor::queued() const
+{
+#if defined(HAVE_EXECUTOR_THREADS)
+	ExecutorImpl* impl = impl_ptr(impl_);
+	SysLock lock(impl->mutex);
+	return impl->queued;
+#else
+	return 0;
+#endif
+}
+
+
+void
+QueryExecutor::shutdown()
+{
+#if defined(HAVE_EXECUTOR_THREADS)
+	ExecutorImpl* impl = impl_ptr(impl_);
+	{
+		SysLock lock(impl->mutex);
+		impl->stopping = true;
+		impl->work_ready.broadcast();
+		impl->space_ready.broadcast();
+	}
+
+	for (size_t i = 0; i < impl->threads.size(); ++i) {
+#	if defined(HAVE_PTHREAD)
+		pthread_join(impl->threads[i], 0);
+#	else
+		WaitForSingleObject(impl->threads[i], INFINITE);
+		CloseHandle(impl->threads[i]);
+#	endif
+	}
+	impl->threads.clear();
+	threads_ = 0;
+#endif
+}
+
+} // end namespace mysqlpp
@@ -0,0 +1,671 @@
+/// \file executor.h
+/// \brief Declares the QueryExecutor class, which runs database work on
+/// a fixed set of worker threads using connections from a
+/// ConnectionPool, and the Future template, which carries each piece
+/// of work's result back to the caller.
+
+/***********************************************************************
+ Copyright (c) 2009 by Educational Technology Resources, Inc.
+ Others may also hold copyrights on code in this file.  See the
+ CREDITS.txt file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#if !defined(MYSQLPP_EXECUTOR_H)
+#define MYSQLPP_EXECUTOR_H
+
+#include "common.h"
+
+#include "exceptions.h"
+
+#include <string>
+#include <vector>
+
+namespace mysqlpp {
+
+#if !defined(DOXYGEN_IGNORE)
+// Make Doxygen ignore this
+class MYSQLPP_EXPORT Connection;
+class MYSQLPP_EXPORT ConnectionPool;
+#endif
+
+/// \brief Lets a group of tasks running in parallel agree on whether
+/// to commit their work.
+///
+/// Each of the tasks calls vote() once, saying whether its part
+/// succeeded, and blocks there until all of them have voted.  They
+/// then all get the same answer: true only if every part succeeded.
+/// This is the coordination step of a two-phase commit; see
+/// ParallelInsert for a user.
+///
+/// All the voters have to be running at once for this to work, so
+/// don't create one with more voters than the QueryExecutor running
+/// them has threads.
+
+class MYSQLPP_EXPORT CommitVote
+{
+public:
+	/// \brief Create a vote among the given number of tasks
+	explicit CommitVote(unsigned int voters);
+
+	/// \brief Destroy the object
+	~CommitVote();
+
+	/// \brief Cast failing votes on behalf of voters that will never
+	/// run, without waiting
+	///
+	/// Use this if some of the tasks couldn't be started, so the ones
+	/// that were don't wait forever for them.
+	void fail(unsigned int voters);
+
+	/// \brief Cast this task's vote, and wait for the outcome
+	///
+	/// \retval true if all the voters passed true
+	bool vote(bool ok);
+
+private:
+	void* impl_;
+
+	// Can't copy these
+	CommitVote(const CommitVote&);
+	CommitVote& operator=(const CommitVote&);
+};
+
+
+/// \brief Gathers keys asked for by many threads into batches, each
+/// closed when it reaches a size limit or has been open for a set
+/// time.
+///
+/// \internal This is the type-independent core of KeyedLoader.  Each
+/// add() call that opens a batch must be matched by exactly one take()
+/// call for the batch's ID, normally made by a task queued on a
+/// QueryExecutor, or by one cancel() call if no task could be queued.
+///
+/// Without thread support, take() doesn't wait, so each batch holds
+/// whatever was added before the task that takes it runs.
+
+class MYSQLPP_EXPORT KeyBatcher
+{
+public:
+	/// \brief What a caller waiting on a key leaves in the batch
+	///
+	/// KeyedLoader derives from this to carry its result type.
+	class Waiter
+	{
+	public:
+		/// \brief Destroy the object
+		virtual ~Waiter() { }
+	};
+
+	/// \brief A key and the caller waiting on it
+	struct Item
+	{
+		std::string key;	///< the key, as SQL text
+		Waiter* waiter;		///< the caller's waiter
+	};
+
+	/// \brief The keys in a batch, in the order they were added
+	typedef std::vector<Item> Batch;
+
+	/// \brief Identifies a batch; add() never returns 0 for one
+	typedef unsigned long BatchId;
+
+	/// \brief Create the object
+	///
+	/// \param limit the most keys a batch holds
+	/// \param window_ms how long a batch stays open for more keys, in
+	/// milliseconds
+	KeyBatcher(size_t limit, unsigned int window_ms);
+
+	/// \brief Wait for all the batches to be taken, then destroy the
+	/// object
+	~KeyBatcher();
+
+	/// \brief Add a key to the open batch, opening a new batch if
+	/// there isn't one
+	///
+	/// The batch takes ownership of \c waiter.
+	///
+	/// \retval the new batch's ID if this opened one, in which case the
+	/// caller must arrange for take() to be called with it; else 0
+	BatchId add(const std::string& key, Waiter* waiter);
+
+	/// \brief Wait for the given batch to fill up or for its window to
+	/// pass, then remove it
+	///
+	/// The caller owns the waiters in \c batch afterward.
+	void take(BatchId id, Batch& batch);
+
+	/// \brief Remove the given batch without waiting for it to fill up
+	///
+	/// This is for when add() opened a batch but no task could be
+	/// queued to take() it.  The caller owns the waiters in \c batch
+	/// afterward.
+	void cancel(BatchId id, Batch& batch);
+
+private:
+	void* impl_;
+
+	// Can't copy these
+	KeyBatcher(const KeyBatcher&);
+	KeyBatcher& operator=(const KeyBatcher&);
+};
+
+
+/// \brief Type-independent part of the state shared between a Future
+/// and the worker thread running its task.
+///
+/// \internal You don't use this directly.  QueryExecutor::submit()
+/// creates one per task, and Future objects refer to it.
+
+class MYSQLPP_EXPORT FutureStateBase
+{
+public:
+	/// \brief Destroy the object
+	virtual ~FutureStateBase();
+
+	/// \brief Add a reference to this object
+	void add_ref();
+
+	/// \brief Returns true if the task has finished running, whether
+	/// or not it succeeded
+	bool ready() const;
+
+	/// \brief Drop a reference to this object, destroying it if that
+	/// was the last one
+	void release();
+
+	/// \brief Throw an exception like the one the task threw, if any
+	void rethrow() const;
+
+	/// \brief Grab a connection from the pool and run the task on it,
+	/// catching anything it throws
+	void run(ConnectionPool& pool);
+
+	/// \brief Block until the task has finished
+	void wait() const;
+
+protected:
+	/// \brief Create the object, with one reference
+	FutureStateBase();
+
+	/// \brief Tell the task it won't be run, because no connection
+	/// could be had for it
+	///
+	/// The result is then failed with \c e, the error from the pool.
+	/// This version does nothing.
+	virtual void abandon(const std::exception&) { }
+
+	/// \brief Run the task on the given connection
+	virtual void call(Connection& c) = 0;
+
+	/// \brief Mark the result as ready, rethrowing \c e from get()
+	/// the same way run() would if the task had thrown it
+	void fail(const std::exception& e);
+
+	/// \brief Mark the result as ready, with no error
+	void succeed();
+
+private:
+	/// \brief What kind of exception the task threw
+	enum ErrorKind {
+		no_error,
+		bad_query,			///< BadQuery, rethrown as is
+		connection_failed,	///< ConnectionFailed, rethrown as is
+		other_error			///< anything else, rethrown as TaskFailed
+	};
+
+	/// \brief Record the outcome of the task and wake up any waiters
+	void finish(ErrorKind kind, const char* msg, int errnum);
+
+	void* sync_;
+	int refs_;
+	bool ready_;
+	ErrorKind error_kind_;
+	std::string error_;
+	int errnum_;
+
+	// Can't copy these
+	FutureStateBase(const FutureStateBase&);
+	FutureStateBase& operator=(const FutureStateBase&);
+};
+
+
+/// \brief Holds the value a task returned
+///
+/// \internal Specialized below for tasks that return nothing.
+
+template <class R>
+class FutureValue : public FutureStateBase
+{
+public:
+	/// \brief Return the task's result
+	const R& value() const { return value_; }
+
+protected:
+	/// \brief Run the task, keeping its result
+	template <class Fn>
+	void invoke(Fn& fn, Connection& c) { value_ = fn(c); }
+
+	/// \brief Keep a result produced some other way
+	void store(const R& v) { value_ = v; }
+
+private:
+	R value_;
+};
+
+
+#if !defined(DOXYGEN_IGNORE)
+// Make Doxygen ignore this
+template <>
+class FutureValue<void> : public FutureStateBase
+{
+public:
+	void value() const { }
+
+protected:
+	template <class Fn>
+	void invoke(Fn& fn, Connection& c) { fn(c); }
+};
+#endif
+
+
+/// \brief Tells a task that it won't be run, because QueryExecutor
+/// couldn't get a connection for it
+///
+/// This version does nothing.  A task that must do something either
+/// way, such as release other tasks waiting on it, defines an overload
+/// for its own type, usually as a friend function in the class, which
+/// QueryExecutor finds by argument-dependent lookup.  It must not
+/// throw.
+///
+/// \param task the task that won't be run
+/// \param e the error from the pool
+template <class Fn>
+inline void
+task_not_run(const Fn& /* task */, const std::exception& /* e */)
+{
+}
+
+
+/// \brief Binds a task to the state it reports its result through
+///
+/// \internal The task is copied in, so it's safe for the caller's
+/// copy to go away before the task runs.
+
+template <class Fn>
+class FutureState : public FutureValue<typename Fn::result_type>
+{
+public:
+	/// \brief Create the state for running a copy of the given task
+	explicit FutureState(const Fn& fn) :
+	fn_(fn)
+	{
+	}
+
+protected:
+	/// \brief Tell the task it won't be run
+	void abandon(const std::exception& e) { task_not_run(fn_, e); }
+
+	/// \brief Run the task on the given connection
+	void call(Connection& c) { this->invoke(fn_, c); }
+
+private:
+	Fn fn_;
+};
+
+
+/// \brief Adapts a plain function to the interface QueryExecutor
+/// expects of tasks
+///
+/// \internal QueryExecutor::submit() uses this when you pass it a
+/// function pointer.
+
+template <class R>
+class FunctionTask
+{
+public:
+	/// \brief The task's result type
+	typedef R result_type;
+
+	/// \brief Wrap the given function
+	explicit FunctionTask(R (*f)(Connection&)) :
+	f_(f)
+	{
+	}
+
+	/// \brief Call the function
+	R operator()(Connection& c) const { return f_(c); }
+
+private:
+	R (*f_)(Connection&);
+};
+
+
+#if !defined(DOXYGEN_IGNORE)
+// Make Doxygen ignore this
+template <class R> class Promise;
+#endif
+
+
+/// \brief The eventual result of a task submitted to a QueryExecutor
+///
+/// Copies of a Future all refer to the same task.  get() blocks until
+/// the task finishes, then returns its result or rethrows its
+/// exception.  A Future may safely outlive the QueryExecutor that
+/// created it.
+
+template <class R>
+class Future
+{
+public:
+	/// \brief Create a Future not tied to any task
+	///
+	/// Calling get() or wait() on this throws ObjectNotInitialized.
+	Future() :
+	state_(0)
+	{
+	}
+
+	/// \brief Create another reference to the same task's result
+	Future(const Future<R>& other) :
+	state_(other.state_)
+	{
+		if (state_) {
+			state_->add_ref();
+		}
+	}
+
+	/// \brief Destroy the object, dropping its reference to the task's
+	/// result
+	~Future()
+	{
+		if (state_) {
+			state_->release();
+		}
+	}
+
+	/// \brief Make this object refer to the same task as another
+	Future<R>& operator=(const Future<R>& rhs)
+	{
+		if (rhs.state_) {
+			rhs.state_->add_ref();
+		}
+		if (state_) {
+			state_->release();
+		}
+		state_ = rhs.state_;
+		return *this;
+	}
+
+	/// \brief Wait for the task to finish, then return its result
+	///
+	/// If the task threw BadQuery or ConnectionFailed, this throws a
+	/// copy of it.  Other exceptions become TaskFailed.
+	R get() const
+	{
+		wait();
+		state_->rethrow();
+		return state_->value();
+	}
+
+	/// \brief Returns true if the task has finished, so get() won't
+	/// block
+	bool ready() const { return state_ && state_->ready(); }
+
+	/// \brief Returns true if this object is tied to a task
+	bool valid() const { return state_ != 0; }
+
+	/// \brief Wait for the task to finish
+	void wait() const
+	{
+		if (!state_) {
+			throw ObjectNotInitialized("Future has no task");
+		}
+		state_->wait();
+	}
+
+private:
+	friend class QueryExecutor;
+	friend class Promise<R>;
+
+	/// \brief Take over the initial reference to a task's state
+	explicit Future(FutureValue<R>* state) :
+	state_(state)
+	{
+	}
+
+	FutureValue<R>* state_;
+};
+
+
+/// \brief Holds a result set by a Promise rather than by running a
+/// task
+///
+/// \internal You don't use this directly.  Promise creates one, and
+/// Future objects refer to it.
+
+template <class R>
+class PromiseState : public FutureValue<R>
+{
+public:
+	/// \brief Make the result an error
+	void set_error(const std::exception& e) { this->fail(e); }
+
+	/// \brief Make the result a value
+	void set_value(const R& v)
+	{
+		this->store(v);
+		this->succeed();
+	}
+
+protected:
+	/// \brief Does nothing; no worker ever runs this state
+	void call(Connection&) { }
+};
+
+
+/// \brief Lets code other than a single QueryExecutor task supply the
+/// result a Future carries
+///
+/// Copies of a Promise refer to the same result.  Set it exactly once,
+/// with set_value() or set_error(); until then, get() on the Futures
+/// that future() returns blocks.  KeyedLoader uses this to hand each
+/// caller its own Future for work done in one shared task.
+
+template <class R>
+class Promise
+{
+public:
+	/// \brief Create a Promise for a result not set yet
+	Promise() :
+	state_(new PromiseState<R>)
+	{
+	}
+
+	/// \brief Create another reference to the same result
+	Promise(const Promise<R>& other) :
+	state_(other.state_)
+	{
+		state_->add_ref();
+	}
+
+	/// \brief Destroy the object, dropping its reference to the
+	/// result
+	~Promise() { state_->release(); }
+
+	/// \brief Make this object refer to the same result as another
+	Promise<R>& operator=(const Promise<R>& rhs)
+	{
+		rhs.state_->add_ref();
+		state_->release();
+		state_ = rhs.state_;
+		return *this;
+	}
+
+	/// \brief Return a Future for the result
+	Future<R> future() const
+	{
+		state_->add_ref();
+		return Future<R>(state_);
+	}
+
+	/// \brief Set the result to an error
+	///
+	/// The Future's get() throws a copy of \c e if it's a BadQuery or
+	/// a ConnectionFailed, and a TaskFailed with its message otherwise.
+	void set_error(const std::exception& e) { state_->set_error(e); }
+
+	/// \brief Set the result to a value
+	void set_value(const R& v) { state_->set_value(v); }
+
+private:
+	PromiseState<R>* state_;
+};
+
+
+/// \brief Runs database work on a fixed set of worker threads, each
+/// using a connection from a ConnectionPool while it works.
+///
+/// A task is any object with a \c result_type typedef and an
+/// \c operator() taking a Connection&, or a plain function taking a
+/// Connection&:
+///
+/// \code
+/// struct CountRows {
+///     typedef unsigned long result_type;
+///     explicit CountRows(const std::string& t) : table(t) { }
+///     unsigned long operator()(mysqlpp::Connection& c) const {
+///         mysqlpp::Query q = c.query("SELECT COUNT(*) FROM " + table);
+///         return q.store()[0][0];
+///     }
+///     std::string table;
+/// };
+///
+/// MyPool pool(...);
+/// mysqlpp::QueryExecutor executor(pool, 8);
+/// mysqlpp::Future<unsigned long> n = executor.submit(CountRows("stock"));
+/// ...
+/// std::cout << n.get() << std::endl;
+/// \endcode
+///
+/// Each worker has its own queue, and submit() hands tasks to the
+/// queues in turn.  A worker whose queue runs dry steals from the far
+/// end of the others' queues, so one slow task doesn't hold up the
+/// work queued behind it.  The queues have a fixed capacity; when all
+/// are full, submit() blocks until a worker takes a task off, which
+/// keeps a fast producer from queueing up unbounded work.  Since no
+/// more than one connection per worker is ever in use, this also
+/// replaces the "sleep until a connection frees up" loop that code
+/// sharing a ConnectionPool among threads otherwise needs.
+///
+/// The executor doesn't own the pool, because ConnectionPool is
+/// abstract; the pool must outlive the executor.  Because the workers
+/// share it with any other threads using it, the pool's connections
+/// are grabbed with ConnectionPool::grab() per task, not held for the
+/// life of the worker.
+///
+/// If MySQL++ was built without thread support, the executor has no
+/// workers, and submit() runs each task before returning.
+
+class MYSQLPP_EXPORT QueryExecutor
+{
+public:
+	/// \brief Create the executor and start its worker threads
+	///
+	/// \param pool where the workers get connections from
+	/// \param threads the number of worker threads to start
+	/// \param queue_limit the most tasks each worker's queue holds
+	///
+	/// Throws ObjectNotInitialized if it can't start the threads.
+	QueryExecutor(ConnectionPool& pool, unsigned int threads = 4,
+			size_t queue_limit = 64);
+
+	/// \brief Run the remaining queued tasks, then stop the worker
+	/// threads
+	~QueryExecutor();
+
+	/// \brief Return the number of tasks waiting for a worker
+	size_t queued() const;
+
+	/// \brief Stop accepting tasks, wait for the queued ones to
+	/// finish, and stop the worker threads
+	///
+	/// Any submit() call blocked waiting for queue space, or made
+	/// afterward, throws ObjectNotInitialized.
+	void shutdown();
+
+	/// \brief Queue a task, waiting for queue space if necessary
+	template <class Fn>
+	Future<typename Fn::result_type> submit(const Fn& fn)
+	{
+		Future<typename Fn::result_type> f(new FutureState<Fn>(fn));
+		enqueue(f.state_, true);
+		return f;
+	}
+
+	/// \brief Queue a plain function as a task
+	template <class R>
+	Future<R> submit(R (*fn)(Connection&))
+	{
+		return submit(FunctionTask<R>(fn));
+	}
+
+	/// \brief Return the number of worker threads
+	///
+	/// This is 0 if MySQL++ was built without thread support.
+	unsigned int threads() const { return threads_; }
+
+	/// \brief Queue a task only if there's room for it right now
+	///
+	/// \retval true if the task was queued, in which case \c f refers
+	/// to its result
+	template <class Fn>
+	bool try_submit(const Fn& fn, Future<typename Fn::result_type>& f)
+	{
+		Future<typename Fn::result_type> nf(new FutureState<Fn>(fn));
+		if (enqueue(nf.state_, false)) {
+			f = nf;
+			return true;
+		}
+		else {
+			return false;
+		}
+	}
+
+private:
+	/// \brief Hand a task to a worker's queue
+	///
+	/// Takes a reference to the task for the worker.
+	///
+	/// \retval false if all the queues were full and \c wait is false
+	bool enqueue(FutureStateBase* task, bool wait);
+
+	ConnectionPool& pool_;
+	unsigned int threads_;
+	void* impl_;
+
+	// Can't copy these
+	QueryExecutor(const QueryExecutor&);
+	QueryExecutor& operator=(const QueryExecutor&);
+};
+
+} // end namespace mysqlpp
+
+#endif // !defined(MYSQLPP_EXECUTOR_H)
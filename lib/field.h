@@ -50,7 +50,8 @@ public:
 	Field() :
 	length_(0),
 	max_length_(0),
-	flags_(0)
+	flags_(0),
+	charsetnr_(0)
 	{
 	}
 
@@ -65,7 +66,12 @@ public:
 			(pf->flags & NOT_NULL_FLAG) == 0),
 	length_(pf->length),
 	max_length_(pf->max_length),
-	flags_(pf->flags)
+	flags_(pf->flags),
+#if MYSQL_VERSION_ID >= 40100	// only in 4.1 +
+	charsetnr_(pf->charsetnr)
+#else
+	charsetnr_(0)
+#endif
 	{
 	}
 
@@ -77,7 +83,8 @@ public:
 	type_(other.type_),
 	length_(other.length_),
 	max_length_(other.max_length_),
-	flags_(other.flags_)
+	flags_(other.flags_),
+	charsetnr_(other.charsetnr_)
 	{
 	}
 
@@ -90,6 +97,17 @@ public:
 	/// \brief Returns true if field is of some BLOB type
 	bool blob_type() const { return flags_ & BLOB_FLAG; }
 
+	/// \brief Returns true if the field holds bytes rather than text
+	///
+	/// This is true for BINARY, VARBINARY and BLOB columns, but unlike
+	/// binary_type(), not for text columns with a binary (\c _bin)
+	/// collation, since it checks for the \c binary character set.
+	bool binary_charset() const { return charsetnr_ == 63; }
+
+	/// \brief Return the number of the field's character set and
+	/// collation, as in \c INFORMATION_SCHEMA.COLLATIONS
+	unsigned int charsetnr() const { return charsetnr_; }
+
 	/// \brief Return the name of the database the field comes from
 	const char* db() const { return db_.c_str(); }
 
@@ -146,6 +164,7 @@ private:
 	size_t length_;			///< creation size of column
 	size_t max_length_;		///< size of largest item in column in result set
 	unsigned int flags_;	///< DB engine-specific set of bit flags
+	unsigned int charsetnr_;	///< character set and collation number
 };
 
 
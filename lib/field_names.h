@@ -28,6 +28,8 @@
 #ifndef MYSQLPP_FIELD_NAMES_H
 #define MYSQLPP_FIELD_NAMES_H
 
+#include "refcounted.h"
+
 #include <string>
 #include <vector>
 
@@ -113,6 +115,15 @@ private:
 	void init(const ResultBase* res);
 };
 
+
+/// \brief Change the reference count Rows and results keep on their
+/// shared FieldNames atomically
+template <>
+struct RefCountedPointerCounter<FieldNames> :
+		public RefCountedPointerAtomicCounter<FieldNames>
+{
+};
+
 } // end namespace mysqlpp
 
 #endif
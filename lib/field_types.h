@@ -28,6 +28,7 @@
 #ifndef MYSQLPP_FIELD_TYPES_H
 #define MYSQLPP_FIELD_TYPES_H
 
+#include "refcounted.h"
 #include "type_info.h"
 
 #include <vector>
@@ -79,6 +80,15 @@ private:
 	void init(const ResultBase* res);
 };
 
+
+/// \brief Change the reference count Rows and results keep on their
+/// shared FieldTypes atomically
+template <>
+struct RefCountedPointerCounter<FieldTypes> :
+		public RefCountedPointerAtomicCounter<FieldTypes>
+{
+};
+
 } // end namespace mysqlpp
 
 #endif
@@ -103,6 +103,16 @@ public:
 		}
 	}
 
+	/// \brief Can we add another object to the query?
+	///
+	/// This is the form Query::insertfrom() calls.  The row's size
+	/// doesn't matter to this policy.
+	template <class RowT>
+	bool can_add(int size, const RowT& object, size_t /* row_size */)
+	{
+		return can_add(size, object);
+	}
+
 	/// \brief Alias for our access controller type
 	typedef AccessController access_controller;
 
@@ -146,6 +156,17 @@ public:
 		return (size < size_);
 	}
 
+	/// \brief Can we add another object to the query?
+	///
+	/// This is the form Query::insertfrom() calls.  The row's size
+	/// doesn't matter to this policy.
+	template <class RowT>
+	bool can_add(int size, const RowT& object,
+			size_t /* row_size */) const
+	{
+		return can_add(size, object);
+	}
+
 	/// \brief Alias for our access controller type
 	typedef AccessController access_controller;
 
@@ -158,9 +179,10 @@ private:
 /// if the object to be added would cause the statement to exceed
 /// a maximum size.
 ///
-/// This differs from the SizeThresholdInsertPolicy in that it builds
-/// the VALUES expression and checks whether it would cause the
-/// length of the INSERT statement to exceed the maximum size.
+/// This differs from the SizeThresholdInsertPolicy in that it looks
+/// at the size of the row's VALUES expression and checks whether it
+/// would cause the length of the INSERT statement to exceed the
+/// maximum size.
 template <class AccessController = Transaction>
 class MYSQLPP_EXPORT MaxPacketInsertPolicy
 {
@@ -198,22 +220,39 @@ public:
 	///
 	/// \retval true if the object is allowed to be added to the
 	///     INSERT statement
+	///
+	/// This has to build the object's VALUES expression to measure
+	/// it.  Query::insertfrom() calls the three-argument form instead,
+	/// passing the size of the expression it has already built.
 	template <class RowT>
 	bool can_add(int size, const RowT& object) const
 	{
 		if (size < size_) {
-			// Haven't hit size threshold yet, so see if this next
-			// item pushes it over the line.
 			SQLStream s(conn_);
 			s << ",(" << object.value_list() << ")";
-			return (size_ - size) >= static_cast<int>(s.str().size());
+			return can_add(size, object, s.buffer().size());
 		}
 		else {
-			// Already too much in query buffer!
 			return false;
 		}
 	}
 
+	/// \brief Can we add another object to the query?
+	///
+	/// \param size current length of the INSERT statement
+	/// \param row_size length of the object's VALUES expression,
+	///     including the comma separating it from the one before
+	///
+	/// \retval true if the object is allowed to be added to the
+	///     INSERT statement
+	template <class RowT>
+	bool can_add(int size, const RowT& /* object */,
+			size_t row_size) const
+	{
+		// Is there room left under the size limit for this row?
+		return (size < size_) && (size_t(size_ - size) >= row_size);
+	}
+
 	/// \brief Alias for our access controller type
 	typedef AccessController access_controller;
 
@@ -222,6 +261,199 @@ private:
 	int size_;
 };
 
+
+/// \brief An insert policy object that tunes its batch size as it
+/// goes, aiming for a target time per INSERT statement.
+///
+/// The other policies use fixed limits, which have to be tuned by
+/// hand for each table and environment.  This one times each INSERT
+/// statement that insertfrom() runs and scales the number of rows in
+/// the next one toward the target time, by at most a factor of two
+/// each time.  Bigger batches spread the per-statement overhead over
+/// more rows, so they raise throughput until the server starts to
+/// take proportionally longer per batch; a target of a few tens of
+/// milliseconds usually gets most of the available throughput while
+/// keeping each statement short enough not to hold locks for long.
+///
+/// Each statement is also kept under the server's
+/// \c max_allowed_packet, which the constructor asks for.
+///
+/// A policy object remembers what it has learned, so reuse it across
+/// insertfrom() calls against the same table.
+///
+/// The timing works by noting when can_add() turns a row away, which
+/// is when insertfrom() runs the statement it has built, and when
+/// can_add() is next called for an empty statement, which is right
+/// after the statement finishes.  The last statement of each
+/// insertfrom() call isn't timed.
+template <class AccessController = Transaction>
+class MYSQLPP_EXPORT AdaptiveInsertPolicy
+{
+public:
+	/// \brief Constructor
+	///
+	/// \param con connection to ask for \c max_allowed_packet, and
+	///     used for escaping text; may be 0, in which case the packet
+	///     size is assumed to be 1 MB
+	/// \param target_seconds time each INSERT statement should take
+	/// \param initial_rows rows to put in the first statement
+	/// \param max_rows most rows to ever put in one statement
+	AdaptiveInsertPolicy(Connection* con, double target_seconds = 0.05,
+			unsigned int initial_rows = 100,
+			unsigned int max_rows = 100000) :
+	conn_(con),
+	max_packet_(internal::max_allowed_packet(con)),
+	target_(target_seconds),
+	max_rows_(max_rows ? max_rows : 1),
+	batch_rows_(initial_rows ? initial_rows : 1),
+	rows_(0),
+	sent_rows_(0),
+	sent_bytes_(0),
+	sent_at_(0),
+	last_seconds_(0),
+	rows_per_second_(0),
+	bytes_per_second_(0)
+	{
+		if (batch_rows_ > max_rows_) {
+			batch_rows_ = max_rows_;
+		}
+	}
+
+	/// \brief Destructor
+	~AdaptiveInsertPolicy() { }
+
+	/// \brief Can we add another object to the query?
+	///
+	/// This has to build the object's VALUES expression to measure
+	/// it.  Query::insertfrom() calls the three-argument form instead.
+	template <class RowT>
+	bool can_add(int size, const RowT& object)
+	{
+		SQLStream s(conn_);
+		s << ",(" << object.value_list() << ")";
+		return can_add(size, object, s.buffer().size());
+	}
+
+	/// \brief Can we add another object to the query?
+	///
+	/// \param size current length of the INSERT statement
+	/// \param row_size length of the object's VALUES expression,
+	///     including the comma separating it from the one before
+	///
+	/// \retval true if the object is allowed to be added to the
+	///     INSERT statement
+	template <class RowT>
+	bool can_add(int size, const RowT& /* object */, size_t row_size)
+	{
+		if (size == 0) {
+			// Starting a new statement.  If we turned a row away last
+			// time, insertfrom() has just run the statement it had.
+			if (sent_at_ > 0) {
+				record(internal::seconds_now() - sent_at_);
+			}
+			rows_ = 0;
+		}
+
+		if ((rows_ < batch_rows_) &&
+				(size_t(size) + row_size < max_packet_)) {
+			++rows_;
+			return true;
+		}
+		else {
+			// insertfrom() will now run what it has, if anything
+			sent_at_ = rows_ ? internal::seconds_now() : 0;
+			sent_rows_ = rows_;
+			sent_bytes_ = size_t(size);
+			rows_ = 0;
+			return false;
+		}
+	}
+
+	/// \brief Return the number of rows the policy currently allows
+	/// in each statement
+	unsigned int batch_rows() const { return batch_rows_; }
+
+	/// \brief Return the recent rate of data sent, in bytes of SQL
+	/// per second
+	///
+	/// This is a moving average over the last few statements, or 0 if
+	/// none have been timed yet.
+	double bytes_per_second() const { return bytes_per_second_; }
+
+	/// \brief Return how long the last timed statement took, in
+	/// seconds
+	double last_seconds() const { return last_seconds_; }
+
+	/// \brief Return the packet size limit the policy is keeping
+	/// statements under
+	size_t max_packet() const { return max_packet_; }
+
+	/// \brief Return the recent rate of rows inserted per second
+	///
+	/// This is a moving average over the last few statements, or 0 if
+	/// none have been timed yet.
+	double rows_per_second() const { return rows_per_second_; }
+
+	/// \brief Alias for our access controller type
+	typedef AccessController access_controller;
+
+private:
+	friend class Query;
+
+	/// \brief Forget any statement we were timing
+	///
+	/// Query calls this as each insertfrom() pass starts.  If the
+	/// statement that was running when the last pass ended failed,
+	/// it never reached the can_add() call that would time it, and
+	/// timing from then until now would throw off the batch size.
+	void begin_pass() { sent_at_ = 0; }
+
+	/// \brief Update the statistics and batch size after timing a
+	/// statement of sent_rows_ rows
+	void record(double seconds)
+	{
+		sent_at_ = 0;
+		if (seconds < 1e-6) {
+			seconds = 1e-6;		// below clock resolution
+		}
+		last_seconds_ = seconds;
+
+		// Weight the newest sample at 1/4 so one slow statement
+		// doesn't swing the numbers too far
+		const double rps = sent_rows_ / seconds;
+		const double bps = sent_bytes_ / seconds;
+		rows_per_second_ = rows_per_second_ ?
+				0.75 * rows_per_second_ + 0.25 * rps : rps;
+		bytes_per_second_ = bytes_per_second_ ?
+				0.75 * bytes_per_second_ + 0.25 * bps : bps;
+
+		// Assume time scales with rows, and aim for the target
+		double scale = target_ / seconds;
+		if (scale > 2) {
+			scale = 2;
+		}
+		else if (scale < 0.5) {
+			scale = 0.5;
+		}
+		double rows = sent_rows_ * scale;
+		batch_rows_ = rows < 1 ? 1 :
+				rows > max_rows_ ? max_rows_ : (unsigned int)rows;
+	}
+
+	Connection* conn_;
+	size_t max_packet_;
+	double target_;
+	unsigned int max_rows_;
+	unsigned int batch_rows_;
+	unsigned int rows_;			///< rows in the statement being built
+	unsigned int sent_rows_;	///< rows in the statement being run
+	size_t sent_bytes_;			///< size of the statement being run
+	double sent_at_;			///< when it started running, or 0
+	double last_seconds_;
+	double rows_per_second_;
+	double bytes_per_second_;
+};
+
 #endif // defined(MYSQLPP_DEFINE_INSERT_POLICY_TEMPLATES)
 
 #endif // !defined(MYSQLPP_INSERTPOLICY_H)
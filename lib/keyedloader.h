@@ -0,0 +1,288 @@
+/// \file keyedloader.h
+/// \brief Declares the KeyedLoader template, which gathers requests
+/// for SSQLS objects by key from many threads into a few bulk queries.
+
+/***********************************************************************
+ Copyright (c) 2009 by Educational Technology Resources, Inc.
+ Others may also hold copyrights on code in this file.  See the
+ CREDITS.txt file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#if !defined(MYSQLPP_KEYEDLOADER_H)
+#define MYSQLPP_KEYEDLOADER_H
+
+#include "common.h"
+
+#include "connection.h"
+#include "executor.h"
+#include "query.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace mysqlpp {
+
+/// \brief Loads SSQLS objects by key, combining the requests made
+/// from many threads at about the same time into one query.
+///
+/// Code that fetches rows one at a time by primary key sends the
+/// server a great many tiny queries.  Instead, ask this object for
+/// each row:
+///
+/// \code
+/// mysqlpp::KeyedLoader<stock, std::string> loader(executor);
+/// ...
+/// mysqlpp::Future<stock> f = loader.load("Nuts");
+/// stock s = f.get();
+/// \endcode
+///
+/// The first load() call opens a batch, and later calls add their keys
+/// to it until it holds \c batch_size keys or \c window_ms
+/// milliseconds pass.  One task on the QueryExecutor then fetches the
+/// whole batch with <tt>SELECT ... WHERE (key) IN (...)</tt>, streams
+/// the rows back with Query::use(), and fills in each caller's Future
+/// from a map of the callers waiting on each key.  Callers asking for
+/// the same key share one slot in the query.
+///
+/// The key fields are the SSQLS's comparison fields, the ones counted
+/// by the second parameter of \c sql_create_N, and \c Key is the type
+/// of the one key field.  Rows are matched to callers by the SQL text
+/// of their keys, so with a case-insensitive collation, ask for string
+/// keys in the case they're stored in.
+///
+/// If no row has a key, get() on its Future throws TaskFailed.  If the
+/// query fails, or no connection can be had for it, all the Futures in
+/// the batch throw what the task caught, as for any other
+/// QueryExecutor task.
+///
+/// The task waits out the window on one of the executor's workers,
+/// holding a connection, so keep the window short.  Without thread
+/// support, each load() runs its own query before returning.  The
+/// loader waits for its outstanding batches before it's destroyed, so
+/// the executor must outlive it.
+
+template <class T, class Key>
+class KeyedLoader
+{
+public:
+	/// \brief Create the loader
+	///
+	/// \param executor runs the queries
+	/// \param batch_size the most keys fetched by one query
+	/// \param window_ms how long to wait for more keys after the first
+	/// one in a batch, in milliseconds
+	KeyedLoader(QueryExecutor& executor, size_t batch_size = 100,
+			unsigned int window_ms = 2) :
+	executor_(executor),
+	batcher_(batch_size, window_ms)
+	{
+	}
+
+	/// \brief Ask for the row with the given key
+	///
+	/// This doesn't block unless the executor's queues are full.
+	Future<T> load(const Key& key)
+	{
+		SQLStream text(0);
+		text << quote << key;
+
+		Waiter* waiter = new Waiter;
+		Future<T> f = waiter->promise.future();
+		if (KeyBatcher::BatchId id = batcher_.add(text.str(), waiter)) {
+			// This key opened a batch, so queue a task to fetch it
+			try {
+				executor_.submit(LoadTask(batcher_, id));
+			}
+			catch (const std::exception& e) {
+				// No task will take this batch, so fail it here
+				KeyBatcher::Batch batch;
+				batcher_.cancel(id, batch);
+				WaiterMap waiting;
+				group(batch, waiting);
+				finish(waiting, &e);
+				throw;
+			}
+		}
+		return f;
+	}
+
+private:
+	/// \brief A caller waiting on a key
+	struct Waiter : public KeyBatcher::Waiter
+	{
+		Promise<T> promise;
+	};
+
+	/// \brief The callers waiting on each key in a batch
+	typedef std::map<std::string, std::vector<Waiter*> > WaiterMap;
+
+	/// \brief The task that fetches one batch
+	class LoadTask
+	{
+	public:
+		typedef void result_type;
+
+		LoadTask(KeyBatcher& batcher, KeyBatcher::BatchId id) :
+		batcher_(&batcher),
+		id_(id)
+		{
+		}
+
+		void operator()(Connection& c) const
+		{
+			WaiterMap waiting;
+			take(*batcher_, id_, waiting);
+
+			try {
+				fetch(c, waiting);
+			}
+			catch (const std::exception& e) {
+				finish(waiting, &e);
+				return;
+			}
+			catch (...) {
+				TaskFailed e("batch load threw an unknown exception");
+				finish(waiting, &e);
+				return;
+			}
+
+			finish(waiting, 0);
+		}
+
+		/// \brief Fail a batch with the pool's error, if the executor
+		/// couldn't get a connection to run the task on
+		///
+		/// The batch still has to be taken, or its callers would
+		/// never hear back, and the loader would wait on it forever.
+		friend void task_not_run(const LoadTask& task,
+				const std::exception& e)
+		{
+			task.abandon(e);
+		}
+
+	private:
+		void abandon(const std::exception& e) const
+		{
+			WaiterMap waiting;
+			take(*batcher_, id_, waiting);
+			finish(waiting, &e);
+		}
+
+		KeyBatcher* batcher_;
+		KeyBatcher::BatchId id_;	///< the batch this task fetches
+	};
+
+	/// \brief Fetch the rows for a batch, handing each to the callers
+	/// waiting on its key and removing them from \c waiting
+	static void fetch(Connection& c, WaiterMap& waiting)
+	{
+		if (waiting.empty()) {
+			return;
+		}
+
+		T proto;
+		Query q = c.query();
+		q << "SELECT " << proto.field_list() << " FROM `" <<
+				proto.table() << "` WHERE (" <<
+				proto.field_list(sql_use_compare) << ") IN (";
+		for (typename WaiterMap::const_iterator it = waiting.begin();
+				it != waiting.end(); ++it) {
+			if (it != waiting.begin()) {
+				q << ',';
+			}
+			q << '(' << it->first << ')';
+		}
+		q << ')';
+
+		UseQueryResult res = q.use();
+		if (!res) {
+			throw BadQuery(q.error(), q.errnum());
+		}
+
+		while (Row row = res.fetch_row()) {
+			T obj(row);
+			SQLStream key(0);
+			key << obj.value_list(sql_use_compare);
+
+			typename WaiterMap::iterator it = waiting.find(key.str());
+			if (it != waiting.end()) {
+				for (size_t i = 0; i < it->second.size(); ++i) {
+					it->second[i]->promise.set_value(obj);
+					delete it->second[i];
+				}
+				waiting.erase(it);
+			}
+		}
+
+		if (c.errnum()) {
+			throw BadQuery(c.error(), c.errnum());
+		}
+	}
+
+	/// \brief Fail the callers left in \c waiting, with \c e if given,
+	/// else because there's no row with their key
+	static void finish(WaiterMap& waiting, const std::exception* e)
+	{
+		for (typename WaiterMap::iterator it = waiting.begin();
+				it != waiting.end(); ++it) {
+			for (size_t i = 0; i < it->second.size(); ++i) {
+				if (e) {
+					it->second[i]->promise.set_error(*e);
+				}
+				else {
+					it->second[i]->promise.set_error(TaskFailed(
+							"no row has key " + it->first));
+				}
+				delete it->second[i];
+			}
+		}
+		waiting.clear();
+	}
+
+	/// \brief Group a batch's callers by key
+	static void group(const KeyBatcher::Batch& batch, WaiterMap& waiting)
+	{
+		for (size_t i = 0; i < batch.size(); ++i) {
+			waiting[batch[i].key].push_back(
+					static_cast<Waiter*>(batch[i].waiter));
+		}
+	}
+
+	/// \brief Take the given batch, grouping its callers by key
+	static void take(KeyBatcher& batcher, KeyBatcher::BatchId id,
+			WaiterMap& waiting)
+	{
+		KeyBatcher::Batch batch;
+		batcher.take(id, batch);
+		group(batch, waiting);
+	}
+
+	QueryExecutor& executor_;
+	KeyBatcher batcher_;
+
+	// Can't copy these
+	KeyedLoader(const KeyedLoader&);
+	KeyedLoader& operator=(const KeyedLoader&);
+};
+
+} // end namespace mysqlpp
+
+#endif // !defined(MYSQLPP_KEYEDLOADER_H)
@@ -27,17 +27,37 @@
 
 #include "manip.h"
 
+#include "datetime.h"
 #include "query.h"
+#include "sqlescape.h"
 #include "sqlstream.h"
 
+#include <string.h>
+#include <time.h>
+
 using namespace std;
 
 namespace mysqlpp {
 
+// Build the X'...' hex literal form of binary data, for the
+// manipulators that hand a finished value to SQLQueryParms.
+static SQLTypeAdapter
+hex_literal(const SQLTypeAdapter& in)
+{
+	string temp(in.length() * 2 + 3, '\'');
+	temp[0] = 'X';
+	hex_encode(&temp[2], in.data(), in.length());
+	return SQLTypeAdapter(temp, true);
+}
+
+
 SQLQueryParms&
 operator <<(quote_type2 p, SQLTypeAdapter& in)
 {
-	if (in.quote_q()) {
+	if (in.quote_q() && in.is_binary()) {
+		return *p.qparms << hex_literal(in);
+	}
+	else if (in.quote_q()) {
 		string temp("'", 1), escaped;
 		p.qparms->escape_string(&escaped, in.data(), in.length());
 		temp.append(escaped);
@@ -55,28 +75,21 @@ operator <<(quote_type2 p, SQLTypeAdapter& in)
 ostream&
 operator <<(quote_type1 o, const SQLTypeAdapter& in)
 {
-	Query* pq = dynamic_cast<Query*>(o.ostr);
-
-	// If it's not a Query*, maybe it's a SQLStream*.
-	SQLStream* psqls = pq ? 0 : dynamic_cast<SQLStream*>(o.ostr);
-
 	// If it's a Query or a SQLStream, we'll be using unformatted output.
-	if (pq || psqls) {
+	if (EscapingStream* es = EscapingStream::lookup(*o.ostr)) {
+		if (in.quote_q() && in.is_binary()) {
+			// Binary data goes in as a hex literal instead of being
+			// escaped
+			es->buffer().append_hex(in.data(), in.length());
+			return *o.ostr;
+		}
+
 		if (in.quote_q()) o.ostr->put('\'');
 
 		// Now, is escaping appropriate for source data type of 'in'?
 		if (in.escape_q()) {
-			string escaped;
-
-			// If it's not a Query*, then it has to be a SQLStream.
-			if (pq) {
-				pq->escape_string(&escaped, in.data(), in.length());
-			}
-			else {
-				psqls->escape_string(&escaped, in.data(), in.length());
-			}
-
-			o.ostr->write(escaped.data(), escaped.length());
+			// Escape straight into the stream's buffer
+			es->append_escaped(in.data(), in.length());
 		}
 		else {
 			o.ostr->write(in.data(), in.length());
@@ -98,13 +111,13 @@ operator <<(quote_type1 o, const SQLTypeAdapter& in)
 ostream&
 operator <<(quote_only_type1 o, const SQLTypeAdapter& in)
 {
-	Query* pq = dynamic_cast<Query*>(o.ostr);
-
-	// If it's not a Query*, maybe it's a SQLStream*.
-	SQLStream* psqls = pq ? 0 : dynamic_cast<SQLStream*>(o.ostr);
-
 	// If it's a Query or SQLStream, use unformatted output
-	if (pq || psqls) {
+	if (EscapingStream* es = EscapingStream::lookup(*o.ostr)) {
+		if (in.quote_q() && in.is_binary()) {
+			es->buffer().append_hex(in.data(), in.length());
+			return *o.ostr;
+		}
+
 		if (in.quote_q()) o.ostr->put('\'');
 
 		o.ostr->write(in.data(), in.length());
@@ -125,7 +138,7 @@ operator <<(quote_only_type1 o, const SQLTypeAdapter& in)
 ostream&
 operator <<(ostream& o, const SQLTypeAdapter& in)
 {
-	if (dynamic_cast<Query*>(&o) || dynamic_cast<SQLStream*>(&o)) {
+	if (EscapingStream::lookup(o)) {
 		// It's a Query or a SQLStream, so use unformatted output.
 		return o.write(in.data(), in.length());
 	}
@@ -140,7 +153,10 @@ operator <<(ostream& o, const SQLTypeAdapter& in)
 SQLQueryParms&
 operator <<(quote_only_type2 p, SQLTypeAdapter& in)
 {
-	if (in.quote_q()) {
+	if (in.quote_q() && in.is_binary()) {
+		return *p.qparms << hex_literal(in);
+	}
+	else if (in.quote_q()) {
 		string temp("'", 1);
 		temp.append(in.data(), in.length());
 		temp.append("'", 1);
@@ -172,13 +188,8 @@ operator <<(quote_double_only_type2 p, SQLTypeAdapter& in)
 ostream&
 operator <<(quote_double_only_type1 o, const SQLTypeAdapter& in)
 {
-	Query* pq = dynamic_cast<Query*>(o.ostr);
-
-	// If it's not a Query*, maybe it's a SQLStream*.
-	SQLStream* psqls = pq ? 0 : dynamic_cast<SQLStream*>(o.ostr);
-
 	// If it's a Query or a SQLStream, use unformatted output
-	if (pq || psqls) {
+	if (EscapingStream::lookup(*o.ostr)) {
 		if (in.quote_q()) o.ostr->put('"');
 
 		o.ostr->write(in.data(), in.length());
@@ -215,26 +226,13 @@ operator <<(escape_type2 p, SQLTypeAdapter& in)
 ostream&
 operator <<(escape_type1 o, const SQLTypeAdapter& in)
 {
-	Query* pq = dynamic_cast<Query*>(o.ostr);
-
-	// If it's not a Query*, maybe it's a SQLStream*.
-	SQLStream* psqls = pq ? 0 : dynamic_cast<SQLStream*>(o.ostr);
-
-	if (pq || psqls) {
+	if (EscapingStream* es = EscapingStream::lookup(*o.ostr)) {
 		// It's a Query or a SQLStream, so we'll be using unformatted output.
 		// Now, is escaping appropriate for source data type of 'in'?
 		if (in.escape_q()) {
-			string escaped;
-
-			// If it's not a Query*, then it has to be a SQLStream.
-			if (pq) {
-				pq->escape_string(&escaped, in.data(), in.length());
-			}
-			else {
-				psqls->escape_string(&escaped, in.data(), in.length());
-			}
-
-			return o.ostr->write(escaped.data(), escaped.length());
+			// Escape straight into the stream's buffer
+			es->append_escaped(in.data(), in.length());
+			return *o.ostr;
 		}
 		else {
 			// It's not escaped, so just write the unformatted output
@@ -250,6 +248,43 @@ operator <<(escape_type1 o, const SQLTypeAdapter& in)
 }
 
 
+ostream&
+operator <<(escape_tsv_type1 o, const SQLTypeAdapter& in)
+{
+	if (in.is_null()) {
+		return o.ostr->write("\\N", 2);
+	}
+	else if (!in.quote_q() && (in.length() == 5) &&
+			(memcmp(in.data(), "NOW()", 5) == 0)) {
+		// A default-constructed DateTime, which means "now".  LOAD DATA
+		// won't evaluate SQL functions, so send the current time
+		// instead, as PreparedQuery does.
+		return *o.ostr << DateTime(::time(0));
+	}
+
+	// Write runs of ordinary characters in one go, stopping only for
+	// the few that LOAD DATA needs escaped.
+	const char* start = in.data();
+	const char* end = start + in.length();
+	for (const char* p = start; p != end; ++p) {
+		char esc;
+		switch (*p) {
+			case '\\':	esc = '\\'; break;
+			case '\t':	esc = 't'; break;
+			case '\n':	esc = 'n'; break;
+			case '\r':	esc = 'r'; break;
+			case '\0':	esc = '0'; break;
+			default:	continue;
+		}
+		o.ostr->write(start, p - start);
+		o.ostr->put('\\');
+		o.ostr->put(esc);
+		start = p + 1;
+	}
+	return o.ostr->write(start, end - start);
+}
+
+
 SQLQueryParms&
 operator <<(do_nothing_type2 p, SQLTypeAdapter& in)
 {
@@ -261,7 +296,7 @@ operator <<(do_nothing_type2 p, SQLTypeAdapter& in)
 ostream&
 operator <<(do_nothing_type1 o, const SQLTypeAdapter& in)
 {
-	if (dynamic_cast<Query*>(o.ostr) || dynamic_cast<SQLStream*>(o.ostr)) {
+	if (EscapingStream::lookup(*o.ostr)) {
 		// It's a Query or a SQLStream, so use unformatted output
 		return o.ostr->write(in.data(), in.length());
 	}
@@ -373,6 +373,49 @@ MYSQLPP_EXPORT std::ostream&
 operator <<(escape_type1 o, const SQLTypeAdapter& in);
 
 
+/// \enum escape_tsv_type0
+/// The 'escape_tsv' manipulator.
+///
+/// Writes the following argument in the tab-separated form that
+/// <tt>LOAD DATA INFILE</tt> reads with its default field and line
+/// terminators: backslashes, tabs, newlines, carriage returns and nul
+/// bytes are backslash-escaped, and SQL null becomes \\N.  Nothing
+/// is quoted.  A default-constructed DateTime, which would otherwise
+/// become a call to SQL's NOW(), is written as the current time.  BulkLoader uses this; it's only useful with plain
+/// C++ streams, not Query or SQLQueryParms.
+
+enum escape_tsv_type0 { escape_tsv };
+
+
+#if !defined(DOXYGEN_IGNORE)
+// Doxygen will not generate documentation for this section.
+
+struct escape_tsv_type1
+{
+	std::ostream* ostr;
+	escape_tsv_type1(std::ostream* o) :
+	ostr(o)
+	{
+	}
+};
+
+
+inline escape_tsv_type1
+operator <<(std::ostream& o, escape_tsv_type0 /* esc */)
+{
+	return escape_tsv_type1(&o);
+}
+
+#endif // !defined(DOXYGEN_IGNORE)
+
+
+/// \brief Inserts anything that can be converted to SQLTypeAdapter into
+/// a stream as a <tt>LOAD DATA INFILE</tt> field
+
+MYSQLPP_EXPORT std::ostream&
+operator <<(escape_tsv_type1 o, const SQLTypeAdapter& in);
+
+
 /// \enum do_nothing_type0
 /// \anchor do_nothing_manip
 ///
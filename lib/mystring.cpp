@@ -173,6 +173,13 @@ String::escape_q() const
 }
 
 
+bool
+String::is_binary() const
+{
+	return buffer_ ? buffer_->is_binary() : false;
+}
+
+
 bool
 String::is_null() const
 {
@@ -192,6 +199,16 @@ String::it_is_null()
 }
 
 
+void
+String::set_binary(bool b)
+{
+	if (!buffer_) {
+		buffer_ = new SQLBuffer(0, 0, mysql_type_info::string_type, false);
+	}
+	buffer_->set_binary(b);
+}
+
+
 String::size_type
 String::length() const
 {
@@ -235,8 +252,9 @@ String::to_string(std::string& s) const
 std::ostream&
 operator <<(std::ostream& o, const String& in)
 {
-	if (dynamic_cast<Query*>(&o)) {
-		// We can just insert the raw data into the stream
+	if (EscapingStream::lookup(o)) {
+		// It's a Query or SQLStream, so we can just insert the raw
+		// data into the stream
 		o.write(in.data(), in.length());
 	}
 	else {
@@ -200,6 +200,26 @@ public:
 	{
 	}
 
+	/// \brief Full constructor, without the copy
+	///
+	/// \param str the string this object represents
+	/// \param len the length of the string, not counting the null
+	/// character that must follow it
+	/// \param type MySQL type information for data within str
+	/// \param is_null string represents a SQL null, not literal data
+	/// \param owner the object keeping \c str alive
+	///
+	/// The resulting object points into \c str, and keeps \c owner
+	/// alive as long as it or any copy of it exists.  Assigning a new
+	/// value makes a private copy, as usual.  If you need to keep a
+	/// value without keeping all of the owner's memory alive, make a
+	/// deep copy with one of the ctors that takes a string.
+	String(const char* str, size_type len, mysql_type_info type,
+			bool is_null, const RefCountedOwner& owner) :
+	buffer_(SQLBuffer::create(str, len, type, is_null, owner))
+	{
+	}
+
 	/// \brief C++ string version of full ctor
 	///
 	/// \param str the string this object represents, or 0 for SQL null
@@ -383,6 +403,13 @@ public:
 	/// otherwise.
 	bool escape_q() const;
 
+	/// \brief Returns true if this object holds binary data, such as
+	/// a value from a BLOB column
+	///
+	/// Binary strings are sent to the server as hex literals when
+	/// quoted in a query, instead of being escaped.
+	bool is_binary() const;
+
 	/// \brief Returns true if this object is a SQL null.
 	bool is_null() const;
 
@@ -415,6 +442,16 @@ public:
 	/// See commentary for length() about the difference between bytes
 	/// and characters.
 	size_type size() const { return length(); }
+
+	/// \brief Set or clear the flag marking this object as holding
+	/// binary data
+	///
+	/// Row sets this for values from binary BLOB columns.  Call it
+	/// yourself on \c sql_blob values you build from other sources,
+	/// such as a file's contents, so they're sent as hex literals.
+	///
+	/// \see is_binary()
+	void set_binary(bool b = true);
 	
 	/// \brief Returns a copy of our internal string without leading
 	/// blanks.
@@ -0,0 +1,125 @@
+/***********************************************************************
+ parallelinsert.cpp - Implements the ParallelInsert class.
+
+ Copyright (c) 2009 by Educational Technology Resources, Inc.
+ Others may also hold copyrights on code in this file.  See the
+ CREDITS.txt file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#define MYSQLPP_NOT_HEADER
+#include "common.h"
+
+#include "parallelinsert.h"
+
+#include <sstream>
+
+#include <time.h>
+
+namespace mysqlpp {
+
+ParallelInsert::ParallelInsert(QueryExecutor& ex, Mode mode,
+		unsigned int shards) :
+executor_(ex),
+mode_(mode),
+shards_(shards),
+jobs_(0)
+{
+}
+
+
+bool
+ParallelInsert::collect(std::vector<Future<ShardResult> >& futures)
+{
+	bool all_ok = true;
+	for (size_t i = 0; i < futures.size(); ++i) {
+		ShardResult r;
+		try {
+			r = futures[i].get();
+		}
+		catch (const std::exception& e) {
+			// Shards catch their own errors, so this is something
+			// like a failure to get a connection from the pool.
+			r = ShardResult(0, false, e.what());
+		}
+		all_ok = all_ok && r.committed();
+		results_.push_back(r);
+	}
+	return all_ok;
+}
+
+
+ulonglong
+ParallelInsert::rows() const
+{
+	ulonglong n = 0;
+	for (size_t i = 0; i < results_.size(); ++i) {
+		if (results_[i].committed()) {
+			n += results_[i].rows();
+		}
+	}
+	return n;
+}
+
+
+ulonglong
+ParallelInsert::shard_rows(ulonglong n, unsigned int count,
+		unsigned int i)
+{
+	// Spread the remainder over the first shards, one row each
+	return n / count + (i < n % count ? 1 : 0);
+}
+
+
+unsigned int
+ParallelInsert::start_job(ulonglong n)
+{
+	results_.clear();
+	++jobs_;
+
+	unsigned int threads = executor_.threads();
+	if (threads == 0) {
+		threads = 1;	// executor runs tasks inline
+	}
+
+	unsigned int count = shards_ ? shards_ : threads;
+	if ((mode_ == all_or_nothing) && (count > threads)) {
+		// Every shard must be running at once to vote
+		count = threads;
+	}
+	if (count > n) {
+		count = static_cast<unsigned int>(n);
+	}
+	return count;
+}
+
+
+std::string
+ParallelInsert::xid(unsigned int i) const
+{
+	// XA transaction IDs are global to the server, so mix in things
+	// that make a clash with another program's IDs unlikely.  The
+	// server limits them to 64 bytes.
+	std::ostringstream os;
+	os << "mysqlpp." << static_cast<const void*>(this) << '.' <<
+			time(0) << '.' << jobs_ << '.' << i;
+	return os.str();
+}
+
+} // end namespace mysqlpp
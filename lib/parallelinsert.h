@@ -0,0 +1,383 @@
+/// \file parallelinsert.h
+/// \brief Declares the ParallelInsert class, which splits a large
+/// Query::insertfrom() job into shards and runs them at once on
+/// several pooled connections.
+
+/***********************************************************************
+ Copyright (c) 2009 by Educational Technology Resources, Inc.
+ Others may also hold copyrights on code in this file.  See the
+ CREDITS.txt file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#if !defined(MYSQLPP_PARALLELINSERT_H)
+#define MYSQLPP_PARALLELINSERT_H
+
+#include "common.h"
+
+#include "connection.h"
+#include "executor.h"
+#include "query.h"
+#include "transaction.h"
+
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace mysqlpp {
+
+/// \brief The outcome of one shard of a ParallelInsert job
+
+class MYSQLPP_EXPORT ShardResult
+{
+public:
+	/// \brief Create an object describing a shard that hasn't run
+	ShardResult() :
+	rows_(0),
+	committed_(false),
+	errnum_(0)
+	{
+	}
+
+	/// \brief Create an object describing a shard's outcome
+	///
+	/// \param rows the number of rows in the shard
+	/// \param committed true if the shard's rows were committed
+	/// \param error why they weren't, if they weren't
+	/// \param errnum the server's error number for it, if any
+	ShardResult(ulonglong rows, bool committed,
+			const std::string& error = std::string(), int errnum = 0) :
+	rows_(rows),
+	committed_(committed),
+	error_(error),
+	errnum_(errnum)
+	{
+	}
+
+	/// \brief Returns true if the shard's rows were committed
+	bool committed() const { return committed_; }
+
+	/// \brief Return the error that stopped the shard, if any
+	///
+	/// A shard can be rolled back without an error of its own, when
+	/// some other shard of an all-or-nothing job fails.
+	const std::string& error() const { return error_; }
+
+	/// \brief Return the server's error number for error(), or 0
+	int errnum() const { return errnum_; }
+
+	/// \brief Return the number of rows in the shard
+	ulonglong rows() const { return rows_; }
+
+private:
+	ulonglong rows_;
+	bool committed_;
+	std::string error_;
+	int errnum_;
+};
+
+
+/// \brief Wraps an insert policy so Query::insertfrom() doesn't start
+/// a transaction of its own
+///
+/// \internal ParallelInsert uses this in all-or-nothing mode, where
+/// each shard's insert runs inside an XATransaction instead.  MySQL
+/// doesn't allow a regular transaction within an XA one.
+
+template <class Policy>
+class NoTransactionPolicy : public Policy
+{
+public:
+	/// \brief Alias for the object type used by insertfrom() to
+	/// manage the transaction: nothing, in this case
+	typedef NoTransaction access_controller;
+
+	/// \brief Wrap a copy of the given policy
+	explicit NoTransactionPolicy(const Policy& p) :
+	Policy(p)
+	{
+	}
+};
+
+
+/// \brief QueryExecutor task running one shard of a ParallelInsert job
+///
+/// \internal ParallelInsert::insertfrom() creates these.  The task
+/// catches everything its work throws, reporting it in its
+/// ShardResult instead, so that the caller can see how every shard
+/// fared, not just the first one to fail.
+
+template <class Iter, class Policy>
+class InsertShard
+{
+public:
+	/// \brief The task's result type
+	typedef ShardResult result_type;
+
+	/// \brief Create a shard task
+	///
+	/// \param first start of the shard's rows
+	/// \param last end of the shard's rows
+	/// \param rows the number of rows in [first, last)
+	/// \param policy insert policy to copy for this shard
+	/// \param vote how the shards of an all-or-nothing job decide
+	/// whether to commit, or 0 to commit this shard on its own
+	/// \param xid the shard's XA transaction ID, if \c vote is set
+	InsertShard(Iter first, Iter last, ulonglong rows,
+			const Policy& policy, CommitVote* vote = 0,
+			const std::string& xid = std::string()) :
+	first_(first),
+	last_(last),
+	rows_(rows),
+	policy_(policy),
+	vote_(vote),
+	xid_(xid)
+	{
+	}
+
+	/// \brief Insert the shard's rows through the given connection
+	///
+	/// Exceptions are turned on for the duration, so a failure
+	/// anywhere along the way shows up as one.
+	ShardResult operator()(Connection& conn) const
+	{
+		bool te = conn.throw_exceptions();
+		conn.enable_exceptions();
+		ShardResult r = vote_ ? run_xa(conn) : run(conn);
+		if (!te) {
+			conn.disable_exceptions();
+		}
+		return r;
+	}
+
+	/// \brief Cast a failing vote for a shard that won't be run
+	/// because the executor couldn't get a connection for it, so the
+	/// other shards of an all-or-nothing job don't wait forever
+	friend void task_not_run(const InsertShard& shard,
+			const std::exception&)
+	{
+		if (shard.vote_) {
+			shard.vote_->fail(1);
+		}
+	}
+
+private:
+	/// \brief Insert and commit the rows without regard to the other
+	/// shards
+	ShardResult run(Connection& conn) const
+	{
+		try {
+			Policy policy(policy_);
+			conn.query().insertfrom(first_, last_, policy);
+			return ShardResult(rows_, true);
+		}
+		catch (const BadQuery& e) {
+			return ShardResult(rows_, false, e.what(), e.errnum());
+		}
+		catch (const std::exception& e) {
+			return ShardResult(rows_, false, e.what());
+		}
+	}
+
+	/// \brief Insert and prepare the rows, then commit them only if
+	/// all the other shards prepared theirs
+	///
+	/// Every path through here votes exactly once, else the other
+	/// shards would wait forever.
+	ShardResult run_xa(Connection& conn) const
+	{
+		bool voted = false;
+		try {
+			XATransaction xa(conn, xid_);
+			NoTransactionPolicy<Policy> policy(policy_);
+			conn.query().insertfrom(first_, last_, policy);
+			bool ok = xa.prepare();
+
+			voted = true;
+			if (vote_->vote(ok)) {
+				xa.commit();
+				return ShardResult(rows_, true);
+			}
+			else {
+				xa.rollback();
+				return ShardResult(rows_, false);
+			}
+		}
+		catch (const BadQuery& e) {
+			if (!voted) {
+				vote_->vote(false);
+			}
+			return ShardResult(rows_, false, e.what(), e.errnum());
+		}
+		catch (const std::exception& e) {
+			if (!voted) {
+				vote_->vote(false);
+			}
+			return ShardResult(rows_, false, e.what());
+		}
+	}
+
+	Iter first_;
+	Iter last_;
+	ulonglong rows_;
+	Policy policy_;
+	CommitVote* vote_;
+	std::string xid_;
+};
+
+
+/// \brief Inserts a large range of rows by splitting it into shards
+/// and running Query::insertfrom() on each at once, using pooled
+/// connections.
+///
+/// Each shard is a contiguous piece of the range.  It gets its own
+/// copy of the insert policy, its own connection from the
+/// QueryExecutor's pool and its own worker thread, so the server can
+/// parse and store several shards' statements at once:
+///
+/// \code
+/// MyPool pool(...);
+/// mysqlpp::QueryExecutor executor(pool, 8);
+/// mysqlpp::ParallelInsert pi(executor,
+///         mysqlpp::ParallelInsert::all_or_nothing);
+/// mysqlpp::Query::MaxPacketInsertPolicy<> policy(&con);
+/// if (!pi.insertfrom(items.begin(), items.end(), policy)) {
+///     ...look at pi.results()...
+/// }
+/// \endcode
+///
+/// In \c per_shard mode, each shard commits or rolls back on its own,
+/// just as a serial insertfrom() call on its rows would, using the
+/// policy's own access controller.  When some shards fail, the rows
+/// of the others stay in the table; results() says which is which.
+///
+/// In \c all_or_nothing mode, each shard's rows go in under an
+/// XATransaction instead.  When a shard's rows are all in, it
+/// prepares its transaction and waits for the others, and then the
+/// shards commit only if all of them prepared successfully.  Since
+/// the wait ties up a worker thread per shard, this mode runs no
+/// more shards than the executor has threads, and you shouldn't
+/// give the executor other work that waits on this job while it
+/// runs.  The tables must use a transactional storage engine.
+///
+/// Sharding doesn't speed up a job bottlenecked on the network
+/// rather than the server, and adds a little overhead to small
+/// jobs, so measure before switching: see examples/pinsert.cpp.
+
+class MYSQLPP_EXPORT ParallelInsert
+{
+public:
+	/// \brief How the shards' commits relate to each other
+	enum Mode {
+		per_shard,		///< each shard commits on its own
+		all_or_nothing	///< all shards commit, or none do
+	};
+
+	/// \brief Create an object for running inserts on an executor
+	///
+	/// \param ex the executor whose threads and connection pool the
+	/// shards run on
+	/// \param mode whether the shards commit together
+	/// \param shards how many pieces to split each job into, or 0 for
+	/// one per executor thread
+	ParallelInsert(QueryExecutor& ex, Mode mode = per_shard,
+			unsigned int shards = 0);
+
+	/// \brief Insert a range of SSQLS objects, in parallel
+	///
+	/// The iterators must be at least forward iterators.  This blocks
+	/// until every shard has finished.
+	///
+	/// \param first start of the range to insert
+	/// \param last end of the range to insert
+	/// \param policy insert policy, copied for each shard.  See
+	/// insertpolicy.h for the choices.
+	///
+	/// \retval true if all the shards committed
+	template <class Iter, class Policy>
+	bool insertfrom(Iter first, Iter last, const Policy& policy)
+	{
+		ulonglong n = std::distance(first, last);
+		unsigned int count = start_job(n);
+		std::vector<Future<ShardResult> > futures;
+		CommitVote vote(count);
+		CommitVote* vp = (mode_ == all_or_nothing) ? &vote : 0;
+
+		try {
+			Iter begin = first;
+			for (unsigned int i = 0; i < count; ++i) {
+				ulonglong rows = shard_rows(n, count, i);
+				Iter end = begin;
+				std::advance(end, rows);
+				futures.push_back(executor_.submit(
+						InsertShard<Iter, Policy>(begin, end, rows,
+						policy, vp, vp ? xid(i) : std::string())));
+				begin = end;
+			}
+		}
+		catch (...) {
+			// Let the shards that did start roll back and finish
+			// before the vote goes away, then pass the error along
+			vote.fail(count - static_cast<unsigned int>(futures.size()));
+			collect(futures);
+			throw;
+		}
+
+		return collect(futures);
+	}
+
+	/// \brief Return the mode set in the constructor
+	Mode mode() const { return mode_; }
+
+	/// \brief Return the outcome of each shard of the last
+	/// insertfrom() call, in range order
+	const std::vector<ShardResult>& results() const { return results_; }
+
+	/// \brief Return the number of rows the last insertfrom() call
+	/// committed
+	ulonglong rows() const;
+
+private:
+	/// \brief Wait for the shards to finish, gathering their results
+	///
+	/// \retval true if all of them committed
+	bool collect(std::vector<Future<ShardResult> >& futures);
+
+	/// \brief Forget the last job, and decide how many shards a new
+	/// one of \c n rows gets
+	unsigned int start_job(ulonglong n);
+
+	/// \brief Return the number of rows in shard \c i of \c count
+	static ulonglong shard_rows(ulonglong n, unsigned int count,
+			unsigned int i);
+
+	/// \brief Build the XA transaction ID for shard \c i of the
+	/// current job
+	std::string xid(unsigned int i) const;
+
+	QueryExecutor& executor_;
+	Mode mode_;
+	unsigned int shards_;
+	unsigned long jobs_;
+	std::vector<ShardResult> results_;
+};
+
+} // end namespace mysqlpp
+
+#endif // !defined(MYSQLPP_PARALLELINSERT_H)
@@ -0,0 +1,477 @@
+/***********************************************************************
+ prepquery.cpp - Implements the PreparedQuery class.
+
+ Copyright (c) 2009 by Educational Technology Resources, Inc.  Others
+ may also hold copyrights on code in this file.  See the CREDITS.txt
+ file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#define MYSQLPP_NOT_HEADER
+#include "prepquery.h"
+
+#include "connection.h"
+#include "dbdriver.h"
+#include "query.h"
+#include "resultcache.h"
+
+#include <string.h>
+#include <time.h>
+
+namespace mysqlpp {
+
+PreparedQuery::BoundParam::BoundParam() :
+type(MYSQL_TYPE_NULL),
+is_set(false),
+is_null(1),
+is_unsigned(0),
+length(0)
+{
+	number.i = 0;
+	memset(&time, 0, sizeof(time));
+}
+
+
+PreparedQuery::PreparedQuery(Connection* c, const char* tmpl, bool te) :
+OptionalExceptions(te),
+conn_(c),
+prepared_(false),
+copacetic_(true)
+{
+	Query q(c, te, tmpl);
+	q.parse();
+	init(q);
+}
+
+
+PreparedQuery::PreparedQuery(Query& q) :
+OptionalExceptions(q.throw_exceptions()),
+conn_(q.conn_),
+prepared_(false),
+copacetic_(true)
+{
+	if (!q.parsed_) {
+		// Not a template query yet, so parse a copy of its text rather
+		// than change the caller's object behind its back.
+		Query t(conn_, throw_exceptions(), q.sbuffer_.str().c_str());
+		t.parse();
+		init(t);
+	}
+	else {
+		init(q);
+	}
+}
+
+
+ulonglong
+PreparedQuery::affected_rows() const
+{
+	return stmt_ ? conn_->driver()->stmt_affected_rows(stmt_.raw()) : 0;
+}
+
+
+PreparedQuery&
+PreparedQuery::bind(int pos, double value)
+{
+	if (BoundParam* p = param(pos)) {
+		p->type = MYSQL_TYPE_DOUBLE;
+		p->is_null = 0;
+		p->is_unsigned = 0;
+		p->number.d = value;
+	}
+	return *this;
+}
+
+
+PreparedQuery&
+PreparedQuery::bind(int pos, const Date& value)
+{
+	if (BoundParam* p = param(pos)) {
+		memset(&p->time, 0, sizeof(p->time));
+		p->time.year = value.year();
+		p->time.month = value.month();
+		p->time.day = value.day();
+		p->time.time_type = MYSQL_TIMESTAMP_DATE;
+		p->type = MYSQL_TYPE_DATE;
+		p->is_null = 0;
+	}
+	return *this;
+}
+
+
+PreparedQuery&
+PreparedQuery::bind(int pos, const DateTime& value)
+{
+	if (BoundParam* p = param(pos)) {
+		// A default-constructed DateTime means "NOW()" when it goes
+		// into SQL text.  There is no such thing in the binary
+		// protocol, so substitute the client's current time.
+		const DateTime& dt = value.is_now() ? DateTime(::time(0)) : value;
+
+		memset(&p->time, 0, sizeof(p->time));
+		p->time.year = dt.year();
+		p->time.month = dt.month();
+		p->time.day = dt.day();
+		p->time.hour = dt.hour();
+		p->time.minute = dt.minute();
+		p->time.second = dt.second();
+		p->time.time_type = MYSQL_TIMESTAMP_DATETIME;
+		p->type = MYSQL_TYPE_DATETIME;
+		p->is_null = 0;
+	}
+	return *this;
+}
+
+
+PreparedQuery&
+PreparedQuery::bind(int pos, const Time& value)
+{
+	if (BoundParam* p = param(pos)) {
+		memset(&p->time, 0, sizeof(p->time));
+		p->time.hour = value.hour();
+		p->time.minute = value.minute();
+		p->time.second = value.second();
+		p->time.time_type = MYSQL_TIMESTAMP_TIME;
+		p->type = MYSQL_TYPE_TIME;
+		p->is_null = 0;
+	}
+	return *this;
+}
+
+
+PreparedQuery&
+PreparedQuery::bind(int pos, const SQLTypeAdapter& value)
+{
+	if (value.is_null()) {
+		return bind(pos, null);
+	}
+	else if (BoundParam* p = param(pos)) {
+		// SQLTypeAdapter copies share the underlying buffer, so this
+		// keeps the caller's data alive without duplicating it.
+		p->text = value;
+		p->type = MYSQL_TYPE_STRING;
+		p->is_null = 0;
+	}
+	return *this;
+}
+
+
+PreparedQuery&
+PreparedQuery::bind(int pos, const null_type&)
+{
+	if (BoundParam* p = param(pos)) {
+		p->type = MYSQL_TYPE_NULL;
+		p->is_null = 1;
+	}
+	return *this;
+}
+
+
+PreparedQuery&
+PreparedQuery::bind_integer(int pos, longlong value, bool is_unsigned)
+{
+	if (BoundParam* p = param(pos)) {
+		// Send all integers as 64-bit; the server narrows them to the
+		// column type, so there's no gain in tracking the C++ width.
+		p->type = MYSQL_TYPE_LONGLONG;
+		p->is_null = 0;
+		p->is_unsigned = is_unsigned;
+		p->number.i = value;
+	}
+	return *this;
+}
+
+
+int
+PreparedQuery::errnum() const
+{
+	int e = stmt_ ? conn_->driver()->stmt_errno(stmt_.raw()) : 0;
+	return e ? e : (conn_ ? conn_->errnum() : 0);
+}
+
+
+const char*
+PreparedQuery::error() const
+{
+	const char* e = stmt_ ? conn_->driver()->stmt_error(stmt_.raw()) : "";
+	return *e ? e : (conn_ ? conn_->error() : "");
+}
+
+
+SimpleResult
+PreparedQuery::execute()
+{
+	if (run()) {
+		return SimpleResult(conn_, insert_id(), affected_rows(),
+				conn_->driver()->query_info());
+	}
+	else {
+		return SimpleResult();
+	}
+}
+
+
+SimpleResult
+PreparedQuery::execute(SQLQueryParms& p)
+{
+	for (size_t i = 0; i < p.size() && i < params_.size(); ++i) {
+		bind(int(i), p[i]);
+	}
+	return execute();
+}
+
+
+bool
+PreparedQuery::fail()
+{
+	copacetic_ = false;
+	if (throw_exceptions()) {
+		throw BadQuery(error(), errnum());
+	}
+	return false;
+}
+
+
+void
+PreparedQuery::init(const Query& q)
+{
+	const SQLParsedTemplate::ElementList& elems = q.parsed_->elements();
+	int highest = int(q.parsed_->names().size()) - 1;
+	for (SQLParsedTemplate::ElementList::const_iterator it =
+			elems.begin(); it != elems.end(); ++it) {
+		sql_ += it->before;
+		if (it->num >= 0) {
+			sql_ += '?';
+			markers_.push_back(it->num);
+			if (it->num > highest) {
+				highest = it->num;
+			}
+		}
+	}
+
+	params_.resize(highest + 1);
+	binds_.resize(markers_.size());
+	parsed_nums_ = q.parsed_->nums();
+
+	// Start with the Query's default parameter values, if any
+	for (size_t i = 0; i < q.template_defaults.size() &&
+			i < params_.size(); ++i) {
+		bind(int(i), q.template_defaults[i]);
+	}
+
+	if (conn_ && conn_->connected()) {
+		if (!prepare()) {
+			fail();
+		}
+	}
+}
+
+
+ulonglong
+PreparedQuery::insert_id() const
+{
+	return stmt_ ? conn_->driver()->stmt_insert_id(stmt_.raw()) : 0;
+}
+
+
+PreparedQuery::operator void*() const
+{
+	return copacetic_ && conn_ && *conn_ ?
+			const_cast<PreparedQuery*>(this) : 0;
+}
+
+
+PreparedQuery::BoundParam*
+PreparedQuery::param(int pos)
+{
+	if ((pos >= 0) && (size_t(pos) < params_.size())) {
+		params_[pos].is_set = true;
+		return &params_[pos];
+	}
+	else {
+		copacetic_ = false;
+		if (throw_exceptions()) {
+			throw BadIndex("PreparedQuery parameter", pos,
+					int(params_.size()));
+		}
+		return 0;
+	}
+}
+
+
+int
+PreparedQuery::param_num(const char* name)
+{
+	std::map<std::string, short int>::const_iterator it =
+			parsed_nums_.find(name);
+	if (it != parsed_nums_.end()) {
+		return it->second;
+	}
+	else {
+		copacetic_ = false;
+		if (throw_exceptions()) {
+			throw BadFieldName(name);
+		}
+		return -1;
+	}
+}
+
+
+bool
+PreparedQuery::prepare()
+{
+	if (prepared_) {
+		return true;
+	}
+	else if (!conn_) {
+		copacetic_ = false;
+		if (throw_exceptions()) {
+			throw ObjectNotInitialized(
+					"PreparedQuery has no connection to prepare on");
+		}
+		return false;
+	}
+
+	DBDriver* d = conn_->driver();
+	if (!stmt_) {
+		MYSQL_STMT* stmt = d->stmt_init();
+		if (!stmt) {
+			return false;
+		}
+		stmt_ = stmt;
+
+		// Have stmt_store_result() work out the longest value in each
+		// column, so TypedResult can size its text buffers up front.
+		bind_bool update_max_length = 1;
+		d->stmt_attr_set(stmt, STMT_ATTR_UPDATE_MAX_LENGTH,
+				&update_max_length);
+	}
+
+	// On failure we keep the handle, so error() can say why, and try
+	// the preparation again on the next execute().
+	return prepared_ = d->stmt_prepare(stmt_.raw(), sql_.data(),
+			sql_.length());
+}
+
+bool
+PreparedQuery::run()
+{
+	if (!prepare()) {
+		return fail();
+	}
+
+	// Only the parameters the statement's markers use need values;
+	// numbering may skip some
+	for (size_t i = 0; i < markers_.size(); ++i) {
+		if (!params_[markers_[i]].is_set) {
+			copacetic_ = false;
+			if (throw_exceptions()) {
+				throw BadParamCount(
+						"Not enough parameters to fill the template.");
+			}
+			return false;
+		}
+	}
+
+	// Point the C API at the current values.  Rebuilt on each call,
+	// since copying a PreparedQuery moves params_.
+	for (size_t i = 0; i < markers_.size(); ++i) {
+		BoundParam& p = params_[markers_[i]];
+		MYSQL_BIND& b = binds_[i];
+		memset(&b, 0, sizeof(b));
+		b.buffer_type = p.type;
+		b.is_null = &p.is_null;
+		b.is_unsigned = p.is_unsigned;
+
+		switch (p.type) {
+			case MYSQL_TYPE_LONGLONG:
+				b.buffer = &p.number.i;
+				break;
+
+			case MYSQL_TYPE_DOUBLE:
+				b.buffer = &p.number.d;
+				break;
+
+			case MYSQL_TYPE_DATE:
+			case MYSQL_TYPE_DATETIME:
+			case MYSQL_TYPE_TIME:
+				b.buffer = &p.time;
+				break;
+
+			case MYSQL_TYPE_STRING:
+				p.length = static_cast<unsigned long>(p.text.length());
+				b.buffer = const_cast<char*>(p.text.data());
+				b.buffer_length = p.length;
+				b.length = &p.length;
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	DBDriver* d = conn_->driver();
+	copacetic_ = (binds_.empty() ||
+			d->stmt_bind_param(stmt_.raw(), &binds_[0])) &&
+			d->stmt_execute(stmt_.raw());
+	if (ResultCache* cache = conn_->result_cache()) {
+		cache->invalidate(sql_.data(), sql_.length());
+	}
+	return copacetic_ || fail();
+}
+
+
+TypedResult
+PreparedQuery::store()
+{
+	if (!run()) {
+		return TypedResult();
+	}
+
+	DBDriver* d = conn_->driver();
+	MYSQL_STMT* stmt = stmt_.raw();
+	if (!d->stmt_store_result(stmt)) {
+		fail();
+		return TypedResult();
+	}
+
+	if (MYSQL_RES* meta = d->stmt_result_metadata(stmt)) {
+		return TypedResult(stmt, meta, d, throw_exceptions());
+	}
+	else {
+		// Either the statement doesn't return rows, or the metadata
+		// fetch failed.  Only the latter is an error.
+		if (errnum()) {
+			fail();
+		}
+		return TypedResult();
+	}
+}
+
+
+TypedResult
+PreparedQuery::store(SQLQueryParms& p)
+{
+	for (size_t i = 0; i < p.size() && i < params_.size(); ++i) {
+		bind(int(i), p[i]);
+	}
+	return store();
+}
+
+} // end namespace mysqlpp
@@ -0,0 +1,374 @@
+/// \file prepquery.h
+/// \brief Declares the PreparedQuery class, a wrapper for server-side
+/// prepared statements.
+
+/***********************************************************************
+ Copyright (c) 2009 by Educational Technology Resources, Inc.  Others
+ may also hold copyrights on code in this file.  See the CREDITS.txt
+ file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#if !defined(MYSQLPP_PREPQUERY_H)
+#define MYSQLPP_PREPQUERY_H
+
+#include "common.h"
+
+#include "datetime.h"
+#include "mystring.h"
+#include "noexceptions.h"
+#include "null.h"
+#include "qparms.h"
+#include "querydef.h"
+#include "refcounted.h"
+#include "result.h"
+#include "stadapter.h"
+#include "tiny_int.h"
+#include "typedresult.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace mysqlpp {
+
+#if !defined(DOXYGEN_IGNORE)
+// Make Doxygen ignore this
+class MYSQLPP_EXPORT Connection;
+class MYSQLPP_EXPORT Query;
+#endif
+
+/// \brief Functor to call mysql_stmt_close() for RefCountedPointer.
+///
+/// As with the MYSQL_RES specialization in result.h, the C API wants
+/// to tear down its own statement handles.
+template <>
+struct RefCountedPointerDestroyer<MYSQL_STMT>
+{
+	/// \brief Functor implementation
+	void operator()(MYSQL_STMT* doomed) const
+	{
+		if (doomed) {
+			mysql_stmt_close(doomed);
+		}
+	}
+};
+
+
+/// \brief A template query compiled once by the database server and
+/// then executed many times with new parameter values.
+///
+/// A plain template query (see Query::parse()) must be rebuilt as SQL
+/// text on every call: each parameter is formatted, escaped and quoted,
+/// and the server then has to parse the complete statement again.
+/// PreparedQuery instead sends the template to the server once, with
+/// each \c %N parameter replaced by a \c ? marker, and afterward sends
+/// only the parameter values, in the C API's binary format.
+///
+/// You can create one from a template string:
+///
+/// \code
+/// mysqlpp::PreparedQuery pq = conn.prepare(
+///         "insert into stock (item, num) values (%0q:item, %1:num)");
+/// pq.bind("item", "Nürnberger Brats").bind("num", 97).execute();
+/// pq.execute("Pickled Herring", 87);
+/// \endcode
+///
+/// ...or from an existing Query object, which lets you reuse template
+/// query code you already have:
+///
+/// \code
+/// mysqlpp::Query q = conn.query("select * from stock where item = %0q");
+/// q.parse();
+/// mysqlpp::PreparedQuery pq(q);
+/// \endcode
+///
+/// The template syntax is exactly that accepted by Query::parse(),
+/// including named parameters.  The \c q and \c Q quoting modifiers are
+/// accepted but have no effect, because parameter values never become
+/// part of the SQL text.  For the same reason, a parameter must not be
+/// enclosed in quotes in the template, and a parameter can stand only
+/// where the server allows a \c ? marker: in place of a value, not a
+/// table or column name.
+///
+/// Values passed to bind() keep their native C++ type all the way to
+/// the server, so integers, floating-point values, and dates and times
+/// are never turned into strings on the client side.  Values passed in
+/// SQLQueryParms or as SQLTypeAdapter arguments to execute() are sent
+/// as strings, which spares the escaping and quoting work but lets the
+/// server do the type conversion.  Bound values persist from one
+/// execution to the next, so you only need to rebind the parameters
+/// that change.
+///
+/// Use execute() for statements that don't return rows, and store()
+/// for those that do.  store() fetches the rows through the binary
+/// protocol as well, into a TypedResult.
+///
+/// Copies of a PreparedQuery share the server-side statement.  The
+/// statement lives until the last copy is destroyed; it must not be
+/// used after its Connection is closed.
+class MYSQLPP_EXPORT PreparedQuery : public OptionalExceptions
+{
+public:
+	/// \brief Prepare a template query for execution
+	///
+	/// If the connection is up, the statement is prepared immediately,
+	/// so syntax errors are reported here.  Otherwise, preparation
+	/// waits until the first call to execute().
+	///
+	/// \param c connection to prepare the statement on
+	/// \param tmpl template query text, in Query::parse() syntax
+	/// \param te if true, throw exceptions on errors
+	PreparedQuery(Connection* c, const char* tmpl, bool te = true);
+
+	/// \brief Prepare the template query held by a Query object
+	///
+	/// If q has been parse()d, its template parameters and default
+	/// values are used.  Otherwise, its current contents are parsed as
+	/// a template; q itself is not modified.
+	explicit PreparedQuery(Query& q);
+
+	/// \brief Return the number of rows affected by the last execution
+	ulonglong affected_rows() const;
+
+	/// \brief Bind a value to the given template parameter
+	///
+	/// There is an overload of this method for each C++ type the
+	/// binary protocol can carry directly, plus Null<T>, SQLTypeAdapter
+	/// and the string types, which are sent as character data.
+	///
+	/// \param pos template parameter number, e.g. 1 for \c %1
+	/// \param value value to send to the server for this parameter
+	///
+	/// \retval *this, so calls can be chained
+	PreparedQuery& bind(int pos, bool value)
+			{ return bind_integer(pos, value, false); }
+	PreparedQuery& bind(int pos, tiny_int<signed char> value)
+			{ return bind_integer(pos, int(value), false); }
+	PreparedQuery& bind(int pos, tiny_int<unsigned char> value)
+			{ return bind_integer(pos, int(value), true); }
+	PreparedQuery& bind(int pos, short value)
+			{ return bind_integer(pos, value, false); }
+	PreparedQuery& bind(int pos, unsigned short value)
+			{ return bind_integer(pos, value, true); }
+	PreparedQuery& bind(int pos, int value)
+			{ return bind_integer(pos, value, false); }
+	PreparedQuery& bind(int pos, unsigned value)
+			{ return bind_integer(pos, value, true); }
+	PreparedQuery& bind(int pos, long value)
+			{ return bind_integer(pos, value, false); }
+	PreparedQuery& bind(int pos, unsigned long value)
+			{ return bind_integer(pos, value, true); }
+	PreparedQuery& bind(int pos, longlong value)
+			{ return bind_integer(pos, value, false); }
+	PreparedQuery& bind(int pos, ulonglong value)
+			{ return bind_integer(pos, longlong(value), true); }
+	PreparedQuery& bind(int pos, float value)
+			{ return bind(pos, double(value)); }
+	PreparedQuery& bind(int pos, double value);
+	PreparedQuery& bind(int pos, const Date& value);
+	PreparedQuery& bind(int pos, const DateTime& value);
+	PreparedQuery& bind(int pos, const Time& value);
+	PreparedQuery& bind(int pos, const char* value)
+			{ return bind(pos, SQLTypeAdapter(value)); }
+	PreparedQuery& bind(int pos, const std::string& value)
+			{ return bind(pos, SQLTypeAdapter(value)); }
+	PreparedQuery& bind(int pos, const String& value)
+			{ return bind(pos, SQLTypeAdapter(value)); }
+	PreparedQuery& bind(int pos, const SQLTypeAdapter& value);
+	PreparedQuery& bind(int pos, const null_type&);
+
+	/// \brief Bind a possibly-SQL-null value to the given template
+	/// parameter
+	template <class T, class B>
+	PreparedQuery& bind(int pos, const Null<T, B>& value)
+	{
+		return value.is_null ? bind(pos, null) : bind(pos, value.data);
+	}
+
+	/// \brief Bind a value to the given named template parameter
+	///
+	/// \param name parameter name, e.g. "item" for \c %0:item
+	/// \param value value to send to the server for this parameter
+	template <class T>
+	PreparedQuery& bind(const char* name, const T& value)
+	{
+		return bind(param_num(name), value);
+	}
+
+	/// \brief Get the last error number that was set
+	///
+	/// Returns the statement's error if it has one, else delegates to
+	/// Connection::errnum().
+	int errnum() const;
+
+	/// \brief Get the last error message that was set
+	///
+	/// Returns the statement's error if it has one, else delegates to
+	/// Connection::error().
+	const char* error() const;
+
+	/// \brief Execute the statement with the currently bound values
+	///
+	/// \retval a SimpleResult, which is false if the statement failed
+	/// and exceptions are disabled
+	SimpleResult execute();
+
+	/// \brief Bind the given values, then execute the statement
+	///
+	/// Parameters beyond the end of p keep their previously bound
+	/// values.
+	SimpleResult execute(SQLQueryParms& p);
+
+	/// \brief Bind a value to the first parameter, then execute the
+	/// statement
+	///
+	/// There are many more overloads of this type (25 total, by
+	/// default; see \c lib/querydef.pl), each taking one more
+	/// SQLTypeAdapter object than the previous one.
+	SimpleResult execute(const SQLTypeAdapter& arg0)
+			{ return execute(SQLQueryParms() << arg0); }
+
+	/// \brief Get ID generated for an AUTO_INCREMENT column by the last
+	/// execution
+	ulonglong insert_id() const;
+
+	/// \brief Test whether the object has experienced an error
+	/// condition
+	///
+	/// \see Query::operator void*()
+	operator void*() const;
+
+	/// \brief Returns the number of distinct template parameters
+	///
+	/// A parameter used more than once in the template counts once.
+	size_t param_count() const { return params_.size(); }
+
+	/// \brief Returns the template parameter number for the given name
+	///
+	/// \retval -1 if there is no such named parameter and exceptions
+	/// are disabled
+	int param_num(const char* name);
+
+	/// \brief Returns the SQL text sent to the server for preparation
+	const std::string& sql() const { return sql_; }
+
+	/// \brief Execute the statement with the currently bound values,
+	/// and fetch all of the rows it returns
+	///
+	/// Values come back through the binary protocol, decoded straight
+	/// into native C++ types; see TypedValue.
+	///
+	/// \retval a TypedResult, which is false if the statement failed
+	/// and exceptions are disabled; it is also false, but without an
+	/// error, if the statement isn't one that returns rows
+	TypedResult store();
+
+	/// \brief Bind the given values, then execute the statement and
+	/// fetch its result set
+	TypedResult store(SQLQueryParms& p);
+
+	/// \brief Bind a value to the first parameter, then execute the
+	/// statement and fetch its result set
+	///
+	/// As with execute(const SQLTypeAdapter&), there are 24 more
+	/// overloads, each taking one more SQLTypeAdapter.
+	TypedResult store(const SQLTypeAdapter& arg0)
+			{ return store(SQLQueryParms() << arg0); }
+
+#if !defined(DOXYGEN_IGNORE)
+	// Declare the remaining overloads.  See the comment in query.h.
+	mysql_query_define0(SimpleResult, execute)
+	mysql_query_define0(TypedResult, store)
+#endif // !defined(DOXYGEN_IGNORE)
+
+private:
+	/// \brief The value bound to one template parameter, in a form
+	/// a MYSQL_BIND structure can point into
+	struct BoundParam
+	{
+		enum_field_types type;	///< C API type of value; NULL if unset
+		bool is_set;			///< true once a value is bound
+		bind_bool is_null;		///< MYSQL_BIND::is_null points here
+		bind_bool is_unsigned;	///< true if number.i holds a ulonglong
+		union {
+			longlong i;
+			double d;
+		} number;				///< storage for numeric types
+		MYSQL_TIME time;		///< storage for temporal types
+		SQLTypeAdapter text;	///< storage for character data
+		unsigned long length;	///< MYSQL_BIND::length points here
+
+		BoundParam();
+	};
+
+	/// \brief Common implementation of the integer bind() overloads
+	PreparedQuery& bind_integer(int pos, longlong value, bool is_unsigned);
+
+	/// \brief Returns the storage for the given parameter, or 0 after
+	/// reporting a bad parameter number
+	BoundParam* param(int pos);
+
+	/// \brief Set up our members from a parsed template query
+	void init(const Query& q);
+
+	/// \brief Have the server prepare sql_, if not already done
+	bool prepare();
+
+	/// \brief Report the current error
+	///
+	/// \retval false always, for the convenience of callers that
+	/// return a success flag
+	bool fail();
+
+	/// \brief Bind the current parameter values and execute the
+	/// statement, preparing it first if need be
+	bool run();
+
+	/// \brief Connection to prepare and execute the statement on
+	Connection* conn_;
+
+	/// \brief True once the server has accepted sql_
+	bool prepared_;
+
+	/// \brief Server-side statement handle; empty until first used
+	mutable RefCountedPointer<MYSQL_STMT> stmt_;
+
+	/// \brief Template with parameters replaced by \c ? markers
+	std::string sql_;
+
+	/// \brief Parameter number for each \c ? marker in sql_, in order
+	std::vector<int> markers_;
+
+	/// \brief Values bound to each template parameter
+	std::vector<BoundParam> params_;
+
+	/// \brief C API parameter descriptors, one per entry in markers_
+	std::vector<MYSQL_BIND> binds_;
+
+	/// \brief Maps template parameter names to their position value
+	std::map<std::string, short int> parsed_nums_;
+
+	/// \brief If true, last operation succeeded
+	bool copacetic_;
+};
+
+} // end namespace mysqlpp
+
+#endif // !defined(MYSQLPP_PREPQUERY_H)
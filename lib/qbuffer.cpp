@@ -0,0 +1,340 @@
+/***********************************************************************
+ qbuffer.cpp - Implements the QueryBuffer class.
+
+ Copyright (c) 2009 by Educational Technology Resources, Inc.
+ Others may also hold copyrights on code in this file.  See the
+ CREDITS.txt file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#include "qbuffer.h"
+
+#include "datetime.h"
+#include "dbdriver.h"
+#include "sqlescape.h"
+
+#include <limits>
+
+#include <limits.h>
+#include <locale.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace mysqlpp {
+
+// Allocate our pword() slot at static initialization time, so it's
+// unlikely to race with threads creating the first Query objects.  The
+// function-local static inside slot() covers other modules' static
+// initializers that run before this one.
+static const int escaping_stream_slot_init = EscapingStream::slot();
+
+
+int
+EscapingStream::slot()
+{
+	static const int index = std::ios_base::xalloc();
+	return index;
+}
+
+
+// Append the text snprintf() made of a floating-point value, turning
+// the C locale's decimal point into the '.' SQL wants, in case the
+// program has changed LC_NUMERIC
+static void
+append_real(QueryBuffer& qb, const char* buf, int n)
+{
+	const char* point = localeconv()->decimal_point;
+	if (!point || ((point[0] == '.') && (point[1] == '\0'))) {
+		qb.append(buf, size_t(n));
+		return;
+	}
+
+	size_t point_len = strlen(point);
+	for (const char* p = buf; p < buf + n; ) {
+		if (point_len && (strncmp(p, point, point_len) == 0)) {
+			qb.append('.');
+			p += point_len;
+		}
+		else {
+			qb.append(*p++);
+		}
+	}
+}
+
+
+QueryBuffer::QueryBuffer()
+{
+	setp(0, 0);
+}
+
+
+QueryBuffer::~QueryBuffer()
+{
+	delete[] pbase();
+}
+
+
+void
+QueryBuffer::advance(size_t n)
+{
+	// pbump() only takes an int, so get there in steps for huge
+	// buffers.
+	while (n > size_t(INT_MAX)) {
+		pbump(INT_MAX);
+		n -= INT_MAX;
+	}
+	pbump(int(n));
+}
+
+
+void
+QueryBuffer::append(const char* s, size_t n)
+{
+	if (size_t(epptr() - pptr()) < n) {
+		grow(n);
+	}
+	if (n) {
+		memcpy(pptr(), s, n);
+		advance(n);
+	}
+}
+
+
+void
+QueryBuffer::append(float f)
+{
+	typedef std::numeric_limits<float> nlf;
+	if ((f != f) || (nlf::has_infinity &&
+			((f == nlf::infinity()) || (f == -nlf::infinity())))) {
+		append('0');
+	}
+	else {
+		char buf[32];
+		int n = snprintf(buf, sizeof(buf), "%.9g", f);
+		append_real(*this, buf, n);
+	}
+}
+
+
+void
+QueryBuffer::append(double d)
+{
+	typedef std::numeric_limits<double> nld;
+	if ((d != d) || (nld::has_infinity &&
+			((d == nld::infinity()) || (d == -nld::infinity())))) {
+		append('0');
+	}
+	else {
+		char buf[32];
+		int n = snprintf(buf, sizeof(buf), "%.17g", d);
+		append_real(*this, buf, n);
+	}
+}
+
+
+void
+QueryBuffer::append(const Date& d)
+{
+	append_padded(d.year(), 4);
+	append('-');
+	append_padded(d.month(), 2);
+	append('-');
+	append_padded(d.day(), 2);
+}
+
+
+void
+QueryBuffer::append(const DateTime& dt)
+{
+	if (dt.is_now()) {
+		append("NOW()", 5);
+	}
+	else {
+		append(Date(dt));
+		append(' ');
+		append(Time(dt));
+	}
+}
+
+
+void
+QueryBuffer::append(const Time& t)
+{
+	append_padded(t.hour(), 2);
+	append(':');
+	append_padded(t.minute(), 2);
+	append(':');
+	append_padded(t.second(), 2);
+}
+
+
+size_t
+QueryBuffer::append_escaped(const char* s, size_t n, DBDriver* driver)
+{
+	// The C API needs room for the worst case, every character
+	// escaped, plus a null terminator.
+	if (size_t(epptr() - pptr()) < n * 2 + 1) {
+		grow(n * 2 + 1);
+	}
+
+	size_t len = driver ?
+			driver->escape_string(pptr(), s, n) :
+			DBDriver::escape_string_no_conn(pptr(), s, n);
+	advance(len);
+	return len;
+}
+
+
+void
+QueryBuffer::append_hex(const char* s, size_t n)
+{
+	if (size_t(epptr() - pptr()) < n * 2 + 3) {
+		grow(n * 2 + 3);
+	}
+
+	char* p = pptr();
+	*p++ = 'X';
+	*p++ = '\'';
+	p += hex_encode(p, s, n);
+	*p = '\'';
+	advance(n * 2 + 3);
+}
+
+
+void
+QueryBuffer::append_padded(unsigned int i, int width)
+{
+	char buf[16];
+	char* p = buf + sizeof(buf);
+	do {
+		*--p = char('0' + i % 10);
+		i /= 10;
+		--width;
+	}
+	while (i);
+	while (width-- > 0) {
+		*--p = '0';
+	}
+	append(p, size_t(buf + sizeof(buf) - p));
+}
+
+
+void
+QueryBuffer::append_signed(longlong i)
+{
+	if (i < 0) {
+		append('-');
+		// Negate in unsigned arithmetic so the most negative value
+		// doesn't overflow.
+		append_unsigned(ulonglong(0) - ulonglong(i));
+	}
+	else {
+		append_unsigned(ulonglong(i));
+	}
+}
+
+
+void
+QueryBuffer::append_unsigned(ulonglong i)
+{
+	char buf[24];
+	char* p = buf + sizeof(buf);
+	do {
+		*--p = char('0' + i % 10);
+		i /= 10;
+	}
+	while (i);
+	append(p, size_t(buf + sizeof(buf) - p));
+}
+
+
+void
+QueryBuffer::grow(size_t n)
+{
+	// Double the buffer each time, so building a query a piece at a
+	// time takes amortized linear time.
+	size_t len = size();
+	size_t cap = capacity() ? capacity() * 2 : 256;
+	if (cap < len + n) {
+		cap = len + n;
+	}
+
+	char* buf = new char[cap];
+	if (len) {
+		memcpy(buf, pbase(), len);
+	}
+	delete[] pbase();
+	setp(buf, buf + cap);
+	set_size(len);
+}
+
+
+QueryBuffer::int_type
+QueryBuffer::overflow(int_type c)
+{
+	if (traits_type::eq_int_type(c, traits_type::eof())) {
+		return traits_type::not_eof(c);
+	}
+
+	append(traits_type::to_char_type(c));
+	return c;
+}
+
+
+QueryBuffer::pos_type
+QueryBuffer::seekoff(off_type off, std::ios_base::seekdir way,
+		std::ios_base::openmode which)
+{
+	off_type base = way == std::ios_base::beg ? 0 :
+			off_type(size());	// cur and end are the same for us
+	return seekpos(pos_type(base + off), which);
+}
+
+
+QueryBuffer::pos_type
+QueryBuffer::seekpos(pos_type pos, std::ios_base::openmode which)
+{
+	off_type off = off_type(pos);
+	if ((which & std::ios_base::out) && (off >= 0) &&
+			(off <= off_type(size()))) {
+		set_size(size_t(off));
+		return pos;
+	}
+	else {
+		return pos_type(off_type(-1));
+	}
+}
+
+
+void
+QueryBuffer::set_size(size_t n)
+{
+	setp(pbase(), epptr());
+	advance(n);
+}
+
+
+std::streamsize
+QueryBuffer::xsputn(const char* s, std::streamsize n)
+{
+	append(s, size_t(n));
+	return n;
+}
+
+} // end namespace mysqlpp
@@ -0,0 +1,313 @@
+/// \file qbuffer.h
+/// \brief Declares the QueryBuffer class, the storage behind Query
+/// and SQLStream, and the EscapingStream interface they share.
+
+/***********************************************************************
+ Copyright (c) 2009 by Educational Technology Resources, Inc.
+ Others may also hold copyrights on code in this file.  See the
+ CREDITS.txt file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#if !defined(MYSQLPP_QBUFFER_H)
+#define MYSQLPP_QBUFFER_H
+
+#include "common.h"
+
+#include <ios>
+#include <streambuf>
+#include <string>
+
+namespace mysqlpp {
+
+#if !defined(DOXYGEN_IGNORE)
+// Make Doxygen ignore this
+class MYSQLPP_EXPORT DBDriver;
+class MYSQLPP_EXPORT Date;
+class MYSQLPP_EXPORT DateTime;
+class MYSQLPP_EXPORT Time;
+#endif
+
+/// \brief A contiguous, growable buffer for building SQL text.
+///
+/// Query and SQLStream are IOStreams writing into one of these, so
+/// everything you insert with \c << ends up here.  Unlike
+/// \c std::stringbuf, the text is always held in a single block of
+/// memory you can get at through data() and size() without copying it,
+/// and clear() keeps that block around for the next query, so a Query
+/// object that's reused doesn't keep reallocating its buffer.
+///
+/// The append() overloads write directly into the buffer, bypassing
+/// the IOStreams machinery.  They're meant for code building large
+/// queries, such as Query::insertfrom(), where per-item stream overhead
+/// adds up.  They format values the same way SQLTypeAdapter does.
+///
+/// Seeking the stream to a position before the end of the buffer
+/// truncates the buffer at that point; there is no separate "high
+/// water mark" as with \c std::stringbuf.
+
+class MYSQLPP_EXPORT QueryBuffer : public std::streambuf
+{
+public:
+	/// \brief Create an empty buffer
+	QueryBuffer();
+
+	/// \brief Destroy the buffer, releasing its memory
+	~QueryBuffer();
+
+	/// \brief Append raw bytes
+	void append(const char* s, size_t n);
+
+	/// \brief Append a C++ string
+	void append(const std::string& s) { append(s.data(), s.length()); }
+
+	/// \brief Append a single character
+	void append(char c)
+	{
+		if (pptr() == epptr()) {
+			grow(1);
+		}
+		*pptr() = c;
+		pbump(1);
+	}
+
+	/// \brief Append a signed integer in decimal form
+	void append(int i) { append_signed(i); }
+
+	/// \brief Append an unsigned integer in decimal form
+	void append(unsigned int i) { append_unsigned(i); }
+
+	/// \brief Append a signed integer in decimal form
+	void append(long i) { append_signed(i); }
+
+	/// \brief Append an unsigned integer in decimal form
+	void append(unsigned long i) { append_unsigned(i); }
+
+	/// \brief Append a signed integer in decimal form
+	void append(longlong i) { append_signed(i); }
+
+	/// \brief Append an unsigned integer in decimal form
+	void append(ulonglong i) { append_unsigned(i); }
+
+	/// \brief Append a floating-point value with enough digits to
+	/// round-trip an IEEE 754 single-precision value
+	///
+	/// Infinities and NaN are written as 0, as SQLTypeAdapter does.
+	/// The decimal point is always '.', whatever LC_NUMERIC says.
+	void append(float f);
+
+	/// \brief Append a floating-point value with enough digits to
+	/// round-trip an IEEE 754 double-precision value
+	///
+	/// Infinities and NaN are written as 0, as SQLTypeAdapter does.
+	/// The decimal point is always '.', whatever LC_NUMERIC says.
+	void append(double d);
+
+	/// \brief Append a date in YYYY-MM-DD form, unquoted
+	void append(const Date& d);
+
+	/// \brief Append a date and time in YYYY-MM-DD HH:MM:SS form,
+	/// unquoted, or \c NOW() if \c dt.is_now()
+	void append(const DateTime& dt);
+
+	/// \brief Append a time in HH:MM:SS form, unquoted
+	void append(const Time& t);
+
+	/// \brief Append a SQL-escaped copy of a character buffer
+	///
+	/// \param s the characters to escape
+	/// \param n the number of characters in \c s
+	/// \param driver the driver to escape with, taking the connection's
+	/// character set into account, or 0 to escape without a connection
+	///
+	/// \retval number of characters added to the buffer
+	///
+	/// The escaped text is written straight into the buffer; there are
+	/// no temporary copies.
+	size_t append_escaped(const char* s, size_t n, DBDriver* driver);
+
+	/// \brief Append a character buffer as a SQL hex literal,
+	/// \c X'...'
+	///
+	/// This is how binary data such as BLOB values is best sent to
+	/// the server: unlike append_escaped(), the cost depends only on
+	/// the length of the data, not its contents, and the result is
+	/// always exactly 2n + 3 characters.
+	///
+	/// \param s the bytes to encode
+	/// \param n the number of bytes in \c s
+	void append_hex(const char* s, size_t n);
+
+	/// \brief Return the buffer's capacity
+	size_t capacity() const { return size_t(epptr() - pbase()); }
+
+	/// \brief Empty the buffer
+	///
+	/// This keeps the buffer's memory for reuse.
+	void clear() { setp(pbase(), epptr()); }
+
+	/// \brief Return a pointer to the start of the buffer
+	///
+	/// The text is not null-terminated.  The pointer is invalidated by
+	/// anything that adds to the buffer.
+	const char* data() const { return pbase(); }
+
+	/// \brief Return true if the buffer is empty
+	bool empty() const { return pptr() == pbase(); }
+
+	/// \brief Ensure the buffer can hold at least \c n characters
+	/// without reallocating
+	void reserve(size_t n)
+	{
+		if (n > capacity()) {
+			grow(n - size());
+		}
+	}
+
+	/// \brief Return the number of characters in the buffer
+	size_t size() const { return size_t(pptr() - pbase()); }
+
+	/// \brief Return a copy of the buffer's contents
+	std::string str() const { return std::string(data(), size()); }
+
+	/// \brief Replace the buffer's contents with a copy of \c s
+	void str(const std::string& s)
+	{
+		clear();
+		append(s);
+	}
+
+protected:
+	/// \brief Make room for one more character after the buffer
+	/// fills up, then append it
+	int_type overflow(int_type c);
+
+	/// \brief Reposition the write pointer
+	///
+	/// Only output positions from the start of the buffer up to its
+	/// current end are supported.
+	pos_type seekoff(off_type off, std::ios_base::seekdir way,
+			std::ios_base::openmode which = std::ios_base::out);
+
+	/// \brief Reposition the write pointer
+	pos_type seekpos(pos_type pos,
+			std::ios_base::openmode which = std::ios_base::out);
+
+	/// \brief Append a block of characters in one go
+	std::streamsize xsputn(const char* s, std::streamsize n);
+
+private:
+	/// \brief Move the write pointer forward \c n characters
+	void advance(size_t n);
+
+	/// \brief Grow the buffer so it can hold at least \c n more
+	/// characters
+	void grow(size_t n);
+
+	/// \brief Move the write pointer to the given offset
+	void set_size(size_t n);
+
+	/// \brief Append signed integer in decimal form
+	void append_signed(longlong i);
+
+	/// \brief Append unsigned integer in decimal form
+	void append_unsigned(ulonglong i);
+
+	/// \brief Append an integer, zero-padded to the given width
+	void append_padded(unsigned int i, int width);
+
+	// Can't copy these
+	QueryBuffer(const QueryBuffer&);
+	QueryBuffer& operator=(const QueryBuffer&);
+};
+
+
+/// \brief Interface for output streams that build SQL text in a
+/// QueryBuffer and know how to escape it.
+///
+/// Query and SQLStream implement this, and register themselves in a
+/// \c pword() slot of their own stream state.  The manipulators in
+/// manip.h use lookup() to find out whether the stream they're given
+/// is one of these, which costs an array index rather than the
+/// \c dynamic_cast calls they needed before.
+
+class MYSQLPP_EXPORT EscapingStream
+{
+public:
+	/// \brief Append a SQL-escaped copy of a character buffer to the
+	/// stream, using the stream's connection if it has one
+	///
+	/// \retval number of characters added
+	virtual size_t append_escaped(const char* original,
+			size_t length) = 0;
+
+	/// \brief Return the buffer holding the stream's text
+	virtual QueryBuffer& buffer() = 0;
+
+	/// \brief Return the EscapingStream behind the given stream, or 0
+	/// if it isn't one
+	///
+	/// Copying a registered stream's state to another stream with
+	/// \c copyfmt() doesn't make the other stream an EscapingStream:
+	/// the callback register_stream() installs clears the copied slot.
+	static EscapingStream* lookup(std::ios_base& ios)
+	{
+		return static_cast<EscapingStream*>(ios.pword(slot()));
+	}
+
+	/// \brief Return the index of the \c pword() slot lookup() uses
+	static int slot();
+
+protected:
+	/// \brief Create an object not yet registered with any stream
+	EscapingStream() { }
+
+	/// \brief Destroy the object
+	virtual ~EscapingStream() { }
+
+	/// \brief Register this object with its stream, so lookup() finds
+	/// it
+	///
+	/// Call this from every constructor of the derived class,
+	/// including the copy ctor.
+	void register_stream(std::ios_base& ios)
+	{
+		ios.pword(slot()) = this;
+		ios.register_callback(stream_event, slot());
+	}
+
+private:
+	/// \brief Clear the slot of a stream whose state is being copied
+	/// from another by \c copyfmt(), or which is going away
+	///
+	/// \c copyfmt() copies \c pword() slots and callbacks both, so the
+	/// copy gets this callback along with a pointer to an object that
+	/// may not outlive it.
+	static void stream_event(std::ios_base::event ev,
+			std::ios_base& ios, int index)
+	{
+		if (ev != std::ios_base::imbue_event) {
+			ios.pword(index) = 0;
+		}
+	}
+};
+
+} // end namespace mysqlpp
+
+#endif // !defined(MYSQLPP_QBUFFER_H)
@@ -26,8 +26,12 @@
 
 #include "qparms.h"
 
+#include "beemutex.h"
 #include "query.h"
 
+#include <ctype.h>
+#include <stdlib.h>
+
 using namespace std;
 
 namespace mysqlpp {
@@ -50,7 +54,7 @@ SQLTypeAdapter&
 SQLQueryParms::operator [](const char* str)
 {
 	if (parent_) {
-		return operator [](parent_->parsed_nums_[str]);
+		return operator [](parent_->parsed_num(str));
 	}
 	throw ObjectNotInitialized("SQLQueryParms object has no parent!");
 }
@@ -59,7 +63,7 @@ const SQLTypeAdapter&
 SQLQueryParms::operator[] (const char* str) const
 {
 	if (parent_) {
-		return operator [](parent_->parsed_nums_[str]);
+		return operator [](parent_->parsed_num(str));
 	}
 	throw ObjectNotInitialized("SQLQueryParms object has no parent!");
 }
@@ -80,4 +84,135 @@ SQLQueryParms::operator +(const SQLQueryParms& other) const
 }
 
 
+// Cache of compiled template queries, keyed by template text.  Entries
+// are never removed, so pointers into it stay valid for the life of
+// the program; see SQLParsedTemplate::lookup().
+typedef std::map<std::string, SQLParsedTemplate*> TemplateCache;
+static TemplateCache template_cache_;
+static BeecryptMutex template_cache_mutex_;
+static const TemplateCache::size_type max_cached_templates_ = 1024;
+
+
+SQLParsedTemplate::SQLParsedTemplate(const std::string& text)
+{
+	std::string str = "";
+	char num[4];
+	std::string name;
+	const char* s = text.c_str();
+
+	while (*s) {
+		if (*s == '%') {
+			// Following might be a template parameter declaration...
+			s++;
+			if (*s == '%') {
+				// Doubled percent sign, so insert literal percent sign.
+				str += *s++;
+			}
+			else if (isdigit(*s)) {
+				// Number following percent sign, so it signifies a
+				// positional parameter.  First step: find position
+				// value, up to 3 digits long.
+				num[0] = *s;
+				s++;
+				if (isdigit(*s)) {
+					num[1] = *s;
+					num[2] = 0;
+					s++;
+					if (isdigit(*s)) {
+						num[2] = *s;
+						num[3] = 0;
+						s++;
+					}
+					else {
+						num[2] = 0;
+					}
+				}
+				else {
+					num[1] = 0;
+				}
+				signed char n = atoi(num);
+
+				// Look for option character following position value.
+				char option = ' ';
+				if (*s == 'q' || *s == 'Q') {
+					option = *s++;
+				}
+
+				// Is it a named parameter?
+				if (*s == ':') {
+					// Save all alphanumeric and underscore characters
+					// following colon as parameter name.
+					s++;
+					for (/* */; isalnum(*s) || *s == '_'; ++s) {
+						name += *s;
+					}
+
+					// Eat trailing colon, if it's present.
+					if (*s == ':') {
+						s++;
+					}
+
+					// Update maps that translate parameter name to
+					// number and vice versa.
+					if (n >= static_cast<short>(names_.size())) {
+						names_.insert(names_.end(),
+								static_cast<std::vector<std::string>::size_type>(
+										n + 1) - names_.size(),
+								std::string());
+					}
+					names_[n] = name;
+					nums_[name] = n;
+				}
+
+				// Finished parsing parameter; save it.
+				elements_.push_back(SQLParseElement(str, option, n));
+				str = "";
+				name = "";
+			}
+			else {
+				// Insert literal percent sign, because sign didn't
+				// precede a valid parameter string; this allows users
+				// to play a little fast and loose with the rules,
+				// avoiding a double percent sign here.
+				str += '%';
+			}
+		}
+		else {
+			// Regular character, so just copy it.
+			str += *s++;
+		}
+	}
+
+	elements_.push_back(SQLParseElement(str, ' ', -1));
+}
+
+
+const SQLParsedTemplate*
+SQLParsedTemplate::lookup(const std::string& text)
+{
+	ScopedLock lock(template_cache_mutex_);
+
+	TemplateCache::const_iterator it = template_cache_.find(text);
+	if (it != template_cache_.end()) {
+		return it->second;
+	}
+	else if (template_cache_.size() < max_cached_templates_) {
+		SQLParsedTemplate* pt = new SQLParsedTemplate(text);
+		template_cache_[text] = pt;
+		return pt;
+	}
+	else {
+		return 0;
+	}
+}
+
+
+short int
+SQLParsedTemplate::num(const std::string& name) const
+{
+	std::map<std::string, short int>::const_iterator it = nums_.find(name);
+	return it != nums_.end() ? it->second : -1;
+}
+
+
 } // end namespace mysqlpp
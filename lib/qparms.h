@@ -34,6 +34,7 @@
 
 #include "stadapter.h"
 
+#include <map>
 #include <vector>
 
 namespace mysqlpp {
@@ -260,6 +261,63 @@ struct SQLParseElement
 	signed char num;		///< the parameter position to use
 };
 
+
+/// \brief The compiled form of a template query
+///
+/// Query::parse() turns the template's text into a list of
+/// SQLParseElement objects plus a table mapping parameter names to
+/// positions.  Since that result depends only on the template text,
+/// it is computed once per distinct template and shared by every
+/// Query object parsing the same text, via lookup().  Objects are
+/// immutable once built, so sharing them between threads is safe.
+
+class MYSQLPP_EXPORT SQLParsedTemplate
+{
+public:
+	/// \brief Type of the list of parsed template elements
+	typedef std::vector<SQLParseElement> ElementList;
+
+	/// \brief Parse the given template query text
+	///
+	/// You normally don't create these objects yourself; use lookup()
+	/// to get a shared copy instead.
+	explicit SQLParsedTemplate(const std::string& text);
+
+	/// \brief Get the shared compiled form of a template query,
+	/// parsing it first if this is the first time we've seen it
+	///
+	/// Objects returned by this function live until the program exits.
+	/// To bound the memory this takes, the cache stops accepting new
+	/// templates once it holds a fixed number of them, in which case
+	/// this function returns 0 and the caller must parse the text into
+	/// its own SQLParsedTemplate object.
+	///
+	/// This function is thread-safe.
+	static const SQLParsedTemplate* lookup(const std::string& text);
+
+	/// \brief Get the list of parsed template elements
+	const ElementList& elements() const { return elements_; }
+
+	/// \brief Get the list mapping parameter positions to names
+	///
+	/// Positions without a name have an empty string here.  The list
+	/// only runs up to the highest position given a name.
+	const std::vector<std::string>& names() const { return names_; }
+
+	/// \brief Get the position of the named parameter, or -1 if the
+	/// template has no parameter by that name
+	short int num(const std::string& name) const;
+
+	/// \brief Get the table mapping parameter names to positions
+	const std::map<std::string, short int>& nums() const
+			{ return nums_; }
+
+private:
+	ElementList elements_;
+	std::vector<std::string> names_;
+	std::map<std::string, short int> nums_;
+};
+
 } // end namespace mysqlpp
 
 #endif // !defined(MYSQLPP_QPARMS_H)
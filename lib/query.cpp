@@ -29,6 +29,7 @@
 #include "autoflag.h"
 #include "dbdriver.h"
 #include "connection.h"
+#include "resultcache.h"
 
 namespace mysqlpp {
 
@@ -48,10 +49,12 @@ std::ostream(0),
 OptionalExceptions(te),
 template_defaults(this),
 conn_(c),
-copacetic_(true)
+copacetic_(true),
+parsed_(0)
 {
 	// Set up our internal IOStreams string buffer
 	init(&sbuffer_);
+	register_stream(*this);
 
 	// Insert passed query string into our string buffer, if given
 	if (qstr) {
@@ -66,16 +69,21 @@ copacetic_(true)
 }
 
 Query::Query(const Query& q) :
+// std::ios is a virtual base, so we name it here to keep -Wextra happy;
+// its default ctor leaves the setup to std::ostream's, as above
+std::ios(),
 #if defined(MYSQLPP_HAVE_STD__NOINIT)
 // ditto above
 std::ostream(std::_Noinit),
 #else
 std::ostream(0),
 #endif
-OptionalExceptions(q.throw_exceptions())
+OptionalExceptions(q.throw_exceptions()),
+parsed_(0)
 {
 	// Set up our internal IOStreams string buffer
 	init(&sbuffer_);
+	register_stream(*this);
 
 	// See above for reason we override locale for Query streams.
 	imbue(std::locale::classic());
@@ -92,6 +100,48 @@ Query::affected_rows()
 }
 
 
+size_t
+Query::append_escaped(const char* original, size_t length)
+{
+	return sbuffer_.append_escaped(original, length,
+			conn_ && *conn_ ? conn_->driver() : 0);
+}
+
+
+void
+Query::append_param(char option, const SQLTypeAdapter& param)
+{
+	if (param.is_null()) {
+		sbuffer_.append("NULL", 4);
+	}
+	else if (param.is_processed()) {
+		sbuffer_.append(param.data(), param.length());
+	}
+	else if ((option == 'q' || option == 'Q') && param.is_binary() &&
+			param.quote_q()) {
+		sbuffer_.append_hex(param.data(), param.length());
+	}
+	else if (option == 'q') {
+		if (param.quote_q()) sbuffer_.append('\'');
+		if (param.escape_q()) {
+			append_escaped(param.data(), param.length());
+		}
+		else {
+			sbuffer_.append(param.data(), param.length());
+		}
+		if (param.quote_q()) sbuffer_.append('\'');
+	}
+	else if (option == 'Q' && param.quote_q()) {
+		sbuffer_.append('\'');
+		sbuffer_.append(param.data(), param.length());
+		sbuffer_.append('\'');
+	}
+	else {
+		sbuffer_.append(param.data(), param.length());
+	}
+}
+
+
 int
 Query::errnum() const
 {
@@ -138,12 +188,31 @@ Query::escape_string(char* escaped, const char* original,
 }
 
 
+bool
+Query::exec()
+{
+	if (parsed_) {
+		proc(template_defaults);
+	}
+	return exec(sbuffer_.data(), sbuffer_.size());
+}
+
+
 bool
 Query::exec(const std::string& str)
 {
-	if ((copacetic_ = conn_->driver()->execute(str.data(),
-			static_cast<unsigned long>(str.length()))) == true) {
-		if (parse_elems_.size() == 0) {
+	return exec(str.data(), str.length());
+}
+
+
+bool
+Query::exec(const char* str, size_t len)
+{
+	copacetic_ = conn_->driver()->execute(str,
+			static_cast<unsigned long>(len));
+	invalidate_cache(str, len);
+	if (copacetic_) {
+		if (parse_elem_count() == 0) {
 			// Not a template query, so auto-reset
 			reset();
 		}
@@ -161,8 +230,7 @@ Query::exec(const std::string& str)
 SimpleResult 
 Query::execute() 
 { 
-	AutoFlag<> af(template_defaults.processing_);
-	return execute(str(template_defaults)); 
+	return execute(template_defaults);
 }
 
 
@@ -170,14 +238,17 @@ SimpleResult
 Query::execute(SQLQueryParms& p)
 {
 	AutoFlag<> af(template_defaults.processing_);
-	return execute(str(p));
+	if (parsed_) {
+		proc(p);
+	}
+	return execute(sbuffer_.data(), sbuffer_.size());
 }
 
 
 SimpleResult
 Query::execute(const SQLTypeAdapter& s)
 {
-	if ((parse_elems_.size() == 2) && !template_defaults.processing_) {
+	if ((parse_elem_count() == 2) && !template_defaults.processing_) {
 		// We're a template query and this isn't a recursive call, so
 		// take s to be a lone parameter for the query.  We will come
 		// back in here with a completed query, but the processing_
@@ -195,7 +266,7 @@ Query::execute(const SQLTypeAdapter& s)
 SimpleResult
 Query::execute(const char* str, size_t len)
 {
-	if ((parse_elems_.size() == 2) && !template_defaults.processing_) {
+	if ((parse_elem_count() == 2) && !template_defaults.processing_) {
 		// We're a template query and this isn't a recursive call, so
 		// take s to be a lone parameter for the query.  We will come
 		// back in here with a completed query, but the processing_
@@ -203,8 +274,10 @@ Query::execute(const char* str, size_t len)
 		AutoFlag<> af(template_defaults.processing_);
 		return execute(SQLQueryParms() << str << len );
 	}
-	if ((copacetic_ = conn_->driver()->execute(str, len)) == true) {
-		if (parse_elems_.size() == 0) {
+	copacetic_ = conn_->driver()->execute(str, len);
+	invalidate_cache(str, len);
+	if (copacetic_) {
+		if (parse_elem_count() == 0) {
 			// Not a template query, so auto-reset
 			reset();
 		}
@@ -226,6 +299,15 @@ Query::info()
 }
 
 
+void
+Query::invalidate_cache(const char* str, size_t len)
+{
+	if (ResultCache* cache = conn_->result_cache()) {
+		cache->invalidate(str, len);
+	}
+}
+
+
 ulonglong
 Query::insert_id()
 {
@@ -248,11 +330,10 @@ Query::operator=(const Query& rhs)
 	conn_ = rhs.conn_;
 	copacetic_ = rhs.copacetic_;
 
-	*this << rhs.sbuffer_.str();
+	sbuffer_.append(rhs.sbuffer_.data(), rhs.sbuffer_.size());
 
-	parse_elems_  = rhs.parse_elems_;
-	parsed_names_ = rhs.parsed_names_;
-	parsed_nums_  = rhs.parsed_nums_;
+	parsed_ = rhs.parsed_;
+	own_parsed_ = rhs.own_parsed_;
 
 	return *this;
 }
@@ -266,160 +347,24 @@ Query::operator void*() const
 void
 Query::parse()
 {
-	std::string str = "";
-	char num[4];
-	std::string name;
-
-	char* s = new char[sbuffer_.str().size() + 1];
-	memcpy(s, sbuffer_.str().data(), sbuffer_.str().size());
-	s[sbuffer_.str().size()] = '\0';
-	const char* s0 = s;
-
-	while (*s) {
-		if (*s == '%') {
-			// Following might be a template parameter declaration...
-			s++;
-			if (*s == '%') {
-				// Doubled percent sign, so insert literal percent sign.
-				str += *s++;
-			}
-			else if (isdigit(*s)) {
-				// Number following percent sign, so it signifies a
-				// positional parameter.  First step: find position
-				// value, up to 3 digits long.
-				num[0] = *s;
-				s++;
-				if (isdigit(*s)) {
-					num[1] = *s;
-					num[2] = 0;
-					s++;
-					if (isdigit(*s)) {
-						num[2] = *s;
-						num[3] = 0;
-						s++;
-					}
-					else {
-						num[2] = 0;
-					}
-				}
-				else {
-					num[1] = 0;
-				}
-				signed char n = atoi(num);
-
-				// Look for option character following position value.
-				char option = ' ';
-				if (*s == 'q' || *s == 'Q') {
-					option = *s++;
-				}
-
-				// Is it a named parameter?
-				if (*s == ':') {
-					// Save all alphanumeric and underscore characters
-					// following colon as parameter name.
-					s++;
-					for (/* */; isalnum(*s) || *s == '_'; ++s) {
-						name += *s;
-					}
-
-					// Eat trailing colon, if it's present.
-					if (*s == ':') {
-						s++;
-					}
-
-					// Update maps that translate parameter name to
-					// number and vice versa.
-					if (n >= static_cast<short>(parsed_names_.size())) {
-						parsed_names_.insert(parsed_names_.end(),
-								static_cast<std::vector<std::string>::size_type>(
-										n + 1) - parsed_names_.size(),
-								std::string());
-					}
-					parsed_names_[n] = name;
-					parsed_nums_[name] = n;
-				}
-
-				// Finished parsing parameter; save it.
-				parse_elems_.push_back(SQLParseElement(str, option, n));
-				str = "";
-				name = "";
-			}
-			else {
-				// Insert literal percent sign, because sign didn't
-				// precede a valid parameter string; this allows users
-				// to play a little fast and loose with the rules,
-				// avoiding a double percent sign here.
-				str += '%';
-			}
-		}
-		else {
-			// Regular character, so just copy it.
-			str += *s++;
-		}
+	const std::string text = sbuffer_.str();
+	parsed_ = SQLParsedTemplate::lookup(text);
+	if (parsed_) {
+		own_parsed_ = 0;
+	}
+	else {
+		// Template cache is full, so keep a private compiled copy
+		own_parsed_ = new SQLParsedTemplate(text);
+		parsed_ = own_parsed_.raw();
 	}
-
-	parse_elems_.push_back(SQLParseElement(str, ' ', -1));
-	delete[] s0;
 }
 
 
-SQLTypeAdapter*
-Query::pprepare(char option, SQLTypeAdapter& S, bool replace)
+short int
+Query::parsed_num(const char* name) const
 {
-	if (S.is_processed()) {
-		return &S;
-	}
-
-	if (option == 'q') {
-		std::string temp(S.quote_q() ? "'" : "", S.quote_q() ? 1 : 0);
-
-		if (S.escape_q()) {
-			char *escaped = new char[S.size() * 2 + 1];
-			size_t len = conn_->driver()->escape_string(escaped,
-					S.data(), static_cast<unsigned long>(S.size()));
-			temp.append(escaped, len);
-			delete[] escaped;
-		}
-		else {
-			temp.append(S.data(), S.length());
-		}
-
-		if (S.quote_q()) temp.append("'", 1);
-
-		SQLTypeAdapter* ss = new SQLTypeAdapter(temp);
-
-		if (replace) {
-			S = *ss;
-			S.set_processed();
-			delete ss;
-			return &S;
-		}
-		else {
-			return ss;
-		}
-	}
-	else if (option == 'Q' && S.quote_q()) {
-		std::string temp("'", 1);
-		temp.append(S.data(), S.length());
-		temp.append("'", 1);
-		SQLTypeAdapter *ss = new SQLTypeAdapter(temp);
-
-		if (replace) {
-			S = *ss;
-			S.set_processed();
-			delete ss;
-			return &S;
-		}
-		else {
-			return ss;
-		}
-	}
-	else {
-		if (replace) {
-			S.set_processed();
-		}
-		return &S;
-	}
+	short int n = parsed_ ? parsed_->num(name) : -1;
+	return n >= 0 ? n : 0;
 }
 
 
@@ -428,9 +373,10 @@ Query::proc(SQLQueryParms& p)
 {
 	sbuffer_.str("");
 
-	for (std::vector<SQLParseElement>::iterator i = parse_elems_.begin();
-			i != parse_elems_.end(); ++i) {
-		MYSQLPP_QUERY_THISPTR << i->before;
+	const SQLParsedTemplate::ElementList& elems = parsed_->elements();
+	for (SQLParsedTemplate::ElementList::const_iterator i = elems.begin();
+			i != elems.end(); ++i) {
+		sbuffer_.append(i->before);
 		int num = i->num;
 		if (num >= 0) {
 			SQLQueryParms* c;
@@ -446,19 +392,7 @@ Query::proc(SQLQueryParms& p)
 						"Not enough parameters to fill the template.");
 			}
 
-			SQLTypeAdapter& param = (*c)[num];
-			if (param.is_null()) {
-				MYSQLPP_QUERY_THISPTR << "NULL";
-			}
-			else {
-				SQLTypeAdapter* ss = pprepare(i->option, param, c->bound());
-				MYSQLPP_QUERY_THISPTR << *ss;
-				if (ss != &param) {
-					// pprepare() returned a new string object instead of
-					// updating param in place, so we need to delete it.
-					delete ss;
-				}
-			}
+			append_param(i->option, (*c)[num]);
 		}
 	}
 }
@@ -471,7 +405,8 @@ Query::reset()
 	clear();
 	sbuffer_.str("");
 
-	parse_elems_.clear();
+	parsed_ = 0;
+	own_parsed_ = 0;
 	template_defaults.clear();
 }
 
@@ -486,8 +421,7 @@ Query::result_empty()
 StoreQueryResult 
 Query::store() 
 { 
-	AutoFlag<> af(template_defaults.processing_);
-	return store(str(template_defaults)); 
+	return store(template_defaults);
 }
 
 
@@ -495,14 +429,17 @@ StoreQueryResult
 Query::store(SQLQueryParms& p)
 {
 	AutoFlag<> af(template_defaults.processing_);
-	return store(str(p));
+	if (parsed_) {
+		proc(p);
+	}
+	return store(sbuffer_.data(), sbuffer_.size());
 }
 
 
 StoreQueryResult
 Query::store(const SQLTypeAdapter& s)
 {
-	if ((parse_elems_.size() == 2) && !template_defaults.processing_) {
+	if ((parse_elem_count() == 2) && !template_defaults.processing_) {
 		// We're a template query and this isn't a recursive call, so
 		// take s to be a lone parameter for the query.  We will come
 		// back in here with a completed query, but the processing_
@@ -520,7 +457,7 @@ Query::store(const SQLTypeAdapter& s)
 StoreQueryResult
 Query::store(const char* str, size_t len)
 {
-	if ((parse_elems_.size() == 2) && !template_defaults.processing_) {
+	if ((parse_elem_count() == 2) && !template_defaults.processing_) {
 		// We're a template query and this isn't a recursive call, so
 		// take s to be a lone parameter for the query.  We will come
 		// back in here with a completed query, but the processing_
@@ -528,17 +465,47 @@ Query::store(const char* str, size_t len)
 		AutoFlag<> af(template_defaults.processing_);
 		return store(SQLQueryParms() << str << len );
 	}
+
+	// Answer repeated SELECTs from the result cache, if we have one,
+	// unless we're in a transaction, which may see different rows
+	ResultCache* cache = conn_->result_cache();
+	const bool cacheable = cache && ResultCache::cacheable(str, len) &&
+			!conn_->driver()->in_transaction();
+	ResultCache::Snapshot before;
+	if (cacheable) {
+		const std::string key(str, len);
+		if (ResultCache::Result hit = cache->find(key)) {
+			copacetic_ = true;
+			if (parse_elem_count() == 0) {
+				// Not a template query, so auto-reset
+				reset();
+			}
+			return *hit;
+		}
+		before = cache->snapshot(key);
+	}
+
 	MYSQL_RES* res = 0;
 	if ((copacetic_ = conn_->driver()->execute(str, len)) == true) {
 		res = conn_->driver()->store_result();
 	}
+	if (!cacheable) {
+		invalidate_cache(str, len);
+	}
 
 	if (res) {
-		if (parse_elems_.size() == 0) {
+		if (parse_elem_count() == 0) {
 			// Not a template query, so auto-reset
 			reset();
 		}
-		return StoreQueryResult(res, conn_->driver(), throw_exceptions());
+		StoreQueryResult result(res, conn_->driver(), throw_exceptions(),
+				conn_->zero_copy(), conn_->arena_recycler());
+		// Don't keep it if the SELECT began a transaction, as it does
+		// with autocommit off
+		if (cacheable && !conn_->driver()->in_transaction()) {
+			cache->insert(before, result);
+		}
+		return result;
 	}
 	else {
 		// Either result set is empty, or there was a problem executing
@@ -549,7 +516,7 @@ Query::store(const char* str, size_t len)
 		// such queries when the query strings come from "outside".)
 		copacetic_ = (conn_->errnum() == 0);
 		if (copacetic_) {
-			if (parse_elems_.size() == 0) {
+			if (parse_elem_count() == 0) {
 				// Not a template query, so auto-reset
 				reset();
 			}
@@ -565,6 +532,77 @@ Query::store(const char* str, size_t len)
 }
 
 
+ColumnarResult
+Query::store_columnar()
+{
+	return store_columnar(template_defaults);
+}
+
+
+ColumnarResult
+Query::store_columnar(SQLQueryParms& p)
+{
+	AutoFlag<> af(template_defaults.processing_);
+	if (parsed_) {
+		proc(p);
+	}
+	return store_columnar(sbuffer_.data(), sbuffer_.size());
+}
+
+
+ColumnarResult
+Query::store_columnar(const SQLTypeAdapter& s)
+{
+	if ((parse_elem_count() == 2) && !template_defaults.processing_) {
+		// Take s to be the lone parameter of a template query
+		AutoFlag<> af(template_defaults.processing_);
+		return store_columnar(SQLQueryParms() << s);
+	}
+	else {
+		// Take s to be the entire query string
+		return store_columnar(s.data(), s.length());
+	}
+}
+
+
+ColumnarResult
+Query::store_columnar(const char* str, size_t len)
+{
+	if ((parse_elem_count() == 2) && !template_defaults.processing_) {
+		AutoFlag<> af(template_defaults.processing_);
+		return store_columnar(SQLQueryParms() << str << len);
+	}
+
+	MYSQL_RES* res = 0;
+	if ((copacetic_ = conn_->driver()->execute(str, len)) == true) {
+		res = conn_->driver()->store_result();
+	}
+	invalidate_cache(str, len);
+
+	if (res) {
+		if (parse_elem_count() == 0) {
+			// Not a template query, so auto-reset
+			reset();
+		}
+		return ColumnarResult(res, conn_->driver(), throw_exceptions());
+	}
+	else {
+		// As in store(), no result set is only an error if the server
+		// says so
+		copacetic_ = (conn_->errnum() == 0);
+		if (copacetic_) {
+			if (parse_elem_count() == 0) {
+				reset();
+			}
+		}
+		else if (throw_exceptions()) {
+			throw BadQuery(error(), errnum());
+		}
+		return ColumnarResult();
+	}
+}
+
+
 StoreQueryResult
 Query::store_next()
 {
@@ -575,7 +613,8 @@ Query::store_next()
 		MYSQL_RES* res = conn_->driver()->store_result();
 		if (res) {
 			return StoreQueryResult(res, conn_->driver(),
-					throw_exceptions());
+					throw_exceptions(), conn_->zero_copy(),
+					conn_->arena_recycler());
 		}
 		else {
 			// Result set is null, but throw an exception only i it is
@@ -613,7 +652,7 @@ Query::store_next()
 std::string
 Query::str(SQLQueryParms& p)
 {
-	if (!parse_elems_.empty()) {
+	if (parsed_) {
 		proc(p);
 	}
 
@@ -621,11 +660,37 @@ Query::str(SQLQueryParms& p)
 }
 
 
+std::string
+Query::upsert_clause(const std::string& fields, const std::string& all)
+{
+	std::vector<std::string> names;
+	internal::split_field_list(fields, names);
+	if (names.empty()) {
+		// Nothing to update, but the clause can't be empty.  Setting a
+		// column to itself leaves a colliding row unchanged.
+		internal::split_field_list(all, names);
+		return names.empty() ? std::string() :
+				" ON DUPLICATE KEY UPDATE " + names[0] + '=' + names[0];
+	}
+
+	// Pair each column name up with the VALUES() function that refers
+	// to the new row's value for that column.
+	std::string clause(" ON DUPLICATE KEY UPDATE ");
+	for (size_t i = 0; i < names.size(); ++i) {
+		if (i) {
+			clause += ',';
+		}
+		clause += names[i] + "=VALUES(" + names[i] + ')';
+	}
+
+	return clause;
+}
+
+
 UseQueryResult 
 Query::use() 
 { 
-	AutoFlag<> af(template_defaults.processing_);
-	return use(str(template_defaults)); 
+	return use(template_defaults);
 }
 
 
@@ -633,14 +698,17 @@ UseQueryResult
 Query::use(SQLQueryParms& p)
 {
 	AutoFlag<> af(template_defaults.processing_);
-	return use(str(p));
+	if (parsed_) {
+		proc(p);
+	}
+	return use(sbuffer_.data(), sbuffer_.size());
 }
 
 
 UseQueryResult
 Query::use(const SQLTypeAdapter& s)
 {
-	if ((parse_elems_.size() == 2) && !template_defaults.processing_) {
+	if ((parse_elem_count() == 2) && !template_defaults.processing_) {
 		// We're a template query and this isn't a recursive call, so
 		// take s to be a lone parameter for the query.  We will come
 		// back in here with a completed query, but the processing_
@@ -658,7 +726,7 @@ Query::use(const SQLTypeAdapter& s)
 UseQueryResult
 Query::use(const char* str, size_t len)
 {
-	if ((parse_elems_.size() == 2) && !template_defaults.processing_) {
+	if ((parse_elem_count() == 2) && !template_defaults.processing_) {
 		// We're a template query and this isn't a recursive call, so
 		// take s to be a lone parameter for the query.  We will come
 		// back in here with a completed query, but the processing_
@@ -670,9 +738,10 @@ Query::use(const char* str, size_t len)
 	if ((copacetic_ = conn_->driver()->execute(str, len)) == true) {
 		res = conn_->driver()->use_result();
 	}
+	invalidate_cache(str, len);
 
 	if (res) {
-		if (parse_elems_.size() == 0) {
+		if (parse_elem_count() == 0) {
 			// Not a template query, so auto-reset
 			reset();
 		}
@@ -683,7 +752,7 @@ Query::use(const char* str, size_t len)
 		// empty result sets and actual error returns here.
 		copacetic_ = (conn_->errnum() == 0);
 		if (copacetic_) {
-			if (parse_elems_.size() == 0) {
+			if (parse_elem_count() == 0) {
 				// Not a template query, so auto-reset
 				reset();
 			}
@@ -30,8 +30,10 @@
 
 #include "common.h"
 
+#include "columnar.h"
 #include "exceptions.h"
 #include "noexceptions.h"
+#include "qbuffer.h"
 #include "qparms.h"
 #include "querydef.h"
 #include "result.h"
@@ -39,12 +41,15 @@
 #include "sqlstream.h"
 #include "stadapter.h"
 #include "transaction.h"
+#include "updatebatch.h"
+#include "utility.h"
 
 #include <deque>
 #include <iomanip>
 #include <list>
 #include <map>
 #include <set>
+#include <sstream>
 #include <vector>
 
 #ifdef HAVE_EXT_SLIST
@@ -120,7 +125,8 @@ class MYSQLPP_EXPORT Transaction;
 
 class MYSQLPP_EXPORT Query :
 		public std::ostream,
-		public OptionalExceptions
+		public OptionalExceptions,
+		public EscapingStream
 {
 public:
 	// Bring in InsertPolicy template as part of this class's interface,
@@ -150,6 +156,20 @@ public:
 	/// \brief Return the number of rows affected by the last query
 	ulonglong affected_rows();
 
+	/// \brief Append a SQL-escaped copy of a character buffer to the
+	/// query
+	///
+	/// The escaped text goes straight into the query buffer, so this
+	/// does no heap allocation beyond what growing that buffer takes.
+	/// As with escape_string(), this uses the connection's character
+	/// set if it is available.
+	///
+	/// \param original pointer to the character buffer to escape
+	/// \param length number of characters to escape
+	///
+	/// \retval number of characters added to the query
+	size_t append_escaped(const char* original, size_t length);
+
 	/// \brief Return a SQL-escaped version of a character buffer
 	///
 	/// \param ps pointer to C++ string to hold escaped version; if
@@ -261,6 +281,10 @@ public:
 	/// other members that accept template query parameters.  See the
 	/// "Template Queries" chapter in the user manual for more
 	/// information.
+	///
+	/// The compiled form of the template is cached process-wide, keyed
+	/// by the template text, so parsing the same template again in
+	/// another Query object is cheap.
 	void parse();
 
 	/// \brief Reset the query object so that it can be reused.
@@ -304,6 +328,14 @@ public:
 	/// this object holds, if any
 	std::string str(SQLQueryParms& p);
 
+	/// \brief Return the buffer holding the query built so far
+	///
+	/// You can append to this directly, bypassing the IOStreams layer,
+	/// which is faster when building large queries a piece at a time.
+	/// Its contents are also what the parameterless exec(), execute(),
+	/// store() and use() overloads send to the server, without copying.
+	QueryBuffer& buffer() { return sbuffer_; }
+
 	/// \brief Execute a built-up query
 	///
 	/// Same as exec(), except that it uses the query string built up
@@ -314,7 +346,7 @@ public:
 	///
 	/// \sa exec(const std::string& str), execute(), store(),
 	/// storein(), and use()
-	bool exec() { return exec(str(template_defaults)); }
+	bool exec();
 
 	/// \brief Execute a query
 	///
@@ -329,6 +361,16 @@ public:
 	/// \sa execute(), store(), storein(), and use()
 	bool exec(const std::string& str);
 
+	/// \brief Execute a query
+	///
+	/// Same as exec(const std::string&), except that it takes a
+	/// character buffer and its length, so the query can contain
+	/// null characters and needn't be copied into a C++ string first.
+	///
+	/// \param str the query to execute
+	/// \param len length of query string in \c str
+	bool exec(const char* str, size_t len);
+
 	/// \brief Execute built-up query
 	///
 	/// Use one of the execute() overloads if you don't expect the
@@ -512,6 +554,39 @@ public:
 	/// from plain C strings and other useful data types implicitly.
 	StoreQueryResult store(const char* str, size_t len);
 
+	/// \brief Execute a query that can return rows, returning all of
+	/// the rows one column at a time
+	///
+	/// This works like store(), but converts each value once, as it
+	/// arrives, into a typed array for its column.  Use it for scans
+	/// over a few columns of a large result, such as sums and filters.
+	/// Results of this kind are never taken from or put in the
+	/// connection's ResultCache, but other statements run this way
+	/// still invalidate it.
+	///
+	/// \sa ColumnarResult, store()
+	ColumnarResult store_columnar();
+
+	/// \brief Execute a template query using the given parameters,
+	/// returning all of the rows one column at a time
+	///
+	/// \sa store(SQLQueryParms&)
+	ColumnarResult store_columnar(SQLQueryParms& p);
+
+	/// \brief Execute a query, returning all of the rows one column at
+	/// a time
+	///
+	/// \param str the SQL query string to execute, or if this object
+	/// is set up as a template query, the value to substitute for its
+	/// first parameter
+	///
+	/// \sa store(const SQLTypeAdapter&)
+	ColumnarResult store_columnar(const SQLTypeAdapter& str);
+
+	/// \brief Execute a query held in a C string of known length,
+	/// returning all of the rows one column at a time
+	ColumnarResult store_columnar(const char* str, size_t len);
+
 	/// \brief Execute a query, and call a functor for each returned row
 	///
 	/// This method wraps a use() query, calling the given functor for
@@ -994,6 +1069,53 @@ public:
 		return *this;
 	}
 
+	/// \brief Write an existing row's changed columns back to the
+	/// database.
+	///
+	/// This function builds an UPDATE SQL query whose SET clause has
+	/// only the fields changed through the SSQLS's \c set_ \e field
+	/// setters, or marked with set_dirty(), since it was loaded.  The
+	/// WHERE clause has only the SSQLS's comparison fields, the ones
+	/// counted by the second parameter of \c sql_create_N, which
+	/// should be the table's primary key.  For a wide row where a
+	/// column or two changed, this is much less for the server to
+	/// parse and write than update(const T&, const T&) makes.
+	///
+	/// Because the WHERE clause uses the object's current values, this
+	/// won't work if you changed a key field.  Use the two-row form
+	/// for that.
+	///
+	/// If nothing has changed, this leaves the query empty, so check
+	/// v.dirty() first.  After the query succeeds, call
+	/// v.clear_dirty().
+	///
+	/// The SSQLS must have comparison fields: with none, there's
+	/// nothing to find the row by, so this throws BadQuery, or leaves
+	/// the query empty if exceptions are disabled.
+	///
+	/// \param v changed row
+	///
+	/// \sa update(const T&, const T&)
+	template <class T>
+	Query& update(const T& v)
+	{
+		reset();
+
+		if (T::key_fields == 0) {
+			copacetic_ = false;
+			if (throw_exceptions()) {
+				throw BadQuery("Can't update an SSQLS with no key fields");
+			}
+		}
+		else if (v.dirty()) {
+			MYSQLPP_QUERY_THISPTR << std::setprecision(16) <<
+					"UPDATE `" << v.table() << "` SET " <<
+					v.dirty_list() << " WHERE " <<
+					v.equal_list(" AND ", sql_use_compare);
+		}
+		return *this;
+	}
+
 	/// \brief Insert a new row.
 	///
 	/// This function builds an INSERT SQL query.  One uses it with
@@ -1067,77 +1189,7 @@ public:
 	template <class Iter, class InsertPolicy>
 	Query& insertfrom(Iter first, Iter last, InsertPolicy& policy)
 	{
-		bool success = true;
-		bool empty = true;
-
-		reset();
-
-		if (first == last) {
-			return *this;   // empty set!
-		}
-
-		typename InsertPolicy::access_controller ac(*conn_);
-		
-		for (Iter it = first; it != last; ++it) {
-			if (policy.can_add(int(tellp()), *it)) {
-				if (empty) {
-					MYSQLPP_QUERY_THISPTR << std::setprecision(16) <<
-						"INSERT INTO `" << it->table() << "` (" <<
-						it->field_list() << ") VALUES (";
-				} 
-				else {
-					MYSQLPP_QUERY_THISPTR << ",(";
-				}
-
-				MYSQLPP_QUERY_THISPTR << it->value_list() << ')';
-
-				empty = false;
-			} 
-			else {
-				// Execute what we've built up already, if there is anything
-				if (!empty) {
-					if (!exec()) {
-						success = false;
-						break;
-					}
-
-					empty = true;
-				}
-
-				// If we _still_ can't add, the policy is too strict
-				if (policy.can_add(int(tellp()), *it)) {
-					MYSQLPP_QUERY_THISPTR << std::setprecision(16) <<
-						"INSERT INTO `" << it->table() << "` (" <<
-						it->field_list() << ") VALUES (" <<
-						it->value_list() << ')';
-
-					empty = false;
-				} 
-				else {
-					// At this point all we can do is give up
-					if (throw_exceptions()) {
-						throw BadInsertPolicy("Insert policy is too strict");
-					}
-
-					success = false;
-					break;
-				}
-			}
-		}
-
-		// We might need to execute the last query here.
-		if (success && !empty && !exec()) {
-			success = false;
-		}
-
-		if (success) {
-			ac.commit();
-		} 
-		else {
-			ac.rollback();
-		}
-
-		return *this;
+		return insertfrom_impl("INSERT", first, last, policy);
 	}
 
 	/// \brief Replace multiple new rows using an insert policy to
@@ -1155,77 +1207,7 @@ public:
 	template <class Iter, class InsertPolicy>
 	Query& replacefrom(Iter first, Iter last, InsertPolicy& policy)
 	{
-		bool success = true;
-		bool empty = true;
-
-		reset();
-
-		if (first == last) {
-			return *this;   // empty set!
-		}
-
-		typename InsertPolicy::access_controller ac(*conn_);
-
-		for (Iter it = first; it != last; ++it) {
-			if (policy.can_add(int(tellp()), *it)) {
-				if (empty) {
-					MYSQLPP_QUERY_THISPTR << std::setprecision(16) <<
-						"REPLACE INTO `" << it->table() << "` (" <<
-						it->field_list() << ") VALUES (";
-				}
-				else {
-					MYSQLPP_QUERY_THISPTR << ",(";
-				}
-
-				MYSQLPP_QUERY_THISPTR << it->value_list() << ')';
-
-				empty = false;
-			}
-			else {
-				// Execute what we've built up already, if there is anything
-				if (!empty) {
-					if (!exec()) {
-						success = false;
-						break;
-					}
-
-					empty = true;
-				}
-
-				// If we _still_ can't add, the policy is too strict
-				if (policy.can_add(int(tellp()), *it)) {
-					MYSQLPP_QUERY_THISPTR << std::setprecision(16) <<
-						"REPLACE INTO `" << it->table() << "` (" <<
-						it->field_list() << ") VALUES (" <<
-						it->value_list() << ')';
-
-					empty = false;
-				}
-				else {
-					// At this point all we can do is give up
-					if (throw_exceptions()) {
-						throw BadInsertPolicy("Insert policy is too strict");
-					}
-
-					success = false;
-					break;
-				}
-			}
-		}
-
-		// We might need to execute the last query here.
-		if (success && !empty && !exec()) {
-			success = false;
-		}
-
-		if (success) {
-			ac.commit();
-		}
-		else {
-			ac.rollback();
-		}
-
-		return *this;
+		return insertfrom_impl("REPLACE", first, last, policy);
 	}
 
 	/// \brief Insert new row unless there is an existing row that
@@ -1286,6 +1268,235 @@ public:
 		return *this;
 	}	
 
+	/// \brief Insert new row, or update the existing one if it
+	/// collides with the new one on a unique index.
+	///
+	/// This function builds an <tt>INSERT ... ON DUPLICATE KEY
+	/// UPDATE</tt> SQL query, setting every column of the existing row
+	/// to the new row's value.  Unlike replace(), this doesn't delete
+	/// the old row first, so it's much cheaper on tables with secondary
+	/// indexes or delete triggers, and columns not in the SSQLS keep
+	/// their values.
+	///
+	/// \param v new row
+	///
+	/// \sa insert(), replace(), upsertfrom()
+	template <class T>
+	Query& upsert(const T& v)
+	{
+		return upsert(v, v.field_list());
+	}
+
+	/// \brief Insert new row, or update some columns of the existing
+	/// one if it collides with the new one on a unique index.
+	///
+	/// Same as upsert(const T&), except that only the columns in
+	/// \c update are changed on the existing row.  Pass one of the
+	/// SSQLS's field lists, such as
+	/// <tt>v.field_list(stock_num, stock_weight)</tt>.
+	///
+	/// If \c update is empty, an existing row is left as it is.
+	///
+	/// \param v new row
+	/// \param update the columns to change on an existing row
+	template <class T, class FieldList>
+	Query& upsert(const T& v, const FieldList& update)
+	{
+		reset();
+
+		MYSQLPP_QUERY_THISPTR << std::setprecision(16) <<
+				"INSERT INTO `" << v.table() << "` (" <<
+				v.field_list() << ") VALUES (" << v.value_list() <<
+				')' << upsert_clause(field_text(update),
+				field_text(v.field_list()));
+		return *this;
+	}
+
+	/// \brief Insert multiple new rows, or update existing ones they
+	/// collide with on a unique index.
+	///
+	/// Builds one <tt>INSERT ... ON DUPLICATE KEY UPDATE</tt> SQL query
+	/// for all the items in the range, the way insert(Iter, Iter) does
+	/// for a plain INSERT.  Every column of each existing row is set to
+	/// the new row's value.
+	///
+	/// \param first iterator pointing to first element in range to
+	///    insert or update
+	/// \param last iterator pointing to one past the last element to
+	///    insert or update
+	///
+	/// \sa upsertfrom()
+	template <class Iter>
+	Query& upsert(Iter first, Iter last)
+	{
+		if (first == last) {
+			reset();
+			return *this;
+		}
+		return upsert(first, last, first->field_list());
+	}
+
+	/// \brief Insert multiple new rows, or update some columns of the
+	/// existing rows they collide with on a unique index.
+	///
+	/// Same as upsert(Iter, Iter), except that only the columns in
+	/// \c update are changed on existing rows.
+	///
+	/// \param first iterator pointing to first element in range
+	/// \param last iterator pointing to one past the last element
+	/// \param update the columns to change on existing rows, as one of
+	/// the SSQLS's field lists
+	template <class Iter, class FieldList>
+	Query& upsert(Iter first, Iter last, const FieldList& update)
+	{
+		insert(first, last);
+		if (first != last) {
+			MYSQLPP_QUERY_THISPTR << upsert_clause(field_text(update),
+					field_text(first->field_list()));
+		}
+		return *this;
+	}
+
+	/// \brief Insert multiple new rows, or update existing ones they
+	/// collide with on a unique index, using an insert policy to
+	/// control how the statements are created.
+	///
+	/// This works like insertfrom(), but each statement ends with an
+	/// <tt>ON DUPLICATE KEY UPDATE</tt> clause setting every column of
+	/// each existing row to the new row's value.
+	///
+	/// \param first iterator pointing to first element in range to
+	///    insert or update
+	/// \param last iterator pointing to one past the last element to
+	///    insert or update
+	/// \param policy insert policy object, see insertpolicy.h for
+	/// details
+	///
+	/// \sa upsert(), insertfrom(), replacefrom()
+	template <class Iter, class InsertPolicy>
+	Query& upsertfrom(Iter first, Iter last, InsertPolicy& policy)
+	{
+		if (first == last) {
+			reset();
+			return *this;
+		}
+		return upsertfrom(first, last, policy, first->field_list());
+	}
+
+	/// \brief Insert multiple new rows, or update some columns of the
+	/// existing rows they collide with on a unique index.
+	///
+	/// Same as upsertfrom(Iter, Iter, InsertPolicy&), except that only
+	/// the columns in \c update are changed on existing rows.
+	///
+	/// If \c update is empty, existing rows are left as they are.
+	///
+	/// \param first iterator pointing to first element in range
+	/// \param last iterator pointing to one past the last element
+	/// \param policy insert policy object
+	/// \param update the columns to change on existing rows, as one of
+	/// the SSQLS's field lists
+	template <class Iter, class InsertPolicy, class FieldList>
+	Query& upsertfrom(Iter first, Iter last, InsertPolicy& policy,
+			const FieldList& update)
+	{
+		if (first == last) {
+			reset();
+			return *this;
+		}
+		return insertfrom_impl("INSERT", first, last, policy,
+				upsert_clause(field_text(update),
+				field_text(first->field_list())));
+	}
+
+	/// \brief Write a range of changed rows back to the database,
+	/// using an insert policy to control how many go in each statement.
+	///
+	/// Each statement sets the non-key columns of many rows at once,
+	/// one \c CASE expression per column choosing each row's value by
+	/// its key:
+	///
+	/// \code
+	/// UPDATE `stock` SET `num` = CASE WHEN (`item`) = ('Nuts') THEN 92
+	///     WHEN (`item`) = ('Bolts') THEN 8 ELSE `num` END, ...
+	///     WHERE (`item`) IN (('Nuts'),('Bolts'))
+	/// \endcode
+	///
+	/// The key fields are the SSQLS's comparison fields, the ones
+	/// counted by the second parameter of \c sql_create_N, which
+	/// should be the table's primary key.  Because rows are found by
+	/// their current key values, this can't change key fields.
+	///
+	/// As with insertfrom(), all the statements run inside one
+	/// transaction by default; see the policy's template parameter.
+	///
+	/// \param first iterator pointing to first element in range to
+	///    update
+	/// \param last iterator pointing to one past the last element to
+	///    update
+	/// \param policy insert policy object, see insertpolicy.h for
+	/// details
+	///
+	/// \sa update(), deletefrom()
+	template <class Iter, class InsertPolicy>
+	Query& updatefrom(Iter first, Iter last, InsertPolicy& policy)
+	{
+		return updatefrom_impl(first, last, policy, 0);
+	}
+
+	/// \brief Set some columns of a range of existing rows
+	///
+	/// Same as updatefrom(Iter, Iter, InsertPolicy&), except that
+	/// only the columns in \c update are set.
+	///
+	/// \param first iterator pointing to first element in range
+	/// \param last iterator pointing to one past the last element
+	/// \param policy insert policy object
+	/// \param update the columns to set, as one of the SSQLS's field
+	/// lists, such as <tt>items[0].field_list(stock_num)</tt>
+	template <class Iter, class InsertPolicy, class FieldList>
+	Query& updatefrom(Iter first, Iter last, InsertPolicy& policy,
+			const FieldList& update)
+	{
+		const std::string columns(field_text(update));
+		return updatefrom_impl(first, last, policy, &columns);
+	}
+
+	/// \brief Delete the rows matching a range of SSQLS objects,
+	/// using an insert policy to control how many go in each statement.
+	///
+	/// Builds statements like
+	/// <tt>DELETE FROM `stock` WHERE (`item`) IN (('Nuts'),('Bolts'))</tt>
+	/// from the objects' key fields: their comparison fields, the ones
+	/// counted by the second parameter of \c sql_create_N.  The other
+	/// fields are ignored.
+	///
+	/// As with insertfrom(), all the statements run inside one
+	/// transaction by default; see the policy's template parameter.
+	///
+	/// \param first iterator pointing to first element in range to
+	///    delete
+	/// \param last iterator pointing to one past the last element to
+	///    delete
+	/// \param policy insert policy object, see insertpolicy.h for
+	/// details
+	///
+	/// \sa updatefrom(), insertfrom()
+	template <class Iter, class InsertPolicy>
+	Query& deletefrom(Iter first, Iter last, InsertPolicy& policy)
+	{
+		if (first == last) {
+			reset();
+			return *this;   // empty set!
+		}
+
+		const std::string head = std::string("DELETE FROM `") +
+				first->table() + "` WHERE (" +
+				field_text(first->field_list(sql_use_compare)) + ") IN (";
+		return batchfrom_impl(first, last, policy, head, KeyWriter(),
+				")");
+	}
+
 #if !defined(DOXYGEN_IGNORE)
 	// Declare the remaining overloads.  These are hidden down here partly
 	// to keep the above code clear, but also so that we may hide them
@@ -1306,6 +1517,7 @@ public:
 	SQLQueryParms template_defaults;
 
 private:
+	friend class PreparedQuery;
 	friend class SQLQueryParms;
 
 	/// \brief Connection to send queries through
@@ -1314,23 +1526,299 @@ private:
 	/// \brief If true, last query succeeded
 	bool copacetic_;
 
-	/// \brief List of template query parameters
-	std::vector<SQLParseElement> parse_elems_;
-
-	/// \brief Maps template parameter position values to the
-	/// corresponding parameter name.
-	std::vector<std::string> parsed_names_;
+	/// \brief Compiled form of the template query, or 0 if parse()
+	/// hasn't been called
+	///
+	/// This usually points into the process-wide template cache, so
+	/// it is shared with other Query objects; see
+	/// SQLParsedTemplate::lookup().
+	const SQLParsedTemplate* parsed_;
 
-	/// \brief Maps template parameter names to their position value.
-	std::map<std::string, short int> parsed_nums_;
+	/// \brief Holds our private copy of parsed_ when the template
+	/// cache was full at the time we called parse()
+	RefCountedPointer<SQLParsedTemplate> own_parsed_;
 
 	/// \brief String buffer for storing assembled query
-	std::stringbuf sbuffer_;
+	QueryBuffer sbuffer_;
+
+	/// \brief Return the number of template query elements, or 0 if
+	/// this isn't a template query
+	size_t parse_elem_count() const
+			{ return parsed_ ? parsed_->elements().size() : 0; }
+
+	/// \brief Return the position of the named template parameter
+	///
+	/// Unknown names map to position 0, for compatibility with older
+	/// versions of the library.
+	short int parsed_num(const char* name) const;
+
+	/// \brief Append a template query parameter's value to the query,
+	/// quoting and escaping it as the given option character says
+	void append_param(char option, const SQLTypeAdapter& param);
+
+	/// \brief Tell the connection's result cache, if any, that a
+	/// statement ran, so it can drop results it made stale
+	void invalidate_cache(const char* str, size_t len);
 
 	/// \brief Process a parameterized query list.
 	void proc(SQLQueryParms& p);
 
-	SQLTypeAdapter* pprepare(char option, SQLTypeAdapter& S, bool replace = true);
+	/// \brief Return the size of the statement being built, as
+	/// batchfrom_impl() tells the insert policy
+	int statement_size(bool empty, const std::string& suffix)
+	{
+		return int(tellp()) + (empty ? 0 : int(suffix.size()));
+	}
+
+	/// \brief Tell an insert policy that a new insertfrom() or
+	/// updatefrom() pass is starting
+	///
+	/// Only AdaptiveInsertPolicy cares; other policies get this no-op.
+	template <class InsertPolicy>
+	static void begin_pass(InsertPolicy& /* policy */) { }
+
+	/// \brief Make an AdaptiveInsertPolicy forget any statement it
+	/// was timing when the previous pass ended
+	template <class AccessController>
+	static void begin_pass(AdaptiveInsertPolicy<AccessController>& policy)
+	{
+		policy.begin_pass();
+	}
+
+	/// \brief Build the <tt>ON DUPLICATE KEY UPDATE</tt> clause for
+	/// upsert() and upsertfrom()
+	///
+	/// \param fields a comma-separated list of backtick-quoted column
+	/// names, as an SSQLS's field_list() writes
+	/// \param all the full field list of the rows being inserted; if
+	/// \c fields is empty, the clause sets the first of these to
+	/// itself, since the SQL syntax doesn't allow an empty list
+	static std::string upsert_clause(const std::string& fields,
+			const std::string& all);
+
+	/// \brief Turn an SSQLS field list into the text upsert_clause()
+	/// and UpdateBatch take
+	template <class FieldList>
+	static std::string field_text(const FieldList& fields)
+	{
+		std::ostringstream os;
+		os << fields;
+		return os.str();
+	}
+
+	/// \brief Writes an SSQLS's VALUES list in parentheses, for
+	/// insertfrom_impl()
+	struct ValuesWriter
+	{
+		template <class T>
+		void operator()(SQLStream& os, const T& v) const
+		{
+			os << '(' << v.value_list() << ')';
+		}
+	};
+
+	/// \brief Writes an SSQLS's key field values in parentheses, for
+	/// deletefrom()
+	struct KeyWriter
+	{
+		template <class T>
+		void operator()(SQLStream& os, const T& v) const
+		{
+			os << '(' << v.value_list(sql_use_compare) << ')';
+		}
+	};
+
+	/// \brief Common implementation of insertfrom(), replacefrom()
+	/// and upsertfrom()
+	template <class Iter, class InsertPolicy>
+	Query& insertfrom_impl(const char* verb, Iter first, Iter last,
+			InsertPolicy& policy, const std::string& suffix = std::string())
+	{
+		if (first == last) {
+			reset();
+			return *this;   // empty set!
+		}
+
+		const std::string head = std::string(verb) + " INTO `" +
+				first->table() + "` (" + field_text(first->field_list()) +
+				") VALUES ";
+		return batchfrom_impl(first, last, policy, head, ValuesWriter(),
+				suffix);
+	}
+
+	/// \brief Build and run statements made of a fixed head, a
+	/// comma-separated list of rows and a fixed suffix, letting an
+	/// insert policy decide how many rows go in each
+	///
+	/// Each row is built exactly once by \c write, in a staging
+	/// stream.  The policy decides from its exact size, and the staged
+	/// bytes go into the current statement, or into the next one if
+	/// the policy says the current one is full.  The policy sees the
+	/// suffix's size as part of every statement but an empty one.
+	template <class Iter, class InsertPolicy, class RowWriter>
+	Query& batchfrom_impl(Iter first, Iter last, InsertPolicy& policy,
+			const std::string& head, const RowWriter& write,
+			const std::string& suffix)
+	{
+		bool success = true;
+		bool empty = true;
+
+		reset();
+		begin_pass(policy);
+
+		if (first == last) {
+			return *this;   // empty set!
+		}
+
+		typename InsertPolicy::access_controller ac(*conn_);
+
+		SQLStream row(conn_);
+		row.precision(16);
+
+		for (Iter it = first; it != last; ++it) {
+			row.buffer().clear();
+			write(row, *it);
+
+			// Count the comma separating it from the previous row, so
+			// the size is the same whether or not it starts a statement
+			const size_t row_size = row.buffer().size() + 1;
+
+			if (!policy.can_add(statement_size(empty, suffix), *it,
+					row_size)) {
+				// Execute what we've built up already, if there is anything
+				if (!empty) {
+					sbuffer_.append(suffix.data(), suffix.size());
+					if (!exec()) {
+						success = false;
+						break;
+					}
+
+					empty = true;
+				}
+
+				// If we _still_ can't add, the policy is too strict
+				if (!policy.can_add(statement_size(empty, suffix), *it,
+						row_size)) {
+					if (throw_exceptions()) {
+						throw BadInsertPolicy("Insert policy is too strict");
+					}
+
+					success = false;
+					break;
+				}
+			}
+
+			if (empty) {
+				sbuffer_.append(head.data(), head.size());
+				empty = false;
+			}
+			else {
+				sbuffer_.append(',');
+			}
+			sbuffer_.append(row.buffer().data(), row.buffer().size());
+		}
+
+		// We might need to execute the last query here.
+		if (success && !empty) {
+			sbuffer_.append(suffix.data(), suffix.size());
+			if (!exec()) {
+				success = false;
+			}
+		}
+
+		if (success) {
+			ac.commit();
+		}
+		else {
+			ac.rollback();
+		}
+
+		return *this;
+	}
+
+	/// \brief Implementation of updatefrom()
+	///
+	/// \param update the columns to set, as field list text, or 0 for
+	/// all but the key fields
+	template <class Iter, class InsertPolicy>
+	Query& updatefrom_impl(Iter first, Iter last, InsertPolicy& policy,
+			const std::string* update)
+	{
+		bool success = true;
+
+		reset();
+		begin_pass(policy);
+
+		if (first == last) {
+			return *this;   // empty set!
+		}
+
+		UpdateBatch batch(first->table(), field_text(first->field_list()),
+				field_text(first->field_list(sql_use_compare)), update);
+		if (batch.columns() == 0) {
+			return *this;	// nothing to set
+		}
+
+		typename InsertPolicy::access_controller ac(*conn_);
+
+		SQLStream row(conn_);
+		row.precision(16);
+		std::string key;
+		std::vector<std::string> values(batch.columns());
+
+		for (Iter it = first; it != last; ++it) {
+			row.buffer().clear();
+			row << it->value_list(sql_use_compare);
+			key.assign(row.buffer().data(), row.buffer().size());
+			for (size_t i = 0; i < values.size(); ++i) {
+				row.buffer().clear();
+				row << it->value_list(batch.mask(i));
+				values[i].assign(row.buffer().data(), row.buffer().size());
+			}
+
+			// batch.size() is 0 while the batch is empty, which is how
+			// the policy learns a new statement is starting, as with
+			// statement_size() in batchfrom_impl()
+			const size_t row_size = batch.row_size(key, values);
+			if (!policy.can_add(int(batch.size()), *it, row_size)) {
+				// Execute what we've built up already, if there is anything
+				if (!batch.empty()) {
+					if (!exec(batch.str())) {
+						success = false;
+						break;
+					}
+
+					batch.clear();
+				}
+
+				// If we _still_ can't add, the policy is too strict
+				if (!policy.can_add(int(batch.size()), *it, row_size)) {
+					if (throw_exceptions()) {
+						throw BadInsertPolicy("Insert policy is too strict");
+					}
+
+					success = false;
+					break;
+				}
+			}
+
+			batch.add(key, values);
+		}
+
+		// We might need to execute the last query here.
+		if (success && !batch.empty() && !exec(batch.str())) {
+			success = false;
+		}
+
+		if (success) {
+			ac.commit();
+		}
+		else {
+			ac.rollback();
+		}
+
+		return *this;
+	}
 };
 
 
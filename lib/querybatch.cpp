@@ -0,0 +1,245 @@
+/***********************************************************************
+ querybatch.cpp - Implements the QueryBatch class.
+
+ Copyright (c) 2009 by Educational Technology Resources, Inc.
+ Others may also hold copyrights on code in this file.  See the
+ CREDITS.txt file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#define MYSQLPP_NOT_HEADER
+#include "common.h"
+
+#include "querybatch.h"
+
+#include "connection.h"
+#include "dbdriver.h"
+#include "options.h"
+#include "query.h"
+#include "resultcache.h"
+#include "utility.h"
+
+#include <ctype.h>
+#include <string.h>
+
+namespace mysqlpp {
+
+// Room left in each packet for the protocol's own bytes, so a batch
+// filled right up to max_allowed_packet doesn't get rejected.
+static const size_t packet_overhead = 64;
+
+// The range of C API error codes raised by the client library itself,
+// CR_MIN_ERROR to CR_MAX_ERROR in errmsg.h.  These mean the connection
+// failed, not the statement.
+static const int client_error_min = 2000;
+static const int client_error_max = 2999;
+
+
+QueryBatch::QueryBatch(Connection* c, bool te) :
+OptionalExceptions(te),
+conn_(c),
+max_packet_(0),
+multi_enabled_(false)
+{
+}
+
+
+void
+QueryBatch::add(const char* sql)
+{
+	push(sql, strlen(sql));
+}
+
+
+void
+QueryBatch::add(Query& q)
+{
+	add(q.str());
+}
+
+
+void
+QueryBatch::add(Query& q, SQLQueryParms& p)
+{
+	add(q.str(p));
+}
+
+
+std::vector<BatchResult>
+QueryBatch::execute()
+{
+	std::vector<BatchResult> results(statements_.size());
+	if (statements_.empty()) {
+		return results;
+	}
+
+	prepare();
+
+	size_t i = 0;
+	while (i < statements_.size()) {
+		i = send_packet(i, packet_end(i), results);
+
+		// Only now has the server finished with the whole packet
+		if (ResultCache* cache = conn_->result_cache()) {
+			cache->invalidate(packet_.data(), packet_.size());
+		}
+	}
+
+	return results;
+}
+
+
+size_t
+QueryBatch::packet_count() const
+{
+	size_t n = 0;
+	for (size_t i = 0; i < statements_.size(); i = packet_end(i)) {
+		++n;
+	}
+	return n;
+}
+
+
+size_t
+QueryBatch::packet_end(size_t first) const
+{
+	if (max_packet_ == 0) {
+		return statements_.size();
+	}
+
+	const size_t limit = max_packet_ > packet_overhead ?
+			max_packet_ - packet_overhead : 1;
+	size_t len = statements_[first].length();
+	size_t end = first + 1;
+	while ((end < statements_.size()) &&
+			(len + 1 + statements_[end].length() <= limit)) {
+		len += 1 + statements_[end++].length();
+	}
+	return end;
+}
+
+
+void
+QueryBatch::prepare()
+{
+	if (max_packet_ == 0) {
+		max_packet_ = internal::max_allowed_packet(conn_);
+	}
+
+	if (!multi_enabled_ && (statements_.size() > 1)) {
+		conn_->set_option(new MultiStatementsOption(true));
+		multi_enabled_ = true;
+	}
+}
+
+
+void
+QueryBatch::push(const char* sql, size_t length)
+{
+	while ((length > 0) && ((sql[length - 1] == ';') ||
+			isspace(static_cast<unsigned char>(sql[length - 1])))) {
+		--length;
+	}
+	statements_.push_back(std::string(sql, length));
+}
+
+
+size_t
+QueryBatch::send_packet(size_t first, size_t end,
+		std::vector<BatchResult>& results)
+{
+	packet_.clear();
+	for (size_t i = first; i < end; ++i) {
+		if (i != first) {
+			packet_.append(';');
+		}
+		packet_.append(statements_[i]);
+	}
+
+	DBDriver* driver = conn_->driver();
+	if (!driver->execute(packet_.data(), packet_.size())) {
+		// The first statement failed, so the server didn't run any
+		set_error(results[first]);
+		return first + 1;
+	}
+
+	for (size_t i = first; /* */; ++i) {
+		BatchResult& r = results[i];
+		MYSQL_RES* res = driver->store_result();
+		if (res || driver->result_empty()) {
+			r.errnum_ = 0;
+			r.simple_ = SimpleResult(true, driver->insert_id(),
+					driver->affected_rows(), driver->query_info());
+			if (res) {
+				r.rows_ = StoreQueryResult(res, driver,
+						throw_exceptions(), conn_->zero_copy(),
+						conn_->arena_recycler());
+				r.has_rows_ = true;
+			}
+		}
+		else {
+			set_error(r);
+		}
+
+		switch (driver->next_result()) {
+			case DBDriver::nr_more_results:
+				if (i + 1 < end) {
+					continue;
+				}
+				// The server thinks there are more statements than we
+				// sent, which can happen if one of them held a
+				// semicolon outside a quoted string.  Drain the extra
+				// results; there's nothing to attach them to.
+				while (driver->next_result() ==
+						DBDriver::nr_more_results) {
+					if ((res = driver->store_result()) != 0) {
+						driver->free_result(res);
+					}
+				}
+				return end;
+
+			case DBDriver::nr_error:
+				// Statement i + 1 failed, and the server skipped the
+				// rest of the packet.  Resend those separately.
+				if (i + 1 < end) {
+					set_error(results[i + 1]);
+				}
+				return i + 2;
+
+			default:
+				return i + 1;
+		}
+	}
+}
+
+
+void
+QueryBatch::set_error(BatchResult& r)
+{
+	DBDriver* driver = conn_->driver();
+	r.errnum_ = driver->errnum();
+	r.error_ = driver->error();
+
+	if (throw_exceptions() && (r.errnum_ >= client_error_min) &&
+			(r.errnum_ <= client_error_max)) {
+		throw BadQuery(r.error_, r.errnum_);
+	}
+}
+
+} // end namespace mysqlpp
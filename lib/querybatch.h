@@ -0,0 +1,247 @@
+/// \file querybatch.h
+/// \brief Declares the QueryBatch class, which sends many independent
+/// SQL statements to the server in as few round trips as possible.
+
+/***********************************************************************
+ Copyright (c) 2009 by Educational Technology Resources, Inc.
+ Others may also hold copyrights on code in this file.  See the
+ CREDITS.txt file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#if !defined(MYSQLPP_QUERYBATCH_H)
+#define MYSQLPP_QUERYBATCH_H
+
+#include "common.h"
+
+#include "noexceptions.h"
+#include "qbuffer.h"
+#include "result.h"
+
+#include <string>
+#include <vector>
+
+namespace mysqlpp {
+
+#if !defined(DOXYGEN_IGNORE)
+// Make Doxygen ignore this
+class MYSQLPP_EXPORT Connection;
+class MYSQLPP_EXPORT Query;
+class MYSQLPP_EXPORT SQLQueryParms;
+#endif
+
+/// \brief Holds the outcome of one statement in a QueryBatch.
+///
+/// A statement either succeeded, in which case simple() describes its
+/// effects and rows() holds any rows it returned, or it failed, in
+/// which case errnum() and error() say why.
+
+class MYSQLPP_EXPORT BatchResult
+{
+private:
+	/// \brief Pointer to bool data member, for use by safe bool
+	/// conversion operator.
+	///
+	/// \see http://www.artima.com/cppsource/safebool.html
+	typedef int BatchResult::*private_bool_type;
+
+public:
+	/// \brief Default ctor, creating a result for a statement that
+	/// hasn't run
+	BatchResult() :
+	errnum_(-1),
+	has_rows_(false)
+	{
+	}
+
+	/// \brief Test whether the statement succeeded
+	operator private_bool_type() const
+	{
+		return errnum_ == 0 ? &BatchResult::errnum_ : 0;
+	}
+
+	/// \brief Return the error message for a failed statement, or an
+	/// empty string if it succeeded
+	const std::string& error() const { return error_; }
+
+	/// \brief Return the C API error number for a failed statement, 0
+	/// if it succeeded, or -1 if it never ran
+	int errnum() const { return errnum_; }
+
+	/// \brief Returns true if the statement returned a result set,
+	/// even an empty one
+	bool has_rows() const { return has_rows_; }
+
+	/// \brief Return the result set the statement returned
+	///
+	/// This is empty unless has_rows() is true.
+	const StoreQueryResult& rows() const { return rows_; }
+
+	/// \brief Return the affected row count, insert ID and info string
+	/// for the statement
+	const SimpleResult& simple() const { return simple_; }
+
+private:
+	friend class QueryBatch;
+
+	int errnum_;
+	bool has_rows_;
+	std::string error_;
+	SimpleResult simple_;
+	StoreQueryResult rows_;
+};
+
+
+/// \brief Sends a list of independent SQL statements to the server in
+/// as few packets as possible, and hands back each statement's result.
+///
+/// Each statement sent on its own costs a full network round trip,
+/// which dominates the run time of small queries.  QueryBatch instead
+/// joins the statements with semicolons and sends them under the MySQL
+/// multi-statement protocol, then collects the results one by one:
+///
+/// \code
+/// mysqlpp::QueryBatch batch(&conn);
+/// batch.add("UPDATE stock SET num = num - 1 WHERE item = 'Hammer'");
+/// batch.add(query);	// a Query, including template queries
+/// batch.add("SELECT * FROM stock");
+/// std::vector<mysqlpp::BatchResult> results = batch.execute();
+/// \endcode
+///
+/// The statements should be independent: if one fails, the server
+/// stops running the rest of its packet, so QueryBatch records the
+/// error against that statement and sends the remaining statements in
+/// a new packet.  Statement failures are never reported by exception;
+/// check each BatchResult instead.  Failures of the connection itself,
+/// such as losing it, are thrown as BadQuery unless exceptions are
+/// turned off, since none of the remaining statements can succeed.
+///
+/// Trailing semicolons and whitespace are stripped from each statement
+/// as it's added, since the server would take the empty statement
+/// between them and the next separator as an error.
+///
+/// A batch is split into several packets as needed to keep each one
+/// under the server's \c max_allowed_packet limit.  A single statement
+/// bigger than the limit is sent alone, and will fail.
+///
+/// The first execute() turns on MultiStatementsOption for the
+/// connection if this object hasn't done so already.
+
+class MYSQLPP_EXPORT QueryBatch : public OptionalExceptions
+{
+public:
+	/// \brief Create an empty batch
+	///
+	/// \param c connection to send the statements through
+	/// \param te if true, execute() throws BadQuery if the connection
+	/// fails, instead of marking each remaining statement as failed
+	QueryBatch(Connection* c, bool te = true);
+
+	/// \brief Add a statement to the batch
+	void add(const std::string& sql) { push(sql.data(), sql.length()); }
+
+	/// \brief Add a statement to the batch
+	void add(const char* sql);
+
+	/// \brief Add the statement built up in a Query, filling in any
+	/// template query parameters from its defaults
+	///
+	/// The query is not reset, so you can change its template
+	/// parameters and add it again.
+	void add(Query& q);
+
+	/// \brief Add an execution of a template query with the given
+	/// parameters
+	void add(Query& q, SQLQueryParms& p);
+
+	/// \brief Remove all statements from the batch
+	void clear() { statements_.clear(); }
+
+	/// \brief Returns true if the batch has no statements
+	bool empty() const { return statements_.empty(); }
+
+	/// \brief Send all statements to the server and collect their
+	/// results
+	///
+	/// \retval one result per statement, in the order they were added
+	///
+	/// The batch is left as it was, so you can run it again.
+	///
+	/// \throw BadQuery if the connection fails and exceptions are
+	/// enabled
+	std::vector<BatchResult> execute();
+
+	/// \brief Return the packet size limit execute() splits batches at
+	///
+	/// This is 0 until set with max_packet(size_t) or fetched from the
+	/// server by the first execute().
+	size_t max_packet() const { return max_packet_; }
+
+	/// \brief Set the packet size limit execute() splits batches at
+	///
+	/// This saves execute() from asking the server for its
+	/// \c max_allowed_packet value.
+	void max_packet(size_t n) { max_packet_ = n; }
+
+	/// \brief Return the number of packets execute() would send,
+	/// assuming every statement succeeds
+	///
+	/// If max_packet() is still 0, this assumes there is no limit.
+	size_t packet_count() const;
+
+	/// \brief Return the number of statements in the batch
+	size_t size() const { return statements_.size(); }
+
+private:
+	/// \brief Return one past the index of the last statement that
+	/// fits in a packet starting with statement \c first
+	size_t packet_end(size_t first) const;
+
+	/// \brief Send the statements in [first, end) as one packet and
+	/// fill in their results
+	///
+	/// \retval index of the first statement that didn't run, because an
+	/// earlier one in the packet failed; \c end if all of them ran
+	size_t send_packet(size_t first, size_t end,
+			std::vector<BatchResult>& results);
+
+	/// \brief Make sure we know max_packet_ and that multi-statement
+	/// support is enabled
+	void prepare();
+
+	/// \brief Add a statement, less any trailing semicolons and
+	/// whitespace
+	void push(const char* sql, size_t length);
+
+	/// \brief Record the connection's current error in a result
+	///
+	/// Throws BadQuery instead if it's a connection-level error and
+	/// exceptions are enabled.
+	void set_error(BatchResult& r);
+
+	Connection* conn_;
+	std::vector<std::string> statements_;
+	size_t max_packet_;
+	bool multi_enabled_;
+	QueryBuffer packet_;
+};
+
+} // end namespace mysqlpp
+
+#endif // !defined(MYSQLPP_QUERYBATCH_H)
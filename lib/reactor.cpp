@@ -0,0 +1,136 @@
+/***********************************************************************
+ reactor.cpp - Implements the Reactor class.
+
+ Copyright (c) 2009 by Educational Technology Resources, Inc.
+ Others may also hold copyrights on code in this file.  See the
+ CREDITS.txt file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#define MYSQLPP_NOT_HEADER
+#include "common.h"
+
+#include "reactor.h"
+
+#if defined(MYSQLPP_HAVE_REACTOR)
+
+#include "exceptions.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+namespace mysqlpp {
+
+// Most sockets we'll pull from the kernel per epoll_wait() call
+static const int max_events = 256;
+
+
+Reactor::Reactor() :
+epoll_fd_(epoll_create(max_events)),
+pending_(0)
+{
+	if (epoll_fd_ < 0) {
+		throw ReactorFailed(strerror(errno));
+	}
+}
+
+
+Reactor::~Reactor()
+{
+	close(epoll_fd_);
+}
+
+
+bool
+Reactor::add(AsyncOperation& op)
+{
+	if (op.status() != AsyncOperation::pending) {
+		op.finished();
+		return false;
+	}
+
+	epoll_event ev;
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN | EPOLLOUT | EPOLLET;
+	ev.data.ptr = &op;
+	if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, op.socket(), &ev) < 0) {
+		throw ReactorFailed(strerror(errno));
+	}
+	++pending_;
+
+	// No need to resume the operation here to catch up on I/O that
+	// happened before the socket was registered: epoll reports the
+	// socket's current state on registration, even in edge-triggered
+	// mode, so the next run_once() will do that.
+	return true;
+}
+
+
+void
+Reactor::remove(AsyncOperation& op)
+{
+	// Linux before 2.6.9 insists on a non-null event pointer, even
+	// though it's ignored.
+	epoll_event ev;
+	epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, op.socket(), &ev);
+	--pending_;
+}
+
+
+void
+Reactor::run()
+{
+	while (pending_) {
+		run_once(-1);
+	}
+}
+
+
+size_t
+Reactor::run_once(int timeout_ms)
+{
+	epoll_event events[max_events];
+	int n = epoll_wait(epoll_fd_, events, max_events, timeout_ms);
+	if (n < 0) {
+		if (errno == EINTR) {
+			return 0;
+		}
+		throw ReactorFailed(strerror(errno));
+	}
+
+	size_t done = 0;
+	for (int i = 0; i < n; ++i) {
+		AsyncOperation* op = static_cast<AsyncOperation*>(
+				events[i].data.ptr);
+		if (op->resume() != AsyncOperation::pending) {
+			// Deregister before calling finished(), so it can start
+			// another operation on the same connection and add it.
+			remove(*op);
+			++done;
+			op->finished();
+		}
+	}
+	return done;
+}
+
+} // end namespace mysqlpp
+
+#endif // defined(MYSQLPP_HAVE_REACTOR)
@@ -0,0 +1,132 @@
+/// \file reactor.h
+/// \brief Declares the Reactor class, which drives many non-blocking
+/// database operations from a single thread.
+
+/***********************************************************************
+ Copyright (c) 2009 by Educational Technology Resources, Inc.
+ Others may also hold copyrights on code in this file.  See the
+ CREDITS.txt file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#if !defined(MYSQLPP_REACTOR_H)
+#define MYSQLPP_REACTOR_H
+
+#include "asyncquery.h"
+
+// The reactor is built on Linux's epoll facility
+#if defined(MYSQLPP_HAVE_NONBLOCKING) && defined(__linux__)
+#	define MYSQLPP_HAVE_REACTOR
+#endif
+
+#if defined(MYSQLPP_HAVE_REACTOR)
+
+namespace mysqlpp {
+
+/// \brief Drives any number of AsyncOperation objects from one thread.
+///
+/// Hand the reactor operations you've started, then call run() or
+/// run_once() to wait for their sockets and resume them as they become
+/// ready.  Each operation's AsyncOperation::finished() is called when
+/// it completes:
+///
+/// \code
+/// class MyQuery : public mysqlpp::AsyncQuery {
+///     ...
+///     void finished() { ...look at status() and result()... }
+/// };
+///
+/// mysqlpp::Reactor reactor;
+/// for (size_t i = 0; i < queries.size(); ++i) {
+///     queries[i].start("SELECT ...");
+///     reactor.add(queries[i]);
+/// }
+/// reactor.run();
+/// \endcode
+///
+/// Each connection can only have one operation in progress at a time,
+/// but there is no limit on the number of connections, beyond the
+/// process's file descriptor limit.  The reactor doesn't own the
+/// operations; they must outlive their time in it, so don't destroy
+/// one operation from another's finished().
+///
+/// The sockets are watched in edge-triggered mode for both reading and
+/// writing, since the C API doesn't say which one it's waiting for.
+/// Edge triggering means an idle but writable socket doesn't wake us
+/// over and over.
+///
+/// This is only available on Linux, when MySQL++ is built against
+/// MySQL 8.0.16 or newer; MYSQLPP_HAVE_REACTOR is defined when it is.
+
+class MYSQLPP_EXPORT Reactor
+{
+public:
+	/// \brief Create a reactor
+	///
+	/// Throws ReactorFailed if the system can't create the epoll
+	/// instance.
+	Reactor();
+
+	/// \brief Destroy the reactor
+	///
+	/// Operations still pending are forgotten, not finished.
+	~Reactor();
+
+	/// \brief Hand an operation to the reactor
+	///
+	/// If the operation is already done, as can happen if start()
+	/// didn't need to wait for anything, this calls its finished()
+	/// right away.  Otherwise the reactor watches its socket until it
+	/// finishes.
+	///
+	/// \retval true if the operation is now pending in the reactor
+	bool add(AsyncOperation& op);
+
+	/// \brief Return the number of operations waiting to finish
+	size_t pending() const { return pending_; }
+
+	/// \brief Run until no operations are pending
+	void run();
+
+	/// \brief Wait for sockets to become ready, and resume the
+	/// operations waiting on them
+	///
+	/// \param timeout_ms how long to wait, in milliseconds, or -1 to
+	/// wait until at least one socket is ready
+	///
+	/// \retval number of operations that finished
+	size_t run_once(int timeout_ms = -1);
+
+private:
+	/// \brief Stop watching an operation's socket
+	void remove(AsyncOperation& op);
+
+	int epoll_fd_;
+	size_t pending_;
+
+	// Can't copy these
+	Reactor(const Reactor&);
+	Reactor& operator=(const Reactor&);
+};
+
+} // end namespace mysqlpp
+
+#endif // defined(MYSQLPP_HAVE_REACTOR)
+
+#endif // !defined(MYSQLPP_REACTOR_H)
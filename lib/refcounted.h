@@ -29,9 +29,40 @@
 #define MYSQLPP_REFCOUNTED_H
 
 #include <memory>
+#include <new>
 
 #include <stddef.h>
 
+#if !defined(DOXYGEN_IGNORE)
+// Doxygen will not generate documentation for the following stuff.
+
+// Work out how to change a reference count atomically.  Where we
+// can't, the "atomic" counter policy below falls back to plain ++/--.
+#if defined(__GNUC__)
+#	define MYSQLPP_ATOMIC_REFCOUNTS
+#	define MYSQLPP_ATOMIC_INC(p) __sync_add_and_fetch((p), 1)
+#	define MYSQLPP_ATOMIC_DEC(p) __sync_sub_and_fetch((p), 1)
+#elif defined(_MSC_VER)
+#	include <intrin.h>
+#	define MYSQLPP_ATOMIC_REFCOUNTS
+#	if defined(_WIN64)
+#		define MYSQLPP_ATOMIC_INC(p) size_t(_InterlockedIncrement64( \
+				reinterpret_cast<volatile __int64*>(p)))
+#		define MYSQLPP_ATOMIC_DEC(p) size_t(_InterlockedDecrement64( \
+				reinterpret_cast<volatile __int64*>(p)))
+#	else
+#		define MYSQLPP_ATOMIC_INC(p) size_t(_InterlockedIncrement( \
+				reinterpret_cast<volatile long*>(p)))
+#		define MYSQLPP_ATOMIC_DEC(p) size_t(_InterlockedDecrement( \
+				reinterpret_cast<volatile long*>(p)))
+#	endif
+#else
+#	define MYSQLPP_ATOMIC_INC(p) (++*(p))
+#	define MYSQLPP_ATOMIC_DEC(p) (--*(p))
+#endif
+
+#endif // !defined(DOXYGEN_IGNORE)
+
 namespace mysqlpp {
 
 /// \brief Functor to call delete on the pointer you pass to it
@@ -49,6 +80,166 @@ struct RefCountedPointerDestroyer
 };
 
 
+/// \brief Functor to destroy an object without freeing its memory
+///
+/// The destroyer for RefCountedPointers holding objects made by
+/// make_refcounted().  Their memory is freed along with the count, by
+/// RefCountedPointerBlockCounter.
+template <class T>
+struct RefCountedPointerInPlaceDestroyer
+{
+	/// \brief Functor implementation
+	void operator()(T* doomed) const { doomed->~T(); }
+};
+
+
+/// \brief Changes a reference count with plain, unsynchronized
+/// arithmetic
+///
+/// The base of the stock RefCountedPointer counter policies.  Only
+/// one thread may copy or destroy the pointers sharing such a count.
+struct RefCountedPointerPlainCount
+{
+	/// \brief Add a reference
+	static void increment(size_t* refs) { ++*refs; }
+
+	/// \brief Drop a reference, returning the number left
+	static size_t decrement(size_t* refs) { return --*refs; }
+};
+
+
+/// \brief A RefCountedPointer counter policy that keeps the count in
+/// a heap block of its own
+template <class T>
+struct RefCountedPointerHeapCounter : public RefCountedPointerPlainCount
+{
+	/// \brief Return a new count of 1 for the object
+	static size_t* create(T*) { return new size_t(1); }
+
+	/// \brief Free the count, after the object is destroyed
+	static void destroy(size_t* refs) { delete refs; }
+};
+
+
+/// \brief Creates and destroys the reference count RefCountedPointer
+/// keeps for an object, and changes it
+///
+/// By default, the count is a separate heap block.  Specialize this
+/// template for a type whose objects carry their own count, deriving
+/// from RefCountedPointerIntrusiveCounter as SQLBuffer does, to save
+/// that allocation.  Derive from RefCountedPointerAtomicCounter
+/// instead to also make the count safe to change from many threads.
+template <class T>
+struct RefCountedPointerCounter : public RefCountedPointerHeapCounter<T>
+{
+};
+
+
+/// \brief A RefCountedPointerCounter for types that keep their own
+/// reference count
+///
+/// \c T must have a \c size_t member called \c refs_ for the count,
+/// accessible to this template.  The count is only touched by
+/// RefCountedPointer, so the object must be created on the heap and
+/// handed to a RefCountedPointer just once; copy the pointer, never
+/// wrap the raw object a second time.
+template <class T>
+struct RefCountedPointerIntrusiveCounter : public RefCountedPointerPlainCount
+{
+	/// \brief Start the object's own count at 1, and return it
+	static size_t* create(T* counted)
+	{
+		counted->refs_ = 1;
+		return &counted->refs_;
+	}
+
+	/// \brief Do nothing; the count went away with the object
+	static void destroy(size_t*) { }
+};
+
+
+/// \brief A RefCountedPointer counter policy that keeps the count in
+/// the same heap block as the object, just ahead of it
+///
+/// This saves the count's allocation for types that can't carry their
+/// own count, such as library and third-party types.  The objects must
+/// be made by make(), usually through make_refcounted(), and the
+/// RefCountedPointer must use RefCountedPointerInPlaceDestroyer; never
+/// wrap an object made with \c new in such a pointer.
+template <class T>
+struct RefCountedPointerBlockCounter : public RefCountedPointerPlainCount
+{
+	/// \brief Copy \c value into a new block with room for its count
+	static T* make(const T& value)
+	{
+		char* block = static_cast<char*>(::operator new(
+				sizeof(Header) + sizeof(T)));
+		try {
+			return new (block + sizeof(Header)) T(value);
+		}
+		catch (...) {
+			::operator delete(block);
+			throw;
+		}
+	}
+
+	/// \brief Start the count in the object's block at 1, and return it
+	static size_t* create(T* counted)
+	{
+		size_t* refs = &reinterpret_cast<Header*>(
+				reinterpret_cast<char*>(counted) - sizeof(Header))->refs;
+		*refs = 1;
+		return refs;
+	}
+
+	/// \brief Free the block, after the object is destroyed
+	static void destroy(size_t* refs) { ::operator delete(refs); }
+
+private:
+	/// \brief The count, padded so the object after it is aligned
+	union Header
+	{
+		size_t refs;
+		double d;
+		long double ld;
+		void* p;
+	};
+};
+
+
+/// \brief A RefCountedPointer counter policy that changes the count
+/// atomically
+///
+/// Copies of a RefCountedPointer using this policy may be made and
+/// destroyed in many threads at once, so an object built in one
+/// thread can be handed to others without copying it.  The object
+/// itself gets no such protection: share it read-only, or lock it.
+///
+/// \c Base supplies the count itself, so the count lives wherever
+/// \c Base puts it.  Pass RefCountedPointerIntrusiveCounter<T> to keep
+/// it in the object, or RefCountedPointerBlockCounter<T> to keep it
+/// next to the object, making one allocation hold both.  The library's
+/// SQLBuffer, SQLBufferOwner, FieldNames and FieldTypes counts work
+/// this way, which is what lets Strings, Rows and StoreQueryResults
+/// be shared among threads.
+///
+/// This falls back to plain arithmetic on compilers we don't know how
+/// to do atomic operations with.  MYSQLPP_ATOMIC_REFCOUNTS is defined
+/// only where the count really is atomic.
+template <class T, class Base = RefCountedPointerHeapCounter<T> >
+struct RefCountedPointerAtomicCounter : public Base
+{
+	/// \brief Add a reference
+	static void increment(size_t* refs) { MYSQLPP_ATOMIC_INC(refs); }
+
+	/// \brief Drop a reference, returning the number left
+	static size_t decrement(size_t* refs)
+	{
+		return MYSQLPP_ATOMIC_DEC(refs);
+	}
+};
+
+
 /// \brief Creates an object that acts as a reference-counted pointer
 /// to another object.
 ///
@@ -67,6 +258,12 @@ struct RefCountedPointerDestroyer
 /// once, then pass around the reference counted pointer, knowing that
 /// the last user will "turn out the lights".
 ///
+/// The \c Counter policy decides where the reference count lives and
+/// how it's changed.  The default, RefCountedPointerCounter, is a
+/// separate heap block changed without any locking, unless it's
+/// specialized for \c T.  Pass RefCountedPointerAtomicCounter<T> to
+/// share the object among threads.
+///
 /// \b Implementation \b detail: You may notice that this class manages
 /// two pointers, one to the data we're managing, and one to the
 /// reference count.  You might wonder why we don't wrap these up into a
@@ -76,11 +273,16 @@ struct RefCountedPointerDestroyer
 /// of just double.  It's a tradeoff, and we've chosen to take a minor
 /// complexity hit to avoid the performance hit.
 
-template <class T, class Destroyer = RefCountedPointerDestroyer<T> >
+template <class T, class Destroyer = RefCountedPointerDestroyer<T>,
+		class Counter = RefCountedPointerCounter<T> >
 class RefCountedPointer
 {
 public:
-	typedef RefCountedPointer<T> ThisType;	///< alias for this object's type
+	/// \brief alias for this object's type
+	typedef RefCountedPointer<T, Destroyer, Counter> ThisType;
+
+	/// \brief alias for the counter policy
+	typedef Counter counter_type;
 
 	/// \brief Default constructor
 	///
@@ -103,7 +305,7 @@ public:
 	{
 		std::auto_ptr<T> exception_guard(counted_);
 		if (counted_) {
-			refs_ = new size_t(1);
+			refs_ = Counter::create(counted_);
 		}
 		exception_guard.release();	// previous new didn't throw
 	}
@@ -114,7 +316,7 @@ public:
 	refs_(other.counted_ ? other.refs_ : 0)
 	{
 		if (counted_) {
-			++(*refs_);
+			Counter::increment(refs_);
 		}
 	}
 
@@ -124,9 +326,10 @@ public:
 	/// drops to 0.
 	~RefCountedPointer()
 	{
-		if (refs_ && (--(*refs_) == 0)) {
+		if (refs_ && (Counter::decrement(refs_) == 0)) {
+			size_t* refs = refs_;
 			Destroyer()(counted_);
-			delete refs_;
+			Counter::destroy(refs);
 		}
 	}
 
@@ -257,10 +460,34 @@ private:
 	/// We can't keep this as a plain integer because this object
 	/// allows itself to be copied.  All copies need to share this
 	/// reference count, not just the pointer to the counted object.
+	/// It points into the counted object itself if the Counter policy
+	/// says so.
 	size_t* refs_;
 };
 
 
+/// \brief Copy an object into a new block of memory along with its
+/// reference count, and return a RefCountedPointer to it
+///
+/// This makes one heap allocation where \c new and the default
+/// counter make two.  \c Pointer must be a RefCountedPointer using
+/// RefCountedPointerInPlaceDestroyer and RefCountedPointerBlockCounter,
+/// directly or as the base of RefCountedPointerAtomicCounter:
+///
+/// \code
+/// typedef mysqlpp::RefCountedPointer<Foo,
+///         mysqlpp::RefCountedPointerInPlaceDestroyer<Foo>,
+///         mysqlpp::RefCountedPointerBlockCounter<Foo> > FooPtr;
+/// FooPtr p = mysqlpp::make_refcounted<FooPtr>(Foo(42));
+/// \endcode
+template <class Pointer, class T>
+inline Pointer
+make_refcounted(const T& value)
+{
+	return Pointer(Pointer::counter_type::make(value));
+}
+
+
 } // end namespace mysqlpp
 
 #endif // !defined(MYSQLPP_REFCOUNTED_H)
@@ -27,11 +27,32 @@
 
 #include "result.h"
 
+#include "arena.h"
 #include "dbdriver.h"
 
 
 namespace mysqlpp {
 
+namespace {
+
+// Keeps a C API result set alive for the values of a zero-copy
+// StoreQueryResult, which point into its rows
+class StoredResultOwner : public SQLBufferOwner
+{
+public:
+	explicit StoredResultOwner(MYSQL_RES* res) :
+	res_(res)
+	{
+	}
+
+	~StoredResultOwner() { mysql_free_result(res_); }
+
+private:
+	MYSQL_RES* res_;
+};
+
+} // end anonymous namespace
+
 
 ResultBase::ResultBase(MYSQL_RES* res, DBDriver* dbd, bool te) :
 OptionalExceptions(te),
@@ -97,21 +118,50 @@ ResultBase::field_num(const std::string& i) const
 
 
 StoreQueryResult::StoreQueryResult(MYSQL_RES* res, DBDriver* dbd,
-		bool te) :
+		bool te, bool zero_copy, ArenaRecycler* recycler) :
 ResultBase(res, dbd, te),
 list_type(list_type::size_type(res && dbd ? dbd->num_rows(res) : 0)),
 copacetic_(res && dbd)
 {
 	if (copacetic_) {
+		// In zero-copy mode, the rows' values share ownership of res,
+		// so it's freed when the last of them goes away.  In arena
+		// mode, they share the arena we copy them into.
+		RefCountedOwner owner;
+		Arena* arena = 0;
+		std::vector<char*> cells;
+		if (zero_copy) {
+			owner = new StoredResultOwner(res);
+		}
+		else if (recycler) {
+			owner = arena = new Arena(recycler);
+			cells.resize(num_fields());
+		}
+
 		iterator it = begin();
 		while (MYSQL_ROW row = dbd->fetch_row(res)) {
 			if (const unsigned long* lengths = dbd->fetch_lengths(res)) {
-				*it = Row(row, this, lengths, throw_exceptions());
+				if (arena) {
+					for (size_t i = 0; i < cells.size(); ++i) {
+						cells[i] = row[i] ?
+								arena->copy(row[i], lengths[i]) : 0;
+					}
+					*it = Row(cells.empty() ? row : &cells[0], this,
+							lengths, owner, throw_exceptions());
+				}
+				else if (zero_copy) {
+					*it = Row(row, this, lengths, owner, throw_exceptions());
+				}
+				else {
+					*it = Row(row, this, lengths, throw_exceptions());
+				}
 				++it;
 			}
 		}
 
-		dbd->free_result(res);
+		if (!zero_copy) {
+			dbd->free_result(res);
+		}
 	}
 }
 
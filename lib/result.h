@@ -41,6 +41,11 @@
 
 namespace mysqlpp {
 
+#if !defined(DOXYGEN_IGNORE)
+// Make Doxygen ignore this
+class MYSQLPP_EXPORT ArenaRecycler;
+#endif
+
 
 /// \brief Holds information about the result of queries that don't
 /// return rows.
@@ -228,7 +233,21 @@ public:
 	}
 	
 	/// \brief Fully initialize object
-	StoreQueryResult(MYSQL_RES* result, DBDriver* dbd, bool te = true);
+	///
+	/// \param result the C API result set to read the rows from
+	/// \param dbd the driver it came from
+	/// \param te if true, throw exceptions on errors
+	/// \param zero_copy if true, the rows' values point into the C
+	/// API's own copy of the rows instead of copying them, and the
+	/// C API result set stays alive until the last of those values
+	/// goes away; if false, it's freed before the ctor returns
+	/// \param recycler if given, and \c zero_copy is false, the values
+	/// are copied into one Arena using this recycler, instead of each
+	/// into its own heap block
+	///
+	/// \sa Connection::set_zero_copy(), Connection::set_arena_recycler()
+	StoreQueryResult(MYSQL_RES* result, DBDriver* dbd, bool te = true,
+			bool zero_copy = false, ArenaRecycler* recycler = 0);
 
 	/// \brief Initialize object as a copy of another StoreQueryResult
 	/// object
@@ -0,0 +1,608 @@
+/***********************************************************************
+ resultcache.cpp - Implements the ResultCache class.
+
+ Copyright (c) 2009 by Educational Technology Resources, Inc.
+ Others may also hold copyrights on code in this file.  See the
+ CREDITS.txt file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#define MYSQLPP_NOT_HEADER
+#include "common.h"
+
+#include "resultcache.h"
+
+#include "field.h"
+#include "utility.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace mysqlpp {
+
+namespace {
+
+// A piece of an SQL statement, as far as ResultCache cares
+struct Token
+{
+	enum Kind {
+		word,			///< keyword or unquoted name
+		quoted_name,	///< backtick-quoted name
+		punct			///< any other single character
+	};
+
+	Kind kind;
+	std::string text;	///< words are uppercased, names unquoted
+	std::string name;	///< word as written, or unquoted name
+
+	bool is(char c) const
+	{
+		return kind == punct && text.size() == 1 && text[0] == c;
+	}
+
+	bool is(const char* w) const { return kind == word && text == w; }
+};
+
+
+static bool
+is_word_char(char c)
+{
+	return isalnum(static_cast<unsigned char>(c)) || (c == '_') ||
+			(c == '$');
+}
+
+
+// Break a statement into tokens, dropping whitespace, comments and
+// string literals.
+static void
+tokenize(const char* s, size_t len, std::vector<Token>& tokens)
+{
+	size_t i = 0;
+	while (i < len) {
+		char c = s[i];
+		if (isspace(static_cast<unsigned char>(c))) {
+			++i;
+		}
+		else if ((c == '#') || ((c == '-') && (i + 2 < len) &&
+				(s[i + 1] == '-') &&
+				isspace(static_cast<unsigned char>(s[i + 2])))) {
+			while ((i < len) && (s[i] != '\n')) ++i;
+		}
+		else if ((c == '/') && (i + 1 < len) && (s[i + 1] == '*')) {
+			i += 2;
+			while ((i + 1 < len) && !((s[i] == '*') && (s[i + 1] == '/'))) {
+				++i;
+			}
+			i += 2;
+		}
+		else if ((c == '\'') || (c == '"')) {
+			for (++i; i < len; ++i) {
+				if (s[i] == '\\') {
+					++i;
+				}
+				else if (s[i] == c) {
+					if ((i + 1 < len) && (s[i + 1] == c)) {
+						++i;		// doubled quote
+					}
+					else {
+						break;
+					}
+				}
+			}
+			++i;
+		}
+		else if (c == '`') {
+			Token t;
+			t.kind = Token::quoted_name;
+			for (++i; i < len; ++i) {
+				if (s[i] == '`') {
+					if ((i + 1 < len) && (s[i + 1] == '`')) {
+						++i;		// doubled backtick
+					}
+					else {
+						break;
+					}
+				}
+				t.name += s[i];
+			}
+			++i;
+			t.text = t.name;
+			tokens.push_back(t);
+		}
+		else if (is_word_char(c)) {
+			Token t;
+			t.kind = Token::word;
+			while ((i < len) && is_word_char(s[i])) {
+				t.name += s[i++];
+			}
+			t.text = t.name;
+			for (size_t j = 0; j < t.text.size(); ++j) {
+				t.text[j] = toupper(static_cast<unsigned char>(t.text[j]));
+			}
+			tokens.push_back(t);
+		}
+		else {
+			Token t;
+			t.kind = Token::punct;
+			t.text = c;
+			tokens.push_back(t);
+			++i;
+		}
+	}
+}
+
+
+// Words that may come between a keyword and the table name after it
+static bool
+is_modifier(const Token& t)
+{
+	static const char* modifiers[] = {
+		"DELAYED", "EXISTS", "HIGH_PRIORITY", "IF", "IGNORE", "INTO",
+		"LOW_PRIORITY", "NOT", "ONLY", "QUICK", "TABLE", 0
+	};
+
+	for (const char** m = modifiers; *m; ++m) {
+		if (t.is(*m)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+
+// Words that may follow a table name, so aren't names or aliases
+static bool
+is_keyword(const Token& t)
+{
+	static const char* keywords[] = {
+		"AS", "CHARACTER", "COLUMNS", "CROSS", "DEFAULT", "FIELDS",
+		"FOR", "FORCE", "FULL", "GROUP", "HAVING", "IGNORE", "INNER",
+		"INTO", "JOIN", "LEFT", "LIMIT", "LINES", "LOCK", "NATURAL",
+		"ON", "ORDER", "OUTER", "PARTITION", "PROCEDURE", "RENAME",
+		"RIGHT", "SELECT", "SET", "STRAIGHT_JOIN", "TO", "UNION", "USE",
+		"USING", "VALUE", "VALUES", "WHERE", "WINDOW", "WITH", 0
+	};
+
+	for (const char** k = keywords; *k; ++k) {
+		if (t.is(*k)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+
+static bool
+is_name(const Token& t)
+{
+	return (t.kind == Token::quoted_name) ||
+			((t.kind == Token::word) && !is_keyword(t));
+}
+
+
+// Turn a table name into the form ResultCache indexes by
+static std::string
+normalize(const std::string& name)
+{
+	std::string n(name, name.find('.') == std::string::npos ? 0 :
+			name.rfind('.') + 1);
+	internal::str_to_lwr(n);
+	return n;
+}
+
+
+// Return the index of the token ending the statement that starts at
+// tokens[begin]: the ';' after it, or the end of the tokens
+static size_t
+statement_end(const std::vector<Token>& tokens, size_t begin)
+{
+	while ((begin < tokens.size()) && !tokens[begin].is(';')) {
+		++begin;
+	}
+	return begin;
+}
+
+
+// Return the first word of the statement in tokens[begin, end),
+// uppercased, looking past any opening parentheses
+static std::string
+first_word(const std::vector<Token>& tokens, size_t begin, size_t end)
+{
+	for (size_t i = begin; i < end; ++i) {
+		if (tokens[i].kind == Token::word) {
+			return tokens[i].text;
+		}
+		else if (!tokens[i].is('(')) {
+			break;
+		}
+	}
+	return std::string();
+}
+
+
+// Add the names of the tables the statement in tokens[begin, end)
+// refers to onto the end of tables; see ResultCache::tables()
+static void
+scan_tables(const std::vector<Token>& tokens, size_t begin, size_t end,
+		std::vector<std::string>& tables)
+{
+	for (size_t i = begin; i < end; ++i) {
+		// Find the keywords a table name follows.  INSERT and REPLACE
+		// only count at the start, since INTO is optional after them
+		// and REPLACE is also a function.  UPDATE doesn't count in
+		// ON DUPLICATE KEY UPDATE.  TO and RENAME catch the new names
+		// in RENAME TABLE and ALTER TABLE.
+		const Token& t = tokens[i];
+		if (!(t.is("FROM") || t.is("JOIN") || t.is("INTO") ||
+				t.is("TABLE") || t.is("TRUNCATE") || t.is("RENAME") ||
+				t.is("TO") ||
+				(t.is("UPDATE") && !((i > 0) && tokens[i - 1].is("KEY"))) ||
+				((i == begin) && (t.is("INSERT") || t.is("REPLACE"))))) {
+			continue;
+		}
+
+		// Collect the comma-separated list of names that follows
+		size_t j = i + 1;
+		if (t.is("RENAME") && (j < end) &&
+				(tokens[j].is("AS") || tokens[j].is("TO"))) {
+			++j;
+		}
+		for (;;) {
+			while ((j < end) && is_modifier(tokens[j])) ++j;
+			if ((j >= end) || !is_name(tokens[j])) {
+				break;
+			}
+
+			std::string name = tokens[j++].name;
+			while ((j + 1 < end) && tokens[j].is('.') &&
+					is_name(tokens[j + 1])) {
+				name = tokens[j + 1].name;		// db.table
+				j += 2;
+			}
+			name = normalize(name);
+			if (std::find(tables.begin(), tables.end(), name) ==
+					tables.end()) {
+				tables.push_back(name);
+			}
+
+			// Skip any alias
+			if ((j < end) && tokens[j].is("AS")) {
+				++j;
+			}
+			if ((j < end) && is_name(tokens[j])) {
+				++j;
+			}
+
+			if ((j < end) && tokens[j].is(',')) {
+				++j;
+			}
+			else {
+				break;
+			}
+		}
+		i = j - 1;
+	}
+}
+
+} // end anonymous namespace
+
+
+ResultCache::ResultCache(size_t max_bytes, unsigned int ttl) :
+max_bytes_(max_bytes),
+ttl_(ttl),
+bytes_(0),
+generation_(0),
+flushed_(0),
+hits_(0),
+misses_(0),
+evictions_(0),
+invalidations_(0)
+{
+}
+
+
+size_t
+ResultCache::bytes() const
+{
+	ScopedLock lock(mutex_);
+	return bytes_;
+}
+
+
+bool
+ResultCache::cacheable(const char* stmt, size_t len)
+{
+	std::vector<Token> tokens;
+	tokenize(stmt, len, tokens);
+	const size_t end = statement_end(tokens, 0);
+	if (first_word(tokens, 0, end) != "SELECT") {
+		return false;
+	}
+
+	// Any statement after the first makes it a multi-statement string,
+	// which may change tables; only trailing semicolons are allowed
+	for (size_t i = end; i < tokens.size(); ++i) {
+		if (!tokens[i].is(';')) {
+			return false;
+		}
+	}
+
+	// Exclude SELECTs with side effects, those that lock rows, and
+	// those that ask not to be cached
+	for (size_t i = 0; i < end; ++i) {
+		if (tokens[i].is("INTO") || tokens[i].is("SQL_NO_CACHE") ||
+				(tokens[i].is("FOR") && (i + 1 < end) &&
+				tokens[i + 1].is("UPDATE")) ||
+				(tokens[i].is("LOCK") && (i + 1 < end) &&
+				tokens[i + 1].is("IN"))) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+void
+ResultCache::clear()
+{
+	ScopedLock lock(mutex_);
+	flush();
+}
+
+
+size_t
+ResultCache::entries() const
+{
+	ScopedLock lock(mutex_);
+	return entries_.size();
+}
+
+
+void
+ResultCache::erase(EntryList::iterator it)
+{
+	for (size_t i = 0; i < it->tables.size(); ++i) {
+		std::pair<TableIndex::iterator, TableIndex::iterator> range =
+				by_table_.equal_range(it->tables[i]);
+		for (TableIndex::iterator t = range.first; t != range.second; ++t) {
+			if (t->second == it) {
+				by_table_.erase(t);
+				break;
+			}
+		}
+	}
+
+	by_query_.erase(it->query);
+	bytes_ -= it->bytes;
+	entries_.erase(it);
+}
+
+
+void
+ResultCache::flush()
+{
+	entries_.clear();
+	by_query_.clear();
+	by_table_.clear();
+	bytes_ = 0;
+	flushed_ = ++generation_;
+}
+
+
+unsigned long
+ResultCache::evictions() const
+{
+	ScopedLock lock(mutex_);
+	return evictions_;
+}
+
+
+ResultCache::Result
+ResultCache::find(const std::string& query)
+{
+	ScopedLock lock(mutex_);
+	QueryIndex::iterator it = by_query_.find(query);
+	if (it == by_query_.end()) {
+		++misses_;
+		return Result();
+	}
+
+	EntryList::iterator e = it->second;
+	if (e->expires && (e->expires <= internal::seconds_now())) {
+		erase(e);
+		++evictions_;
+		++misses_;
+		return Result();
+	}
+
+	// Move it to the front, the most recently used end
+	entries_.splice(entries_.begin(), entries_, e);
+	++hits_;
+	return e->result;
+}
+
+
+unsigned long
+ResultCache::hits() const
+{
+	ScopedLock lock(mutex_);
+	return hits_;
+}
+
+
+void
+ResultCache::insert(const Snapshot& before, const StoreQueryResult& result)
+{
+	// Estimate the memory the copy of the result will use
+	const std::string& query = before.query_;
+	size_t bytes = sizeof(Entry) + 2 * query.size() +
+			sizeof(StoreQueryResult) + result.num_fields() * sizeof(Field);
+	for (StoreQueryResult::const_iterator it = result.begin();
+			it != result.end(); ++it) {
+		bytes += sizeof(Row) + it->size() * sizeof(String);
+		for (Row::const_iterator f = it->begin(); f != it->end(); ++f) {
+			bytes += f->length();
+		}
+	}
+	if (bytes > max_bytes_) {
+		return;
+	}
+
+	// Do the slow parts before taking the lock
+	std::vector<std::string> names(before.tables_);
+	Result copy(make_refcounted<Result>(result));
+
+	// Refuse the result if something may have changed it since the
+	// snapshot, as the new value might not be in it
+	ScopedLock lock(mutex_);
+	if (flushed_ > before.generation_) {
+		return;
+	}
+	for (size_t i = 0; i < names.size(); ++i) {
+		GenerationMap::const_iterator g = changed_.find(names[i]);
+		if ((g != changed_.end()) && (g->second > before.generation_)) {
+			return;
+		}
+	}
+
+	QueryIndex::iterator old = by_query_.find(query);
+	if (old != by_query_.end()) {
+		erase(old->second);
+	}
+
+	entries_.push_front(Entry());
+	EntryList::iterator e = entries_.begin();
+	e->query = query;
+	e->result = copy;
+	e->tables.swap(names);
+	e->bytes = bytes;
+	e->expires = ttl_ ? internal::seconds_now() + ttl_ : 0;
+
+	by_query_[query] = e;
+	for (size_t i = 0; i < e->tables.size(); ++i) {
+		by_table_.insert(std::make_pair(e->tables[i], e));
+	}
+	bytes_ += bytes;
+
+	// Push out the least recently used results until we're back under
+	// budget.  The new one fits, so this never removes it.
+	while (bytes_ > max_bytes_) {
+		erase(--entries_.end());
+		++evictions_;
+	}
+}
+
+
+void
+ResultCache::invalidate(const std::string& table)
+{
+	const std::string name(normalize(table));
+	ScopedLock lock(mutex_);
+	changed_[name] = ++generation_;
+
+	std::pair<TableIndex::iterator, TableIndex::iterator> range =
+			by_table_.equal_range(name);
+	std::vector<EntryList::iterator> doomed;
+	for (TableIndex::iterator it = range.first; it != range.second; ++it) {
+		doomed.push_back(it->second);
+	}
+
+	for (size_t i = 0; i < doomed.size(); ++i) {
+		erase(doomed[i]);
+	}
+	invalidations_ += doomed.size();
+}
+
+
+void
+ResultCache::invalidate(const char* stmt, size_t len)
+{
+	std::vector<Token> tokens;
+	tokenize(stmt, len, tokens);
+
+	std::vector<std::string> names;
+	for (size_t begin = 0; begin < tokens.size(); ) {
+		const size_t end = statement_end(tokens, begin);
+		const std::string verb = first_word(tokens, begin, end);
+		if ((verb == "COMMIT") || (verb == "ROLLBACK") ||
+				(verb == "CALL")) {
+			// A transaction's changes only now become visible to other
+			// connections, which may have cached what was there before,
+			// and we can't see what a stored procedure touches
+			ScopedLock lock(mutex_);
+			invalidations_ += entries_.size();
+			flush();
+			return;
+		}
+		else if (verb != "SELECT") {
+			scan_tables(tokens, begin, end, names);
+		}
+		begin = end + 1;
+	}
+
+	for (size_t i = 0; i < names.size(); ++i) {
+		invalidate(names[i]);
+	}
+}
+
+
+unsigned long
+ResultCache::invalidations() const
+{
+	ScopedLock lock(mutex_);
+	return invalidations_;
+}
+
+
+unsigned long
+ResultCache::misses() const
+{
+	ScopedLock lock(mutex_);
+	return misses_;
+}
+
+
+ResultCache::Snapshot
+ResultCache::snapshot(const std::string& query) const
+{
+	Snapshot s;
+	s.query_ = query;
+	tables(query.data(), query.size(), s.tables_);
+
+	ScopedLock lock(mutex_);
+	s.generation_ = generation_;
+	return s;
+}
+
+
+void
+ResultCache::tables(const char* stmt, size_t len,
+		std::vector<std::string>& tables)
+{
+	std::vector<Token> tokens;
+	tokenize(stmt, len, tokens);
+	for (size_t begin = 0; begin < tokens.size(); ) {
+		const size_t end = statement_end(tokens, begin);
+		scan_tables(tokens, begin, end, tables);
+		begin = end + 1;
+	}
+}
+
+} // end namespace mysqlpp
@@ -0,0 +1,263 @@
+/// \file resultcache.h
+/// \brief Declares the ResultCache class, which keeps the results of
+/// repeated SELECT queries on the client side.
+
+/***********************************************************************
+ Copyright (c) 2009 by Educational Technology Resources, Inc.
+ Others may also hold copyrights on code in this file.  See the
+ CREDITS.txt file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#if !defined(MYSQLPP_RESULTCACHE_H)
+#define MYSQLPP_RESULTCACHE_H
+
+#include "common.h"
+
+#include "beemutex.h"
+#include "refcounted.h"
+#include "result.h"
+
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace mysqlpp {
+
+/// \brief Keeps the results of SELECT queries, so repeating one
+/// doesn't have to go to the database server.
+///
+/// Attach a cache to one or more connections with
+/// Connection::set_result_cache().  Query::store() then looks up each
+/// SELECT statement by its exact text before sending it, and keeps the
+/// result of each one it does send.  Every other statement run through
+/// those connections, whether by Query, PreparedQuery, QueryBatch,
+/// AsyncQuery or BulkLoader, drops the cached results of queries that
+/// read from any table it names.  A result read while such a statement
+/// was running isn't kept, since it may predate the change.  To share
+/// a cache among the connections of a ConnectionPool, attach it in
+/// your pool's create() override.
+///
+/// Inside a transaction, Query::store() neither uses nor fills the
+/// cache, since the transaction may see rows no one else can.  Because
+/// the changes a transaction makes only become visible to others when
+/// it ends, \c COMMIT and \c ROLLBACK drop every cached result, as
+/// does \c CALL, since the cache can't see what a stored procedure
+/// changes.
+///
+/// Changes made any other way aren't seen: by other programs, by
+/// connections without the cache, or by triggers acting on tables the
+/// statement doesn't name.  Results also leave the cache when they're
+/// older than the time to live, and the least recently used ones leave
+/// when the cache grows past its byte budget.  Only share a cache
+/// among connections to the same database, since the cache doesn't
+/// know which database a query ran against.
+///
+/// Don't use this for queries whose results change without any table
+/// changing, such as those calling \c NOW() or \c RAND().
+///
+/// The cache is safe to share among threads.  The results it hands
+/// out share their row data with the cached copy, but all the
+/// reference counts involved are changed atomically, so each thread
+/// may copy and destroy its results, and the Rows and Strings taken
+/// from them, without locking.  See the user manual's chapter on
+/// threads for the limits of this.
+
+class MYSQLPP_EXPORT ResultCache
+{
+public:
+	/// \brief A result held in the cache
+	///
+	/// Everyone who looks up the query shares the one result, so treat
+	/// it as read-only.  Copy it if you need to change it.  The result
+	/// and its count share one heap block, made by make_refcounted().
+	typedef RefCountedPointer<StoreQueryResult,
+			RefCountedPointerInPlaceDestroyer<StoreQueryResult>,
+			RefCountedPointerAtomicCounter<StoreQueryResult,
+				RefCountedPointerBlockCounter<StoreQueryResult> > >
+			Result;
+
+	/// \brief What a query's result depends on, noted before the
+	/// query runs
+	///
+	/// insert() compares this against the changes the cache has seen
+	/// since, so it can refuse a result that a concurrent change may
+	/// have made stale before it was stored.
+	class Snapshot
+	{
+	public:
+		/// \brief Create a snapshot of no query
+		Snapshot() : generation_(0) { }
+
+		/// \brief Return the query the snapshot was taken for
+		const std::string& query() const { return query_; }
+
+	private:
+		friend class ResultCache;
+
+		std::string query_;
+		std::vector<std::string> tables_;
+		unsigned long generation_;
+	};
+
+	/// \brief Create an empty cache
+	///
+	/// \param max_bytes the most memory the results may use
+	/// \param ttl how long a result stays usable, in seconds, or 0 to
+	/// keep it until it's pushed out or invalidated
+	ResultCache(size_t max_bytes = 16 * 1024 * 1024,
+			unsigned int ttl = 60);
+
+	/// \brief Return the approximate memory used by the results
+	size_t bytes() const;
+
+	/// \brief Return true if the statement is one whose result can be
+	/// cached: a single SELECT
+	static bool cacheable(const char* stmt, size_t len);
+
+	/// \brief Drop all the results
+	///
+	/// Results read before this call won't be added afterward.
+	void clear();
+
+	/// \brief Return the number of results in the cache
+	size_t entries() const;
+
+	/// \brief Return the number of results dropped to stay under the
+	/// byte budget, or because they outlived the time to live
+	unsigned long evictions() const;
+
+	/// \brief Look up the result of a query
+	///
+	/// \retval a null pointer if it isn't cached
+	Result find(const std::string& query);
+
+	/// \brief Return the number of find() calls that found a result
+	unsigned long hits() const;
+
+	/// \brief Add a query's result to the cache, replacing any older
+	/// one
+	///
+	/// The result isn't kept if any table the query reads from has
+	/// been invalidated since \c before was taken, nor if it's bigger
+	/// than the whole byte budget.
+	///
+	/// \param before a snapshot taken before running the query
+	/// \param result the query's result
+	void insert(const Snapshot& before, const StoreQueryResult& result);
+
+	/// \brief Add a result known to be current to the cache
+	///
+	/// Same as <tt>insert(snapshot(query), result)</tt>.  Use the other
+	/// form for results read before now.
+	void insert(const std::string& query, const StoreQueryResult& result)
+	{
+		insert(snapshot(query), result);
+	}
+
+	/// \brief Drop the results of queries that read from a table
+	///
+	/// Table names are compared without regard to case or any database
+	/// name before them.
+	void invalidate(const std::string& table);
+
+	/// \brief Drop the results of queries that read from any table a
+	/// statement names, unless it's a SELECT
+	///
+	/// Query calls this after running each statement.  Each statement
+	/// of a multi-statement string is treated separately.  \c COMMIT,
+	/// \c ROLLBACK and \c CALL drop everything, since the cache can't
+	/// tell which tables they changed.
+	void invalidate(const char* stmt, size_t len);
+
+	/// \brief Return the number of results dropped because a table they
+	/// read from changed
+	unsigned long invalidations() const;
+
+	/// \brief Return the number of find() calls that found nothing
+	unsigned long misses() const;
+
+	/// \brief Note what a query's result depends on, before running
+	/// the query, for passing to insert() afterward
+	Snapshot snapshot(const std::string& query) const;
+
+	/// \brief Add the names of the tables a statement refers to onto
+	/// the end of \c tables, in the form invalidate() compares them
+	///
+	/// \internal This is a scan for the names following \c FROM,
+	/// \c JOIN, \c INTO, \c UPDATE, \c TABLE, \c RENAME and \c TO,
+	/// not a full SQL parser, so it may find a few names that aren't
+	/// tables.  That only costs some needless invalidations.
+	static void tables(const char* stmt, size_t len,
+			std::vector<std::string>& tables);
+
+private:
+	/// \brief A cached result
+	struct Entry
+	{
+		std::string query;
+		Result result;
+		std::vector<std::string> tables;
+		size_t bytes;
+		double expires;		///< per internal::seconds_now(), or 0
+	};
+
+	typedef std::list<Entry> EntryList;
+	typedef std::map<std::string, EntryList::iterator> QueryIndex;
+	typedef std::multimap<std::string, EntryList::iterator> TableIndex;
+
+	typedef std::map<std::string, unsigned long> GenerationMap;
+
+	/// \brief Remove an entry; caller holds the mutex
+	void erase(EntryList::iterator it);
+
+	/// \brief Remove every entry, and refuse results read before now;
+	/// caller holds the mutex
+	void flush();
+
+	const size_t max_bytes_;
+	const unsigned int ttl_;
+
+	EntryList entries_;			///< most recently used first
+	QueryIndex by_query_;
+	TableIndex by_table_;
+	size_t bytes_;
+
+	/// \brief Count of invalidations, for telling whether a Snapshot
+	/// is still current
+	unsigned long generation_;
+	GenerationMap changed_;		///< generation each table last changed
+	unsigned long flushed_;		///< generation of the last flush()
+
+	unsigned long hits_;
+	unsigned long misses_;
+	unsigned long evictions_;
+	unsigned long invalidations_;
+
+	mutable BeecryptMutex mutex_;
+
+	// Can't copy these
+	ResultCache(const ResultCache&);
+	ResultCache& operator=(const ResultCache&);
+};
+
+} // end namespace mysqlpp
+
+#endif // !defined(MYSQLPP_RESULTCACHE_H)
@@ -36,29 +36,17 @@ Row::Row(MYSQL_ROW row, const ResultBase* res,
 OptionalExceptions(throw_exceptions),
 initialized_(false)
 {
-	if (row) {
-		if (res) {
-			size_type size = res->num_fields();
-			data_.reserve(size);
-			for (size_type i = 0; i < size; ++i) {
-				bool is_null = row[i] == 0;
-				data_.push_back(value_type(
-						is_null ? "NULL" : row[i],
-						is_null ? 4 : lengths[i],
-						res->field_type(int(i)),
-						is_null));
-			}
+	init(row, res, lengths, 0);
+}
 
-			field_names_ = res->field_names();
-			initialized_ = true;
-		}
-		else if (throw_exceptions) {
-			throw ObjectNotInitialized("RES is NULL");
-		}
-	}
-	else if (throw_exceptions) {
-		throw ObjectNotInitialized("ROW is NULL");
-	}
+
+Row::Row(MYSQL_ROW row, const ResultBase* res,
+		const unsigned long* lengths, const RefCountedOwner& owner,
+		bool throw_exceptions) :
+OptionalExceptions(throw_exceptions),
+initialized_(false)
+{
+	init(row, res, lengths, &owner);
 }
 
 
@@ -184,6 +172,49 @@ Row::field_num(const char* name) const
 }
 
 
+void
+Row::init(MYSQL_ROW row, const ResultBase* res,
+		const unsigned long* lengths, const RefCountedOwner* owner)
+{
+	if (row) {
+		if (res) {
+			size_type size = res->num_fields();
+			data_.reserve(size);
+			for (size_type i = 0; i < size; ++i) {
+				bool is_null = row[i] == 0;
+				const char* data = is_null ? "NULL" : row[i];
+				size_type length = is_null ? 4 : lengths[i];
+				if (owner) {
+					data_.push_back(value_type(data, length,
+							res->field_type(int(i)), is_null, *owner));
+				}
+				else {
+					data_.push_back(value_type(data, length,
+							res->field_type(int(i)), is_null));
+				}
+
+				// Mark BLOB values (not TEXT, which shares BLOB_FLAG,
+				// and with a _bin collation shares BINARY_FLAG too) so
+				// they go back to the server as hex literals.
+				const Field& f = res->field(i);
+				if (!is_null && f.blob_type() && f.binary_charset()) {
+					data_.back().set_binary();
+				}
+			}
+
+			field_names_ = res->field_names();
+			initialized_ = true;
+		}
+		else if (throw_exceptions()) {
+			throw ObjectNotInitialized("RES is NULL");
+		}
+	}
+	else if (throw_exceptions()) {
+		throw ObjectNotInitialized("ROW is NULL");
+	}
+}
+
+
 const Row::value_type&
 Row::operator [](const char* field) const
 {
@@ -137,6 +137,21 @@ public:
 	Row(MYSQL_ROW row, const ResultBase* res,
 			const unsigned long* lengths, bool te = true);
 
+	/// \brief Create a row object that points into the C API's row
+	/// data instead of copying it
+	///
+	/// \param row MySQL C API row data
+	/// \param res result set that the row comes from
+	/// \param lengths length of each item in row
+	/// \param owner keeps the row data alive
+	/// \param te if true, throw exceptions on errors
+	///
+	/// \sa String(const char*, size_type, mysql_type_info, bool,
+	/// const RefCountedOwner&)
+	Row(MYSQL_ROW row, const ResultBase* res,
+			const unsigned long* lengths, const RefCountedOwner& owner,
+			bool te = true);
+
 	/// \brief Destroy object
 	~Row() { }
 
@@ -521,6 +536,11 @@ public:
 	}
 
 private:
+	/// \brief Common implementation of the C API row ctors, sharing the
+	/// row data with \c owner if given, else copying it
+	void init(MYSQL_ROW row, const ResultBase* res,
+			const unsigned long* lengths, const RefCountedOwner* owner);
+
 	list_type data_;
 	RefCountedPointer<FieldNames> field_names_;
 	bool initialized_;
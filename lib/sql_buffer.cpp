@@ -40,6 +40,7 @@ SQLBuffer::assign(const char* data, size_type length, mysql_type_info type,
 	replace_buffer(data, length);
 	type_ = type;
 	is_null_ = is_null;
+	is_binary_ = false;
 	return *this;
 }
 
@@ -49,6 +50,7 @@ SQLBuffer::assign(const std::string& s, mysql_type_info type, bool is_null)
 	replace_buffer(s.data(), s.length());
 	type_ = type;
 	is_null_ = is_null;
+	is_binary_ = false;
 	return *this;
 }
 
@@ -67,10 +69,24 @@ SQLBuffer::quote_q() const
 	}
 }
 
+void
+SQLBuffer::release()
+{
+	if (borrowed_) {
+		borrowed_ = false;
+		if (!placed_) {
+			owner_ = 0;
+		}
+	}
+	else if (data_ != inline_) {
+		delete[] data_;
+	}
+}
+
 void
 SQLBuffer::replace_buffer(const char* pd, size_type length)
 {
-	delete[] data_;
+	release();
 	data_ = 0;
 	length_ = 0;
 
@@ -81,7 +97,7 @@ SQLBuffer::replace_buffer(const char* pd, size_type length)
 		// 
 		// We cast away const for pd in case we're on a system that uses
 		// the old definition of memcpy() with non-const 2nd parameter.
-		data_ = new char[length + 1];
+		data_ = length < sizeof(inline_) ? inline_ : new char[length + 1];
 		length_ = length;
 		memcpy(const_cast<char*>(data_), const_cast<char*>(pd), length_);
 		const_cast<char*>(data_)[length_] = '\0';
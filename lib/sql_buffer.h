@@ -31,12 +31,71 @@
 #include "refcounted.h"
 #include "type_info.h"
 
+#include <new>
 #include <string>
 
 namespace mysqlpp {
 
+/// \brief Base class for objects that own memory SQLBuffer can point
+/// into instead of copying it
+///
+/// A SQLBuffer created with an owner keeps a reference to it, so the
+/// owner, and the memory it holds, live until the last such buffer
+/// goes away.  StoreQueryResult uses this to keep the C API's result
+/// set alive when asked not to copy it.
+
+class SQLBufferOwner
+{
+public:
+	/// \brief Create object
+	SQLBufferOwner() : refs_(0) { }
+
+	/// \brief Destroy object, freeing the memory it owns
+	virtual ~SQLBufferOwner() { }
+
+	/// \brief Return memory for a SQLBuffer that will point into this
+	/// object, or 0 to allocate it on the heap
+	///
+	/// The buffer is then destroyed in place, and its memory freed
+	/// along with the owner's.  This is only called while the owner's
+	/// values are being handed out, from the one thread doing that.
+	/// This version returns 0.
+	virtual void* place(size_t /* bytes */) { return 0; }
+
+private:
+	friend struct RefCountedPointerIntrusiveCounter<SQLBufferOwner>;
+
+	size_t refs_;		///< RefCountedOwner's reference count
+
+	// Can't copy these
+	SQLBufferOwner(const SQLBufferOwner&);
+	SQLBufferOwner& operator=(const SQLBufferOwner&);
+};
+
+
+/// \brief Keep SQLBufferOwner's reference count in the object, and change
+/// it atomically
+template <>
+struct RefCountedPointerCounter<SQLBufferOwner> :
+		public RefCountedPointerAtomicCounter<SQLBufferOwner,
+			RefCountedPointerIntrusiveCounter<SQLBufferOwner> >
+{
+};
+
+
+/// \brief Reference-counted version of SQLBufferOwner.
+typedef RefCountedPointer<SQLBufferOwner> RefCountedOwner;
+
+
 /// \brief Holds SQL data in string form plus type information for use
 /// in converting the string to compatible C++ data types.
+///
+/// Most SQL values are short: numbers, flags, dates.  Those up to
+/// inline_size - 1 bytes long are kept inside the object, and the
+/// reference count RefCountedBuffer needs is too, so a String holding
+/// one costs just the one allocation for this object.  A buffer
+/// pointing into an owner may live in the owner's memory too; see
+/// create().
 
 class SQLBuffer
 {
@@ -44,27 +103,72 @@ public:
 	/// \brief Type of length values
 	typedef size_t size_type;
 
+	/// \brief Room for a value inside the object, counting the null
+	/// character we add
+	enum { inline_size = 23 };
+
 	/// \brief Initialize object as a copy of a raw data buffer
 	///
-	/// Copies the string into a new buffer one byte longer than
-	/// the length value given, using that to hold a C string null
+	/// Copies the string into a buffer one byte longer than the
+	/// length value given, using that to hold a C string null
 	/// terminator, just for safety.  The length value we keep does
 	/// not include this extra byte, allowing this same mechanism
-	/// to work for both C strings and binary data.
+	/// to work for both C strings and binary data.  Short values go
+	/// in a buffer inside this object, longer ones on the heap.
 	SQLBuffer(const char* data, size_type length, mysql_type_info type,
 			bool is_null) : data_(), length_(), type_(type),
-			is_null_(is_null)
+			is_null_(is_null), is_binary_(false), borrowed_(false),
+			placed_(false), refs_(0)
 			{ replace_buffer(data, length); }
 
+	/// \brief Initialize object to point into memory owned by another
+	/// object, without copying it
+	///
+	/// The data must stay valid and unchanged for as long as \c owner
+	/// lives.  Like our own copies, it must be followed by a null
+	/// character not counted in \c length.  Any later assign() makes
+	/// a private copy and lets go of the owner.
+	SQLBuffer(const char* data, size_type length, mysql_type_info type,
+			bool is_null, const RefCountedOwner& owner) :
+			data_(data), length_(length), type_(type),
+			is_null_(is_null), is_binary_(false), borrowed_(true),
+			placed_(false), owner_(owner), refs_(0)
+	{
+	}
+
 	/// \brief Initialize object as a copy of a C++ string object
 	SQLBuffer(const std::string& s, mysql_type_info type, bool is_null) :
-			data_(), length_(), type_(type), is_null_(is_null)
+			data_(), length_(), type_(type), is_null_(is_null),
+			is_binary_(false), borrowed_(false), placed_(false),
+			refs_(0)
 	{
 		replace_buffer(s.data(), static_cast<size_type>(s.length()));
 	}
 
 	/// \brief Destructor
-	~SQLBuffer() { delete[] data_; }
+	~SQLBuffer() { release(); }
+
+	/// \brief Create a buffer pointing into memory owned by another
+	/// object, as the ctor taking an owner does, but in memory the
+	/// owner provides if it will
+	///
+	/// This saves a heap allocation per value for owners like Arena,
+	/// which hand out many values at once.  The buffer keeps its
+	/// owner alive even after an assign(), since it lives there.
+	static SQLBuffer* create(const char* data, size_type length,
+			mysql_type_info type, bool is_null,
+			const RefCountedOwner& owner)
+	{
+		if (void* p = owner ? owner->place(sizeof(SQLBuffer)) : 0) {
+			SQLBuffer* b = new (p) SQLBuffer(data, length, type,
+					is_null, owner);
+			b->placed_ = true;
+			return b;
+		}
+		else {
+			return new SQLBuffer(data, length, type, is_null, owner);
+		}
+	}
 
 	/// \brief Replace contents of buffer with copy of given C string
 	SQLBuffer& assign(const char* data, size_type length,
@@ -91,6 +195,14 @@ public:
 	/// easily as a C string.
 	size_type length() const { return length_; }
 
+	/// \brief Returns true if the buffer holds binary data, which
+	/// should be sent to the server as a hex literal instead of a
+	/// quoted and escaped string
+	///
+	/// Set either explicitly, or by Row when it holds data from a
+	/// binary BLOB column.
+	bool is_binary() const { return is_binary_; }
+
 	/// \brief Returns true if type of buffer's contents is string
 	bool is_string() { return type_ == mysql_type_info::string_type; }
 
@@ -106,6 +218,12 @@ public:
 	/// that must be quoted when used in a SQL query
 	bool quote_q() const;
 
+	/// \brief Sets or clears the flag marking the buffer's contents
+	/// as binary data
+	///
+	/// \see is_binary()
+	void set_binary(bool b = true) { is_binary_ = b; }
+
 	/// \brief Sets the internal SQL null flag
 	void set_null() { is_null_ = true; }
 
@@ -113,12 +231,19 @@ public:
 	const mysql_type_info& type() const { return type_; }
 
 private:
+	friend struct RefCountedPointerIntrusiveCounter<SQLBuffer>;
+	friend struct RefCountedPointerDestroyer<SQLBuffer>;
+
 	SQLBuffer(const SQLBuffer&);
 	SQLBuffer& operator=(const SQLBuffer&);
 
 	/// \brief Common initialization for ctors
 	void init(const char* pd, size_type len, mysql_type_info type,
 			bool is_null);
+	/// \brief Free the data buffer if it's ours, else let go of the
+	/// object owning it
+	void release();
+
 	/// \brief Implementation detail of assign() and init()
 	void replace_buffer(const char* pd, size_type length);
 
@@ -126,6 +251,43 @@ private:
 	size_type length_;		///< bytes in buffer, without trailing null
 	mysql_type_info type_;	///< SQL type of data in the buffer
 	bool is_null_;			///< if true, string represents a SQL null
+	bool is_binary_;		///< if true, send as hex literal in queries
+	bool borrowed_;			///< if true, owner_ owns data_
+	bool placed_;			///< if true, we live in owner_'s memory
+	RefCountedOwner owner_;	///< owns data_ or this object, if not 0
+	size_t refs_;			///< RefCountedBuffer's reference count
+	char inline_[inline_size];	///< holds data_, if it's short
+};
+
+
+/// \brief Keep SQLBuffer's reference count in the object, and change
+/// it atomically
+template <>
+struct RefCountedPointerCounter<SQLBuffer> :
+		public RefCountedPointerAtomicCounter<SQLBuffer,
+			RefCountedPointerIntrusiveCounter<SQLBuffer> >
+{
+};
+
+
+/// \brief Destroy a SQLBuffer, in place if SQLBuffer::create()
+/// put it in its owner's memory
+template <>
+struct RefCountedPointerDestroyer<SQLBuffer>
+{
+	/// \brief Functor implementation
+	void operator()(SQLBuffer* doomed) const
+	{
+		if (doomed->placed_) {
+			// Hold on to the owner until the buffer is gone, as its
+			// memory goes with the owner
+			RefCountedOwner home(doomed->owner_);
+			doomed->~SQLBuffer();
+		}
+		else {
+			delete doomed;
+		}
+	}
 };
 
 
@@ -0,0 +1,290 @@
+/***********************************************************************
+ sqlescape.cpp - Implements the vectorized SQL string escaper and
+ 	hex encoder.
+
+ Copyright (c) 2009 by Educational Technology Resources, Inc.
+ Others may also hold copyrights on code in this file.  See the
+ CREDITS.txt file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#include "sqlescape.h"
+
+#include <string.h>
+
+// SSE2 is part of the x86-64 baseline, and can be turned on for 32-bit
+// x86 builds.  AVX2 isn't, so we build that version separately with a
+// function attribute and only use it if the CPU supports it, which
+// requires GCC 4.9+ or Clang.
+#if defined(__SSE2__) || defined(_M_X64) || \
+		(defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#	define MYSQLPP_ESCAPE_SSE2
+#	include <emmintrin.h>
+#	if defined(_MSC_VER)
+#		include <intrin.h>
+#	endif
+#	if (defined(__x86_64__) || defined(__i386__)) && (defined(__clang__) || \
+			(__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 9)))
+#		define MYSQLPP_ESCAPE_AVX2
+#		include <immintrin.h>
+#	endif
+#endif
+
+namespace mysqlpp {
+
+// Return the character to put after the backslash when escaping c, or
+// 0 if c doesn't need escaping.  Mirrors escape_string_for_mysql() in
+// the C API.
+static inline char
+escaped_form(unsigned char c)
+{
+	switch (c) {
+		case 0:			return '0';
+		case '\n':		return 'n';
+		case '\r':		return 'r';
+		case '\\':		return '\\';
+		case '\'':		return '\'';
+		case '"':		return '"';
+		case '\032':	return 'Z';
+		default:		return 0;
+	}
+}
+
+
+// Return the number of bytes at the start of p that can be copied
+// to the output as-is.  If stop_high is set, bytes with the high bit
+// set end the run as well as those needing escaping.
+static size_t
+clean_prefix_scalar(const char* p, size_t n, bool stop_high)
+{
+	for (size_t i = 0; i < n; ++i) {
+		unsigned char c = static_cast<unsigned char>(p[i]);
+		if ((c & 0x80) ? stop_high : ((c <= '\\') && escaped_form(c))) {
+			return i;
+		}
+	}
+	return n;
+}
+
+
+#if defined(MYSQLPP_ESCAPE_SSE2)
+// Return the index of the lowest set bit in a nonzero mask
+static inline size_t
+first_set(unsigned int mask)
+{
+#	if defined(_MSC_VER)
+	unsigned long i;
+	_BitScanForward(&i, mask);
+	return i;
+#	else
+	return __builtin_ctz(mask);
+#	endif
+}
+
+
+static size_t
+clean_prefix_sse2(const char* p, size_t n, bool stop_high)
+{
+	const __m128i nul = _mm_setzero_si128();
+	const __m128i lf = _mm_set1_epi8('\n');
+	const __m128i cr = _mm_set1_epi8('\r');
+	const __m128i bs = _mm_set1_epi8('\\');
+	const __m128i sq = _mm_set1_epi8('\'');
+	const __m128i dq = _mm_set1_epi8('"');
+	const __m128i cz = _mm_set1_epi8('\032');
+
+	size_t i = 0;
+	for (/* */; i + 16 <= n; i += 16) {
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+		__m128i hit = _mm_or_si128(
+				_mm_or_si128(
+					_mm_or_si128(_mm_cmpeq_epi8(v, nul), _mm_cmpeq_epi8(v, lf)),
+					_mm_or_si128(_mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, bs))),
+				_mm_or_si128(
+					_mm_or_si128(_mm_cmpeq_epi8(v, sq), _mm_cmpeq_epi8(v, dq)),
+					_mm_cmpeq_epi8(v, cz)));
+		unsigned int mask = _mm_movemask_epi8(hit);
+		if (stop_high) {
+			mask |= _mm_movemask_epi8(v);
+		}
+		if (mask) {
+			return i + first_set(mask);
+		}
+	}
+
+	return i + clean_prefix_scalar(p + i, n - i, stop_high);
+}
+#endif // defined(MYSQLPP_ESCAPE_SSE2)
+
+
+#if defined(MYSQLPP_ESCAPE_AVX2)
+__attribute__((target("avx2")))
+static size_t
+clean_prefix_avx2(const char* p, size_t n, bool stop_high)
+{
+	const __m256i nul = _mm256_setzero_si256();
+	const __m256i lf = _mm256_set1_epi8('\n');
+	const __m256i cr = _mm256_set1_epi8('\r');
+	const __m256i bs = _mm256_set1_epi8('\\');
+	const __m256i sq = _mm256_set1_epi8('\'');
+	const __m256i dq = _mm256_set1_epi8('"');
+	const __m256i cz = _mm256_set1_epi8('\032');
+
+	size_t i = 0;
+	for (/* */; i + 32 <= n; i += 32) {
+		__m256i v = _mm256_loadu_si256(
+				reinterpret_cast<const __m256i*>(p + i));
+		__m256i hit = _mm256_or_si256(
+				_mm256_or_si256(
+					_mm256_or_si256(_mm256_cmpeq_epi8(v, nul),
+						_mm256_cmpeq_epi8(v, lf)),
+					_mm256_or_si256(_mm256_cmpeq_epi8(v, cr),
+						_mm256_cmpeq_epi8(v, bs))),
+				_mm256_or_si256(
+					_mm256_or_si256(_mm256_cmpeq_epi8(v, sq),
+						_mm256_cmpeq_epi8(v, dq)),
+					_mm256_cmpeq_epi8(v, cz)));
+		unsigned int mask = static_cast<unsigned int>(
+				_mm256_movemask_epi8(hit));
+		if (stop_high) {
+			mask |= static_cast<unsigned int>(_mm256_movemask_epi8(v));
+		}
+		if (mask) {
+			return i + first_set(mask);
+		}
+	}
+
+	// Finish up with the 16-byte version, which handles the last few
+	// bytes itself.
+	return i + clean_prefix_sse2(p + i, n - i, stop_high);
+}
+#endif // defined(MYSQLPP_ESCAPE_AVX2)
+
+
+typedef size_t (*CleanPrefixFunc)(const char*, size_t, bool);
+
+// Pick the fastest scanner this CPU supports
+static CleanPrefixFunc
+choose_clean_prefix()
+{
+#if defined(MYSQLPP_ESCAPE_AVX2)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		return clean_prefix_avx2;
+	}
+#endif
+#if defined(MYSQLPP_ESCAPE_SSE2)
+	return clean_prefix_sse2;
+#else
+	return clean_prefix_scalar;
+#endif
+}
+
+// Chosen once, at static initialization time.  escape_sql() falls back
+// to the scalar version if it's called by some other module's static
+// initializers before this one is set.
+static const CleanPrefixFunc clean_prefix = choose_clean_prefix();
+
+
+size_t
+escape_sql(char* to, const char* from, size_t length, EscapeRunFunc high,
+		void* ctx)
+{
+	CleanPrefixFunc scan = clean_prefix ? clean_prefix : clean_prefix_scalar;
+	char* const start = to;
+	const char* const end = from + length;
+
+	while (from < end) {
+		// Copy everything up to the next byte needing attention
+		size_t n = scan(from, size_t(end - from), high != 0);
+		memcpy(to, from, n);
+		to += n;
+		from += n;
+		if (from == end) {
+			break;
+		}
+
+		if (*from & 0x80) {
+			// Start of a run of non-ASCII bytes in a multibyte character
+			// set.  Let the C API deal with it, since it knows how to
+			// treat invalid sequences.  The run must end at an ASCII
+			// byte, which can't be part of a valid multibyte character
+			// in the character sets we're used with, so cutting it off
+			// there doesn't change how the C API treats it.
+			const char* run = from;
+			while ((from < end) && (*from & 0x80)) {
+				++from;
+			}
+			to += high(ctx, to, run, size_t(from - run));
+		}
+		else {
+			*to++ = '\\';
+			*to++ = escaped_form(static_cast<unsigned char>(*from++));
+		}
+	}
+
+	*to = '\0';
+	return size_t(to - start);
+}
+
+
+static const char hex_digits[] = "0123456789ABCDEF";
+
+size_t
+hex_encode(char* to, const char* from, size_t length)
+{
+	size_t i = 0;
+
+#if defined(MYSQLPP_ESCAPE_SSE2)
+	// Split each byte into its two nibbles, turn each nibble into an
+	// ASCII digit by adding '0', plus 7 more for A-F, then interleave
+	// the high and low digits back into byte order.  There's no AVX2
+	// version because unpacking works within 128-bit lanes, so it
+	// would need extra shuffling for little gain: this is already
+	// bound by memory bandwidth on long buffers.
+	const __m128i lo_mask = _mm_set1_epi8(0x0F);
+	const __m128i nine = _mm_set1_epi8(9);
+	const __m128i seven = _mm_set1_epi8(7);
+	const __m128i zero = _mm_set1_epi8('0');
+	for (/* */; i + 16 <= length; i += 16) {
+		__m128i v = _mm_loadu_si128(
+				reinterpret_cast<const __m128i*>(from + i));
+		__m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), lo_mask);
+		__m128i lo = _mm_and_si128(v, lo_mask);
+		hi = _mm_add_epi8(_mm_add_epi8(hi, zero),
+				_mm_and_si128(_mm_cmpgt_epi8(hi, nine), seven));
+		lo = _mm_add_epi8(_mm_add_epi8(lo, zero),
+				_mm_and_si128(_mm_cmpgt_epi8(lo, nine), seven));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(to + i * 2),
+				_mm_unpacklo_epi8(hi, lo));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(to + i * 2 + 16),
+				_mm_unpackhi_epi8(hi, lo));
+	}
+#endif
+
+	for (/* */; i < length; ++i) {
+		unsigned char c = static_cast<unsigned char>(from[i]);
+		to[i * 2] = hex_digits[c >> 4];
+		to[i * 2 + 1] = hex_digits[c & 0x0F];
+	}
+
+	return length * 2;
+}
+
+} // end namespace mysqlpp
@@ -0,0 +1,94 @@
+/// \file sqlescape.h
+/// \brief Declares the vectorized SQL string escaping and hex
+/// encoding routines used by DBDriver and QueryBuffer.
+///
+/// These are only intended to be used within the library.  End-user
+/// code should call DBDriver::escape_string() or one of the higher
+/// level escaping mechanisms instead.
+
+/***********************************************************************
+ Copyright (c) 2009 by Educational Technology Resources, Inc.
+ Others may also hold copyrights on code in this file.  See the
+ CREDITS.txt file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#if !defined(MYSQLPP_SQLESCAPE_H)
+#define MYSQLPP_SQLESCAPE_H
+
+#include <stddef.h>
+
+namespace mysqlpp {
+
+/// \brief Type of the function escape_sql() hands runs of non-ASCII
+/// bytes to
+///
+/// It must behave like \c mysql_real_escape_string(): write the
+/// escaped form of \c length bytes at \c from to \c to, null-terminate
+/// it, and return the escaped length.  \c ctx is passed through from
+/// the escape_sql() call.
+typedef size_t (*EscapeRunFunc)(void* ctx, char* to, const char* from,
+		size_t length);
+
+/// \brief SQL-escape a character buffer the way the MySQL C API does
+/// when backslash escapes are in effect
+///
+/// Scans the input 16 or 32 bytes at a time, using SSE2 or AVX2 if the
+/// compiler and CPU support them, and copies runs of bytes that need
+/// no escaping in bulk.  The seven ASCII characters the C API escapes
+/// (NUL, LF, CR, backslash, single and double quote, and Ctrl-Z) are
+/// escaped with a backslash, exactly as the C API would.
+///
+/// This is only byte-for-byte equivalent to the C API for character
+/// sets in which every byte below 0x80 stands for its ASCII character,
+/// never part of a multibyte one: the single-byte sets such as
+/// \c latin1 and \c binary, and the UTF-8 family.
+///
+/// \param to buffer to hold the escaped version; must point to at
+/// least (length * 2 + 1) bytes
+/// \param from the buffer to escape
+/// \param length the number of bytes in \c from
+/// \param high if not 0, each run of bytes with the high bit set is
+/// handed to this function rather than being copied as-is; pass the C
+/// API for multibyte character sets, so it can apply its handling of
+/// invalid sequences
+/// \param ctx passed to \c high
+///
+/// \retval number of characters placed in \c to, not counting the
+/// null terminator
+size_t escape_sql(char* to, const char* from, size_t length,
+		EscapeRunFunc high = 0, void* ctx = 0);
+
+/// \brief Encode a buffer as uppercase hexadecimal digits
+///
+/// Converts 16 bytes at a time using SSE2 where the compiler supports
+/// it.  The output is always exactly twice the input's length and is
+/// not null-terminated.
+///
+/// \param to buffer to hold the hex digits; must point to at least
+/// (length * 2) bytes
+/// \param from the bytes to encode
+/// \param length the number of bytes in \c from
+///
+/// \retval number of characters placed in \c to
+size_t hex_encode(char* to, const char* from, size_t length);
+
+} // end namespace mysqlpp
+
+#endif // !defined(MYSQLPP_SQLESCAPE_H)
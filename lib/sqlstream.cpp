@@ -33,9 +33,16 @@
 namespace mysqlpp {
 
 SQLStream::SQLStream(Connection* c, const char* pstr) :
-std::ostringstream(),
+#if defined(MYSQLPP_HAVE_STD__NOINIT)
+// prevents a double-init memory leak in native VC++ RTL (not STLport!)
+std::ostream(std::_Noinit),
+#else
+std::ostream(0),
+#endif
 conn_(c)
 {
+	init(&buffer_);
+	register_stream(*this);
 	if (pstr != 0) {
 		str(pstr);
 	}
@@ -43,9 +50,28 @@ conn_(c)
 
 
 SQLStream::SQLStream(const SQLStream& s) :
-std::ostringstream(s.str()),
+// std::ios is a virtual base, so we name it here to keep -Wextra happy;
+// its default ctor leaves the setup to std::ostream's, as above
+std::ios(),
+#if defined(MYSQLPP_HAVE_STD__NOINIT)
+// ditto above
+std::ostream(std::_Noinit),
+#else
+std::ostream(0),
+#endif
 conn_(s.conn_)
 {
+	init(&buffer_);
+	register_stream(*this);
+	str(s.str());
+}
+
+
+size_t
+SQLStream::append_escaped(const char* original, size_t length)
+{
+	return buffer_.append_escaped(original, length,
+			conn_ && *conn_ ? conn_->driver() : 0);
 }
 
 
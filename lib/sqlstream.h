@@ -28,8 +28,10 @@
 #define MYSQLPP_SQLSTREAM_H
 
 #include "common.h"
+#include "qbuffer.h"
 
-#include <sstream>
+#include <ostream>
+#include <string>
 
 namespace mysqlpp {
 
@@ -40,10 +42,16 @@ class MYSQLPP_EXPORT Connection;
 
 /// \brief A class for building SQL-formatted strings.
 ///
+/// This works like \c std::ostringstream, except that the text is kept
+/// in a QueryBuffer, which you can get at through buffer() to append
+/// values without going through the IOStreams layer, or to use the
+/// result without copying it.
+///
 /// See the user manual for more details about these options.
 
 class MYSQLPP_EXPORT SQLStream :
-public std::ostringstream
+public std::ostream,
+public EscapingStream
 {
 public:
 	/// \brief Create a new stream object attached to a connection.
@@ -57,6 +65,12 @@ public:
 	/// This is a traditional copy ctor.
 	SQLStream(const SQLStream& s);
 
+	/// \brief Append a SQL-escaped copy of a character buffer to the
+	/// stream
+	///
+	/// \see Query::append_escaped(const char*, size_t)
+	size_t append_escaped(const char* original, size_t length);
+
 	/// \brief Return a SQL-escaped version of a character buffer
 	///
 	/// \param ps pointer to C++ string to hold escaped version; if
@@ -101,8 +115,24 @@ public:
 	/// \brief Assigns contents of another SQLStream to this one
 	SQLStream& operator=(const SQLStream& rhs);
 
+	/// \brief Return the buffer holding the text built so far
+	QueryBuffer& buffer() { return buffer_; }
+
+	/// \brief Return the buffer holding the text built so far
+	const QueryBuffer& buffer() const { return buffer_; }
+
+	/// \brief Return a copy of the text built so far
+	std::string str() const { return buffer_.str(); }
+
+	/// \brief Replace the stream's contents with a copy of \c s
+	void str(const std::string& s) { buffer_.str(s); }
+
 	/// \brief Connection to send queries through
 	Connection* conn_;
+
+private:
+	/// \brief Holds the text built so far
+	QueryBuffer buffer_;
 };
 
 
@@ -71,6 +71,7 @@ print OUT << "---";
 #	error Your compiler is not compatible with the SSQLS feature!
 #endif
 
+#include <bitset>
 #include <string>
 
 #include <math.h>
@@ -294,6 +295,7 @@ foreach my $i (1..$max_data_members) {
 	my $cusparms22 = "";
 	my $cusparmsv = "";
 	my $defs = "";
+	my $dirty_bools = "";
 	my $enums = "";
 	my $equal_list = "";
 	my $field_list = "";
@@ -306,6 +308,7 @@ foreach my $i (1..$max_data_members) {
 	my $parm_simple2c_b = "";
 	my $parm_simple_b = "";
 	my $popul = "";
+	my $setters = "";
 	my $value_list = "";
 	my $value_list_cus = "";
 
@@ -324,6 +327,12 @@ foreach my $i (1..$max_data_members) {
 		$defs  .= "    T$j I$j;";
 		$defs  .= "\n" unless $j == $i;
 
+		$setters .= "    void set_##I$j(const T$j& p) { I$j = p; dirty_.set(".($j-1)."); }";
+		$setters .= "\n" unless $j == $i;
+
+		$dirty_bools .= "dirty_[".($j-1)."]";
+		$dirty_bools .= ", " unless $j == $i;
+
 		$popul .= "    s->I$j = row[N$j].conv(T$j());";
 		$popul .= "\n" unless $j == $i;
 
@@ -521,6 +530,18 @@ $defs
 	NAME##_equal_list<mysqlpp::quote_type0> equal_list(const char* d = ",",
 			const char* c = " = ") const
 			{ return equal_list(d, c, mysqlpp::quote); }
+
+	/* dirty field tracking; update() finds the row by the key fields */
+	enum { key_fields = CMP };
+
+$setters
+	bool dirty() const { return dirty_.any(); }
+	bool dirty(NAME##_enum i) const { return dirty_.test(i); }
+	void set_dirty(NAME##_enum i, bool d = true) { dirty_.set(i, d); }
+	void clear_dirty() { dirty_.reset(); }
+	NAME##_cus_equal_list<mysqlpp::quote_type0> dirty_list(const char* d = ",",
+			const char* c = " = ") const
+			{ return equal_list(d, c, mysqlpp::quote, $dirty_bools); }
 	template <class Manip>
 	NAME##_equal_list<Manip> equal_list(const char* d, const char* c, Manip m) const;
 
@@ -646,6 +667,7 @@ $defs
 	private:
 	static const char* table_;
 	const char* table_override_;
+	std::bitset<$i> dirty_;
 	};
 	MYSQLPP_SSQLS_CONDITIONAL_STATICS(
 		const char* NAME::names[] = {
@@ -858,6 +880,7 @@ $popul
 	inline void NAME::set(const mysqlpp::Row& row)
 	{
 		table_override_ = 0;
+		dirty_.reset();
 		populate_##NAME<mysqlpp::sql_dummy>(this, row);
 	}
 
@@ -76,6 +76,7 @@ buffer_(new SQLBuffer(
 		str.is_null ? typeid(void) : typeid(str.data), str.is_null)),
 is_processed_(processed)
 {
+	buffer_->set_binary(!str.is_null && str.data.is_binary());
 }
 #endif
 
@@ -257,6 +257,12 @@ public:
 	/// that must be escaped when used in a SQL query
 	bool escape_q() const;
 
+	/// \brief Return true if buffer's contents are binary data,
+	/// to be sent as a hex literal when quoted
+	///
+	/// \see String::is_binary()
+	bool is_binary() const { return buffer_ && buffer_->is_binary(); }
+
 	/// \brief Return true if buffer's contents represent a SQL
 	/// null.
 	///
@@ -119,3 +119,87 @@ Transaction::rollback()
 }
 
 
+
+//// XATransaction /////////////////////////////////////////////////////
+
+XATransaction::XATransaction(Connection& conn, const std::string& xid) :
+conn_(conn),
+xid_(xid),
+state_(finished)	// don't bother rolling it back if ctor fails
+{
+	if (exec("START")) {
+		state_ = active;
+	}
+}
+
+
+XATransaction::~XATransaction()
+{
+	if (state_ != finished) {
+		try {
+			rollback();
+		}
+		catch (...) {
+			// eat all exceptions
+		}
+	}
+}
+
+
+void
+XATransaction::commit()
+{
+	if (state_ == active) {
+		exec("END");
+		state_ = ended;
+	}
+	if (state_ == ended) {
+		exec("COMMIT", " ONE PHASE");
+	}
+	else {
+		exec("COMMIT");
+	}
+	state_ = finished;
+}
+
+
+bool
+XATransaction::exec(const char* verb, const char* suffix)
+{
+	Query q(conn_.query("XA "));
+	q << verb << ' ' << quote << xid_ << suffix;
+	return q.exec();
+}
+
+
+bool
+XATransaction::prepare()
+{
+	if (state_ != active) {
+		return state_ == prepared;
+	}
+
+	// Once the transaction has ended, it can only be prepared or
+	// rolled back, so if END succeeds and PREPARE fails, rollback()
+	// has to skip the END.
+	if (!exec("END")) {
+		return false;
+	}
+	state_ = ended;
+	if (!exec("PREPARE")) {
+		return false;
+	}
+	state_ = prepared;
+	return true;
+}
+
+
+void
+XATransaction::rollback()
+{
+	if (state_ == active) {
+		exec("END");
+	}
+	exec("ROLLBACK");
+	state_ = finished;
+}
@@ -34,6 +34,8 @@
 
 #include "common.h"
 
+#include <string>
+
 namespace mysqlpp {
 
 #if !defined(DOXYGEN_IGNORE)
@@ -124,6 +126,75 @@ private:
 };
 
 
+/// \brief Helper object for creating exception-safe XA transactions,
+/// which can be committed in two phases.
+///
+/// Use this in place of Transaction when the work on one connection
+/// must only be committed if work on other connections also
+/// succeeds.  Do the work, call prepare() on each connection's
+/// XATransaction, and then call commit() on all of them only if all
+/// the prepare() calls succeeded; otherwise, call rollback().  Once
+/// prepare() succeeds, the server guarantees that commit() can
+/// succeed, even across a server crash.  See ParallelInsert for a
+/// user.
+///
+/// A prepared transaction that is neither committed nor rolled back,
+/// say because the program died, stays in the server until someone
+/// finishes it.  <tt>XA RECOVER</tt> lists them.
+
+class MYSQLPP_EXPORT XATransaction
+{
+public:
+	/// \brief Constructor
+	///
+	/// Starts an XA transaction.
+	///
+	/// \param conn The connection we use to manage the transaction
+	/// \param xid The transaction's ID, which must be unique among
+	/// the server's XA transactions
+	XATransaction(Connection& conn, const std::string& xid);
+
+	/// \brief Destructor
+	///
+	/// Rolls back the transaction if it hasn't been committed or
+	/// rolled back yet, for the same reason Transaction's does.
+	~XATransaction();
+
+	/// \brief Commits the transaction
+	///
+	/// If prepare() hasn't been called, this commits in one phase.
+	void commit();
+
+	/// \brief Ends the transaction's work and prepares it for commit
+	///
+	/// \retval true if the server is now ready to commit it.  If not,
+	/// and the connection doesn't throw exceptions, call rollback().
+	bool prepare();
+
+	/// \brief Rolls back the transaction
+	void rollback();
+
+	/// \brief Return the transaction's ID
+	const std::string& xid() const { return xid_; }
+
+private:
+	/// \brief Run one XA statement naming our transaction
+	bool exec(const char* verb, const char* suffix = "");
+
+	/// \brief Where the transaction is in its life
+	enum State {
+		active,		///< started, and statements can be added
+		ended,		///< no more statements can be added
+		prepared,	///< ended and prepared
+		finished	///< committed or rolled back
+	};
+
+	Connection& conn_;	///! Connection to send queries through
+	std::string xid_;	///! Transaction ID
+	State state_;		///! Where we are
+};
+
+
 /// \brief Compile-time substitute for Transaction, which purposely
 /// does nothing.  Use it to instantiate templates that take Transaction
 /// when you don't want transactions to be used.
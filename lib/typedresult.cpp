@@ -0,0 +1,575 @@
+/***********************************************************************
+ typedresult.cpp - Implements the TypedValue, TypedRow and TypedResult
+ 	classes.
+
+ Copyright (c) 2009 by Educational Technology Resources, Inc.  Others
+ may also hold copyrights on code in this file.  See the CREDITS.txt
+ file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#define MYSQLPP_NOT_HEADER
+#include "common.h"
+
+#include "typedresult.h"
+
+#include "dbdriver.h"
+#include "exceptions.h"
+#include "field_names.h"
+
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <typeinfo>
+
+#include <string.h>
+
+namespace mysqlpp {
+
+namespace {
+	// Receives one column's value from DBDriver::stmt_fetch()
+	struct FetchBuffer
+	{
+		TypedValue::kind_type kind;
+		mysql_type_info type;
+		union {
+			longlong i;
+			double d;
+		} number;
+		MYSQL_TIME time;
+		std::vector<char> text;
+		unsigned long length;
+		bind_bool is_null;
+		bind_bool error;
+	};
+
+	// Range checks for TypedValue::number().  Each returns true if the
+	// value fits in Type without overflow.
+	template <class Type>
+	bool
+	fits_signed(longlong i)
+	{
+		typedef std::numeric_limits<Type> limits;
+		if (!limits::is_integer) {
+			return true;
+		}
+		else if (!limits::is_signed) {
+			return (i >= 0) && (static_cast<ulonglong>(i) <=
+					static_cast<ulonglong>(limits::max()));
+		}
+		else {
+			return (i >= static_cast<longlong>(limits::min())) &&
+					(i <= static_cast<longlong>(limits::max()));
+		}
+	}
+
+	template <class Type>
+	bool
+	fits_unsigned(ulonglong u)
+	{
+		typedef std::numeric_limits<Type> limits;
+		return !limits::is_integer ||
+				(u <= static_cast<ulonglong>(limits::max()));
+	}
+
+	template <class Type>
+	bool
+	fits_real(double d)
+	{
+		typedef std::numeric_limits<Type> limits;
+		if (limits::is_integer) {
+			// max() isn't exact as a double for 64-bit types, but
+			// max() / 2 + 1, a power of 2, is.  The comparisons are
+			// false for NaN.
+			const double end = (double(limits::max() / 2) + 1) * 2;
+			return (d >= double(limits::min())) && (d < end);
+		}
+		else {
+			// Infinities and NaN carry over to float, but finite
+			// values too big for it are undefined
+			return (d != d) || (d == d * 2) ||
+					((d >= -double(limits::max())) &&
+					(d <= double(limits::max())));
+		}
+	}
+}
+
+
+TypedValue::TypedValue(const MYSQL_TIME& t)
+{
+	switch (t.time_type) {
+		case MYSQL_TIMESTAMP_DATE:	kind_ = tv_date; break;
+		case MYSQL_TIMESTAMP_TIME:	kind_ = tv_time; break;
+		default:					kind_ = tv_datetime; break;
+	}
+
+	value_.t.year = static_cast<unsigned short>(t.year);
+	value_.t.month = static_cast<unsigned char>(t.month);
+	value_.t.day = static_cast<unsigned char>(t.day);
+	value_.t.hour = t.hour;
+	value_.t.minute = static_cast<unsigned char>(t.minute);
+	value_.t.second = static_cast<unsigned char>(t.second);
+	value_.t.neg = t.neg;
+}
+
+
+void
+TypedValue::bad_conversion(const char* type_name) const
+{
+	std::string s(str());
+	throw BadConversion(type_name, s.c_str(), 0, s.length());
+}
+
+
+template <class Type>
+Type
+TypedValue::number(const char* type_name) const
+{
+	switch (kind_) {
+		case tv_signed:
+			if (!fits_signed<Type>(value_.i)) {
+				bad_conversion(type_name);
+			}
+			return static_cast<Type>(value_.i);
+
+		case tv_unsigned:
+			if (!fits_unsigned<Type>(static_cast<ulonglong>(value_.i))) {
+				bad_conversion(type_name);
+			}
+			return static_cast<Type>(static_cast<ulonglong>(value_.i));
+
+		case tv_real: {
+			if (!fits_real<Type>(value_.d)) {
+				bad_conversion(type_name);
+			}
+
+			// Match String: a value with a fractional part can't go
+			// into an integer.  (Type(0.5) is nonzero only for
+			// floating-point types.)
+			Type v = static_cast<Type>(value_.d);
+			if ((static_cast<Type>(0.5) == 0) && (double(v) != value_.d)) {
+				bad_conversion(type_name);
+			}
+			return v;
+		}
+
+		case tv_text:
+			return text_.conv(Type());
+
+		default:
+			bad_conversion(type_name);
+			return Type();
+	}
+}
+
+
+#define MYSQLPP_TV_GET_NUMBER(T) \
+	void TypedValue::get(T& v) const { v = number<T>(typeid(T).name()); }
+
+MYSQLPP_TV_GET_NUMBER(signed char)
+MYSQLPP_TV_GET_NUMBER(unsigned char)
+MYSQLPP_TV_GET_NUMBER(short int)
+MYSQLPP_TV_GET_NUMBER(unsigned short int)
+MYSQLPP_TV_GET_NUMBER(int)
+MYSQLPP_TV_GET_NUMBER(unsigned int)
+MYSQLPP_TV_GET_NUMBER(long int)
+MYSQLPP_TV_GET_NUMBER(unsigned long int)
+MYSQLPP_TV_GET_NUMBER(longlong)
+MYSQLPP_TV_GET_NUMBER(ulonglong)
+MYSQLPP_TV_GET_NUMBER(float)
+MYSQLPP_TV_GET_NUMBER(double)
+
+#undef MYSQLPP_TV_GET_NUMBER
+
+
+void
+TypedValue::get(bool& v) const
+{
+	v = number<longlong>(typeid(bool).name()) != 0;
+}
+
+
+void
+TypedValue::get(Date& v) const
+{
+	switch (kind_) {
+		case tv_date:
+		case tv_datetime:
+			v = Date(value_.t.year, value_.t.month, value_.t.day);
+			break;
+
+		case tv_text:
+			v = Date(text_);
+			break;
+
+		default:
+			bad_conversion(typeid(Date).name());
+	}
+}
+
+
+void
+TypedValue::get(DateTime& v) const
+{
+	switch (kind_) {
+		case tv_date:
+		case tv_datetime:
+			v = DateTime(value_.t.year, value_.t.month, value_.t.day,
+					static_cast<unsigned char>(value_.t.hour),
+					value_.t.minute, value_.t.second);
+			break;
+
+		case tv_text:
+			v = DateTime(text_);
+			break;
+
+		default:
+			bad_conversion(typeid(DateTime).name());
+	}
+}
+
+
+void
+TypedValue::get(Time& v) const
+{
+	switch (kind_) {
+		case tv_time:
+		case tv_datetime:
+			// Time can't hold TIME values outside 0-255 hours, nor
+			// negative ones
+			if (value_.t.neg || (value_.t.hour > 255)) {
+				bad_conversion(typeid(Time).name());
+			}
+			v = Time(static_cast<unsigned char>(value_.t.hour),
+					value_.t.minute, value_.t.second);
+			break;
+
+		case tv_text:
+			v = Time(text_);
+			break;
+
+		default:
+			bad_conversion(typeid(Time).name());
+	}
+}
+
+
+std::string
+TypedValue::str() const
+{
+	std::ostringstream os;
+	os.imbue(std::locale::classic());
+
+	switch (kind_) {
+		case tv_null:
+			return "NULL";
+
+		case tv_signed:
+			os << value_.i;
+			break;
+
+		case tv_unsigned:
+			os << static_cast<ulonglong>(value_.i);
+			break;
+
+		case tv_real:
+			os << std::setprecision(17) << value_.d;
+			break;
+
+		case tv_date:
+			os << conv(Date());
+			break;
+
+		case tv_datetime:
+			os << conv(DateTime());
+			break;
+
+		case tv_time:
+			os << (value_.t.neg ? "-" : "") << std::setfill('0') <<
+					std::setw(2) << value_.t.hour << ':' <<
+					std::setw(2) << int(value_.t.minute) << ':' <<
+					std::setw(2) << int(value_.t.second);
+			break;
+
+		case tv_text:
+			return std::string(text_.data(), text_.length());
+	}
+
+	return os.str();
+}
+
+
+String
+TypedValue::text() const
+{
+	if (kind_ == tv_text) {
+		return text_;
+	}
+	else {
+		return String(str(), mysql_type_info::string_type, is_null());
+	}
+}
+
+
+std::ostream&
+operator <<(std::ostream& o, const TypedValue& in)
+{
+	if (in.kind() == TypedValue::tv_text) {
+		return o << in.text();
+	}
+	else {
+		return o << in.str();
+	}
+}
+
+
+TypedRow::TypedRow(list_type& values, const ResultBase* res, bool te) :
+OptionalExceptions(te),
+initialized_(false)
+{
+	if (res) {
+		data_.swap(values);
+		field_names_ = res->field_names();
+		initialized_ = true;
+	}
+	else if (te) {
+		throw ObjectNotInitialized("RES is NULL");
+	}
+}
+
+
+TypedRow::const_reference
+TypedRow::at(size_type i) const
+{
+	if (i < size()) {
+		return data_[i];
+	}
+	else {
+		throw BadIndex("TypedRow", int(i), int(size()));
+	}
+}
+
+
+TypedRow::size_type
+TypedRow::field_num(const char* name) const
+{
+	if (field_names_) {
+		return (*field_names_)[name];
+	}
+	else if (throw_exceptions()) {
+		throw BadFieldName(name);
+	}
+	else {
+		return 0;
+	}
+}
+
+
+TypedRow::const_reference
+TypedRow::operator [](const char* field) const
+{
+	size_type si = field_num(field);
+	if (si < size()) {
+		return at(si);
+	}
+	else if (throw_exceptions()) {
+		throw BadFieldName(field);
+	}
+	else {
+		static value_type empty;
+		return empty;
+	}
+}
+
+
+TypedResult::TypedResult(MYSQL_STMT* stmt, MYSQL_RES* meta,
+		DBDriver* dbd, bool te) :
+ResultBase(meta, dbd, te),
+copacetic_(stmt && meta && dbd)
+{
+	if (!copacetic_) {
+		if (meta && dbd) {
+			dbd->free_result(meta);
+		}
+		return;
+	}
+
+	// Set up a receiving buffer for each column.  The C API converts
+	// all integer types to 64 bits and FLOAT to double for us, so we
+	// need only a few buffer types.  Text buffers are sized from the
+	// max_length the C API computed while buffering the result set.
+	const size_t nf = num_fields();
+	std::vector<FetchBuffer> bufs(nf);
+	std::vector<MYSQL_BIND> binds(nf);
+	for (size_t i = 0; i < nf; ++i) {
+		const MYSQL_FIELD* pf = dbd->fetch_field(meta, i);
+		FetchBuffer& fb = bufs[i];
+		MYSQL_BIND& b = binds[i];
+		memset(&b, 0, sizeof(b));
+		b.is_null = &fb.is_null;
+		b.error = &fb.error;
+		b.length = &fb.length;
+		fb.type = field_type(int(i));
+
+		switch (pf->type) {
+			case MYSQL_TYPE_TINY:
+			case MYSQL_TYPE_SHORT:
+			case MYSQL_TYPE_INT24:
+			case MYSQL_TYPE_LONG:
+			case MYSQL_TYPE_LONGLONG:
+			case MYSQL_TYPE_YEAR:
+				b.is_unsigned = (pf->flags & UNSIGNED_FLAG) != 0;
+				fb.kind = b.is_unsigned ? TypedValue::tv_unsigned :
+						TypedValue::tv_signed;
+				b.buffer_type = MYSQL_TYPE_LONGLONG;
+				b.buffer = &fb.number.i;
+				break;
+
+			case MYSQL_TYPE_FLOAT:
+			case MYSQL_TYPE_DOUBLE:
+				fb.kind = TypedValue::tv_real;
+				b.buffer_type = MYSQL_TYPE_DOUBLE;
+				b.buffer = &fb.number.d;
+				break;
+
+			case MYSQL_TYPE_DATE:
+			case MYSQL_TYPE_NEWDATE:
+				fb.kind = TypedValue::tv_date;
+				b.buffer_type = MYSQL_TYPE_DATE;
+				b.buffer = &fb.time;
+				break;
+
+			case MYSQL_TYPE_DATETIME:
+			case MYSQL_TYPE_TIMESTAMP:
+				fb.kind = TypedValue::tv_datetime;
+				b.buffer_type = MYSQL_TYPE_DATETIME;
+				b.buffer = &fb.time;
+				break;
+
+			case MYSQL_TYPE_TIME:
+				fb.kind = TypedValue::tv_time;
+				b.buffer_type = MYSQL_TYPE_TIME;
+				b.buffer = &fb.time;
+				break;
+
+			case MYSQL_TYPE_NULL:
+				fb.kind = TypedValue::tv_null;
+				b.buffer_type = MYSQL_TYPE_NULL;
+				break;
+
+			default:
+				fb.kind = TypedValue::tv_text;
+				fb.text.resize(pf->max_length + 1);
+				b.buffer_type = MYSQL_TYPE_STRING;
+				b.buffer = &fb.text[0];
+				b.buffer_length = static_cast<unsigned long>(fb.text.size());
+				break;
+		}
+	}
+
+	int rc = 1;
+	if ((nf == 0) || dbd->stmt_bind_result(stmt, &binds[0])) {
+		reserve(dbd->stmt_num_rows(stmt));
+		TypedRow::list_type values;
+		while ((rc = dbd->stmt_fetch(stmt)) == 0 ||
+				rc == MYSQL_DATA_TRUNCATED) {
+			values.reserve(nf);
+			for (size_t i = 0; i < nf; ++i) {
+				const FetchBuffer& fb = bufs[i];
+				if (fb.is_null) {
+					values.push_back(TypedValue());
+					continue;
+				}
+
+				switch (fb.kind) {
+					case TypedValue::tv_signed:
+						values.push_back(TypedValue(fb.number.i));
+						break;
+
+					case TypedValue::tv_unsigned:
+						values.push_back(TypedValue(fb.number.i, true));
+						break;
+
+					case TypedValue::tv_real:
+						values.push_back(TypedValue(fb.number.d));
+						break;
+
+					case TypedValue::tv_date:
+					case TypedValue::tv_datetime:
+					case TypedValue::tv_time:
+						values.push_back(TypedValue(fb.time));
+						break;
+
+					case TypedValue::tv_text:
+						if (fb.length < fb.text.size()) {
+							values.push_back(TypedValue(&fb.text[0],
+									fb.length, fb.type));
+						}
+						else {
+							// Didn't fit; fetch it again into a buffer
+							// big enough to hold it.
+							std::vector<char> big(fb.length + 1);
+							unsigned long len = 0;
+							MYSQL_BIND b = binds[i];
+							b.buffer = &big[0];
+							b.buffer_length = fb.length + 1;
+							b.length = &len;
+							dbd->stmt_fetch_column(stmt, &b, i);
+							values.push_back(TypedValue(&big[0],
+									fb.length, fb.type));
+						}
+						break;
+
+					default:
+						values.push_back(TypedValue());
+						break;
+				}
+			}
+
+			push_back(TypedRow(values, this, throw_exceptions()));
+		}
+	}
+
+	// Grab any error info before freeing the result, which clears it
+	copacetic_ = rc == MYSQL_NO_DATA;
+	std::string err(copacetic_ ? "" : dbd->stmt_error(stmt));
+	int errnum = copacetic_ ? 0 : dbd->stmt_errno(stmt);
+
+	dbd->stmt_free_result(stmt);
+	dbd->free_result(meta);
+
+	if (!copacetic_ && throw_exceptions()) {
+		throw BadQuery(err, errnum);
+	}
+}
+
+
+TypedResult&
+TypedResult::copy(const TypedResult& other)
+{
+	if (this != &other) {
+		ResultBase::copy(other);
+		assign(other.begin(), other.end());
+		copacetic_ = other.copacetic_;
+	}
+
+	return *this;
+}
+
+} // end namespace mysqlpp
@@ -0,0 +1,415 @@
+/// \file typedresult.h
+/// \brief Declares classes for holding result sets fetched through
+/// the binary protocol used by prepared statements.
+
+/***********************************************************************
+ Copyright (c) 2009 by Educational Technology Resources, Inc.  Others
+ may also hold copyrights on code in this file.  See the CREDITS.txt
+ file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#if !defined(MYSQLPP_TYPEDRESULT_H)
+#define MYSQLPP_TYPEDRESULT_H
+
+#include "common.h"
+
+#include "datetime.h"
+#include "mystring.h"
+#include "noexceptions.h"
+#include "null.h"
+#include "refcounted.h"
+#include "result.h"
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace mysqlpp {
+
+#if !defined(DOXYGEN_IGNORE)
+// Make Doxygen ignore this
+class FieldNames;
+#endif
+
+/// \brief Holds one column value from a row fetched with the binary
+/// protocol.
+///
+/// Where String holds every value as text and converts it on request,
+/// this class holds integers, floating-point values and dates and
+/// times in native form, as the C API decoded them.  Converting one of
+/// these to a C++ type is just a cast.  Only DECIMAL, character and
+/// binary columns are kept as text, in a String, and converted as
+/// String would.
+///
+/// The conversion operators mirror those of String, so code written
+/// against Row can use TypedRow with few or no changes.  As with
+/// String, converting a SQL null to anything but a Null<T> throws
+/// BadConversion; use is_null() or Null<T> if the column can be null.
+class MYSQLPP_EXPORT TypedValue
+{
+public:
+	/// \brief The form in which the value is held
+	enum kind_type {
+		tv_null,		///< SQL null
+		tv_signed,		///< signed integer, any width
+		tv_unsigned,	///< unsigned integer, any width
+		tv_real,		///< FLOAT or DOUBLE
+		tv_date,		///< DATE
+		tv_datetime,	///< DATETIME or TIMESTAMP
+		tv_time,		///< TIME
+		tv_text			///< everything else, held as a String
+	};
+
+	/// \brief Create a SQL null value
+	TypedValue() :
+	kind_(tv_null)
+	{
+		value_.i = 0;
+	}
+
+	/// \brief Create an integer value
+	explicit TypedValue(longlong i, bool is_unsigned = false) :
+	kind_(is_unsigned ? tv_unsigned : tv_signed)
+	{
+		value_.i = i;
+	}
+
+	/// \brief Create a floating-point value
+	explicit TypedValue(double d) :
+	kind_(tv_real)
+	{
+		value_.d = d;
+	}
+
+	/// \brief Create a temporal value from the C API's structure
+	///
+	/// The \c time_type member of t decides whether this is a date,
+	/// a time, or a date and time.
+	explicit TypedValue(const MYSQL_TIME& t);
+
+	/// \brief Create a value held as text
+	///
+	/// \param data the value's bytes; copied
+	/// \param length number of bytes in data
+	/// \param type SQL type of the column the value came from
+	TypedValue(const char* data, size_t length,
+			mysql_type_info type = mysql_type_info::string_type) :
+	kind_(tv_text),
+	text_(data, static_cast<String::size_type>(length), type)
+	{
+		value_.i = 0;
+	}
+
+	/// \brief Convert the value to the given C++ type
+	///
+	/// Supports the same types String::conv() does, plus std::string
+	/// and String.
+	///
+	/// \throw BadConversion if the value is SQL null, or if it can't
+	/// be represented in the requested type
+	template <class Type>
+	Type conv(Type) const
+	{
+		Type v;
+		get(v);
+		return v;
+	}
+
+	/// \brief Overload of conv() for types wrapped with Null<>
+	template <class T, class B>
+	Null<T, B> conv(Null<T, B>) const
+	{
+		if (is_null()) {
+			return Null<T, B>(null);
+		}
+		else {
+			return Null<T, B>(conv(T()));
+		}
+	}
+
+	/// \brief Returns true if the value is a SQL null
+	bool is_null() const { return kind_ == tv_null; }
+
+	/// \brief Returns the form in which the value is held
+	kind_type kind() const { return kind_; }
+
+	/// \brief Returns the value as text, formatting it if needed
+	///
+	/// A SQL null comes out as "NULL", as with String.
+	std::string str() const;
+
+	/// \brief Returns the value as a String
+	///
+	/// Free for text values; others are formatted as by str().
+	String text() const;
+
+	operator signed char() const
+			{ return conv(static_cast<signed char>(0)); }
+	operator unsigned char() const
+			{ return conv(static_cast<unsigned char>(0)); }
+	operator int() const
+			{ return conv(static_cast<int>(0)); }
+	operator unsigned int() const
+			{ return conv(static_cast<unsigned int>(0)); }
+	operator short int() const
+			{ return conv(static_cast<short int>(0)); }
+	operator unsigned short int() const
+			{ return conv(static_cast<unsigned short int>(0)); }
+	operator long int() const
+			{ return conv(static_cast<long int>(0)); }
+	operator unsigned long int() const
+			{ return conv(static_cast<unsigned long int>(0)); }
+#if !defined(NO_LONG_LONGS)
+	operator longlong() const
+			{ return conv(static_cast<longlong>(0)); }
+	operator ulonglong() const
+			{ return conv(static_cast<ulonglong>(0)); }
+#endif
+	operator float() const
+			{ return conv(static_cast<float>(0)); }
+	operator double() const
+			{ return conv(static_cast<double>(0)); }
+	operator bool() const
+			{ return conv(false); }
+	operator Date() const { return conv(Date()); }
+	operator DateTime() const { return conv(DateTime()); }
+	operator Time() const { return conv(Time()); }
+	operator std::string() const { return str(); }
+
+	/// \brief Converts the value to a nullable data type
+	template <class T, class B>
+	operator Null<T, B>() const { return conv(Null<T, B>()); }
+
+private:
+	/// \brief Conversion implementations for conv()
+	void get(signed char& v) const;
+	void get(unsigned char& v) const;
+	void get(short int& v) const;
+	void get(unsigned short int& v) const;
+	void get(int& v) const;
+	void get(unsigned int& v) const;
+	void get(long int& v) const;
+	void get(unsigned long int& v) const;
+	void get(longlong& v) const;
+	void get(ulonglong& v) const;
+	void get(float& v) const;
+	void get(double& v) const;
+	void get(bool& v) const;
+	void get(Date& v) const;
+	void get(DateTime& v) const;
+	void get(Time& v) const;
+	void get(std::string& v) const { v = str(); }
+	void get(String& v) const { v = text(); }
+
+	/// \brief Common implementation of the numeric get() overloads
+	template <class Type>
+	Type number(const char* type_name) const;
+
+	/// \brief Throws BadConversion for a conversion to the named type
+	void bad_conversion(const char* type_name) const;
+
+	kind_type kind_;
+	union {
+		longlong i;			///< tv_signed and tv_unsigned values
+		double d;			///< tv_real values
+		struct {
+			unsigned short year;
+			unsigned char month;
+			unsigned char day;
+			unsigned int hour;	///< TIME values can exceed 24 hours
+			unsigned char minute;
+			unsigned char second;
+			bool neg;
+		} t;				///< tv_date, tv_datetime and tv_time values
+	} value_;
+	String text_;			///< tv_text values
+};
+
+/// \brief Inserts a TypedValue into a C++ stream in its text form
+MYSQLPP_EXPORT std::ostream& operator <<(std::ostream& o,
+		const TypedValue& in);
+
+
+/// \brief A row from a result set fetched with the binary protocol.
+///
+/// This offers the read-only container interface of Row, with
+/// TypedValue in place of String.
+class MYSQLPP_EXPORT TypedRow : public OptionalExceptions
+{
+private:
+	/// \brief Pointer to bool data member, for use by safe bool
+	/// conversion operator.
+	///
+	/// \see http://www.artima.com/cppsource/safebool.html
+	typedef bool TypedRow::*private_bool_type;
+
+public:
+	typedef std::vector<TypedValue> list_type;	///< type of our data
+	typedef list_type::const_iterator const_iterator;	///< iterator
+	typedef list_type::const_reference const_reference;	///< reference
+	typedef list_type::const_reverse_iterator const_reverse_iterator;
+	typedef list_type::difference_type difference_type;
+	typedef const_iterator iterator;	///< Row is read-only, too
+	typedef const_reference reference;	///< same as const_reference
+	typedef const_reverse_iterator reverse_iterator;
+	typedef list_type::size_type size_type;		///< size of container
+	typedef list_type::value_type value_type;	///< TypedValue
+
+	/// \brief Default constructor
+	TypedRow() :
+	initialized_(false)
+	{
+	}
+
+	/// \brief Create a row from a list of values
+	///
+	/// \param values column values, in result set order; the contents
+	/// are taken over by the new row, leaving \c values empty
+	/// \param res result set the row belongs to
+	/// \param te if true, throw exceptions on errors
+	TypedRow(list_type& values, const ResultBase* res, bool te = true);
+
+	/// \brief Get a const reference to the field given its index
+	///
+	/// \throw mysqlpp::BadIndex if the row doesn't have that many
+	/// fields
+	const_reference at(size_type i) const;
+
+	/// \brief Get a reference to the last element of the vector
+	const_reference back() const { return data_.back(); }
+
+	/// \brief Return a const iterator pointing to first element
+	const_iterator begin() const { return data_.begin(); }
+
+	/// \brief Returns true if container is empty
+	bool empty() const { return data_.empty(); }
+
+	/// \brief Return a const iterator pointing past the last element
+	const_iterator end() const { return data_.end(); }
+
+	/// \brief Returns a field's index given its name
+	size_type field_num(const char* name) const;
+
+	/// \brief Get a reference to the first element of the vector
+	const_reference front() const { return data_.front(); }
+
+	/// \brief Get the value with the given field name
+	///
+	/// \see Row::operator[](const char*)
+	const_reference operator [](const char* field) const;
+
+	/// \brief Get the value with the given index
+	///
+	/// As with Row, the parameter must be \c int, not \c size_type,
+	/// else row[0] is ambiguous.
+	const_reference operator [](int i) const
+			{ return at(static_cast<size_type>(i)); }
+
+	/// \brief Returns true if row object was fully initialized and
+	/// has data.
+	operator private_bool_type() const
+	{
+		return data_.size() && initialized_ ? &TypedRow::initialized_ : 0;
+	}
+
+	/// \brief Return reverse iterator pointing to first element
+	const_reverse_iterator rbegin() const { return data_.rbegin(); }
+
+	/// \brief Return reverse iterator pointing past the last element
+	const_reverse_iterator rend() const { return data_.rend(); }
+
+	/// \brief Get the number of fields in the row.
+	size_type size() const { return data_.size(); }
+
+private:
+	list_type data_;
+	RefCountedPointer<FieldNames> field_names_;
+	bool initialized_;
+};
+
+
+/// \brief Result set from a prepared statement, with values decoded
+/// into native C++ types.
+///
+/// This is the binary protocol counterpart to StoreQueryResult; get
+/// one from PreparedQuery::store().  All rows are read into memory at
+/// once, and each column value is converted from the wire format just
+/// once, by the C API, instead of on each access through String.
+class MYSQLPP_EXPORT TypedResult :
+		public ResultBase,
+		public std::vector<TypedRow>
+{
+private:
+	/// \brief Pointer to bool data member, for use by safe bool
+	/// conversion operator.
+	typedef bool TypedResult::*private_bool_type;
+
+public:
+	typedef std::vector<TypedRow> list_type;	///< type of vector base
+
+	/// \brief Default constructor
+	TypedResult() :
+	ResultBase(),
+	copacetic_(false)
+	{
+	}
+
+	/// \brief Fetch all rows of an executed prepared statement
+	///
+	/// \param stmt statement, executed and with its result set
+	/// already buffered by DBDriver::stmt_store_result()
+	/// \param meta result set metadata for stmt; this object frees it
+	/// \param dbd driver for the connection stmt belongs to
+	/// \param te if true, throw exceptions on errors
+	TypedResult(MYSQL_STMT* stmt, MYSQL_RES* meta, DBDriver* dbd,
+			bool te = true);
+
+	/// \brief Initialize object as a copy of another TypedResult
+	TypedResult(const TypedResult& other) :
+	ResultBase(),
+	std::vector<TypedRow>(),
+	copacetic_(false)
+	{
+		copy(other);
+	}
+
+	/// \brief Returns the number of rows in this result set
+	list_type::size_type num_rows() const { return size(); }
+
+	/// \brief Copy another TypedResult object's data into this object
+	TypedResult& operator =(const TypedResult& rhs)
+			{ return this != &rhs ? copy(rhs) : *this; }
+
+	/// \brief Test whether the query that created this result succeeded
+	operator private_bool_type() const
+	{
+		return copacetic_ ? &TypedResult::copacetic_ : 0;
+	}
+
+private:
+	/// \brief Copy another TypedResult object's contents into this one
+	TypedResult& copy(const TypedResult& other);
+
+	bool copacetic_;	///< true if initialized from a good result set
+};
+
+} // end namespace mysqlpp
+
+#endif // !defined(MYSQLPP_TYPEDRESULT_H)
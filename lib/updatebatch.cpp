@@ -0,0 +1,174 @@
+/***********************************************************************
+ updatebatch.cpp - Implements the UpdateBatch class.
+
+ Copyright (c) 2009 by Educational Technology Resources, Inc.
+ Others may also hold copyrights on code in this file.  See the
+ CREDITS.txt file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#define MYSQLPP_NOT_HEADER
+#include "common.h"
+
+#include "updatebatch.h"
+
+#include "utility.h"
+
+#include <algorithm>
+
+namespace mysqlpp {
+
+// The fixed pieces of the statement, and their lengths
+static const char update_text[] = "UPDATE `";
+static const char set_text[] = "` SET ";
+static const char case_text[] = " = CASE";
+static const char when_text[] = " WHEN ";
+static const char equals_text[] = " = (";
+static const char then_text[] = ") THEN ";
+static const char else_text[] = " ELSE ";
+static const char end_text[] = " END";
+static const char where_text[] = " WHERE ";
+static const char in_text[] = " IN (";
+
+#define TEXT_LEN(t) (sizeof(t) - 1)
+
+
+UpdateBatch::UpdateBatch(const std::string& table,
+		const std::string& fields, const std::string& keys,
+		const std::string* update) :
+table_(table),
+key_expr_('(' + keys + ')')
+{
+	std::vector<std::string> all, key_names, wanted;
+	internal::split_field_list(fields, all);
+	internal::split_field_list(keys, key_names);
+	if (update) {
+		internal::split_field_list(*update, wanted);
+	}
+
+	for (size_t i = 0; i < all.size(); ++i) {
+		bool set = update ?
+				std::find(wanted.begin(), wanted.end(), all[i]) !=
+					wanted.end() :
+				std::find(key_names.begin(), key_names.end(), all[i]) ==
+					key_names.end();
+		if (set) {
+			columns_.push_back(all[i]);
+			masks_.push_back(std::vector<bool>(all.size(), false));
+			masks_.back()[i] = true;
+		}
+	}
+
+	cases_.resize(columns_.size());
+	clear();
+}
+
+
+void
+UpdateBatch::add(const std::string& key,
+		const std::vector<std::string>& values)
+{
+	size_ += row_size(key, values);
+	if (rows_++ == 0) {
+		--size_;	// no comma before the first key in the IN list
+	}
+	else {
+		in_list_ += ',';
+	}
+
+	for (size_t i = 0; i < columns_.size(); ++i) {
+		cases_[i] += when_text;
+		cases_[i] += key_expr_;
+		cases_[i] += equals_text;
+		cases_[i] += key;
+		cases_[i] += then_text;
+		cases_[i] += values[i];
+	}
+
+	in_list_ += '(';
+	in_list_ += key;
+	in_list_ += ')';
+}
+
+
+void
+UpdateBatch::clear()
+{
+	for (size_t i = 0; i < cases_.size(); ++i) {
+		cases_[i].clear();
+	}
+	in_list_.clear();
+	rows_ = 0;
+
+	// Size of the statement with no rows in it
+	size_ = TEXT_LEN(update_text) + table_.size() + TEXT_LEN(set_text) +
+			TEXT_LEN(where_text) + key_expr_.size() + TEXT_LEN(in_text) +
+			1;
+	for (size_t i = 0; i < columns_.size(); ++i) {
+		size_ += (i ? 1 : 0) + columns_[i].size() * 2 +
+				TEXT_LEN(case_text) + TEXT_LEN(else_text) +
+				TEXT_LEN(end_text);
+	}
+}
+
+
+size_t
+UpdateBatch::row_size(const std::string& key,
+		const std::vector<std::string>& values) const
+{
+	// A WHEN clause for each column, and a comma and the parenthesized
+	// key in the IN list
+	size_t size = 1 + key.size() + 2;
+	for (size_t i = 0; i < columns_.size(); ++i) {
+		size += TEXT_LEN(when_text) + key_expr_.size() +
+				TEXT_LEN(equals_text) + key.size() + TEXT_LEN(then_text) +
+				values[i].size();
+	}
+	return size;
+}
+
+
+std::string
+UpdateBatch::str() const
+{
+	std::string s;
+	s.reserve(size_);
+	s += update_text;
+	s += table_;
+	s += set_text;
+	for (size_t i = 0; i < columns_.size(); ++i) {
+		if (i) {
+			s += ',';
+		}
+		s += columns_[i];
+		s += case_text;
+		s += cases_[i];
+		s += else_text;
+		s += columns_[i];
+		s += end_text;
+	}
+	s += where_text;
+	s += key_expr_;
+	s += in_text;
+	s += in_list_;
+	s += ')';
+	return s;
+}
+
+} // end namespace mysqlpp
@@ -0,0 +1,102 @@
+/// \file updatebatch.h
+/// \brief Declares the UpdateBatch class, which builds the multi-row
+/// UPDATE statements Query::updatefrom() sends.
+
+/***********************************************************************
+ Copyright (c) 2009 by Educational Technology Resources, Inc.
+ Others may also hold copyrights on code in this file.  See the
+ CREDITS.txt file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#if !defined(MYSQLPP_UPDATEBATCH_H)
+#define MYSQLPP_UPDATEBATCH_H
+
+#include "common.h"
+
+#include <string>
+#include <vector>
+
+namespace mysqlpp {
+
+/// \brief Builds an UPDATE statement setting columns of many rows at
+/// once, with one \c CASE expression per column.
+///
+/// \internal Query::updatefrom() turns each row's key and column
+/// values into SQL text and hands them to add(), asking row_size() and
+/// size() first so the insert policy can decide when to send what has
+/// been built up.  All the string assembly lives here, out of the
+/// template code.
+
+class MYSQLPP_EXPORT UpdateBatch
+{
+public:
+	/// \brief Create an empty batch
+	///
+	/// \param table the table to update
+	/// \param fields all the SSQLS's fields, as field_list() writes them
+	/// \param keys the key fields, the same way
+	/// \param update the fields to set the same way, or 0 for all the
+	/// non-key fields.  Names not in \c fields are ignored.
+	UpdateBatch(const std::string& table, const std::string& fields,
+			const std::string& keys, const std::string* update);
+
+	/// \brief Add a row to the statement
+	///
+	/// \param key the row's key values, comma-separated
+	/// \param values the row's value for each column, in column order
+	void add(const std::string& key, const std::vector<std::string>& values);
+
+	/// \brief Remove all the rows, leaving the batch empty
+	void clear();
+
+	/// \brief Return the number of columns the statement sets
+	size_t columns() const { return columns_.size(); }
+
+	/// \brief Returns true if no rows have been added
+	bool empty() const { return rows_ == 0; }
+
+	/// \brief Return the field mask selecting column \c i, for the
+	/// SSQLS's value_list()
+	std::vector<bool>* mask(size_t i) { return &masks_[i]; }
+
+	/// \brief Return how much add() would grow the statement by
+	size_t row_size(const std::string& key,
+			const std::vector<std::string>& values) const;
+
+	/// \brief Return the size of the statement, or 0 if it's empty
+	size_t size() const { return rows_ ? size_ : 0; }
+
+	/// \brief Return the statement
+	std::string str() const;
+
+private:
+	std::string table_;			///< table being updated
+	std::string key_expr_;		///< parenthesized key field names
+	std::vector<std::string> columns_;	///< names of columns to set
+	std::vector<std::vector<bool> > masks_;	///< field masks for columns_
+	std::vector<std::string> cases_;	///< each column's WHEN clauses
+	std::string in_list_;		///< keys for the WHERE clause
+	size_t rows_;				///< number of rows added
+	size_t size_;				///< size of str() once rows_ > 0
+};
+
+} // end namespace mysqlpp
+
+#endif // !defined(MYSQLPP_UPDATEBATCH_H)
@@ -23,10 +23,88 @@
  USA
 ***********************************************************************/
 
+#define MYSQLPP_NOT_HEADER
+#include "common.h"
+
 #include "utility.h"
 
+#include "connection.h"
+#include "exceptions.h"
+#include "noexceptions.h"
+#include "query.h"
+
+#include <time.h>
+#if !defined(MYSQLPP_PLATFORM_WINDOWS)
+#	include <sys/time.h>
+#endif
+
 namespace mysqlpp {
 	namespace internal {
+		size_t max_allowed_packet(Connection* conn)
+		{
+			// The server's default in MySQL 5.5 and older
+			const size_t default_max_packet = 1024 * 1024;
+
+			if (conn && conn->connected()) {
+				// Callers only want a number to size their batches by,
+				// so failures mean the default, not an exception.
+				Query q(conn->query("SELECT @@max_allowed_packet"));
+				NoExceptions ne(q);
+				StoreQueryResult res = q.store();
+				if (res && res.num_rows() && !res[0][0].is_null()) {
+					try {
+						size_t n = size_t(ulonglong(res[0][0]));
+						if (n > 0) {
+							return n;
+						}
+					}
+					catch (const BadConversion&) {
+					}
+				}
+			}
+			return default_max_packet;
+		}
+
+		double seconds_now()
+		{
+#if defined(MYSQLPP_PLATFORM_WINDOWS)
+			LARGE_INTEGER freq, now;
+			QueryPerformanceFrequency(&freq);
+			QueryPerformanceCounter(&now);
+			return double(now.QuadPart) / double(freq.QuadPart);
+#elif defined(CLOCK_MONOTONIC)
+			struct timespec ts;
+			clock_gettime(CLOCK_MONOTONIC, &ts);
+			return ts.tv_sec + ts.tv_nsec / 1e9;
+#else
+			struct timeval tv;
+			gettimeofday(&tv, 0);
+			return tv.tv_sec + tv.tv_usec / 1e6;
+#endif
+		}
+
+		void split_field_list(const std::string& fields,
+				std::vector<std::string>& names)
+		{
+			names.clear();
+			size_t i = 0;
+			while ((i = fields.find('`', i)) != std::string::npos) {
+				size_t end = i + 1;
+				while (((end = fields.find('`', end)) !=
+						std::string::npos) &&
+						(end + 1 < fields.size()) &&
+						(fields[end + 1] == '`')) {
+					end += 2;
+				}
+				if (end == std::string::npos) {
+					break;		// unterminated name, so not from an SSQLS
+				}
+
+				names.push_back(fields.substr(i, end - i + 1));
+				i = end + 1;
+			}
+		}
+
 		void str_to_lwr(std::string& s)
 		{
 			std::string::iterator it;
@@ -36,10 +36,38 @@
 #include <cctype>
 #include <cstring>
 #include <string>
+#include <vector>
 
 namespace mysqlpp {
+	#if !defined(DOXYGEN_IGNORE)
+	// Make Doxygen ignore this
+	class MYSQLPP_EXPORT Connection;
+	#endif
+
 	/// \brief Namespace for holding things used only within MySQL++
 	namespace internal {
+		/// \brief Ask the server for its \c max_allowed_packet setting
+		///
+		/// Returns the server's default, 1 MB, if \c conn is 0 or the
+		/// query fails.
+		size_t MYSQLPP_EXPORT max_allowed_packet(Connection* conn);
+
+		/// \brief Return the time in seconds from an arbitrary fixed
+		/// point, for measuring intervals
+		///
+		/// Uses a monotonic clock where the system has one, so the
+		/// intervals aren't upset by changes to the system time.
+		double MYSQLPP_EXPORT seconds_now();
+
+		/// \brief Split a comma-separated list of backtick-quoted
+		/// column names, as an SSQLS's field_list() writes, into
+		/// its names
+		///
+		/// The names keep their backticks.  Doubled backticks within
+		/// a name are allowed.
+		void MYSQLPP_EXPORT split_field_list(const std::string& fields,
+				std::vector<std::string>& names);
+
 		/// \brief Lowercase a C++ string in place
 		void MYSQLPP_EXPORT str_to_lwr(std::string& s);
 
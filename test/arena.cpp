@@ -0,0 +1,195 @@
+/***********************************************************************
+ test/arena.cpp - Tests the way Arena parcels out its blocks, and that
+	ArenaRecycler hands the same blocks back out.
+
+ Copyright (c) 2009 by Educational Technology Resources, Inc.
+ Others may also hold copyrights on code in this file.  See the
+ CREDITS.txt file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#include <mysql++.h>
+
+#include <cstring>
+#include <iostream>
+#include <string>
+
+using namespace mysqlpp;
+using namespace std;
+
+
+static bool
+test_bump()
+{
+	ArenaRecycler recycler(64, 0);
+	Arena arena(&recycler);
+
+	// Values packed end to end, each with its null character
+	char* a = arena.copy("Nuts", 4);
+	char* b = arena.copy("Bolts", 5);
+	if ((b != a + 5) || (strcmp(a, "Nuts") != 0) ||
+			(strcmp(b, "Bolts") != 0) || (arena.blocks() != 1)) {
+		cerr << "Arena didn't pack values into one block!" << endl;
+		return false;
+	}
+
+	// Anything over a quarter block gets a block of its own, without
+	// disturbing the current one
+	const char big[] = "0123456789abcdefghij";
+	char* c = arena.copy(big, sizeof(big) - 1);
+	char* d = arena.allocate(1);
+	if ((strcmp(c, big) != 0) || (d != b + 6) || (arena.blocks() != 2)) {
+		cerr << "Arena mishandled an oversized value!" << endl;
+		return false;
+	}
+
+	// Filling the block starts another
+	for (int i = 0; i < 10; ++i) {
+		arena.allocate(10);
+	}
+	if (arena.blocks() != 3) {
+		cerr << "Arena has " << arena.blocks() << " blocks, not 3!" <<
+				endl;
+		return false;
+	}
+
+	return true;
+}
+
+
+static bool
+test_recycling()
+{
+	ArenaRecycler recycler(64, 1);
+	char* first;
+	{
+		Arena arena(&recycler);
+		first = arena.allocate(10);
+		for (int i = 0; i < 6; ++i) {
+			arena.allocate(10);			// spills into a second block
+		}
+		if (arena.blocks() != 2) {
+			cerr << "Arena didn't start a second block!" << endl;
+			return false;
+		}
+	}
+	if (recycler.kept() != 1) {
+		cerr << "Recycler kept " << recycler.kept() << " blocks, not "
+				"its limit of 1!" << endl;
+		return false;
+	}
+
+	// The arena returns its blocks in order, so the first is kept
+	Arena arena(&recycler);
+	if ((arena.allocate(10) != first) || (recycler.kept() != 0)) {
+		cerr << "Recycler didn't hand out its kept block!" << endl;
+		return false;
+	}
+
+	return true;
+}
+
+
+static bool
+test_strings()
+{
+	// Values in an arena keep it alive, through the owner reference
+	// each one holds
+	ArenaRecycler recycler(64, 4);
+	String kept;
+	{
+		Arena* arena = new Arena(&recycler);
+		RefCountedOwner owner(arena);
+		char* p = arena->copy("Nuts", 4);
+		kept = String(p, 4, mysql_type_info::string_type, false, owner);
+		if (kept.data() != p) {
+			cerr << "String copied its value out of the arena!" << endl;
+			return false;
+		}
+	}
+
+	if ((kept != "Nuts") || (recycler.kept() != 0)) {
+		cerr << "Arena was freed while a String used it!" << endl;
+		return false;
+	}
+
+	kept = String();
+	if (recycler.kept() != 1) {
+		cerr << "Arena outlived the last String using it!" << endl;
+		return false;
+	}
+
+	return true;
+}
+
+
+static bool
+test_placed()
+{
+	// Buffers pointing into an arena live there too, aligned, and keep
+	// it alive even once they no longer point into it
+	ArenaRecycler recycler(4096, 4);
+	RefCountedBuffer buf;
+	{
+		Arena* arena = new Arena(&recycler);
+		RefCountedOwner owner(arena);
+		char* p = arena->copy("Nuts", 4);
+		buf = SQLBuffer::create(p, 4, mysql_type_info::string_type,
+				false, owner);
+		char* after = arena->allocate(1);
+		if ((buf->data() != p) || (arena->blocks() != 1) ||
+				(size_t(after - p) < 5 + sizeof(SQLBuffer))) {
+			cerr << "SQLBuffer wasn't put in the arena!" << endl;
+			return false;
+		}
+		if (reinterpret_cast<size_t>(buf.raw()) % sizeof(void*)) {
+			cerr << "SQLBuffer was put in the arena unaligned!" << endl;
+			return false;
+		}
+	}
+
+	const string big(40, 'x');
+	buf->assign(big);
+	if ((buf->length() != big.size()) || (recycler.kept() != 0)) {
+		cerr << "Arena was freed while a SQLBuffer lived in it!" << endl;
+		return false;
+	}
+
+	buf = 0;
+	if (recycler.kept() != 1) {
+		cerr << "Arena outlived the last SQLBuffer in it!" << endl;
+		return false;
+	}
+
+	return true;
+}
+
+
+int
+main()
+{
+	try {
+		return test_bump() && test_recycling() && test_strings() &&
+				test_placed() ? 0 : 1;
+	}
+	catch (const Exception& e) {
+		cerr << "Unexpected MySQL++ exception: " << e.what() << endl;
+		return 1;
+	}
+}
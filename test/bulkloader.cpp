@@ -0,0 +1,178 @@
+/***********************************************************************
+ test/bulkloader.cpp - Tests the text BulkLoader sends to the server
+	for LOAD DATA LOCAL INFILE, without needing a server.
+
+ Copyright (c) 2009 by Educational Technology Resources, Inc.
+ Others may also hold copyrights on code in this file.  See the
+ CREDITS.txt file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#include <mysql++.h>
+#include <dbdriver.h>
+#define MYSQLPP_ALLOW_SSQLS_V1	// suppress deprecation warning
+#include <ssqls.h>
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+using namespace mysqlpp;
+using namespace std;
+
+sql_create_3(item, 1, 3,
+	sql_int,				id,
+	sql_varchar,			name,
+	sql_varchar_null,		note)
+
+
+static bool
+check(const string& what, const string& got, const string& expected)
+{
+	if (got == expected) {
+		return true;
+	}
+	else {
+		cerr << what << " gave '" << got << "', expected '" <<
+				expected << "'!" << endl;
+		return false;
+	}
+}
+
+
+static bool
+test_escape()
+{
+	ostringstream os;
+	os << escape_tsv << "plain";
+	if (!check("escape_tsv", os.str(), "plain")) return false;
+
+	os.str("");
+	os << escape_tsv << string("tab\there\nback\\slash\rnul\0!", 25);
+	if (!check("escape_tsv", os.str(),
+			"tab\\there\\nback\\\\slash\\rnul\\0!")) return false;
+
+	os.str("");
+	os << escape_tsv << sql_varchar_null(null);
+	if (!check("escape_tsv of null", os.str(), "\\N")) return false;
+
+	os.str("");
+	os << escape_tsv << 42;
+	if (!check("escape_tsv of int", os.str(), "42")) return false;
+
+	// LOAD DATA can't call NOW(), so "now" must go out as a time
+	os.str("");
+	os << escape_tsv << DateTime();
+	if ((os.str().length() != 19) || (os.str()[4] != '-')) {
+		cerr << "escape_tsv of DateTime() gave '" << os.str() <<
+				"', expected the current time!" << endl;
+		return false;
+	}
+
+	os.str("");
+	os << escape_tsv << DateTime(2020, 1, 2, 3, 4, 5);
+	if (!check("escape_tsv of DateTime", os.str(), "2020-01-02 03:04:05")) {
+		return false;
+	}
+
+	os.str("");
+	os << escape_tsv << string("NOW()");
+	return check("escape_tsv of NOW() string", os.str(), "NOW()");
+}
+
+
+static bool
+test_range()
+{
+	vector<item> items;
+	items.push_back(item(1, "one", sql_varchar_null("first\tnote")));
+	items.push_back(item(2, "two\nlines", sql_varchar_null(null)));
+
+	BulkRange<vector<item>::const_iterator> source(items.begin(),
+			items.end());
+	ostringstream os;
+	source.columns(os);
+	if (!check("BulkRange::columns()", os.str(), "`id`,`name`,`note`")) {
+		return false;
+	}
+
+	os.str("");
+	while (source.next(os)) {
+		// keep going
+	}
+	return check("BulkRange::next()", os.str(),
+			"1\tone\tfirst\\tnote\n2\ttwo\\nlines\t\\N\n");
+}
+
+
+static bool
+test_statement()
+{
+	vector<item> items;
+	items.push_back(item(1, "one", sql_varchar_null(null)));
+	BulkRange<vector<item>::const_iterator> source(items.begin(),
+			items.end());
+
+	// The rows are in the connection's character set, which the
+	// statement must name
+	Connection conn(false);
+	BulkLoader loader(&conn, false);
+	return check("BulkLoader::statement()",
+			loader.statement("item", source),
+			string("LOAD DATA LOCAL INFILE 'mysqlpp-bulk' INTO TABLE item "
+			"CHARACTER SET ") + conn.driver()->character_set_name() +
+			" FIELDS TERMINATED BY '\\t' ESCAPED BY '\\\\' "
+			"LINES TERMINATED BY '\\n' (`id`,`name`,`note`)");
+}
+
+
+static bool
+test_unconnected()
+{
+	Connection conn(false);
+	BulkLoader loader(&conn, false);
+	vector<item> items;
+	if (loader.load(items.begin(), items.end()) != 0) {
+		cerr << "Loading no rows claimed to load some!" << endl;
+		return false;
+	}
+
+	items.push_back(item(1, "one", sql_varchar_null(null)));
+	if ((loader.load(items.begin(), items.end()) != 0) ||
+			(loader.rows() != 0)) {
+		cerr << "Loading on an unconnected connection succeeded!" << endl;
+		return false;
+	}
+
+	return true;
+}
+
+
+int
+main()
+{
+	try {
+		return test_escape() && test_range() && test_statement() &&
+				test_unconnected() ? 0 : 1;
+	}
+	catch (const Exception& e) {
+		cerr << "Unexpected MySQL++ exception: " << e.what() << endl;
+		return 1;
+	}
+}
@@ -0,0 +1,240 @@
+/***********************************************************************
+ test/columnar.cpp - Tests the way Column converts values from the
+	server's text form and lays them out in memory.
+
+ Copyright (c) 2009 by Educational Technology Resources, Inc.
+ Others may also hold copyrights on code in this file.  See the
+ CREDITS.txt file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#include <mysql++.h>
+
+#include <cstring>
+#include <iostream>
+
+#include <locale.h>
+
+using namespace mysqlpp;
+using namespace std;
+
+
+// Append a null-terminated string, or a SQL null if it's 0
+static void
+add(Column& c, const char* s)
+{
+	c.append(s, s ? strlen(s) : 0);
+}
+
+
+static bool
+test_numbers()
+{
+	Column ints(Column::integer);
+	add(ints, "42");
+	add(ints, 0);
+	add(ints, "-9223372036854775807");
+	add(ints, "+7");
+	longlong sum = 0;
+	for (size_t i = 0; i < ints.size(); ++i) {
+		sum += ints.ints()[i];
+	}
+	if ((ints.size() != 4) || (ints.ints()[2] != -9223372036854775807LL) ||
+			(sum != 49 - 9223372036854775807LL)) {
+		cerr << "Integer column holds the wrong values!" << endl;
+		return false;
+	}
+
+	Column big(Column::unsigned_integer);
+	add(big, "18446744073709551615");
+	if (big.uints()[0] != 18446744073709551615ULL) {
+		cerr << "Unsigned column lost the top bit!" << endl;
+		return false;
+	}
+
+	Column reals(Column::real);
+	add(reals, "2.5");
+	add(reals, "-1e3");
+	add(reals, 0);
+	add(reals, "123456789012345678901234567890123456789012345678901234"
+			"567890123456789012345.5");
+	if ((reals.reals()[0] != 2.5) || (reals.reals()[1] != -1000.0) ||
+			(reals.reals()[2] != 0.0) || (reals.reals()[3] < 1e74)) {
+		cerr << "Real column holds the wrong values!" << endl;
+		return false;
+	}
+
+	return true;
+}
+
+
+static bool
+test_locale()
+{
+	// Only runs where one of these locales, which use a decimal comma,
+	// is installed
+	const char* names[] = {
+		"de_DE.UTF-8", "de_DE.utf8", "de_DE", "fr_FR.UTF-8", "fr_FR"
+	};
+	bool found = false;
+	for (size_t i = 0; !found && (i < sizeof(names) / sizeof(names[0]));
+			++i) {
+		found = setlocale(LC_NUMERIC, names[i]) != 0;
+	}
+	if (!found) {
+		return true;
+	}
+
+	Column reals(Column::real);
+	add(reals, "2.5");
+	add(reals, "-0.125e2");
+	setlocale(LC_NUMERIC, "C");
+	if ((reals.reals()[0] != 2.5) || (reals.reals()[1] != -12.5)) {
+		cerr << "Real column depends on the C locale!" << endl;
+		return false;
+	}
+	return true;
+}
+
+
+static bool
+test_nulls()
+{
+	// Cross a byte boundary in the bitmap
+	Column c(Column::integer);
+	for (int i = 0; i < 10; ++i) {
+		add(c, (i % 3) ? "1" : 0);
+	}
+
+	if (c.null_count() != 4) {
+		cerr << "Column counted " << c.null_count() << " nulls, not 4!" <<
+				endl;
+		return false;
+	}
+	if ((c.null_bitmap()[0] != 0x49) || (c.null_bitmap()[1] != 0x02)) {
+		cerr << "Null bitmap is wrong!" << endl;
+		return false;
+	}
+	for (size_t i = 0; i < c.size(); ++i) {
+		if (c.is_null(i) != ((i % 3) == 0) ||
+				(c.is_null(i) && c.ints()[i] != 0)) {
+			cerr << "Value " << i << " has the wrong null state!" << endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+static bool
+test_dates()
+{
+	Column c(Column::datetime);
+	add(c, "2009-03-05 12:34:56");
+	add(c, "2009-03-05");
+	add(c, "2009-03-05 12:34:56.789");
+	add(c, "20090305123456");
+
+	const longlong* p = c.ints();
+	if ((p[0] != 20090305123456LL) || (p[1] != 20090305000000LL) ||
+			(p[2] != p[0]) || (p[3] != p[0])) {
+		cerr << "Dates packed wrong: " << p[0] << ' ' << p[1] << ' ' <<
+				p[2] << ' ' << p[3] << endl;
+		return false;
+	}
+
+	if (c.datetime_at(0) != DateTime(2009, 3, 5, 12, 34, 56)) {
+		cerr << "Unpacked date is " << c.datetime_at(0) << '!' << endl;
+		return false;
+	}
+
+	return true;
+}
+
+
+static bool
+test_text()
+{
+	Column c(Column::text);
+	add(c, "Nuts");
+	add(c, 0);
+	c.append("a\0b", 3);
+	add(c, "");
+
+	if ((c.size() != 4) || (c.offsets()[4] != 11) ||
+			(strcmp(c.text_at(0), "Nuts") != 0) || (c.length(1) != 0) ||
+			(c.length(2) != 3) || (memcmp(c.text_at(2), "a\0b", 3) != 0) ||
+			(c.length(3) != 0) || !c.is_null(1) || c.is_null(3)) {
+		cerr << "Text column holds the wrong values!" << endl;
+		return false;
+	}
+
+	return true;
+}
+
+
+static bool
+test_kinds()
+{
+	struct {
+		enum_field_types type;
+		bool is_unsigned;
+		Column::Kind kind;
+	} cases[] = {
+		{ MYSQL_TYPE_TINY, false, Column::integer },
+		{ MYSQL_TYPE_LONG, true, Column::integer },
+		{ MYSQL_TYPE_LONGLONG, false, Column::integer },
+		{ MYSQL_TYPE_LONGLONG, true, Column::unsigned_integer },
+		{ MYSQL_TYPE_DOUBLE, false, Column::real },
+		{ MYSQL_TYPE_DATE, false, Column::datetime },
+		{ MYSQL_TYPE_DATETIME, false, Column::datetime },
+		{ MYSQL_TYPE_VAR_STRING, false, Column::text },
+		{ MYSQL_TYPE_TIME, false, Column::text },
+	};
+
+	for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+		for (int null = 0; null < 2; ++null) {
+			mysql_type_info t(cases[i].type, cases[i].is_unsigned,
+					null != 0);
+			if (Column::kind_for(t) != cases[i].kind) {
+				cerr << "Type " << t.sql_name() << " got column kind " <<
+						Column::kind_for(t) << ", not " <<
+						cases[i].kind << '!' << endl;
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+
+int
+main()
+{
+	try {
+		return test_numbers() && test_locale() && test_nulls() &&
+				test_dates() && test_text() && test_kinds() ? 0 : 1;
+	}
+	catch (const Exception& e) {
+		cerr << "Unexpected MySQL++ exception: " << e.what() << endl;
+		return 1;
+	}
+}
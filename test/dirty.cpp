@@ -0,0 +1,138 @@
+/***********************************************************************
+ test/dirty.cpp - Tests SSQLS dirty field tracking, and the minimal
+	UPDATE statements Query::update() builds from it.
+
+ Copyright (c) 2009 by Educational Technology Resources, Inc.
+ Others may also hold copyrights on code in this file.  See the
+ CREDITS.txt file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#include <mysql++.h>
+#define MYSQLPP_ALLOW_SSQLS_V1	// suppress deprecation warning
+#include <ssqls.h>
+
+#include <iostream>
+
+using namespace mysqlpp;
+using namespace std;
+
+// The first field is the key
+sql_create_4(item, 1, 4,
+	sql_int,				id,
+	sql_varchar,			name,
+	sql_int,				count,
+	sql_double,				weight)
+
+// Enough of an SSQLS for Query::update(), but with no key fields, so
+// there's no way to find the row to update.  sql_create_N itself won't
+// take 0 comparison fields.
+struct keyless
+{
+	enum { key_fields = 0 };
+	const char* table() const { return "keyless"; }
+	bool dirty() const { return true; }
+	const char* dirty_list() const { return "`b` = 3"; }
+	const char* equal_list(const char*, sql_cmp_type) const { return ""; }
+};
+
+
+static bool
+check(const char* what, const string& got, const string& expected)
+{
+	if (got == expected) {
+		return true;
+	}
+	else {
+		cerr << what << " built '" << got << "', expected '" <<
+				expected << "'!" << endl;
+		return false;
+	}
+}
+
+
+int
+main()
+{
+	try {
+		Query q(0);		// don't pass 0 for conn parameter in real code
+		item it(1, "one", 5, 2.5);
+
+		if (it.dirty()) {
+			cerr << "New SSQLS claims to be dirty!" << endl;
+			return 1;
+		}
+		if (!check("update() of clean object", q.update(it).str(), "")) {
+			return 1;
+		}
+
+		it.set_count(6);
+		if (!it.dirty() || !it.dirty(item_count) || it.dirty(item_name) ||
+				(it.count != 6)) {
+			cerr << "Setter didn't mark just its field dirty!" << endl;
+			return 1;
+		}
+		if (!check("update() of one field", q.update(it).str(),
+				"UPDATE `item` SET `count` = 6 WHERE `id` = 1")) {
+			return 1;
+		}
+
+		it.weight = 3.5;
+		it.set_dirty(item_weight);
+		it.set_name("uno");
+		if (!check("update() of three fields", q.update(it).str(),
+				"UPDATE `item` SET `name` = 'uno',`count` = 6,"
+				"`weight` = 3.5 WHERE `id` = 1")) {
+			return 1;
+		}
+
+		// Copies carry the flags along
+		item copy(it);
+		if (!copy.dirty(item_weight)) {
+			cerr << "Copy lost its dirty flags!" << endl;
+			return 1;
+		}
+
+		it.clear_dirty();
+		if (it.dirty()) {
+			cerr << "clear_dirty() left dirty flags set!" << endl;
+			return 1;
+		}
+
+		keyless k;
+		try {
+			q.update(k);
+			cerr << "update() of keyless SSQLS didn't throw!" << endl;
+			return 1;
+		}
+		catch (const BadQuery&) {
+		}
+
+		Query quiet(0, false);
+		if (!check("update() of keyless SSQLS", quiet.update(k).str(), "")) {
+			return 1;
+		}
+
+		return 0;
+	}
+	catch (const Exception& e) {
+		cerr << "Unexpected MySQL++ exception: " << e.what() << endl;
+		return 1;
+	}
+}
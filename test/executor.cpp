@@ -0,0 +1,293 @@
+/***********************************************************************
+ test/executor.cpp - Tests the QueryExecutor class and its futures,
+	using tasks that don't talk to a database server.
+
+ Copyright (c) 2009 by Educational Technology Resources, Inc.
+ Others may also hold copyrights on code in this file.  See the
+ CREDITS.txt file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#include <connection.h>
+#include <cpool.h>
+#include <executor.h>
+
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+
+static const unsigned int num_threads = 4;
+static const size_t queue_limit = 8;
+
+
+// Hands out unconnected Connection objects, counting them
+class TestConnectionPool : public mysqlpp::ConnectionPool
+{
+public:
+	TestConnectionPool() : created_(0) { }
+	~TestConnectionPool() { clear(); }
+
+	unsigned int created() const { return created_; }
+	unsigned int max_idle_time() { return 60; }
+
+private:
+	mysqlpp::Connection* create()
+	{
+		++created_;		// called with the pool's mutex held
+		return new mysqlpp::Connection(false);
+	}
+	void destroy(mysqlpp::Connection* cp) { delete cp; }
+
+	unsigned int created_;
+};
+
+
+struct Square
+{
+	typedef long result_type;
+	explicit Square(long n) : n_(n) { }
+	long operator()(mysqlpp::Connection&) const { return n_ * n_; }
+	long n_;
+};
+
+
+struct FailQuery
+{
+	typedef int result_type;
+	int operator()(mysqlpp::Connection&) const
+	{
+		throw mysqlpp::BadQuery("no such table", 1146);
+	}
+};
+
+
+struct FailOther
+{
+	typedef int result_type;
+	int operator()(mysqlpp::Connection&) const
+	{
+		throw std::runtime_error("something else broke");
+	}
+};
+
+
+struct Vote
+{
+	typedef bool result_type;
+	Vote(mysqlpp::CommitVote& v, bool ok) : vote_(&v), ok_(ok) { }
+	bool operator()(mysqlpp::Connection&) const { return vote_->vote(ok_); }
+	mysqlpp::CommitVote* vote_;
+	bool ok_;
+};
+
+
+static void
+do_nothing(mysqlpp::Connection&)
+{
+}
+
+
+static bool
+test_results(TestConnectionPool& pool)
+{
+	mysqlpp::QueryExecutor executor(pool, num_threads, queue_limit);
+	vector<mysqlpp::Future<long> > futures;
+	for (long i = 0; i < 1000; ++i) {
+		futures.push_back(executor.submit(Square(i)));
+		if (executor.queued() > num_threads * queue_limit) {
+			cerr << "Executor queued " << executor.queued() <<
+					" tasks, over its limit of " <<
+					num_threads * queue_limit << '!' << endl;
+			return false;
+		}
+	}
+
+	for (long i = 0; i < 1000; ++i) {
+		if (futures[i].get() != i * i) {
+			cerr << "Task " << i << " returned " << futures[i].get() <<
+					", not " << i * i << '!' << endl;
+			return false;
+		}
+	}
+
+	if (pool.created() > num_threads) {
+		cerr << "Executor with " << num_threads << " workers used " <<
+				pool.created() << " connections!" << endl;
+		return false;
+	}
+
+	mysqlpp::Future<void> fv = executor.submit(do_nothing);
+	fv.get();
+
+	mysqlpp::Future<long> ft;
+	if (ft.valid()) {
+		cerr << "Default-constructed future claims to have a task!" <<
+				endl;
+		return false;
+	}
+	if (!executor.try_submit(Square(3), ft) || (ft.get() != 9)) {
+		cerr << "try_submit() on an idle executor failed!" << endl;
+		return false;
+	}
+
+	return true;
+}
+
+
+static bool
+test_exceptions(TestConnectionPool& pool)
+{
+	mysqlpp::QueryExecutor executor(pool, num_threads, queue_limit);
+	mysqlpp::Future<int> fq = executor.submit(FailQuery());
+	mysqlpp::Future<int> fo = executor.submit(FailOther());
+
+	try {
+		fq.get();
+		cerr << "BadQuery wasn't passed back through the future!" << endl;
+		return false;
+	}
+	catch (const mysqlpp::BadQuery& e) {
+		if (e.errnum() != 1146) {
+			cerr << "BadQuery came back with errnum " << e.errnum() <<
+					", not 1146!" << endl;
+			return false;
+		}
+	}
+
+	try {
+		fo.get();
+		cerr << "runtime_error wasn't passed back through the future!" <<
+				endl;
+		return false;
+	}
+	catch (const mysqlpp::TaskFailed& e) {
+		if (string(e.what()) != "something else broke") {
+			cerr << "TaskFailed has the wrong message: " << e.what() <<
+					endl;
+			return false;
+		}
+	}
+
+	// Futures must stay usable after their executor is gone
+	mysqlpp::Future<long> late = executor.submit(Square(7));
+	executor.shutdown();
+	if (!late.ready() || (late.get() != 49)) {
+		cerr << "shutdown() didn't finish the queued work!" << endl;
+		return false;
+	}
+
+	try {
+		executor.submit(Square(1));
+		cerr << "Executor accepted a task after shutdown()!" << endl;
+		return false;
+	}
+	catch (const mysqlpp::ObjectNotInitialized&) {
+	}
+
+	return true;
+}
+
+
+static bool
+test_vote(TestConnectionPool& pool, bool fail_one)
+{
+	mysqlpp::QueryExecutor executor(pool, num_threads, queue_limit);
+	if (executor.threads() == 0) {
+		return true;	// voters can't all run at once without threads
+	}
+
+	mysqlpp::CommitVote vote(num_threads);
+	vector<mysqlpp::Future<bool> > futures;
+	for (unsigned int i = 0; i < num_threads; ++i) {
+		futures.push_back(executor.submit(Vote(vote,
+				!fail_one || (i != num_threads - 1))));
+	}
+
+	for (unsigned int i = 0; i < num_threads; ++i) {
+		if (futures[i].get() == fail_one) {
+			cerr << "Voter " << i << " got the wrong outcome with " <<
+					(fail_one ? "one" : "no") << " failing vote!" << endl;
+			return false;
+		}
+	}
+
+	// Votes cast on behalf of tasks that never ran must release the
+	// ones that did
+	mysqlpp::CommitVote partial(num_threads);
+	mysqlpp::Future<bool> f = executor.submit(Vote(partial, true));
+	partial.fail(num_threads - 1);
+	if (f.get()) {
+		cerr << "CommitVote::fail() didn't make the vote fail!" << endl;
+		return false;
+	}
+
+	return true;
+}
+
+
+static bool
+test_promise()
+{
+	mysqlpp::Promise<int> p;
+	mysqlpp::Future<int> f = p.future();
+	if (f.ready()) {
+		cerr << "Future of an unset promise claims to be ready!" << endl;
+		return false;
+	}
+	mysqlpp::Promise<int>(p).set_value(42);	// copies share the result
+	if (!f.ready() || (f.get() != 42)) {
+		cerr << "Promise didn't pass its value to the future!" << endl;
+		return false;
+	}
+
+	mysqlpp::Promise<int> bad;
+	bad.set_error(mysqlpp::BadQuery("no such table", 1146));
+	try {
+		bad.future().get();
+		cerr << "Promise didn't pass its error to the future!" << endl;
+		return false;
+	}
+	catch (const mysqlpp::BadQuery& e) {
+		if (e.errnum() != 1146) {
+			cerr << "Promise's BadQuery came back with errnum " <<
+					e.errnum() << ", not 1146!" << endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+int
+main()
+{
+	try {
+		TestConnectionPool pool;
+		return test_results(pool) && test_exceptions(pool) &&
+				test_vote(pool, false) && test_vote(pool, true) &&
+				test_promise() ? 0 : 1;
+	}
+	catch (const mysqlpp::Exception& e) {
+		cerr << "Unexpected MySQL++ exception: " << e.what() << endl;
+		return 1;
+	}
+}
@@ -90,11 +90,122 @@ test_row_count()
 }
 
 
+// Run rows through the policy the way insertfrom() does, returning
+// the number it takes before asking for the statement to be sent
+template <class InsertPolicy>
+static unsigned int
+fill_batch(InsertPolicy& ip, size_t row_size)
+{
+	mysqlpp::Row dummy;
+	unsigned int rows = 0;
+	int size = 0;
+	while (ip.can_add(size, dummy, row_size)) {
+		size += int(row_size);
+		++rows;
+	}
+	return rows;
+}
+
+
+static bool
+test_adaptive()
+{
+	// With no connection, the policy assumes a 1 MB packet limit
+	mysqlpp::Query::AdaptiveInsertPolicy<> ip(0, 1.0, 10);
+	unsigned int rows = fill_batch(ip, 10);
+	if (rows != 10) {
+		std::cerr << "AdaptiveInsertPolicy allowed " << rows <<
+				" rows in its first batch, not 10!" << std::endl;
+		return false;
+	}
+
+	// The "statement" took no time at all, far under the target, so
+	// the next batch should be twice as big.
+	rows = fill_batch(ip, 10);
+	if ((rows != 20) || (ip.batch_rows() != 20) ||
+			(ip.rows_per_second() <= 0)) {
+		std::cerr << "AdaptiveInsertPolicy didn't grow a fast batch: " <<
+				rows << " rows, " << ip.rows_per_second() <<
+				" rows/s!" << std::endl;
+		return false;
+	}
+
+	// Now make one take too long, and it should halve
+	mysqlpp::Query::AdaptiveInsertPolicy<> slow(0, 1e-6, 10);
+	fill_batch(slow, 10);
+	double start = mysqlpp::internal::seconds_now();
+	while (mysqlpp::internal::seconds_now() - start < 0.001) {
+		// wait for the "statement" to run
+	}
+	rows = fill_batch(slow, 10);
+	if (rows != 5) {
+		std::cerr << "AdaptiveInsertPolicy allowed " << rows <<
+				" rows after a slow batch, not 5!" << std::endl;
+		return false;
+	}
+
+	// Rows can't push the statement past max_allowed_packet
+	mysqlpp::Query::AdaptiveInsertPolicy<> big(0, 1.0, 1000);
+	rows = fill_batch(big, 100 * 1024);
+	if (rows != 10) {
+		std::cerr << "AdaptiveInsertPolicy allowed " << rows <<
+				" 100 KB rows in a 1 MB packet!" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+
+static bool
+test_max_packet()
+{
+	// Check the form insertfrom() uses, where it passes in the size
+	// of the row's already-built VALUES expression.
+	mysqlpp::Query::MaxPacketInsertPolicy<> ip(100);
+	mysqlpp::Row dummy;
+	const struct {
+		int size;
+		size_t row_size;
+		bool allowed;
+	} cases[] = {
+		{ 0, 100, true },
+		{ 0, 101, false },
+		{ 50, 50, true },
+		{ 50, 51, false },
+		{ 99, 1, true },
+		{ 100, 1, false },
+		{ 150, 0, false },
+	};
+	for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+		if (ip.can_add(cases[i].size, dummy, cases[i].row_size) !=
+				cases[i].allowed) {
+			std::cerr << "MaxPacketInsertPolicy(100) " <<
+					(cases[i].allowed ? "refused" : "allowed") <<
+					" a " << cases[i].row_size << " byte row at size " <<
+					cases[i].size << '!' << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+static bool
+test_size_threshold()
+{
+	mysqlpp::Query::SizeThresholdInsertPolicy<> ip(nonzero);
+	return test_policy(ip, nonzero);
+}
+
+
 int
 main()
 {
 	try {
-		return test_row_count() ? 0 : 1;
+		return test_row_count() && test_size_threshold() &&
+				test_max_packet() && test_adaptive() ? 0 : 1;
 	}
 	catch (...) {
 		std::cerr << "Unhandled exception caught by "
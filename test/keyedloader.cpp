@@ -0,0 +1,219 @@
+/***********************************************************************
+ test/keyedloader.cpp - Tests the way KeyedLoader gathers keys into
+	batches, and that every caller hears back when a batch fails or
+	can't get a connection.
+
+ Copyright (c) 2009 by Educational Technology Resources, Inc.
+ Others may also hold copyrights on code in this file.  See the
+ CREDITS.txt file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#include <mysql++.h>
+#define MYSQLPP_ALLOW_SSQLS_V1	// suppress deprecation warning
+#include <ssqls.h>
+
+#include <iostream>
+#include <vector>
+
+using namespace mysqlpp;
+using namespace std;
+
+// The first field is the key
+sql_create_2(item, 1, 2,
+	sql_int,				id,
+	sql_varchar,			name)
+
+
+// Hands out unconnected Connection objects
+class TestConnectionPool : public ConnectionPool
+{
+public:
+	~TestConnectionPool() { clear(); }
+	unsigned int max_idle_time() { return 60; }
+
+protected:
+	Connection* create() { return new Connection(false); }
+	void destroy(Connection* cp) { delete cp; }
+};
+
+
+// Throws instead of handing out its first connection
+class FlakyConnectionPool : public TestConnectionPool
+{
+public:
+	FlakyConnectionPool() : failed_(false) { }
+
+private:
+	Connection* create()
+	{
+		if (!failed_) {
+			failed_ = true;		// called with the pool's mutex held
+			throw ConnectionFailed("server went away");
+		}
+		return new Connection(false);
+	}
+
+	bool failed_;
+};
+
+
+// Take a batch, check its size and free its waiters
+static bool
+take(KeyBatcher& batcher, KeyBatcher::BatchId id, size_t expected,
+		const char* what)
+{
+	KeyBatcher::Batch batch;
+	batcher.take(id, batch);
+	for (size_t i = 0; i < batch.size(); ++i) {
+		delete batch[i].waiter;
+	}
+
+	if (batch.size() != expected) {
+		cerr << what << " batch has " << batch.size() << " keys, not " <<
+				expected << '!' << endl;
+		return false;
+	}
+	return true;
+}
+
+
+static bool
+test_batcher()
+{
+	// A window long enough that only filling up closes a batch
+	KeyBatcher full(3, 60000);
+	KeyBatcher::BatchId opened[4];
+	for (int i = 0; i < 4; ++i) {
+		opened[i] = full.add("1", new KeyBatcher::Waiter);
+	}
+	if (!opened[0] || opened[1] || opened[2] || !opened[3] ||
+			(opened[0] == opened[3])) {
+		cerr << "Batch of 3 didn't open on keys 1 and 4!" << endl;
+		return false;
+	}
+	full.add("2", new KeyBatcher::Waiter);
+	full.add("3", new KeyBatcher::Waiter);
+
+	// Each batch goes to the one who takes its ID, even out of order
+	if (!take(full, opened[3], 3, "Second full") ||
+			!take(full, opened[0], 3, "First full")) {
+		return false;
+	}
+
+	// A short window closes a batch that doesn't fill up
+	KeyBatcher timed(100, 10);
+	KeyBatcher::BatchId id = timed.add("1", new KeyBatcher::Waiter);
+	timed.add("2", new KeyBatcher::Waiter);
+	if (!take(timed, id, 2, "Timed")) {
+		return false;
+	}
+
+	// Cancelling removes the given batch, not the oldest, and doesn't
+	// wait out the window
+	KeyBatcher cancelled(2, 60000);
+	KeyBatcher::BatchId first = cancelled.add("1", new KeyBatcher::Waiter);
+	cancelled.add("2", new KeyBatcher::Waiter);
+	KeyBatcher::BatchId second = cancelled.add("3", new KeyBatcher::Waiter);
+	KeyBatcher::Batch batch;
+	cancelled.cancel(second, batch);
+	for (size_t i = 0; i < batch.size(); ++i) {
+		delete batch[i].waiter;
+	}
+	if ((batch.size() != 1) || (batch[0].key != "3")) {
+		cerr << "Cancel took the wrong batch!" << endl;
+		return false;
+	}
+	cancelled.cancel(second, batch);
+	if (!batch.empty()) {
+		cerr << "Cancelled batch was still there!" << endl;
+		return false;
+	}
+	return take(cancelled, first, 2, "Uncancelled");
+}
+
+
+static bool
+test_loader()
+{
+	// The pool's connections aren't connected, so every batch fails,
+	// and every caller must get the error, duplicates included
+	TestConnectionPool pool;
+	QueryExecutor executor(pool, 2);
+	KeyedLoader<item, sql_int> loader(executor, 4, 5);
+
+	vector<Future<item> > futures;
+	const int keys[] = { 1, 2, 2, 3, 4, 5 };
+	for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); ++i) {
+		futures.push_back(loader.load(keys[i]));
+	}
+
+	for (size_t i = 0; i < futures.size(); ++i) {
+		try {
+			futures[i].get();
+			cerr << "Load of key " << keys[i] << " succeeded without "
+					"a server!" << endl;
+			return false;
+		}
+		catch (const BadQuery&) {
+		}
+		catch (const ConnectionFailed&) {
+		}
+	}
+
+	return true;
+}
+
+
+// The task for a batch that can't get a connection must still fail
+// the batch's callers, else they and the loader's destructor wait
+// forever
+static bool
+test_no_connection()
+{
+	FlakyConnectionPool pool;
+	QueryExecutor executor(pool, 1);
+	{
+		KeyedLoader<item, sql_int> loader(executor, 4, 5);
+		Future<item> f = loader.load(1);
+		try {
+			f.get();
+			cerr << "Load succeeded without a connection!" << endl;
+			return false;
+		}
+		catch (const ConnectionFailed&) {
+		}
+	}
+
+	return true;
+}
+
+
+int
+main()
+{
+	try {
+		return test_batcher() && test_loader() &&
+				test_no_connection() ? 0 : 1;
+	}
+	catch (const Exception& e) {
+		cerr << "Unexpected MySQL++ exception: " << e.what() << endl;
+		return 1;
+	}
+}
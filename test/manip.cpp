@@ -24,6 +24,8 @@
 ***********************************************************************/
 
 #include <mysql++.h>
+#include <dbdriver.h>
+#include <sqlescape.h>
 
 #include <iostream>
 #include <sstream>
@@ -152,6 +154,201 @@ test(T test, size_t len)
 }
 
 
+// Characters needing escaping must come out escaped exactly once,
+// whether they go through a manipulator or a template query parameter.
+static bool
+test_escaping()
+{
+	const char* expected = "'it\\'s'";
+
+	mysqlpp::Query q(0);
+	q << mysqlpp::quote << "it's";
+	mysqlpp::SQLStream s(0);
+	s << '\'' << mysqlpp::escape << "it's" << '\'';
+	mysqlpp::Query t(0, false, "%0q");
+	t.parse();
+	t.template_defaults << "it's";
+	std::string first = t.str(), second = t.str();
+
+	if (q.str() != expected || s.str() != expected ||
+			first != expected || second != expected) {
+		std::cerr << "Escaping failed: got " << q.str() << ", " <<
+				s.str() << ", " << first << " and " << second <<
+				"; expected " << expected << std::endl;
+		return false;
+	}
+	return true;
+}
+
+
+// Binary strings must go into the query as hex literals, whether
+// through the quote manipulator or a template query.
+static bool
+test_binary()
+{
+	const char* expected = "X'610062'";
+
+	mysqlpp::sql_blob b("a\0b", 3);
+	b.set_binary();
+	mysqlpp::Query q(0);
+	q << mysqlpp::quote << b;
+	mysqlpp::Query t(0, false, "%0q");
+	t.parse();
+	t.template_defaults << b;
+	std::string tq = t.str();
+
+	if (q.str() != expected || tq != expected) {
+		std::cerr << "Binary quoting failed: got " << q.str() <<
+				" and " << tq << "; expected " << expected << std::endl;
+		return false;
+	}
+
+	// Row marks BLOB values binary by their character set.  A TEXT
+	// column with a _bin collation has BINARY_FLAG too, but isn't one.
+	MYSQL_FIELD mf;
+	memset(&mf, 0, sizeof(mf));
+	mf.name = mf.table = mf.db = const_cast<char*>("");
+	mf.type = MYSQL_TYPE_BLOB;
+	mf.flags = BLOB_FLAG | BINARY_FLAG;
+	mf.charsetnr = 63;					// binary
+	mysqlpp::Field blob(&mf);
+	mf.charsetnr = 83;					// utf8_bin
+	mysqlpp::Field text(&mf);
+	if (!blob.binary_charset() || text.binary_charset()) {
+		std::cerr << "Field mistook which column holds bytes!" <<
+				std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+
+// The manipulators find Query and SQLStream through a pword() slot,
+// not RTTI, so make sure copies register themselves and that copying a
+// Query's stream state onto a plain stream doesn't fool them, even
+// after the Query is gone.
+static bool
+test_dispatch()
+{
+	mysqlpp::Query q(0);
+	mysqlpp::Query qc(q);
+	mysqlpp::SQLStream s(0);
+	mysqlpp::SQLStream sc(s);
+	std::ostringstream os;
+	os.copyfmt(q);
+	std::ostringstream stale;
+	{
+		mysqlpp::SQLStream gone(0);
+		stale.copyfmt(gone);
+	}
+
+	if (mysqlpp::EscapingStream::lookup(q) != &q ||
+			mysqlpp::EscapingStream::lookup(qc) != &qc ||
+			mysqlpp::EscapingStream::lookup(s) != &s ||
+			mysqlpp::EscapingStream::lookup(sc) != &sc ||
+			mysqlpp::EscapingStream::lookup(os) != 0 ||
+			mysqlpp::EscapingStream::lookup(stale) != 0) {
+		std::cerr << "Escaping stream lookup failed!" << std::endl;
+		return false;
+	}
+
+	qc << mysqlpp::quote << "it's";
+	os << mysqlpp::quote << "it's";
+	if (qc.str() != "'it\\'s'" || os.str() != "it's") {
+		std::cerr << "Manipulator dispatch failed: got " << qc.str() <<
+				" and " << os.str() << std::endl;
+		return false;
+	}
+	return true;
+}
+
+
+// Escapes a run of non-ASCII bytes with the C API, as the connection
+// aware DBDriver::escape_string() does for UTF-8 connections
+static size_t
+escape_run(void* ctx, char* to, const char* from, size_t length)
+{
+	return mysql_real_escape_string(static_cast<MYSQL*>(ctx), to, from,
+			static_cast<unsigned long>(length));
+}
+
+
+// The vectorized escaper must produce exactly what the C API does, both
+// without a connection and through a MYSQL handle's character set.
+// Test buffers of many sizes, so that every special character lands at
+// every position relative to the 16 and 32 byte scanning blocks, and
+// mix in UTF-8 sequences, both valid and broken.
+static bool
+test_escape_differential()
+{
+	static const char alphabet[] = "abcXYZ09 \0\n\r\\'\"\032"
+			"\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80\xc3\xff\x80";
+	const size_t alen = sizeof(alphabet) - 1;
+
+	// An unconnected handle has the client's default character set,
+	// which is what escape_string() dispatches on.  We only check it
+	// when escape_string() would use the vectorized escaper for it.
+	MYSQL mysql;
+	if (!mysql_init(&mysql)) {
+		std::cerr << "Failed to set up a MYSQL handle!" << std::endl;
+		return false;
+	}
+	const char* cs = mysql_character_set_name(&mysql);
+	bool single = cs && ((strcmp(cs, "latin1") == 0) ||
+			(strcmp(cs, "ascii") == 0) || (strcmp(cs, "binary") == 0));
+	bool utf8 = cs && (strncmp(cs, "utf8", 4) == 0);
+
+	bool ok = true;
+	unsigned long seed = 12345;
+	std::string in, expected, got;
+	for (size_t len = 0; ok && len < 300; ++len) {
+		for (int pass = 0; ok && pass < 8; ++pass) {
+			in.resize(len);
+			for (size_t i = 0; i < len; ++i) {
+				seed = seed * 1103515245 + 12345;
+				// Mostly plain letters, so the bulk copy path gets used
+				size_t r = (seed >> 16) % (alen * 4);
+				in[i] = r < alen ? alphabet[r] : char('a' + r % 26);
+			}
+
+			expected.resize(len * 2 + 1);
+			got.resize(len * 2 + 1);
+			expected.resize(mysql_escape_string(&expected[0], in.data(),
+					static_cast<unsigned long>(len)));
+			got.resize(mysqlpp::DBDriver::escape_string_no_conn(&got[0],
+					in.data(), len));
+			if (got != expected) {
+				std::cerr << "Escaping differs from C API for " <<
+						len << "-byte input, pass " << pass << '!' <<
+						std::endl;
+				ok = false;
+			}
+			else if (single || utf8) {
+				expected.resize(len * 2 + 1);
+				got.resize(len * 2 + 1);
+				expected.resize(mysql_real_escape_string(&mysql,
+						&expected[0], in.data(),
+						static_cast<unsigned long>(len)));
+				got.resize(single ?
+						mysqlpp::escape_sql(&got[0], in.data(), len) :
+						mysqlpp::escape_sql(&got[0], in.data(), len,
+							escape_run, &mysql));
+				if (got != expected) {
+					std::cerr << "Escaping differs from C API in " <<
+							cs << " for " << len << "-byte input, pass " <<
+							pass << '!' << std::endl;
+					ok = false;
+				}
+			}
+		}
+	}
+
+	mysql_close(&mysql);
+	return ok;
+}
+
+
 int
 main()
 {
@@ -165,6 +362,10 @@ main()
 	failures += test(std::string(s), len) == false;
 	failures += test(mysqlpp::SQLTypeAdapter(s), len) == false;
 	failures += test(mysqlpp::Null<std::string>(s), len) == false;
+	failures += test_escaping() == false;
+	failures += test_binary() == false;
+	failures += test_dispatch() == false;
+	failures += test_escape_differential() == false;
 	return failures;
 }
 
@@ -0,0 +1,233 @@
+/***********************************************************************
+ test/parallelinsert.cpp - Tests how ParallelInsert splits a job into
+	shards and reports their outcomes.  It uses connections that aren't
+	connected to a database server, and an insert policy too strict to
+	let any row through, so every shard fails.
+
+ Copyright (c) 2009 by Educational Technology Resources, Inc.
+ Others may also hold copyrights on code in this file.  See the
+ CREDITS.txt file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#include <mysql++.h>
+#define MYSQLPP_ALLOW_SSQLS_V1	// suppress deprecation warning
+#include <ssqls.h>
+
+#include <iostream>
+#include <vector>
+
+using namespace mysqlpp;
+using namespace std;
+
+static const unsigned int num_threads = 4;
+
+sql_create_2(item, 1, 2,
+	sql_int,				id,
+	sql_varchar,			name)
+
+
+// Hands out unconnected Connection objects
+class TestConnectionPool : public ConnectionPool
+{
+public:
+	~TestConnectionPool() { clear(); }
+	unsigned int max_idle_time() { return 60; }
+
+protected:
+	Connection* create() { return new Connection(false); }
+	void destroy(Connection* cp) { delete cp; }
+};
+
+
+// As above, but fails to create the first connection asked of it
+class FlakyConnectionPool : public TestConnectionPool
+{
+public:
+	FlakyConnectionPool() : failed_(false) { }
+
+private:
+	Connection* create()
+	{
+		if (!failed_) {
+			failed_ = true;		// called with the pool's mutex held
+			throw ConnectionFailed("server went away");
+		}
+		return new Connection(false);
+	}
+
+	bool failed_;
+};
+
+
+// Check that the job was split into shards of the given sizes, and
+// that none of them committed
+static bool
+check_shards(const char* what, const ParallelInsert& pi,
+		const unsigned int* sizes, size_t count)
+{
+	const vector<ShardResult>& results = pi.results();
+	if (results.size() != count) {
+		cerr << what << " job ran " << results.size() <<
+				" shards, not " << count << '!' << endl;
+		return false;
+	}
+
+	for (size_t i = 0; i < count; ++i) {
+		if (results[i].rows() != sizes[i]) {
+			cerr << what << " shard " << i << " got " <<
+					results[i].rows() << " rows, not " << sizes[i] <<
+					'!' << endl;
+			return false;
+		}
+		if (results[i].committed()) {
+			cerr << what << " shard " << i << " committed!" << endl;
+			return false;
+		}
+		if (results[i].error().empty()) {
+			cerr << what << " shard " << i << " failed without "
+					"saying why!" << endl;
+			return false;
+		}
+	}
+
+	if (pi.rows() != 0) {
+		cerr << what << " job claims to have inserted " << pi.rows() <<
+				" rows!" << endl;
+		return false;
+	}
+
+	return true;
+}
+
+
+static bool
+test_per_shard(QueryExecutor& executor, const vector<item>& items)
+{
+	Query::MaxPacketInsertPolicy<> policy(4);
+
+	ParallelInsert pi(executor);
+	if (pi.insertfrom(items.begin(), items.end(), policy)) {
+		cerr << "Parallel insert succeeded with a bad policy!" << endl;
+		return false;
+	}
+	if (executor.threads() == 0) {
+		const unsigned int sizes[] = { 10 };
+		if (!check_shards("Inline", pi, sizes, 1)) return false;
+	}
+	else {
+		const unsigned int sizes[] = { 3, 3, 2, 2 };
+		if (!check_shards("Default", pi, sizes, 4)) return false;
+	}
+
+	// Can't have more shards than rows
+	ParallelInsert many(executor, ParallelInsert::per_shard, 20);
+	many.insertfrom(items.begin(), items.begin() + 3, policy);
+	const unsigned int ones[] = { 1, 1, 1 };
+	if (!check_shards("Small", many, ones, 3)) return false;
+
+	// An empty job trivially succeeds
+	if (!many.insertfrom(items.begin(), items.begin(), policy) ||
+			!many.results().empty()) {
+		cerr << "Empty parallel insert failed!" << endl;
+		return false;
+	}
+
+	return true;
+}
+
+
+static bool
+test_all_or_nothing(QueryExecutor& executor, const vector<item>& items)
+{
+	Query::MaxPacketInsertPolicy<> policy(4);
+
+	// Asking for more shards than there are threads gets one per
+	// thread, since all the shards have to be running to vote
+	ParallelInsert pi(executor, ParallelInsert::all_or_nothing, 8);
+	if (pi.insertfrom(items.begin(), items.end(), policy)) {
+		cerr << "All-or-nothing insert succeeded with a bad policy!" <<
+				endl;
+		return false;
+	}
+	if (executor.threads() == 0) {
+		const unsigned int sizes[] = { 10 };
+		return check_shards("Inline XA", pi, sizes, 1);
+	}
+	else {
+		const unsigned int sizes[] = { 3, 3, 2, 2 };
+		return check_shards("XA", pi, sizes, 4);
+	}
+}
+
+
+// A shard that can't get a connection must still vote, else the
+// others wait for it forever
+static bool
+test_no_connection(const vector<item>& items)
+{
+	FlakyConnectionPool pool;
+	QueryExecutor executor(pool, num_threads);
+	Query::MaxPacketInsertPolicy<> policy(4);
+	ParallelInsert pi(executor, ParallelInsert::all_or_nothing);
+	if (pi.insertfrom(items.begin(), items.end(), policy)) {
+		cerr << "All-or-nothing insert succeeded without a "
+				"connection!" << endl;
+		return false;
+	}
+
+	const vector<ShardResult>& results = pi.results();
+	size_t expected = executor.threads() ? num_threads : 1;
+	if (results.size() != expected) {
+		cerr << "Connectionless job ran " << results.size() <<
+				" shards, not " << expected << '!' << endl;
+		return false;
+	}
+	for (size_t i = 0; i < results.size(); ++i) {
+		if (results[i].committed() || results[i].error().empty()) {
+			cerr << "Connectionless shard " << i << " has the wrong "
+					"outcome!" << endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+int
+main()
+{
+	try {
+		vector<item> items;
+		for (int i = 0; i < 10; ++i) {
+			items.push_back(item(i, "row"));
+		}
+
+		TestConnectionPool pool;
+		QueryExecutor executor(pool, num_threads);
+		return test_per_shard(executor, items) &&
+				test_all_or_nothing(executor, items) &&
+				test_no_connection(items) ? 0 : 1;
+	}
+	catch (const Exception& e) {
+		cerr << "Unexpected MySQL++ exception: " << e.what() << endl;
+		return 1;
+	}
+}
@@ -0,0 +1,143 @@
+/***********************************************************************
+ test/prepquery.cpp - Tests the translation of template queries into
+ 	prepared statement form, and PreparedQuery's parameter handling.
+
+ Copyright (c) 2009 by Educational Technology Resources, Inc.
+ Others may also hold copyrights on code in this file.  See the
+ CREDITS.txt file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#include <mysql++.h>
+
+#include <iostream>
+
+using namespace mysqlpp;
+using namespace std;
+
+
+static bool
+test_sql(const char* testname, const PreparedQuery& pq,
+		const char* expected, size_t params)
+{
+	if (pq.sql().compare(expected) != 0) {
+		cerr << "TEST " << testname << " failed: got '" << pq.sql() <<
+				"', expected '" << expected << "'!" << endl;
+		return false;
+	}
+	else if (pq.param_count() != params) {
+		cerr << "TEST " << testname << " failed: " << pq.param_count() <<
+				" params, expected " << params << '!' << endl;
+		return false;
+	}
+	else {
+		return true;
+	}
+}
+
+
+static bool
+test_names()
+{
+	PreparedQuery pq(0,
+			"update stock set num = %1:num where item = %0q:item", false);
+	if (pq.param_num("item") != 0 || pq.param_num("num") != 1) {
+		cerr << "TEST names failed: bad name to number mapping!" << endl;
+		return false;
+	}
+	pq.bind("num", 42).bind("item", "Hotdog Buns");
+	pq.bind(0, Null<string>(null)).bind(1, sql_tinyint(3));
+	if (pq.param_num("bogus") != -1) {
+		cerr << "TEST names failed: unknown name not reported!" << endl;
+		return false;
+	}
+	return true;
+}
+
+
+static bool
+test_exceptions()
+{
+	PreparedQuery pq(0, "select * from stock where num > %0", true);
+
+	try {
+		pq.bind(1, 5);
+		cerr << "TEST exceptions failed: no throw on bad index!" << endl;
+		return false;
+	}
+	catch (const BadIndex&) {
+	}
+
+	try {
+		pq.bind("nope", 5);
+		cerr << "TEST exceptions failed: no throw on bad name!" << endl;
+		return false;
+	}
+	catch (const BadFieldName&) {
+	}
+
+	try {
+		pq.execute(5);
+		cerr << "TEST exceptions failed: executed without a connection!" <<
+				endl;
+		return false;
+	}
+	catch (const ObjectNotInitialized&) {
+	}
+
+	return true;
+}
+
+
+int
+main()
+{
+	try {
+		Query q(0, false, "insert into t values (%0q, %1:num, %0Q, "
+				"'%%')");	// don't pass 0 for conn in real code
+		q.parse();
+		PreparedQuery fromq(q);
+		Query raw(0, false, "select %0");
+		PreparedQuery fromraw(raw);
+
+		if (	test_sql("plain", PreparedQuery(0, "select 1", false),
+						"select 1", 0) &&
+				test_sql("positional", PreparedQuery(0,
+						"select * from t where a = %0 and b = %1q", false),
+						"select * from t where a = ? and b = ?", 2) &&
+				test_sql("sparse", PreparedQuery(0,
+						"select %2 from t", false),
+						"select ? from t", 3) &&
+				test_sql("fromquery", fromq,
+						"insert into t values (?, ?, ?, '%')", 2) &&
+				test_sql("unparsed", fromraw, "select ?", 1) &&
+				test_names() &&
+				test_exceptions()) {
+			return 0;
+		}
+	}
+	catch (const mysqlpp::Exception& e) {
+		cerr << "PreparedQuery test failed: " << e.what() << endl;
+	}
+	catch (const std::exception& e) {
+		cerr << "Unexpected exception: " << e.what() << endl;
+	}
+
+	return 1;
+}
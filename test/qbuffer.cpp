@@ -0,0 +1,222 @@
+/***********************************************************************
+ test/qbuffer.cpp - Tests the QueryBuffer class's direct append paths,
+ 	and its behavior as the stream buffer behind Query.
+
+ Copyright (c) 2009 by Educational Technology Resources, Inc.
+ Others may also hold copyrights on code in this file.  See the
+ CREDITS.txt file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#include <mysql++.h>
+
+#include <iostream>
+#include <limits>
+
+#include <locale.h>
+
+using namespace mysqlpp;
+using namespace std;
+
+
+static bool
+test(const char* testname, const QueryBuffer& qb, const char* expected)
+{
+	if (qb.str().compare(expected) == 0) {
+		return true;
+	}
+	else {
+		cerr << "TEST " << testname << " failed: got '" << qb.str() <<
+				"', expected '" << expected << "'!" << endl;
+		return false;
+	}
+}
+
+
+static bool
+test_numbers()
+{
+	QueryBuffer qb;
+	qb.append(0);
+	qb.append(',');
+	qb.append(-42);
+	qb.append(',');
+	qb.append(numeric_limits<longlong>::min());
+	qb.append(',');
+	qb.append(numeric_limits<ulonglong>::max());
+	qb.append(',');
+	qb.append(2.5);
+	qb.append(',');
+	qb.append(0.1f);
+	qb.append(',');
+	qb.append(numeric_limits<double>::infinity());
+	return test("numbers", qb, "0,-42,-9223372036854775808,"
+			"18446744073709551615,2.5,0.100000001,0");
+}
+
+
+static bool
+test_locale()
+{
+	// Only runs where one of these locales, which use a decimal comma,
+	// is installed
+	const char* names[] = {
+		"de_DE.UTF-8", "de_DE.utf8", "de_DE", "fr_FR.UTF-8", "fr_FR"
+	};
+	bool found = false;
+	for (size_t i = 0; !found && (i < sizeof(names) / sizeof(names[0]));
+			++i) {
+		found = setlocale(LC_NUMERIC, names[i]) != 0;
+	}
+	if (!found) {
+		return true;
+	}
+
+	QueryBuffer qb;
+	qb.append(1.5);
+	qb.append(',');
+	qb.append(-0.25f);
+	setlocale(LC_NUMERIC, "C");
+	return test("decimal comma locale", qb, "1.5,-0.25");
+}
+
+
+static bool
+test_dates()
+{
+	QueryBuffer qb;
+	qb.append(Date(2009, 2, 4));
+	qb.append(' ');
+	qb.append(Time(7, 8, 9));
+	qb.append('|');
+	qb.append(DateTime(999, 12, 31, 23, 59, 0));
+	qb.append('|');
+	DateTime now;
+	qb.append(now);
+	return test("dates", qb, "2009-02-04 07:08:09|0999-12-31 23:59:00|NOW()");
+}
+
+
+static bool
+test_escaped()
+{
+	QueryBuffer qb;
+	qb.append('\'');
+	size_t n = qb.append_escaped("it's", 4, 0);
+	qb.append('\'');
+	if (n != 5) {
+		cerr << "TEST escaped failed: added " << n << " chars!" << endl;
+		return false;
+	}
+	return test("escaped", qb, "'it\\'s'");
+}
+
+
+static bool
+test_hex()
+{
+	QueryBuffer qb;
+	qb.append_hex("", 0);
+	if (!test("empty hex", qb, "X''")) {
+		return false;
+	}
+
+	// Long enough to go through the 16-byte blocks and the tail, with
+	// every byte value so all digit pairs get checked.
+	std::string in, expected("X'");
+	static const char digits[] = "0123456789ABCDEF";
+	for (int i = 0; i < 256 + 7; ++i) {
+		unsigned char c = static_cast<unsigned char>(i * 7 + 3);
+		in += char(c);
+		expected += digits[c >> 4];
+		expected += digits[c & 0x0F];
+	}
+	expected += '\'';
+	qb.clear();
+	qb.append_hex(in.data(), in.length());
+	return test("hex", qb, expected.c_str());
+}
+
+
+static bool
+test_reuse()
+{
+	QueryBuffer qb;
+	qb.reserve(1000);
+	size_t cap = qb.capacity();
+	const char* p = qb.data();
+	for (int i = 0; i < 100; ++i) {
+		qb.append("0123456789", 10);
+	}
+	qb.clear();
+	qb.append("x", 1);
+	if (qb.capacity() != cap || qb.data() != p) {
+		cerr << "TEST reuse failed: buffer reallocated!" << endl;
+		return false;
+	}
+	return test("reuse", qb, "x");
+}
+
+
+static bool
+test_query()
+{
+	Query q(0, false, "select ");	// don't pass 0 for conn in real code
+	q << "a, ";
+	q.buffer().append(42);
+	q << " from t";
+	if (!test("query mixed", q.buffer(), "select a, 42 from t")) {
+		return false;
+	}
+
+	q.seekp(7);
+	q << '*';
+	if (!test("query seek", q.buffer(), "select *")) {
+		return false;
+	}
+
+	q.reset();
+	q << "select 1";
+	return test("query reset", q.buffer(), "select 1");
+}
+
+
+int
+main()
+{
+	try {
+		if (	test_numbers() &&
+				test_locale() &&
+				test_dates() &&
+				test_escaped() &&
+				test_hex() &&
+				test_reuse() &&
+				test_query()) {
+			return 0;
+		}
+	}
+	catch (const mysqlpp::Exception& e) {
+		cerr << "QueryBuffer test failed: " << e.what() << endl;
+	}
+	catch (const std::exception& e) {
+		cerr << "Unexpected exception: " << e.what() << endl;
+	}
+
+	return 1;
+}
@@ -64,6 +64,22 @@ test_plain(const char* testname, Query& q1, Query q2)
 }
 
 
+static bool
+test_defaults(const char* testname, Query& q, const char* expected)
+{
+	string s = q.str();
+	if (s.compare(expected) == 0) {
+		return true;
+	}
+	else {
+		std::cerr << "TEST " << testname << " failed: " <<
+				"got '" << s << "', expected '" << expected << "'!" <<
+				std::endl;
+		return false;
+	}
+}
+
+
 int
 main()
 {
@@ -82,12 +98,26 @@ main()
 		Query copy5(orig3);
 		Query copy6(0); copy6 = orig3;
 
+		// Separately-parsed queries with the same text share a compiled
+		// template; make sure that doesn't leak state between them.
+		Query sibling(0, false, "template %0 test");
+		sibling.parse();
+		Query named1(0, false, "template %0:what test");
+		named1.parse();
+		named1.template_defaults["what"] = "query";
+		Query named2(0, false, "template %0:what test");
+		named2.parse();
+		named2.template_defaults["what"] = "other";
+
 		if (	test_plain("1a", orig1, copy1) &&
 				test_plain("1b", orig1, copy2) &&
 				test_plain("2a", orig2, copy3) &&
 				test_plain("2b", orig2, copy4) &&
 				test_parm("3a", orig3, copy5, "query") &&
-				test_parm("3b", orig3, copy6, "query")) {
+				test_parm("3b", orig3, copy6, "query") &&
+				test_parm("4a", orig3, sibling, "query") &&
+				test_defaults("4b", named1, "template query test") &&
+				test_defaults("4c", named2, "template other test")) {
 			return 0;
 		}
 	}
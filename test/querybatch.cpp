@@ -0,0 +1,138 @@
+/***********************************************************************
+ test/querybatch.cpp - Tests the way QueryBatch builds its statement
+	list and splits it into packets.  The sending side needs a server,
+	so it's exercised by the examples instead.
+
+ Copyright (c) 2009 by Educational Technology Resources, Inc.
+ Others may also hold copyrights on code in this file.  See the
+ CREDITS.txt file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#include <mysql++.h>
+
+#include <iostream>
+
+using namespace mysqlpp;
+using namespace std;
+
+
+static bool
+test_packets(const char* testname, const QueryBatch& b, size_t expected)
+{
+	size_t n = b.packet_count();
+	if (n == expected) {
+		return true;
+	}
+	else {
+		cerr << "TEST " << testname << " failed: " << n <<
+				" packets, expected " << expected << '!' << endl;
+		return false;
+	}
+}
+
+
+static bool
+test_split()
+{
+	QueryBatch b(0);	// don't pass 0 for conn in real code
+	if (!test_packets("empty", b, 0)) {
+		return false;
+	}
+
+	// 10 statements of 100 bytes each, plus separators
+	string stmt(100, 'x');
+	for (int i = 0; i < 10; ++i) {
+		b.add(stmt);
+	}
+	if (!test_packets("unlimited", b, 1)) {
+		return false;
+	}
+
+	// 64 bytes of each packet are held back for protocol overhead, so
+	// this leaves room for exactly three statements and their
+	// separators.
+	b.max_packet(64 + 302);
+	if (!test_packets("three per packet", b, 4)) {
+		return false;
+	}
+	b.max_packet(64 + 301);
+	if (!test_packets("two per packet", b, 5)) {
+		return false;
+	}
+
+	// An oversized statement goes in a packet of its own
+	b.add(string(1000, 'y'));
+	b.add(stmt);
+	if (!test_packets("oversized", b, 7)) {
+		return false;
+	}
+
+	// Trailing semicolons and whitespace are dropped, so these fit
+	// three to a packet just as above
+	b.clear();
+	b.max_packet(64 + 302);
+	for (int i = 0; i < 5; ++i) {
+		b.add(stmt + "; ;\n");
+	}
+	b.add((stmt + ";").c_str());
+	return test_packets("trailing semicolons", b, 2);
+}
+
+
+static bool
+test_add_query()
+{
+	QueryBatch b(0);
+	Query q(0, false, "select %0:x");
+	q.parse();
+	q.template_defaults["x"] = 1;
+	b.add(q);
+	SQLQueryParms p;
+	p << 2;
+	b.add(q, p);
+	b.add(q);
+
+	if (b.size() != 3) {
+		cerr << "TEST add query failed: " << b.size() <<
+				" statements, expected 3!" << endl;
+		return false;
+	}
+	b.clear();
+	return b.empty();
+}
+
+
+int
+main()
+{
+	try {
+		if (test_split() && test_add_query()) {
+			return 0;
+		}
+	}
+	catch (const mysqlpp::Exception& e) {
+		cerr << "QueryBatch test failed: " << e.what() << endl;
+	}
+	catch (const std::exception& e) {
+		cerr << "Unexpected exception: " << e.what() << endl;
+	}
+
+	return 1;
+}
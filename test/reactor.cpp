@@ -0,0 +1,109 @@
+/***********************************************************************
+ test/reactor.cpp - Tests that Reactor and the non-blocking operations
+	report failures properly.  Actually running queries needs a server,
+	so that's left to the async example.
+
+ Copyright (c) 2009 by Educational Technology Resources, Inc.
+ Others may also hold copyrights on code in this file.  See the
+ CREDITS.txt file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#include <mysql++.h>
+
+#include <iostream>
+
+using namespace std;
+
+#if defined(MYSQLPP_HAVE_REACTOR)
+// Counts calls to finished(), so we can check the reactor made them
+template <class Op>
+class Counted : public Op
+{
+public:
+	Counted(mysqlpp::Connection* c) : Op(c), calls(0) { }
+	Counted(mysqlpp::Connection* c, const char* server) :
+			Op(c, 0, server), calls(0) { }
+	void finished() { ++calls; }
+	int calls;
+};
+
+
+static bool
+test_unconnected_query()
+{
+	mysqlpp::Connection conn(false);
+	Counted<mysqlpp::AsyncQuery> q(&conn);
+	if (q.start("SELECT 1") != mysqlpp::AsyncOperation::failed ||
+			q.error().empty()) {
+		cerr << "Query on unconnected Connection didn't fail!" << endl;
+		return false;
+	}
+
+	mysqlpp::Reactor reactor;
+	if (reactor.add(q) || (q.calls != 1) || reactor.pending()) {
+		cerr << "Reactor mishandled an already-failed operation!" << endl;
+		return false;
+	}
+	return true;
+}
+
+
+static bool
+test_refused_connect()
+{
+	// Nothing listens on port 1, so this fails, either right away or
+	// once the reactor sees the socket's error.
+	mysqlpp::Connection conn(false);
+	Counted<mysqlpp::AsyncConnect> ac(&conn, "127.0.0.1:1");
+
+	mysqlpp::Reactor reactor;
+	ac.start();
+	reactor.add(ac);
+	reactor.run();
+	if (ac.status() != mysqlpp::AsyncOperation::failed ||
+			(ac.calls != 1) || conn.connected()) {
+		cerr << "Connecting to a closed port didn't fail!" << endl;
+		return false;
+	}
+	return true;
+}
+#endif
+
+
+int
+main()
+{
+	try {
+#if defined(MYSQLPP_HAVE_REACTOR)
+		if (!test_unconnected_query() || !test_refused_connect()) {
+			return 1;
+		}
+#endif
+		return 0;
+	}
+	catch (const mysqlpp::Exception& e) {
+		cerr << "Reactor test failed: " << e.what() << endl;
+	}
+	catch (const std::exception& e) {
+		cerr << "Unexpected exception: " << e.what() << endl;
+	}
+
+	return 1;
+}
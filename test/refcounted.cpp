@@ -0,0 +1,204 @@
+/***********************************************************************
+ test/refcounted.cpp - Stress tests the atomic reference counts, by
+	having several QueryExecutor workers copy and drop pointers to
+	the same objects at once.  Worth running under a race detector,
+	such as GCC's or Clang's -fsanitize=thread, as well.
+
+ Copyright (c) 2009 by Educational Technology Resources, Inc.
+ Others may also hold copyrights on code in this file.  See the
+ CREDITS.txt file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#include <mysql++.h>
+
+#include <iostream>
+#include <vector>
+
+using namespace mysqlpp;
+using namespace std;
+
+static const unsigned int num_threads = 4;
+static const int copies = 100000;
+
+
+// Hands out unconnected Connection objects; the tasks don't use them
+class TestConnectionPool : public ConnectionPool
+{
+public:
+	~TestConnectionPool() { clear(); }
+	unsigned int max_idle_time() { return 60; }
+
+private:
+	Connection* create() { return new Connection(false); }
+	void destroy(Connection* cp) { delete cp; }
+};
+
+
+// Counts its own destruction, which must happen exactly once, after
+// every task is done with it
+static int destroyed = 0;
+
+struct Counted
+{
+	~Counted() { ++destroyed; }
+};
+
+typedef RefCountedPointer<Counted, RefCountedPointerDestroyer<Counted>,
+		RefCountedPointerAtomicCounter<Counted> > CountedPtr;
+
+// Counts the copies alive, since make_refcounted() copies its
+// argument into the block it makes
+static int live = 0;
+
+struct Tracked
+{
+	explicit Tracked(int v) : value(v) { ++live; }
+	Tracked(const Tracked& other) : value(other.value) { ++live; }
+	~Tracked() { --live; }
+
+	int value;
+};
+
+typedef RefCountedPointer<Tracked, RefCountedPointerInPlaceDestroyer<Tracked>,
+		RefCountedPointerAtomicCounter<Tracked,
+			RefCountedPointerBlockCounter<Tracked> > > TrackedPtr;
+
+class CountedOwner : public SQLBufferOwner
+{
+public:
+	~CountedOwner() { ++destroyed; }
+};
+
+
+// Copies the shared values over and over, checking that they stay
+// intact.  Each task waits until all have started, so they overlap.
+struct Copier
+{
+	typedef bool result_type;
+
+	Copier(CommitVote* start, const CountedPtr& counted,
+			const TrackedPtr& tracked, const vector<String>& row,
+			const RefCountedPointer<FieldNames>& names) :
+	start_(start),
+	counted_(counted),
+	tracked_(tracked),
+	row_(row),
+	names_(names)
+	{
+	}
+
+	bool operator()(Connection&) const
+	{
+		if (start_) {
+			start_->vote(true);
+		}
+
+		bool ok = true;
+		for (int i = 0; i < copies; ++i) {
+			CountedPtr c(counted_);
+			TrackedPtr t(tracked_);
+			RefCountedPointer<FieldNames> names(names_);
+			String first(row_[0]), second(row_[1]), third;
+			third = row_[2];
+			ok = ok && c && (t->value == 42) && (names->size() == 1) &&
+					(first == "Nuts") &&
+					(second.length() > SQLBuffer::inline_size) &&
+					(third == "Bolts");
+		}
+
+		vector<String> row(row_);
+		return ok && (row.size() == row_.size());
+	}
+
+	CommitVote* start_;
+	CountedPtr counted_;
+	TrackedPtr tracked_;
+	vector<String> row_;		// copies share the Strings' buffers
+	RefCountedPointer<FieldNames> names_;
+};
+
+
+static bool
+test_sharing(TestConnectionPool& pool)
+{
+	CountedPtr counted(new Counted);
+	TrackedPtr tracked = make_refcounted<TrackedPtr>(Tracked(42));
+
+	// A short value kept inline, a long one on the heap, and one
+	// pointing into an owner, as zero-copy results do
+	static const char owned[] = "Bolts";
+	vector<String> row;
+	row.push_back(String("Nuts"));
+	row.push_back(String("a value too long to keep inside the buffer"));
+	row.push_back(String(owned, sizeof(owned) - 1,
+			mysql_type_info::string_type, false,
+			RefCountedOwner(new CountedOwner)));
+
+	RefCountedPointer<FieldNames> names(new FieldNames);
+	names->push_back("item");
+
+	{
+		QueryExecutor executor(pool, num_threads, num_threads);
+		CommitVote start(num_threads);
+		CommitVote* gate = executor.threads() ? &start : 0;
+		vector<Future<bool> > futures;
+		for (unsigned int i = 0; i < num_threads; ++i) {
+			futures.push_back(executor.submit(Copier(gate, counted,
+					tracked, row, names)));
+		}
+		for (unsigned int i = 0; i < num_threads; ++i) {
+			if (!futures[i].get()) {
+				cerr << "Worker " << i << " saw a damaged value!" << endl;
+				return false;
+			}
+		}
+	}
+
+	if ((destroyed != 0) || (live != 1)) {
+		cerr << "A shared object was destroyed while still in use!" <<
+				endl;
+		return false;
+	}
+
+	counted = 0;
+	tracked = 0;
+	row.clear();
+	if ((destroyed != 2) || (live != 0)) {
+		cerr << (destroyed + 1 - live) << " shared objects destroyed, "
+				"not 3!" << endl;
+		return false;
+	}
+
+	return true;
+}
+
+
+int
+main()
+{
+	try {
+		TestConnectionPool pool;
+		return test_sharing(pool) ? 0 : 1;
+	}
+	catch (const Exception& e) {
+		cerr << "Unexpected MySQL++ exception: " << e.what() << endl;
+		return 1;
+	}
+}
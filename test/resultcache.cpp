@@ -0,0 +1,330 @@
+/***********************************************************************
+ test/resultcache.cpp - Tests ResultCache's eviction and invalidation
+	rules, and that Query uses a connection's cache.
+
+ Copyright (c) 2009 by Educational Technology Resources, Inc.
+ Others may also hold copyrights on code in this file.  See the
+ CREDITS.txt file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#include <mysql++.h>
+
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#if defined(MYSQLPP_PLATFORM_WINDOWS)
+#	define SLEEP(n) Sleep((n) * 1000)
+#else
+#	include <unistd.h>
+#	define SLEEP(n) sleep(n)
+#endif
+
+using namespace mysqlpp;
+using namespace std;
+
+
+// Check that tables() finds the expected names, given as one
+// space-separated string
+static bool
+test_tables(const char* stmt, const char* expected)
+{
+	vector<string> names;
+	ResultCache::tables(stmt, strlen(stmt), names);
+
+	string got;
+	for (size_t i = 0; i < names.size(); ++i) {
+		got += (i ? " " : "") + names[i];
+	}
+	if (got != expected) {
+		cerr << "Found tables '" << got << "' in '" << stmt <<
+				"', expected '" << expected << "'!" << endl;
+		return false;
+	}
+	return true;
+}
+
+
+static bool
+test_parsing()
+{
+	if (!test_tables("SELECT * FROM `stock` WHERE item = 'from x'",
+					"stock") ||
+			!test_tables("select a.x from db.A a, `b` as bb "
+					"left join C on a.x = c.x", "a b c") ||
+			!test_tables("SELECT * FROM (SELECT id FROM t1) AS s "
+					"WHERE id IN (SELECT id FROM t2)", "t1 t2") ||
+			!test_tables("INSERT INTO `stock` (`item`) VALUES ('Nuts') "
+					"ON DUPLICATE KEY UPDATE `num` = 1", "stock") ||
+			!test_tables("REPLACE LOW_PRIORITY t VALUES (1)", "t") ||
+			!test_tables("UPDATE IGNORE t1, t2 SET t1.a = t2.a", "t1 t2") ||
+			!test_tables("DELETE t1 FROM t1 JOIN t2 USING (id)",
+					"t1 t2") ||
+			!test_tables("TRUNCATE TABLE `odd``name`", "odd`name") ||
+			!test_tables("CREATE TABLE IF NOT EXISTS t (a INT)", "t") ||
+			!test_tables("RENAME TABLE a TO b, db.c TO d", "a b c d") ||
+			!test_tables("ALTER TABLE t RENAME AS u", "t u") ||
+			!test_tables("SELECT * FROM a; DELETE FROM b", "a b") ||
+			!test_tables("SELECT 1 + 1 -- FROM nothing", "")) {
+		return false;
+	}
+
+	const char* yes[] = {
+		"SELECT * FROM stock",
+		"  (select * from a) UNION (select * from b)",
+		"SELECT * FROM stock WHERE item = ';';",
+	};
+	const char* no[] = {
+		"INSERT INTO stock VALUES (1)",
+		"SELECT * FROM stock FOR UPDATE",
+		"SELECT * FROM stock LOCK IN SHARE MODE",
+		"SELECT SQL_NO_CACHE * FROM stock",
+		"SELECT * INTO OUTFILE '/tmp/x' FROM stock",
+		"SHOW TABLES",
+		"SELECT * FROM stock; DELETE FROM stock",
+	};
+	for (size_t i = 0; i < sizeof(yes) / sizeof(yes[0]); ++i) {
+		if (!ResultCache::cacheable(yes[i], strlen(yes[i]))) {
+			cerr << "'" << yes[i] << "' isn't cacheable!" << endl;
+			return false;
+		}
+	}
+	for (size_t i = 0; i < sizeof(no) / sizeof(no[0]); ++i) {
+		if (ResultCache::cacheable(no[i], strlen(no[i]))) {
+			cerr << "'" << no[i] << "' is cacheable!" << endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+static bool
+test_lru()
+{
+	// Size the cache to hold two of these results
+	const string q1("SELECT * FROM t WHERE id = 1");
+	const string q2("SELECT * FROM t WHERE id = 2");
+	const string q3("SELECT * FROM t WHERE id = 3");
+	StoreQueryResult empty;
+	size_t one;
+	{
+		ResultCache sizer;
+		sizer.insert(q1, empty);
+		one = sizer.bytes();
+	}
+
+	ResultCache cache(one * 2 + one / 2, 0);
+	cache.insert(q1, empty);
+	cache.insert(q2, empty);
+	if (!cache.find(q1)) {		// q2 is now the least recently used
+		cerr << "Cache lost a result with room to spare!" << endl;
+		return false;
+	}
+	cache.insert(q3, empty);
+	if (cache.find(q2) || !cache.find(q1) || !cache.find(q3)) {
+		cerr << "Cache didn't push out the least recently used "
+				"result!" << endl;
+		return false;
+	}
+	if ((cache.entries() != 2) || (cache.evictions() != 1) ||
+			(cache.hits() != 3) || (cache.misses() != 1)) {
+		cerr << "Cache has " << cache.entries() << " entries, " <<
+				cache.evictions() << " evictions, " << cache.hits() <<
+				" hits and " << cache.misses() << " misses, not 2, 1, "
+				"3 and 1!" << endl;
+		return false;
+	}
+
+	ResultCache tiny(one / 2, 0);
+	tiny.insert(q1, empty);
+	if (tiny.entries() != 0) {
+		cerr << "Cache kept a result bigger than its budget!" << endl;
+		return false;
+	}
+
+	return true;
+}
+
+
+static bool
+test_invalidation()
+{
+	StoreQueryResult empty;
+	ResultCache cache;
+	cache.insert("SELECT * FROM `stock` WHERE num > 5", empty);
+	cache.insert("SELECT * FROM a JOIN b ON a.id = b.id", empty);
+	cache.insert("SELECT * FROM c", empty);
+
+	const char* update = "UPDATE stock SET num = 0";
+	cache.invalidate(update, strlen(update));
+	const char* select = "SELECT * FROM a";
+	cache.invalidate(select, strlen(select));
+	if ((cache.entries() != 2) || (cache.invalidations() != 1)) {
+		cerr << "UPDATE didn't drop exactly the one result!" << endl;
+		return false;
+	}
+
+	cache.invalidate("mydb.B");
+	if ((cache.entries() != 1) || !cache.find("SELECT * FROM c")) {
+		cerr << "Invalidating B didn't drop exactly the join!" << endl;
+		return false;
+	}
+
+	// Every statement in a multi-statement string counts
+	const char* multi = "SELECT * FROM a; DELETE FROM c";
+	cache.invalidate(multi, strlen(multi));
+	if (cache.entries() != 0) {
+		cerr << "DELETE after a SELECT didn't drop its result!" << endl;
+		return false;
+	}
+
+	// These can change tables the cache can't see, so drop everything
+	const char* flushers[] = { "ROLLBACK", "commit", "CALL restock()" };
+	for (size_t i = 0; i < sizeof(flushers) / sizeof(flushers[0]); ++i) {
+		cache.insert("SELECT * FROM c", empty);
+		cache.invalidate(flushers[i], strlen(flushers[i]));
+		if ((cache.entries() != 0) || (cache.bytes() != 0)) {
+			cerr << flushers[i] << " didn't empty the cache!" << endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+// A result read while a table it depends on changed mustn't be kept
+static bool
+test_snapshot()
+{
+	StoreQueryResult empty;
+	ResultCache cache;
+	ResultCache::Snapshot stock = cache.snapshot("SELECT * FROM stock");
+	ResultCache::Snapshot other = cache.snapshot("SELECT * FROM other");
+	ResultCache::Snapshot later;
+
+	const char* update = "UPDATE stock SET num = 0";
+	cache.invalidate(update, strlen(update));
+	cache.insert(stock, empty);
+	cache.insert(other, empty);
+	if (cache.find("SELECT * FROM stock") ||
+			!cache.find("SELECT * FROM other")) {
+		cerr << "Cache kept a result read before its table changed, "
+				"or refused one whose table didn't!" << endl;
+		return false;
+	}
+
+	later = cache.snapshot("SELECT * FROM stock");
+	cache.insert(later, empty);
+	if (!cache.find("SELECT * FROM stock")) {
+		cerr << "Cache refused a result read after the change!" << endl;
+		return false;
+	}
+
+	later = cache.snapshot("SELECT * FROM stock");
+	cache.clear();
+	cache.insert(later, empty);
+	if (cache.entries() != 0) {
+		cerr << "Cache kept a result read before clear()!" << endl;
+		return false;
+	}
+
+	return true;
+}
+
+
+static bool
+test_ttl()
+{
+	ResultCache cache(1024 * 1024, 1);
+	cache.insert("SELECT * FROM t", StoreQueryResult());
+	if (!cache.find("SELECT * FROM t")) {
+		cerr << "Fresh result isn't in the cache!" << endl;
+		return false;
+	}
+
+	SLEEP(2);
+	if (cache.find("SELECT * FROM t") || (cache.evictions() != 1)) {
+		cerr << "Result outlived its time to live!" << endl;
+		return false;
+	}
+
+	return true;
+}
+
+
+static bool
+test_query()
+{
+	// The connection isn't connected, so only a cached result can
+	// make store() succeed
+	ResultCache cache;
+	Connection conn(false);
+	conn.set_result_cache(&cache);
+	cache.insert("SELECT * FROM stock", StoreQueryResult());
+
+	Query q = conn.query("SELECT * FROM stock");
+	q.store();
+	if (!q || (cache.hits() != 1)) {
+		cerr << "Query didn't use the connection's cache!" << endl;
+		return false;
+	}
+	if (!q.str().empty()) {
+		cerr << "Query didn't reset after a cache hit!" << endl;
+		return false;
+	}
+
+	q << "DELETE FROM stock";
+	q.execute();
+	if (cache.entries() != 0) {
+		cerr << "DELETE through the connection didn't invalidate the "
+				"cached result!" << endl;
+		return false;
+	}
+
+	// Statements sent other ways count, too
+	cache.insert("SELECT * FROM stock", StoreQueryResult());
+	QueryBatch batch(&conn, false);
+	batch.add("DELETE FROM stock");
+	batch.execute();
+	if (cache.entries() != 0) {
+		cerr << "DELETE through a QueryBatch didn't invalidate the "
+				"cached result!" << endl;
+		return false;
+	}
+
+	return true;
+}
+
+
+int
+main()
+{
+	try {
+		return test_parsing() && test_lru() && test_invalidation() &&
+				test_snapshot() && test_query() && test_ttl() ? 0 : 1;
+	}
+	catch (const Exception& e) {
+		cerr << "Unexpected MySQL++ exception: " << e.what() << endl;
+		return 1;
+	}
+}
@@ -132,6 +132,31 @@ test_int_conversion(const mysqlpp::String& s, bool throw_expected)
 }
 
 
+// Checks values on both sides of the size SQLBuffer keeps inline,
+// including embedded null characters
+static bool
+test_lengths()
+{
+	const size_t limit = mysqlpp::SQLBuffer::inline_size;
+	for (size_t len = limit - 3; len <= limit + 1; ++len) {
+		std::string value(len, 'x');
+		value[len / 2] = '\0';
+		mysqlpp::String s(value.data(), len);
+		mysqlpp::String copy(s);
+		s = "";
+		if ((copy.length() != len) || (copy.c_str()[len] != '\0') ||
+				(std::string(copy.data(), copy.length()) != value) ||
+				!s.empty()) {
+			std::cerr << "String of length " << len << " didn't "
+					"survive!" << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
 // Checks that String's null comparison methods work right
 static bool
 test_null()
@@ -182,6 +207,63 @@ test_numeric(const mysqlpp::String& s, int value)
 }
 
 
+// Stands in for a C API result set that Strings point into
+class TestOwner : public mysqlpp::SQLBufferOwner
+{
+public:
+	explicit TestOwner(bool& alive) : alive_(alive) { alive_ = true; }
+	~TestOwner() { alive_ = false; }
+
+private:
+	bool& alive_;
+};
+
+
+// Checks that Strings built on an owner's memory share it instead of
+// copying it, and keep the owner alive as long as they need it
+static bool
+test_owner()
+{
+	static const char row[] = "42\0Nuts";
+	bool alive = false;
+	mysqlpp::String kept;
+	{
+		mysqlpp::RefCountedOwner owner(new TestOwner(alive));
+		mysqlpp::String num(row, 2, typeid(int), false, owner);
+		mysqlpp::String item(row + 3, 4,
+				mysqlpp::mysql_type_info::string_type, false, owner);
+		if ((num.data() != row) || (int(num) != 42) || (item != "Nuts")) {
+			std::cerr << "Owned String doesn't point at its data!" <<
+					std::endl;
+			return false;
+		}
+
+		kept = item;
+		item = "Bolts";
+		if ((item.data() == row + 3) || (kept.data() != row + 3)) {
+			std::cerr << "Assigning to an owned String didn't copy!" <<
+					std::endl;
+			return false;
+		}
+	}
+
+	if (!alive || (kept != "Nuts")) {
+		std::cerr << "Owner died while a String still pointed into "
+				"it!" << std::endl;
+		return false;
+	}
+
+	kept = mysqlpp::String();
+	if (alive) {
+		std::cerr << "Owner outlived the last String pointing into "
+				"it!" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+
 static bool
 test_quote_q(const mysqlpp::String& s, bool expected)
 {
@@ -284,7 +366,9 @@ main(int, char* argv[])
 		failures += test_int_conversion(intable1, false) == false;
 		failures += test_int_conversion(intable2, false) == false;
 		failures += test_int_conversion(nonint, true) == false;
+		failures += test_lengths() == false;
 		failures += test_null() == false;
+		failures += test_owner() == false;
 		failures += test_string_equality(definit, empty) == false;
 		failures += test_string_equality(empty, definit) == false;
 		failures += test_string_equality(definit, "") == false;
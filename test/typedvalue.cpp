@@ -0,0 +1,177 @@
+/***********************************************************************
+ test/typedvalue.cpp - Tests the conversions TypedValue offers from the
+ 	binary protocol's native value forms to C++ types.
+
+ Copyright (c) 2009 by Educational Technology Resources, Inc.
+ Others may also hold copyrights on code in this file.  See the
+ CREDITS.txt file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#include <mysql++.h>
+
+#include <iostream>
+
+#include <string.h>
+
+using namespace mysqlpp;
+using namespace std;
+
+
+template <class T>
+static bool
+test(const char* testname, const T& got, const T& expected)
+{
+	if (got == expected) {
+		return true;
+	}
+	else {
+		cerr << "TEST " << testname << " failed: got '" << got <<
+				"', expected '" << expected << "'!" << endl;
+		return false;
+	}
+}
+
+
+template <class T>
+static bool
+test_throws(const char* testname, const TypedValue& tv, T)
+{
+	try {
+		T t = tv.conv(T());
+		cerr << "TEST " << testname << " failed: got '" << t <<
+				"', expected BadConversion!" << endl;
+		return false;
+	}
+	catch (const BadConversion&) {
+		return true;
+	}
+}
+
+
+static bool
+test_numbers()
+{
+	TypedValue i(longlong(-42)), u(longlong(-1), true), d(2.5), w(4.0);
+	return
+			test("signed int", int(i), -42) &&
+			test("signed str", i.str(), string("-42")) &&
+			test("unsigned ull", ulonglong(u), ~ulonglong(0)) &&
+			test("double", double(d), 2.5) &&
+			test("double float", float(d), 2.5f) &&
+			test("whole double int", int(w), 4) &&
+			test_throws("fractional double int", d, int()) &&
+			test("bool", bool(TypedValue(longlong(1))), true);
+}
+
+
+static bool
+test_overflow()
+{
+	TypedValue big(longlong(256)), neg(longlong(-1)), top(longlong(-1), true),
+			huge(1e19), edge(9223372036854775808.0), nan(0.0 / 0.0);
+	return
+			test("uchar max", int(TypedValue(longlong(255)).conv(
+					(unsigned char)0)), 255) &&
+			test_throws("uchar overflow", big, (unsigned char)0) &&
+			test_throws("schar overflow", big, (signed char)0) &&
+			test_throws("negative unsigned", neg, 0U) &&
+			test_throws("negative ulonglong", neg, ulonglong(0)) &&
+			test_throws("unsigned longlong", top, longlong(0)) &&
+			test_throws("unsigned int", top, 0U) &&
+			test_throws("huge double longlong", huge, longlong(0)) &&
+			test_throws("huge double int", huge, 0) &&
+			test("huge double ulonglong", huge.conv(ulonglong(0)),
+					ulonglong(10000000000000000000ULL)) &&
+			test_throws("2^63 longlong", edge, longlong(0)) &&
+			test_throws("NaN int", nan, 0) &&
+			test_throws("huge double float", TypedValue(1e300), 0.0f);
+}
+
+
+static bool
+test_times()
+{
+	MYSQL_TIME mt;
+	memset(&mt, 0, sizeof(mt));
+	mt.year = 2009;
+	mt.month = 2;
+	mt.day = 14;
+	mt.hour = 13;
+	mt.minute = 5;
+	mt.second = 9;
+	mt.time_type = MYSQL_TIMESTAMP_DATETIME;
+	TypedValue dt(mt);
+
+	mt.year = mt.month = mt.day = 0;
+	mt.hour = 123;
+	mt.time_type = MYSQL_TIMESTAMP_TIME;
+	TypedValue t(mt);
+	mt.hour = 300;
+	TypedValue t300(mt);
+
+	return
+			test("datetime", dt.conv(DateTime()), DateTime(2009, 2, 14, 13, 5, 9)) &&
+			test("datetime date", dt.conv(Date()), Date(2009, 2, 14)) &&
+			test("datetime time", dt.conv(Time()), Time(13, 5, 9)) &&
+			test("datetime str", dt.str(), string("2009-02-14 13:05:09")) &&
+			test("long time str", t.str(), string("123:05:09")) &&
+			test_throws("time as date", t, Date()) &&
+			test_throws("300-hour time", t300, Time()) &&
+			test_throws("datetime as int", dt, int());
+}
+
+
+static bool
+test_text_and_null()
+{
+	TypedValue dec("12.50", 5), s("abc", 3), n;
+	Null<int> ni = n;
+	Null<double> nd = dec;
+	return
+			test("decimal double", double(dec), 12.5) &&
+			test_throws("decimal int", dec, int()) &&
+			test("text str", string(s), string("abc")) &&
+			test("text String", s.text().compare("abc"), 0) &&
+			test("null is_null", n.is_null(), true) &&
+			test("null str", n.str(), string("NULL")) &&
+			test("null to Null<>", ni.is_null, true) &&
+			test("text to Null<>", nd.data, 12.5) &&
+			test_throws("null int", n, int());
+}
+
+
+int
+main()
+{
+	try {
+		if (test_numbers() && test_overflow() && test_times() &&
+				test_text_and_null()) {
+			return 0;
+		}
+	}
+	catch (const mysqlpp::Exception& e) {
+		cerr << "TypedValue test failed: " << e.what() << endl;
+	}
+	catch (const std::exception& e) {
+		cerr << "Unexpected exception: " << e.what() << endl;
+	}
+
+	return 1;
+}
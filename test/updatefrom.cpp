@@ -0,0 +1,230 @@
+/***********************************************************************
+ test/updatefrom.cpp - Tests the multi-row UPDATE statements built for
+	Query::updatefrom(), the insert policies' view of them, and the
+	empty-range cases of it and deletefrom().
+
+ Copyright (c) 2009 by Educational Technology Resources, Inc.
+ Others may also hold copyrights on code in this file.  See the
+ CREDITS.txt file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#include <mysql++.h>
+#define MYSQLPP_ALLOW_SSQLS_V1	// suppress deprecation warning
+#include <ssqls.h>
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+using namespace mysqlpp;
+using namespace std;
+
+// The first field is the key
+sql_create_3(item, 1, 3,
+	sql_int,				id,
+	sql_varchar,			name,
+	sql_int,				count)
+
+
+static bool
+check(const char* what, const string& got, const string& expected)
+{
+	if (got == expected) {
+		return true;
+	}
+	else {
+		cerr << what << " built '" << got << "', expected '" <<
+				expected << "'!" << endl;
+		return false;
+	}
+}
+
+
+// Add an item to the batch the way Query::updatefrom() does
+static void
+add(UpdateBatch& batch, const item& it)
+{
+	// Quoting only happens when writing to an SQLStream
+	SQLStream key(0);
+	key << it.value_list(sql_use_compare);
+
+	vector<string> values;
+	for (size_t i = 0; i < batch.columns(); ++i) {
+		SQLStream value(0);
+		value << it.value_list(batch.mask(i));
+		values.push_back(value.str());
+	}
+
+	size_t before = batch.size();
+	size_t row_size = batch.row_size(key.str(), values);
+	batch.add(key.str(), values);
+	if (before && (batch.size() != before + row_size)) {
+		cerr << "Batch grew by " << (batch.size() - before) <<
+				" bytes, not the " << row_size << " promised!" << endl;
+		throw 1;
+	}
+}
+
+
+static bool
+check_batch(const char* what, const UpdateBatch& batch,
+		const string& expected)
+{
+	if (batch.size() != batch.str().size()) {
+		cerr << what << " claims to be " << batch.size() <<
+				" bytes, but is " << batch.str().size() << '!' << endl;
+		return false;
+	}
+	return check(what, batch.str(), expected);
+}
+
+
+// Fill batches the way Query::updatefrom() does, without running them,
+// and check that AdaptiveInsertPolicy sees each new statement start:
+// it only times what it sent when told the statement size is 0.
+static bool
+test_adaptive(const string& fields, const string& keys)
+{
+	UpdateBatch batch("item", fields, keys, 0);
+	Query::AdaptiveInsertPolicy<> policy(0, 0.05, 2);
+	int sent = 0;
+	for (int i = 0; i < 5; ++i) {
+		item it(i, "many", i);
+		SQLStream key(0);
+		key << it.value_list(sql_use_compare);
+		vector<string> values;
+		for (size_t j = 0; j < batch.columns(); ++j) {
+			SQLStream value(0);
+			value << it.value_list(batch.mask(j));
+			values.push_back(value.str());
+		}
+
+		const size_t row_size = batch.row_size(key.str(), values);
+		if (!policy.can_add(int(batch.size()), it, row_size)) {
+			++sent;
+			batch.clear();
+			if (!policy.can_add(int(batch.size()), it, row_size)) {
+				cerr << "Adaptive policy refused a row in an empty "
+						"UPDATE!" << endl;
+				return false;
+			}
+		}
+		batch.add(key.str(), values);
+	}
+
+	if (sent == 0) {
+		cerr << "Adaptive policy never turned a row away!" << endl;
+		return false;
+	}
+	else if (policy.rows_per_second() <= 0) {
+		cerr << "Adaptive policy never timed an UPDATE!" << endl;
+		return false;
+	}
+	return true;
+}
+
+
+int
+main()
+{
+	try {
+		ostringstream fields, keys;
+		item it(1, "one", 5);
+		fields << it.field_list();
+		keys << it.field_list(sql_use_compare);
+
+		// Default is to set all the non-key columns
+		UpdateBatch all("item", fields.str(), keys.str(), 0);
+		if ((all.columns() != 2) || !all.empty() || (all.size() != 0)) {
+			cerr << "New batch has " << all.columns() <<
+					" columns and size " << all.size() << '!' << endl;
+			return 1;
+		}
+		add(all, it);
+		if (!check_batch("One row", all,
+				"UPDATE `item` SET "
+				"`name` = CASE WHEN (`id`) = (1) THEN 'one' "
+				"ELSE `name` END,"
+				"`count` = CASE WHEN (`id`) = (1) THEN 5 "
+				"ELSE `count` END "
+				"WHERE (`id`) IN ((1))")) {
+			return 1;
+		}
+		add(all, item(2, "two", 7));
+		if (!check_batch("Two rows", all,
+				"UPDATE `item` SET "
+				"`name` = CASE WHEN (`id`) = (1) THEN 'one' "
+				"WHEN (`id`) = (2) THEN 'two' ELSE `name` END,"
+				"`count` = CASE WHEN (`id`) = (1) THEN 5 "
+				"WHEN (`id`) = (2) THEN 7 ELSE `count` END "
+				"WHERE (`id`) IN ((1),(2))")) {
+			return 1;
+		}
+
+		all.clear();
+		add(all, item(3, "three", 9));
+		if (!check_batch("Row after clear()", all,
+				"UPDATE `item` SET "
+				"`name` = CASE WHEN (`id`) = (3) THEN 'three' "
+				"ELSE `name` END,"
+				"`count` = CASE WHEN (`id`) = (3) THEN 9 "
+				"ELSE `count` END "
+				"WHERE (`id`) IN ((3))")) {
+			return 1;
+		}
+
+		// Restrict it to a single column
+		ostringstream count;
+		count << it.field_list(item_count);
+		const string count_text(count.str());
+		UpdateBatch one("item", fields.str(), keys.str(), &count_text);
+		add(one, it);
+		if (!check_batch("One column", one,
+				"UPDATE `item` SET "
+				"`count` = CASE WHEN (`id`) = (1) THEN 5 "
+				"ELSE `count` END "
+				"WHERE (`id`) IN ((1))")) {
+			return 1;
+		}
+
+		// Empty ranges build nothing, so they're safe without a
+		// connection
+		Query q(0);		// don't pass 0 for conn parameter in real code
+		vector<item> none;
+		Query::MaxPacketInsertPolicy<> policy(1000);
+		if (!check("updatefrom() of nothing",
+					q.updatefrom(none.begin(), none.end(), policy).str(),
+					"") ||
+				!check("deletefrom() of nothing",
+					q.deletefrom(none.begin(), none.end(), policy).str(),
+					"")) {
+			return 1;
+		}
+
+		return test_adaptive(fields.str(), keys.str()) ? 0 : 1;
+	}
+	catch (const Exception& e) {
+		cerr << "Unexpected MySQL++ exception: " << e.what() << endl;
+		return 1;
+	}
+	catch (int) {
+		return 1;
+	}
+}
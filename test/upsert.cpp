@@ -0,0 +1,132 @@
+/***********************************************************************
+ test/upsert.cpp - Tests the INSERT ... ON DUPLICATE KEY UPDATE
+	statements Query::upsert() builds from SSQLS objects.
+
+ Copyright (c) 2009 by Educational Technology Resources, Inc.
+ Others may also hold copyrights on code in this file.  See the
+ CREDITS.txt file in the top directory of the distribution for details.
+
+ This file is part of MySQL++.
+
+ MySQL++ is free software; you can redistribute it and/or modify it
+ under the terms of the GNU Lesser General Public License as published
+ by the Free Software Foundation; either version 2.1 of the License, or
+ (at your option) any later version.
+
+ MySQL++ is distributed in the hope that it will be useful, but WITHOUT
+ ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with MySQL++; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ USA
+***********************************************************************/
+
+#include <mysql++.h>
+#define MYSQLPP_ALLOW_SSQLS_V1	// suppress deprecation warning
+#include <ssqls.h>
+
+#include <iostream>
+#include <vector>
+
+using namespace mysqlpp;
+using namespace std;
+
+sql_create_3(item, 1, 3,
+	sql_int,				id,
+	sql_varchar,			name,
+	sql_int,				count)
+
+
+static bool
+check(const char* what, const string& got, const string& expected)
+{
+	if (got == expected) {
+		return true;
+	}
+	else {
+		cerr << what << " built '" << got << "', expected '" <<
+				expected << "'!" << endl;
+		return false;
+	}
+}
+
+
+int
+main()
+{
+	try {
+		Query q(0);		// don't pass 0 for conn parameter in real code
+		item it(1, "one", 5);
+
+		if (!check("upsert()", q.upsert(it).str(),
+				"INSERT INTO `item` (`id`,`name`,`count`) "
+				"VALUES (1,'one',5) ON DUPLICATE KEY UPDATE "
+				"`id`=VALUES(`id`),`name`=VALUES(`name`),"
+				"`count`=VALUES(`count`)")) {
+			return 1;
+		}
+
+		if (!check("upsert() with update list",
+				q.upsert(it, it.field_list(item_count)).str(),
+				"INSERT INTO `item` (`id`,`name`,`count`) "
+				"VALUES (1,'one',5) ON DUPLICATE KEY UPDATE "
+				"`count`=VALUES(`count`)")) {
+			return 1;
+		}
+
+		vector<bool> cols(3, false);
+		cols[1] = true;
+		cols[2] = true;
+		if (!check("upsert() with column mask",
+				q.upsert(it, it.field_list(&cols)).str(),
+				"INSERT INTO `item` (`id`,`name`,`count`) "
+				"VALUES (1,'one',5) ON DUPLICATE KEY UPDATE "
+				"`name`=VALUES(`name`),`count`=VALUES(`count`)")) {
+			return 1;
+		}
+
+		// The SQL syntax needs at least one column to update, so an
+		// empty list sets a column to itself
+		vector<bool> nocols(3, false);
+		if (!check("upsert() with empty update list",
+				q.upsert(it, it.field_list(&nocols)).str(),
+				"INSERT INTO `item` (`id`,`name`,`count`) "
+				"VALUES (1,'one',5) ON DUPLICATE KEY UPDATE "
+				"`id`=`id`")) {
+			return 1;
+		}
+
+		// Each row of a multi-row statement refers to its own values
+		vector<item> items;
+		items.push_back(it);
+		items.push_back(item(2, "two", 6));
+		items.push_back(item(3, "three", 7));
+		if (!check("upsert() of several rows",
+				q.upsert(items.begin(), items.end(),
+					it.field_list(item_name, item_count)).str(),
+				"INSERT INTO `item` (`id`,`name`,`count`) "
+				"VALUES (1,'one',5),(2,'two',6),(3,'three',7) "
+				"ON DUPLICATE KEY UPDATE "
+				"`name`=VALUES(`name`),`count`=VALUES(`count`)")) {
+			return 1;
+		}
+
+		// An empty range sends nothing
+		vector<item> none;
+		Query::RowCountInsertPolicy<NoTransaction> policy(10);
+		if (!check("upsertfrom() on no rows",
+				q.upsertfrom(none.begin(), none.end(), policy).str(),
+				"")) {
+			return 1;
+		}
+
+		return 0;
+	}
+	catch (const Exception& e) {
+		cerr << "Unexpected MySQL++ exception: " << e.what() << endl;
+		return 1;
+	}
+}